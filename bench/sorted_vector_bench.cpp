@@ -0,0 +1,495 @@
+/*
+ * Замеры производительности cim::sorted_vector
+ *
+ * push, replace, erase, find..., merge, merge_replace, repair и проход
+ * итератором для int, 64-байтной структуры и std::string на размерах
+ * от 1e2 до 1e8 (размеры больше CIM_SORTED_VECTOR_BENCH_MAX_BYTES
+ * пропускаются). Для сравнения те же операции измеряются у std::multiset,
+ * отсортированного std::vector с std::lower_bound и std::flat_multiset
+ * (если он есть в стандартной библиотеке).
+ *
+ * Программа собирается дважды: sorted_vector_bench и
+ * sorted_vector_bench_memmove (с CIM_SORTED_VECTOR_USE_MEMMOVE). При
+ * побитовом перемещении std::string не замеряется: строки libstdc++
+ * с коротким буфером хранят указатель на самих себя.
+ *
+ * Изменяющие замеры (push, erase, merge...) работают с копией общего
+ * набора данных и восстанавливают её вне замера.
+ *
+ */
+
+#include "sorted_vector.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#if defined(__has_include)
+# if __has_include(<flat_set>)
+#  include <flat_set>
+# endif
+#endif
+
+#ifndef CIM_SORTED_VECTOR_BENCH_MAX_BYTES
+# define CIM_SORTED_VECTOR_BENCH_MAX_BYTES (1ULL << 30)
+#endif
+  //Наибольший объём набора данных: размеры,
+  //элементы которых не помещаются в него,
+  //не замеряются.
+
+namespace {
+
+//***Element types***
+
+struct pod64
+{
+  uint64_t  key;
+  char      payload[56];
+
+  bool operator==(const pod64 &p) const { return key == p.key; }
+  bool operator<(const pod64 &p) const  { return key < p.key; }
+  bool operator>(const pod64 &p) const  { return key > p.key; }
+};
+
+static_assert(sizeof(pod64) == 64, "pod64 must be 64 bytes");
+
+template <class T>
+  T make_value(std::mt19937_64 &g);
+
+template <>
+  int make_value <int> (std::mt19937_64 &g)
+{
+  return (int)(g() >> 33);
+}
+
+template <>
+  pod64 make_value <pod64> (std::mt19937_64 &g)
+{
+  pod64 p;
+  p.key = g();
+  memset(p.payload, (int)(p.key & 0xff), sizeof(p.payload));
+  return p;
+}
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+template <>
+  std::string make_value <std::string> (std::mt19937_64 &g)
+{
+  //8-24 символа: часть строк помещается в короткий буфер
+  uint64_t r = g();
+  std::string s(8 + r % 17, 'a');
+  for (size_t i = 0; i < s.size(); i++, r = (r >> 5) | (r << 59))
+    s[i] = (char)('a' + r % 26);
+  return s;
+}
+#endif
+
+inline size_t weight(int t)                 { return (size_t)t; }
+inline size_t weight(const pod64 &t)        { return (size_t)t.key; }
+inline size_t weight(const std::string &t)  { return t.size(); }
+
+//***Datasets***
+
+template <class T>
+  std::vector <T> random_values(size_t n, uint64_t seed)
+{
+  std::mt19937_64 g(seed);
+  std::vector <T> v;
+  v.reserve(n);
+  for (size_t i = 0; i < n; i++)
+    v.push_back(make_value <T> (g));
+  return v;
+}
+
+template <class T>
+  const cim::sorted_vector <T> &dataset(size_t n)
+{
+  //Хранится только последний набор: замеры одного
+  //семейства идут подряд по возрастанию размера
+  static size_t cached = (size_t)-1;
+  static cim::sorted_vector <T> sv;
+  if (cached != n) {
+    sv.clear();
+    sv.shrink_to_fit();
+    sv = cim::sorted_vector <T> (random_values <T> (n, n));
+    cached = n;
+  }
+  return sv;
+}
+
+template <class T>
+  std::vector <T> sample_keys(const cim::sorted_vector <T> &sv, size_t count, uint64_t seed)
+{
+  //Ключи элементов с попарно различными позициями,
+  //в случайном порядке
+  std::mt19937_64 g(seed);
+  size_t n = sv.size();
+  count = std::min(count, n);
+  size_t stride = n / count;
+  std::vector <T> keys;
+  keys.reserve(count);
+  for (size_t i = 0; i < count; i++)
+    keys.push_back(sv[i * stride + g() % stride]);
+  std::shuffle(keys.begin(), keys.end(), g);
+  return keys;
+}
+
+size_t batch_size(size_t n)
+{
+  //Число изменений копии набора до её восстановления
+  return std::max((size_t)1, std::min(n / 2, (size_t)1024));
+}
+
+const size_t query_mask = 4095;
+
+template <class T>
+  void sizes(benchmark::internal::Benchmark *b)
+{
+  for (uint64_t n = 100; n <= 100000000; n *= 10)
+    if (n * sizeof(T) <= CIM_SORTED_VECTOR_BENCH_MAX_BYTES)
+      b->Arg((int64_t)n);
+}
+
+//***sorted_vector***
+
+template <class T>
+  void bm_push(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  std::vector <T> keys = random_values <T> (batch_size(base.size()), 1);
+  cim::sorted_vector <T> sv(base);
+  size_t i = 0;
+  for (auto _ : state) {
+    sv.push(keys[i]);
+    if (++i == keys.size()) {
+      state.PauseTiming();
+      sv = base;
+      i = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_replace(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  std::vector <T> keys = sample_keys(base, query_mask + 1, 2);
+  cim::sorted_vector <T> sv(base);
+  size_t i = 0;
+  for (auto _ : state)
+    sv.replace(keys[i++ % keys.size()]);
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_erase(benchmark::State &state)
+{
+  //Удаление по ключу: find и erase
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  std::vector <T> keys = sample_keys(base, batch_size(base.size()), 3);
+  cim::sorted_vector <T> sv(base);
+  const cim::sorted_vector <T> &c = sv;
+  size_t i = 0;
+  for (auto _ : state) {
+    sv.erase(c.find(keys[i]));
+    if (++i == keys.size()) {
+      state.PauseTiming();
+      sv = base;
+      i = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+enum find_kind
+{
+  kind_find,
+  kind_first,
+  kind_last,
+  kind_floor,
+  kind_ceil,
+  kind_interpolated
+};
+
+template <class T, find_kind Kind>
+  void bm_find(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  std::vector <T> keys = sample_keys(base, query_mask + 1, 4);
+  size_t i = 0;
+  for (auto _ : state) {
+    const T &k = keys[i++ % keys.size()];
+    switch (Kind) {
+      case kind_find:         benchmark::DoNotOptimize(base.find(k));              break;
+      case kind_first:        benchmark::DoNotOptimize(base.find_first(k));        break;
+      case kind_last:         benchmark::DoNotOptimize(base.find_last(k));         break;
+      case kind_floor:        benchmark::DoNotOptimize(base.find_floor(k));        break;
+      case kind_ceil:         benchmark::DoNotOptimize(base.find_ceil(k));         break;
+      case kind_interpolated: benchmark::DoNotOptimize(base.find_interpolated(k)); break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_merge(benchmark::State &state)
+{
+  //Слияние с вектором в 10 раз меньшего размера
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  std::vector <T> extra = random_values <T> (std::max((size_t)1, base.size() / 10), 5);
+  cim::sorted_vector <T> sv;
+  for (auto _ : state) {
+    state.PauseTiming();
+    sv = base;
+    state.ResumeTiming();
+    sv.merge(extra);
+  }
+  state.SetItemsProcessed(state.iterations() * extra.size());
+}
+
+template <class T>
+  void bm_merge_replace(benchmark::State &state)
+{
+  //Половина добавляемых элементов заменяет имеющиеся
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  size_t m = std::max((size_t)2, std::min(base.size() / 100, (size_t)1000));
+  std::vector <T> extra = random_values <T> (m / 2, 6);
+  std::vector <T> hits = sample_keys(base, m - m / 2, 7);
+  extra.insert(extra.end(), hits.begin(), hits.end());
+  cim::sorted_vector <T> sv;
+  for (auto _ : state) {
+    state.PauseTiming();
+    sv = base;
+    state.ResumeTiming();
+    sv.merge_replace(extra);
+  }
+  state.SetItemsProcessed(state.iterations() * extra.size());
+}
+
+template <class T>
+  void bm_repair(benchmark::State &state)
+{
+  //Изменение одного элемента и восстановление порядка сдвигом
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  std::vector <T> values = random_values <T> (query_mask + 1, 8);
+  std::mt19937_64 g(9);
+  std::vector <size_t> pos(query_mask + 1);
+  for (size_t &p : pos)
+    p = g() % base.size();
+  cim::sorted_vector <T> sv(base);
+  size_t i = 0;
+  for (auto _ : state) {
+    sv[pos[i & query_mask]] = values[i & query_mask];
+    sv.repair();
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_iterate(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &base = dataset <T> (state.range(0));
+  for (auto _ : state) {
+    size_t sum = 0;
+    for (const T &t : base)
+      sum += weight(t);
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * base.size());
+}
+
+//***Baselines***
+
+template <class T>
+  void bm_std_multiset_insert(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::multiset <T> base(data.begin(), data.end());
+  std::vector <T> keys = random_values <T> (batch_size(data.size()), 1);
+  std::multiset <T> s(base);
+  size_t i = 0;
+  for (auto _ : state) {
+    s.insert(keys[i]);
+    if (++i == keys.size()) {
+      state.PauseTiming();
+      s = base;
+      i = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_std_multiset_erase(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::multiset <T> base(data.begin(), data.end());
+  std::vector <T> keys = sample_keys(data, batch_size(data.size()), 3);
+  std::multiset <T> s(base);
+  size_t i = 0;
+  for (auto _ : state) {
+    s.erase(s.find(keys[i]));
+    if (++i == keys.size()) {
+      state.PauseTiming();
+      s = base;
+      i = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_std_multiset_find(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::multiset <T> s(data.begin(), data.end());
+  std::vector <T> keys = sample_keys(data, query_mask + 1, 4);
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(s.find(keys[i++ % keys.size()]));
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_std_multiset_iterate(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::multiset <T> s(data.begin(), data.end());
+  for (auto _ : state) {
+    size_t sum = 0;
+    for (const T &t : s)
+      sum += weight(t);
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * s.size());
+}
+
+template <class T>
+  void bm_std_vector_insert(benchmark::State &state)
+{
+  //Отсортированный std::vector: upper_bound и insert
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::vector <T> base(data.begin(), data.end());
+  std::vector <T> keys = random_values <T> (batch_size(data.size()), 1);
+  std::vector <T> v(base);
+  size_t i = 0;
+  for (auto _ : state) {
+    v.insert(std::upper_bound(v.begin(), v.end(), keys[i]), keys[i]);
+    if (++i == keys.size()) {
+      state.PauseTiming();
+      v = base;
+      i = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_std_lower_bound(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::vector <T> keys = sample_keys(data, query_mask + 1, 4);
+  const T *first = data.data();
+  const T *last = first + data.size();
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(std::lower_bound(first, last, keys[i++ % keys.size()]));
+  state.SetItemsProcessed(state.iterations());
+}
+
+#ifdef __cpp_lib_flat_set
+template <class T>
+  void bm_std_flat_multiset_insert(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::flat_multiset <T> base(std::sorted_equivalent, data.begin(), data.end());
+  std::vector <T> keys = random_values <T> (batch_size(data.size()), 1);
+  std::flat_multiset <T> s(base);
+  size_t i = 0;
+  for (auto _ : state) {
+    s.insert(keys[i]);
+    if (++i == keys.size()) {
+      state.PauseTiming();
+      s = base;
+      i = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+  void bm_std_flat_multiset_find(benchmark::State &state)
+{
+  const cim::sorted_vector <T> &data = dataset <T> (state.range(0));
+  std::flat_multiset <T> s(std::sorted_equivalent, data.begin(), data.end());
+  std::vector <T> keys = sample_keys(data, query_mask + 1, 4);
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(s.find(keys[i++ % keys.size()]));
+  state.SetItemsProcessed(state.iterations());
+}
+#endif // __cpp_lib_flat_set
+
+}
+
+//***Registration***
+
+#define CIM_BENCH(name, T) \
+  BENCHMARK_TEMPLATE(name, T)->Apply(sizes <T>)
+
+#define CIM_BENCH_FIND(T, kind) \
+  BENCHMARK_TEMPLATE(bm_find, T, kind)->Apply(sizes <T>)
+
+#ifdef __cpp_lib_flat_set
+# define CIM_BENCH_FLAT(T) \
+  CIM_BENCH(bm_std_flat_multiset_insert, T); \
+  CIM_BENCH(bm_std_flat_multiset_find, T)
+#else
+# define CIM_BENCH_FLAT(T) \
+  static_assert(true, "")
+#endif
+
+#define CIM_BENCH_TYPE(T) \
+  CIM_BENCH(bm_push, T); \
+  CIM_BENCH(bm_replace, T); \
+  CIM_BENCH(bm_erase, T); \
+  CIM_BENCH_FIND(T, kind_find); \
+  CIM_BENCH_FIND(T, kind_first); \
+  CIM_BENCH_FIND(T, kind_last); \
+  CIM_BENCH_FIND(T, kind_floor); \
+  CIM_BENCH_FIND(T, kind_ceil); \
+  CIM_BENCH(bm_merge, T); \
+  CIM_BENCH(bm_merge_replace, T); \
+  CIM_BENCH(bm_repair, T); \
+  CIM_BENCH(bm_iterate, T); \
+  CIM_BENCH(bm_std_multiset_insert, T); \
+  CIM_BENCH(bm_std_multiset_erase, T); \
+  CIM_BENCH(bm_std_multiset_find, T); \
+  CIM_BENCH(bm_std_multiset_iterate, T); \
+  CIM_BENCH(bm_std_vector_insert, T); \
+  CIM_BENCH(bm_std_lower_bound, T); \
+  CIM_BENCH_FLAT(T)
+
+CIM_BENCH_TYPE(int);
+CIM_BENCH_FIND(int, kind_interpolated);
+CIM_BENCH_TYPE(pod64);
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+CIM_BENCH_TYPE(std::string);
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,1082 @@
+/*
+ * Двоичный формат хранения cim::sorted_vector и шаблонный класс
+ * cim::mapped_sorted_vector
+ *
+ * - функции save_sorted_vector / load_sorted_vector записывают и читают
+ * экземпляры sorted_vector и sorted_vector_with_key с тривиально
+ * копируемым типом элемента в версионированном двоичном формате:
+ *
+ *   заголовок (sorted_vector_file_header);
+ *   элементы - образ хранилища без преобразований;
+ *   теневой массив ключей (только для sorted_vector_with_key) - ключи
+ *   элементов подряд, для поиска без обращения к самим элементам;
+ *   поисковый индекс - ключи (или элементы) на границах блоков по
+ *   index_stride элементов; по умолчанию блок занимает страницу памяти.
+ *
+ * Все части выровнены на 64 байта. Формат использует порядок байт и
+ * представление типов платформы, на которой записан, и не предназначен
+ * для переноса между архитектурами. Флаг упорядоченности сохраняет
+ * состояние экземпляра: испорченный экземпляр записывается как есть.
+ * load_sorted_vector читает упорядоченный файл без вызова std::sort.
+ * Файл, размер которого меньше указанного в заголовке, не читается и не
+ * отображается: load_sorted_vector и open возвращают false.
+ * open отклоняет и файл с невыровненными элементами или с поисковым
+ * индексом, не согласованным с числом элементов и размером элемента.
+ *
+ * Класс mapped_sorted_vector отображает такой файл в память (mmap, только
+ * POSIX) и предоставляет константную часть интерфейса sorted_vector
+ * (find..., operator[], at, front, back, data, cbegin / cend, range,
+ * count_range, rank) непосредственно над страничным кэшем - без разбора,
+ * копирования и сортировки при открытии. Поиск сначала выполняется по
+ * компактному поисковому индексу, затем внутри одного блока. Для
+ * неупорядоченного файла поиск, как и в sorted_vector, линейный, а
+ * find_floor / find_ceil возвращают -1.
+ *
+ * mapped_sorted_vector_with_key добавляет поиск по ключу (find, find_first,
+ * find_last, range, count_range, rank), использующий теневой массив ключей.
+ *
+ */
+
+#ifndef CIM_MAPPED_SORTED_VECTOR_H
+#define CIM_MAPPED_SORTED_VECTOR_H
+
+#include "sorted_vector.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cim{
+
+//***File format***
+
+#define CIM_SORTED_VECTOR_FILE_MAGIC    "CIMSVEC"
+#define CIM_SORTED_VECTOR_FILE_VERSION  1
+#define CIM_SORTED_VECTOR_FILE_ALIGN    64
+
+enum sorted_vector_file_flags
+{
+  sorted_vector_file_sorted = 1,
+  sorted_vector_file_keys   = 2,
+  sorted_vector_file_index  = 4
+};
+
+struct sorted_vector_file_header
+{
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  flags;
+  uint64_t  count;
+  uint32_t  element_size;
+  uint32_t  key_size;
+  uint64_t  data_offset;
+  uint64_t  key_offset;
+  uint64_t  index_offset;
+  uint64_t  index_count;
+  uint64_t  index_stride;
+};
+
+template <class T>
+  struct sorted_vector_file_identity
+{
+  const T &operator()(const T &t) const
+  {
+    return t;
+  }
+};
+
+template <class T, class Key>
+  struct sorted_vector_file_key
+{
+  const Key &operator()(const T &t) const
+  {
+    return t.CIM_KEYNAME;
+  }
+};
+
+inline uint64_t sorted_vector_file_align(
+  uint64_t offset)
+{
+  return (offset + CIM_SORTED_VECTOR_FILE_ALIGN - 1)
+    / CIM_SORTED_VECTOR_FILE_ALIGN * CIM_SORTED_VECTOR_FILE_ALIGN;
+}
+
+inline bool sorted_vector_file_pad(
+  FILE *f,
+  uint64_t offset)
+{
+  static const char zeros[CIM_SORTED_VECTOR_FILE_ALIGN] = {};
+  uint64_t n = sorted_vector_file_align(offset) - offset;
+  return fwrite(zeros, 1, n, f) == n;
+}
+
+inline bool sorted_vector_file_fits(
+  uint64_t offset,
+  uint64_t count,
+  uint64_t size,
+  uint64_t file_size)
+{
+  //offset + count * size <= file_size без переполнения
+  //(count и offset прочитаны из файла)
+  if (offset > file_size)
+    return false;
+  return (size == 0) || (count <= (file_size - offset) / size);
+}
+
+inline bool sorted_vector_file_index_valid(
+  const sorted_vector_file_header &h,
+  size_t element_size,
+  size_t element_align)
+{
+  //Индекс из блоков по index_stride элементов: записей
+  //не больше числа блоков. Без теневого массива ключей
+  //индекс состоит из элементов и читается как T
+  if (!(h.flags & sorted_vector_file_index))
+    return true;
+  if (  (h.index_count == 0)
+      ||(h.index_stride == 0)
+      ||(h.index_count > h.count / h.index_stride + (h.count % h.index_stride != 0)))
+    return false;
+  if (h.flags & sorted_vector_file_keys)
+    return true;
+  return (h.key_size == element_size)
+      && (h.index_offset % element_align == 0);
+}
+
+inline size_t sorted_vector_file_stride(
+  size_t index_stride,
+  size_t element_size)
+{
+  if (index_stride != 0)
+    return index_stride;
+  return (element_size < 4096) ? 4096 / element_size : 1;
+}
+
+template <class T, class K>
+  void sorted_vector_file_init(
+    sorted_vector_file_header &h,
+    size_t count,
+    bool sorted,
+    bool with_keys,
+    size_t index_stride)
+{
+  index_stride = sorted_vector_file_stride(index_stride, sizeof(T));
+  size_t index_count = (sorted && count > 0)
+    ? (count + index_stride - 1) / index_stride
+    : 0;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CIM_SORTED_VECTOR_FILE_MAGIC, sizeof(CIM_SORTED_VECTOR_FILE_MAGIC));
+  h.version = CIM_SORTED_VECTOR_FILE_VERSION;
+  h.flags = (sorted ? sorted_vector_file_sorted : 0)
+          | (with_keys ? sorted_vector_file_keys : 0)
+          | (index_count ? sorted_vector_file_index : 0);
+  h.count = count;
+  h.element_size = sizeof(T);
+  h.key_size = sizeof(K);
+  h.data_offset = sorted_vector_file_align(sizeof(h));
+  uint64_t end = h.data_offset + count * sizeof(T);
+  if (with_keys) {
+    h.key_offset = sorted_vector_file_align(end);
+    end = h.key_offset + count * sizeof(K);
+  }
+  if (index_count) {
+    h.index_offset = sorted_vector_file_align(end);
+    h.index_count = index_count;
+    h.index_stride = index_stride;
+  }
+}
+
+template <class T, class K, class Proj>
+  bool sorted_vector_file_write(
+    const char *path,
+    const T *data,
+    size_t count,
+    bool sorted,
+    bool with_keys,
+    size_t index_stride,
+    Proj proj)
+{
+  static_assert(
+    std::is_trivially_copyable <T>::value,
+    "sorted_vector file format requires trivially copyable elements");
+  static_assert(
+    std::is_trivially_copyable <K>::value,
+    "sorted_vector file format requires trivially copyable keys");
+
+  sorted_vector_file_header h;
+  sorted_vector_file_init <T, K> (h, count, sorted, with_keys, index_stride);
+  index_stride = h.index_stride;
+  size_t index_count = h.index_count;
+
+  FILE *f = fopen(path, "wb");
+  if (f == nullptr)
+    return false;
+
+  bool ok = (fwrite(&h, sizeof(h), 1, f) == 1)
+         && (sorted_vector_file_pad(f, sizeof(h)))
+         && (fwrite(data, sizeof(T), count, f) == count)
+         && (sorted_vector_file_pad(f, h.data_offset + count * sizeof(T)));
+
+  if (  (ok)
+      &&(with_keys)) {
+    for (size_t i = 0; (ok) && (i < count); i++)
+      ok = fwrite(&proj(data[i]), sizeof(K), 1, f) == 1;
+    ok = (ok) && (sorted_vector_file_pad(f, h.key_offset + count * sizeof(K)));
+  }
+
+  if (  (ok)
+      &&(index_count))
+    for (size_t i = 0; (ok) && (i < index_count); i++)
+      ok = fwrite(&proj(data[i * index_stride]), sizeof(K), 1, f) == 1;
+
+  if (fclose(f) != 0)
+    ok = false;
+  return ok;
+}
+
+template <class T>
+  bool save_sorted_vector(
+    const sorted_vector <T> &sv,
+    const char *path,
+    size_t index_stride = 0)
+{
+  return sorted_vector_file_write <T, T> (
+    path,
+    sv.data(),
+    sv.size(),
+    !sv.corrupted(),
+    false,
+    index_stride,
+    sorted_vector_file_identity <T>());
+}
+
+template <class T, class Key>
+  bool save_sorted_vector(
+    const sorted_vector_with_key <T, Key> &sv,
+    const char *path,
+    size_t index_stride = 0)
+{
+  return sorted_vector_file_write <T, Key> (
+    path,
+    sv.data(),
+    sv.size(),
+    !sv.corrupted(),
+    true,
+    index_stride,
+    sorted_vector_file_key <T, Key>());
+}
+
+template <class T>
+  bool load_sorted_vector(
+    const char *path,
+    sorted_vector <T> &sv)
+{
+  static_assert(
+    std::is_trivially_copyable <T>::value,
+    "sorted_vector file format requires trivially copyable elements");
+
+  FILE *f = fopen(path, "rb");
+  if (f == nullptr)
+    return false;
+
+  //Размер элементов проверяется по размеру файла до
+  //выделения памяти: испорченный заголовок не должен
+  //приводить к выделению count * sizeof(T) байт
+  struct stat st;
+  sorted_vector_file_header h;
+  bool ok = (fstat(fileno(f), &st) == 0)
+         && (fread(&h, sizeof(h), 1, f) == 1)
+         && (memcmp(h.magic, CIM_SORTED_VECTOR_FILE_MAGIC, sizeof(CIM_SORTED_VECTOR_FILE_MAGIC)) == 0)
+         && (h.version == CIM_SORTED_VECTOR_FILE_VERSION)
+         && (h.element_size == sizeof(T))
+         && (sorted_vector_file_fits(h.data_offset, h.count, sizeof(T), (uint64_t)st.st_size))
+         && (fseeko(f, (off_t)h.data_offset, SEEK_SET) == 0);
+
+  std::vector <T> v;
+  if (ok) {
+    v.resize((size_t)h.count);
+    ok = fread(v.data(), sizeof(T), v.size(), f) == v.size();
+  }
+  fclose(f);
+  if (!ok)
+    return false;
+
+  //Неупорядоченный файл сортируется самим sv, чтобы
+  //потомок (например, sorted_vector_with_key) применил
+  //собственный порядок
+  sv.assign_sorted(static_cast <std::vector <T> &&> (v));
+  if (!(h.flags & sorted_vector_file_sorted))
+    sv.sort();
+  return true;
+}
+
+//***Mapped sorted vector***
+
+template <class T>
+  class mapped_sorted_vector
+{
+  public:
+    typedef const T * const_iterator;
+
+    mapped_sorted_vector();
+    explicit mapped_sorted_vector(const char *path);
+    mapped_sorted_vector(mapped_sorted_vector <T> &&msv);
+    mapped_sorted_vector(const mapped_sorted_vector <T> &msv) = delete;
+
+    virtual ~mapped_sorted_vector();
+
+    mapped_sorted_vector <T> &operator=(mapped_sorted_vector <T> &&msv);
+    mapped_sorted_vector <T> &operator=(const mapped_sorted_vector <T> &msv) = delete;
+
+    bool open(const char *path);
+    void close();
+    bool is_open() const;
+
+    const T &at(size_t pos)         const;
+    const T &operator[](size_t pos) const;
+    const T &front()                const;
+    const T &back()                 const;
+    const T *data()                 const;
+
+    const_iterator begin()  const;
+    const_iterator cbegin() const;
+    const_iterator end()    const;
+    const_iterator cend()   const;
+
+    bool empty()      const;
+    size_t size()     const;
+    bool corrupted()  const;
+
+    size_t find(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_first(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)   const;
+    size_t find_floor(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_ceil(const T &t, size_t start_pos = 0, size_t end_pos = -1)   const;
+
+    sorted_vector_view <T> range(const T &lo, const T &hi)  const;
+    size_t count_range(const T &lo, const T &hi)             const;
+    size_t rank(const T &t)                                  const;
+
+  protected:
+    template <class K, class Proj>
+      size_t lower(const K &k, Proj proj, const K *index, size_t start_pos, size_t end_pos) const;
+    template <class K, class Proj>
+      size_t upper(const K &k, Proj proj, const K *index, size_t start_pos, size_t end_pos) const;
+    template <class K, class Proj>
+      size_t linear(const K &k, Proj proj, size_t start_pos, size_t end_pos, bool last) const;
+
+    const sorted_vector_file_header &header() const;
+    const void *section(uint64_t offset)      const;
+    const T *element_index()                  const;
+
+  private:
+    void    *_map       = nullptr;
+    size_t  _map_size   = 0;
+    const T *_data      = nullptr;
+    size_t  _size       = 0;
+    bool    _is_sorted  = false;
+};
+
+template <class T>
+  mapped_sorted_vector <T>::  mapped_sorted_vector()
+{}
+
+template <class T>
+  mapped_sorted_vector <T>::  mapped_sorted_vector(
+    const char *path)
+{
+  open(path);
+}
+
+template <class T>
+  mapped_sorted_vector <T>::  mapped_sorted_vector(
+    mapped_sorted_vector <T> &&msv)
+{
+  *this = static_cast <mapped_sorted_vector <T> &&> (msv);
+}
+
+template <class T>
+  mapped_sorted_vector <T>::  ~mapped_sorted_vector()
+{
+  close();
+}
+
+template <class T>
+  mapped_sorted_vector <T> &mapped_sorted_vector <T>::  operator=(
+    mapped_sorted_vector <T> &&msv)
+{
+  if (this == &msv)
+    return *this;
+
+  close();
+  _map = msv._map;
+  _map_size = msv._map_size;
+  _data = msv._data;
+  _size = msv._size;
+  _is_sorted = msv._is_sorted;
+
+  msv._map = nullptr;
+  msv._map_size = 0;
+  msv._data = nullptr;
+  msv._size = 0;
+  msv._is_sorted = false;
+
+  return *this;
+}
+
+template <class T>
+  bool mapped_sorted_vector <T>::  open(
+    const char *path)
+{
+  static_assert(
+    std::is_trivially_copyable <T>::value,
+    "sorted_vector file format requires trivially copyable elements");
+
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (  (fstat(fd, &st) != 0)
+      ||((size_t)st.st_size < sizeof(sorted_vector_file_header))) {
+    ::close(fd);
+    return false;
+  }
+
+  void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  const sorted_vector_file_header *h =
+    reinterpret_cast <const sorted_vector_file_header *> (map);
+
+  if (  (memcmp(h->magic, CIM_SORTED_VECTOR_FILE_MAGIC, sizeof(CIM_SORTED_VECTOR_FILE_MAGIC)) != 0)
+      ||(h->version != CIM_SORTED_VECTOR_FILE_VERSION)
+      ||(h->element_size != sizeof(T))
+      ||(!sorted_vector_file_fits(h->data_offset, h->count, sizeof(T), (uint64_t)st.st_size))
+      ||(!sorted_vector_file_fits(h->key_offset, h->count, h->key_size, (uint64_t)st.st_size))
+      ||(!sorted_vector_file_fits(h->index_offset, h->index_count, h->key_size, (uint64_t)st.st_size))
+      ||(h->data_offset % alignof(T) != 0)
+      ||(!sorted_vector_file_index_valid(*h, sizeof(T), alignof(T)))) {
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  _map = map;
+  _map_size = st.st_size;
+  _data = reinterpret_cast <const T *> (static_cast <const char *> (map) + h->data_offset);
+  _size = h->count;
+  _is_sorted = (h->flags & sorted_vector_file_sorted) != 0;
+  return true;
+}
+
+template <class T>
+  void mapped_sorted_vector <T>:: close()
+{
+  if (_map != nullptr)
+    munmap(_map, _map_size);
+  _map = nullptr;
+  _map_size = 0;
+  _data = nullptr;
+  _size = 0;
+  _is_sorted = false;
+}
+
+template <class T>
+  bool mapped_sorted_vector <T>:: is_open()
+  const
+{
+  return _map != nullptr;
+}
+
+template <class T>
+  const T &mapped_sorted_vector <T>:: at(
+    size_t pos)
+    const
+{
+  if (pos >= _size)
+    throw std::out_of_range("mapped_sorted_vector::at");
+  return _data[pos];
+}
+
+template <class T>
+  const T &mapped_sorted_vector <T>:: operator[](
+    size_t pos)
+    const
+{
+  return _data[pos];
+}
+
+template <class T>
+  const T &mapped_sorted_vector <T>:: front()
+  const
+{
+  return _data[0];
+}
+
+template <class T>
+  const T &mapped_sorted_vector <T>:: back()
+  const
+{
+  return _data[_size - 1];
+}
+
+template <class T>
+  const T *mapped_sorted_vector <T>:: data()
+  const
+{
+  return _data;
+}
+
+template <class T>
+  typename mapped_sorted_vector <T>::const_iterator mapped_sorted_vector <T>:: begin()
+  const
+{
+  return _data;
+}
+
+template <class T>
+  typename mapped_sorted_vector <T>::const_iterator mapped_sorted_vector <T>:: cbegin()
+  const
+{
+  return _data;
+}
+
+template <class T>
+  typename mapped_sorted_vector <T>::const_iterator mapped_sorted_vector <T>:: end()
+  const
+{
+  return _data + _size;
+}
+
+template <class T>
+  typename mapped_sorted_vector <T>::const_iterator mapped_sorted_vector <T>:: cend()
+  const
+{
+  return _data + _size;
+}
+
+template <class T>
+  bool mapped_sorted_vector <T>:: empty()
+  const
+{
+  return _size == 0;
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>:: size()
+  const
+{
+  return _size;
+}
+
+template <class T>
+  bool mapped_sorted_vector <T>:: corrupted()
+  const
+{
+  return !_is_sorted;
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>:: find(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  return find_first(t, start_pos, end_pos);
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>:: find_first(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  sorted_vector_file_identity <T> proj;
+  if (!_is_sorted)
+    return linear(t, proj, start_pos, end_pos, false);
+  const T *index = element_index();
+  size_t pos = lower(t, proj, index, start_pos, end_pos);
+  if (  (pos > end_pos)
+      ||(!(_data[pos] == t)))
+    return -1;
+  return pos;
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>:: find_last(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  sorted_vector_file_identity <T> proj;
+  if (!_is_sorted)
+    return linear(t, proj, start_pos, end_pos, true);
+  const T *index = element_index();
+  size_t pos = upper(t, proj, index, start_pos, end_pos);
+  if (  (pos == start_pos)
+      ||(!(_data[pos - 1] == t)))
+    return -1;
+  return pos - 1;
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>:: find_floor(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Семантика sorted_vector::find_floor: первый равный
+  //элемент, иначе наибольший меньший
+  if (  (_size == 0)
+      ||(!_is_sorted))
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  const T *index = element_index();
+  size_t pos = lower(t, sorted_vector_file_identity <T>(), index, start_pos, end_pos);
+  if (  (pos <= end_pos)
+      &&(_data[pos] == t))
+    return pos;
+  return (pos == start_pos) ? (size_t)-1 : pos - 1;
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>:: find_ceil(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Семантика sorted_vector::find_ceil: последний равный
+  //элемент, иначе наименьший больший
+  if (  (_size == 0)
+      ||(!_is_sorted))
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  const T *index = element_index();
+  size_t pos = upper(t, sorted_vector_file_identity <T>(), index, start_pos, end_pos);
+  if (  (pos > start_pos)
+      &&(_data[pos - 1] == t))
+    return pos - 1;
+  return (pos > end_pos) ? (size_t)-1 : pos;
+}
+
+template <class T>
+  sorted_vector_view <T> mapped_sorted_vector <T>::  range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (  (_size == 0)
+      ||(!_is_sorted)
+      ||(hi < lo))
+    return sorted_vector_view <T> ();
+  const T *index = element_index();
+  sorted_vector_file_identity <T> proj;
+  return sorted_vector_view <T> (
+    _data + lower(lo, proj, index, 0, _size - 1),
+    _data + upper(hi, proj, index, 0, _size - 1));
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>::  count_range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (!_is_sorted) {
+    size_t n = 0;
+    for (size_t i = 0; i < _size; i++)
+      if (  (!(_data[i] < lo))
+          &&(!(hi < _data[i])))
+        n++;
+    return n;
+  }
+  return range(lo, hi).size();
+}
+
+template <class T>
+  size_t mapped_sorted_vector <T>:: rank(
+    const T &t)
+    const
+{
+  if (_size == 0)
+    return 0;
+  if (!_is_sorted) {
+    size_t n = 0;
+    for (size_t i = 0; i < _size; i++)
+      if (_data[i] < t)
+        n++;
+    return n;
+  }
+  const T *index = element_index();
+  return lower(t, sorted_vector_file_identity <T>(), index, 0, _size - 1);
+}
+
+//***protected methods***
+
+template <class T>
+  template <class K, class Proj>
+  size_t mapped_sorted_vector <T>:: lower(
+    const K &k,
+    Proj proj,
+    const K *index,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Первая позиция в [start_pos, end_pos + 1], проекция
+  //которой не меньше k. При поиске по всему вектору
+  //окно сужается до одного блока поисковым индексом
+  size_t f = start_pos;
+  size_t l = end_pos + 1;
+  const sorted_vector_file_header &h = header();
+  if (  (index != nullptr)
+      &&(start_pos == 0)
+      &&(end_pos == _size - 1)) {
+    size_t b = std::lower_bound(index, index + h.index_count, k) - index;
+    if (b == 0)
+      return 0;
+    f = (b - 1) * h.index_stride + 1;
+    l = std::min(b * h.index_stride, _size);
+  }
+  while (f < l) {
+    size_t m = f + (l - f) / 2;
+    if (proj(_data[m]) < k)
+      f = m + 1;
+    else
+      l = m;
+  }
+  return f;
+}
+
+template <class T>
+  template <class K, class Proj>
+  size_t mapped_sorted_vector <T>:: upper(
+    const K &k,
+    Proj proj,
+    const K *index,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Первая позиция в [start_pos, end_pos + 1], проекция
+  //которой больше k
+  size_t f = start_pos;
+  size_t l = end_pos + 1;
+  const sorted_vector_file_header &h = header();
+  if (  (index != nullptr)
+      &&(start_pos == 0)
+      &&(end_pos == _size - 1)) {
+    size_t b = std::upper_bound(index, index + h.index_count, k) - index;
+    if (b == 0)
+      return 0;
+    f = (b - 1) * h.index_stride + 1;
+    l = std::min(b * h.index_stride, _size);
+  }
+  while (f < l) {
+    size_t m = f + (l - f) / 2;
+    if (k < proj(_data[m]))
+      l = m;
+    else
+      f = m + 1;
+  }
+  return f;
+}
+
+template <class T>
+  template <class K, class Proj>
+  size_t mapped_sorted_vector <T>:: linear(
+    const K &k,
+    Proj proj,
+    size_t start_pos,
+    size_t end_pos,
+    bool last)
+    const
+{
+  if (last) {
+    for (size_t i = end_pos + 1; i-- > start_pos;)
+      if (proj(_data[i]) == k)
+        return i;
+  } else {
+    for (size_t i = start_pos; i <= end_pos; i++)
+      if (proj(_data[i]) == k)
+        return i;
+  }
+  return -1;
+}
+
+template <class T>
+  const sorted_vector_file_header &mapped_sorted_vector <T>:: header()
+  const
+{
+  return *reinterpret_cast <const sorted_vector_file_header *> (_map);
+}
+
+template <class T>
+  const void *mapped_sorted_vector <T>:: section(
+    uint64_t offset)
+    const
+{
+  if (offset == 0)
+    return nullptr;
+  return static_cast <const char *> (_map) + offset;
+}
+
+template <class T>
+  const T *mapped_sorted_vector <T>:: element_index()
+  const
+{
+  //Поисковый индекс из элементов - только в файлах без
+  //теневого массива ключей; open проверил его размер
+  if (  (!(header().flags & sorted_vector_file_index))
+      ||(header().flags & sorted_vector_file_keys))
+    return nullptr;
+  return static_cast <const T *> (section(header().index_offset));
+}
+
+//***end mapped_sorted_vector***
+
+template <class T, class Key>
+  class mapped_sorted_vector_with_key : public mapped_sorted_vector <T>
+{
+  public:
+    mapped_sorted_vector_with_key();
+    explicit mapped_sorted_vector_with_key(const char *path);
+
+    size_t find(const Key &key, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_first(const Key &key, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_last(const Key &key, size_t start_pos = 0, size_t end_pos = -1)   const;
+
+    sorted_vector_view <T> range(const Key &lo, const Key &hi)  const;
+    size_t count_range(const Key &lo, const Key &hi)             const;
+    size_t rank(const Key &key)                                  const;
+
+    using mapped_sorted_vector <T>::find;
+    using mapped_sorted_vector <T>::find_first;
+    using mapped_sorted_vector <T>::find_last;
+    using mapped_sorted_vector <T>::range;
+    using mapped_sorted_vector <T>::count_range;
+    using mapped_sorted_vector <T>::rank;
+
+  private:
+    const Key *keys()   const;
+    const Key *index()  const;
+
+    size_t lower_key(const Key &key, size_t start_pos, size_t end_pos) const;
+    size_t upper_key(const Key &key, size_t start_pos, size_t end_pos) const;
+};
+
+template <class T, class Key>
+  mapped_sorted_vector_with_key <T, Key>::  mapped_sorted_vector_with_key()
+{}
+
+template <class T, class Key>
+  mapped_sorted_vector_with_key <T, Key>::  mapped_sorted_vector_with_key(
+    const char *path)
+    : mapped_sorted_vector <T> (path)
+{}
+
+template <class T, class Key>
+  size_t mapped_sorted_vector_with_key <T, Key>:: find(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  return find_first(key, start_pos, end_pos);
+}
+
+template <class T, class Key>
+  size_t mapped_sorted_vector_with_key <T, Key>:: find_first(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (this->empty())
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+  if (this->corrupted())
+    return this->linear(key, sorted_vector_file_key <T, Key>(), start_pos, end_pos, false);
+  size_t pos = lower_key(key, start_pos, end_pos);
+  if (  (pos > end_pos)
+      ||(!((*this)[pos].CIM_KEYNAME == key)))
+    return -1;
+  return pos;
+}
+
+template <class T, class Key>
+  size_t mapped_sorted_vector_with_key <T, Key>:: find_last(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (this->empty())
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+  if (this->corrupted())
+    return this->linear(key, sorted_vector_file_key <T, Key>(), start_pos, end_pos, true);
+  size_t pos = upper_key(key, start_pos, end_pos);
+  if (  (pos == start_pos)
+      ||(!((*this)[pos - 1].CIM_KEYNAME == key)))
+    return -1;
+  return pos - 1;
+}
+
+template <class T, class Key>
+  sorted_vector_view <T> mapped_sorted_vector_with_key <T, Key>::  range(
+    const Key &lo,
+    const Key &hi)
+    const
+{
+  if (  (this->empty())
+      ||(this->corrupted())
+      ||(hi < lo))
+    return sorted_vector_view <T> ();
+  return sorted_vector_view <T> (
+    this->data() + lower_key(lo, 0, this->size() - 1),
+    this->data() + upper_key(hi, 0, this->size() - 1));
+}
+
+template <class T, class Key>
+  size_t mapped_sorted_vector_with_key <T, Key>::  count_range(
+    const Key &lo,
+    const Key &hi)
+    const
+{
+  if (this->corrupted()) {
+    size_t n = 0;
+    for (size_t i = 0; i < this->size(); i++)
+      if (  (!((*this)[i].CIM_KEYNAME < lo))
+          &&(!(hi < (*this)[i].CIM_KEYNAME)))
+        n++;
+    return n;
+  }
+  return range(lo, hi).size();
+}
+
+template <class T, class Key>
+  size_t mapped_sorted_vector_with_key <T, Key>:: rank(
+    const Key &key)
+    const
+{
+  if (this->empty())
+    return 0;
+  if (this->corrupted()) {
+    size_t n = 0;
+    for (size_t i = 0; i < this->size(); i++)
+      if ((*this)[i].CIM_KEYNAME < key)
+        n++;
+    return n;
+  }
+  return lower_key(key, 0, this->size() - 1);
+}
+
+template <class T, class Key>
+  const Key *mapped_sorted_vector_with_key <T, Key>:: keys()
+  const
+{
+  //Теневой массив ключей есть только в файлах,
+  //записанных из sorted_vector_with_key с тем же Key
+  if (  (!(this->header().flags & sorted_vector_file_keys))
+      ||(this->header().key_size != sizeof(Key))
+      ||(this->header().key_offset % alignof(Key) != 0))
+    return nullptr;
+  return static_cast <const Key *> (this->section(this->header().key_offset));
+}
+
+template <class T, class Key>
+  const Key *mapped_sorted_vector_with_key <T, Key>:: index()
+  const
+{
+  if (  (keys() == nullptr)
+      ||(!(this->header().flags & sorted_vector_file_index))
+      ||(this->header().index_offset % alignof(Key) != 0))
+    return nullptr;
+  return static_cast <const Key *> (this->section(this->header().index_offset));
+}
+
+template <class T, class Key>
+  size_t mapped_sorted_vector_with_key <T, Key>:: lower_key(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  const Key *k = keys();
+  if (k == nullptr)
+    return this->lower(key, sorted_vector_file_key <T, Key>(), (const Key *)nullptr, start_pos, end_pos);
+
+  const sorted_vector_file_header &h = this->header();
+  const Key *idx = index();
+  const Key *f = k + start_pos;
+  const Key *l = k + end_pos + 1;
+  if (  (idx != nullptr)
+      &&(start_pos == 0)
+      &&(end_pos == this->size() - 1)) {
+    size_t b = std::lower_bound(idx, idx + h.index_count, key) - idx;
+    if (b == 0)
+      return 0;
+    f = k + (b - 1) * h.index_stride + 1;
+    l = k + std::min((size_t)(b * h.index_stride), this->size());
+  }
+  return std::lower_bound(f, l, key) - k;
+}
+
+template <class T, class Key>
+  size_t mapped_sorted_vector_with_key <T, Key>:: upper_key(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  const Key *k = keys();
+  if (k == nullptr)
+    return this->upper(key, sorted_vector_file_key <T, Key>(), (const Key *)nullptr, start_pos, end_pos);
+
+  const sorted_vector_file_header &h = this->header();
+  const Key *idx = index();
+  const Key *f = k + start_pos;
+  const Key *l = k + end_pos + 1;
+  if (  (idx != nullptr)
+      &&(start_pos == 0)
+      &&(end_pos == this->size() - 1)) {
+    size_t b = std::upper_bound(idx, idx + h.index_count, key) - idx;
+    if (b == 0)
+      return 0;
+    f = k + (b - 1) * h.index_stride + 1;
+    l = k + std::min((size_t)(b * h.index_stride), this->size());
+  }
+  return std::upper_bound(f, l, key) - k;
+}
+
+}
+
+#endif // CIM_MAPPED_SORTED_VECTOR_H
@@ -26,15 +26,54 @@
  * возвращает упорядоченность сдвигом части вектора и перестановкой
  * изменённого элемента в требуемое порядком место. Если упорядоченность
  * (потенциально) нарушена из-за большего числа элементов, запускается
- * std::sort. Для большего быстродействия рекомендуется приостанавливать
- * автоматическое восстановление упорядоченности методом suspend_autorepair
- * перед массированными добавлением или изменением элементов, после чего
- * возобновлять автоматическую сортировку вызовом метода resume_autorepair.
+ * полная сортировка (sort). Для большего быстродействия рекомендуется
+ * приостанавливать автоматическое восстановление упорядоченности методом
+ * suspend_autorepair перед массированными добавлением или изменением
+ * элементов, после чего возобновлять автоматическую сортировку вызовом
+ * метода resume_autorepair.
+ *
+ * sort выбирает алгоритм по данным: хранилище из не более чем
+ * CIM_SORTED_VECTOR_SORT_RUNS естественных серий (упорядоченный префикс и
+ * добавленные элементы после merge, убывающие серии разворачиваются)
+ * сливается попарно за O(n log серий); целые от
+ * CIM_SORTED_VECTOR_RADIX_SORT элементов сортируются поразрядно (LSD по
+ * 11 бит с пропуском одинаковых разрядов), как и элементы
+ * sorted_vector_with_key с целым ключом до 32 бит (сортируются пары ключ -
+ * позиция, затем записи собираются в новый массив); в остальных случаях
+ * используется std::sort.
+ *
+ * Метод assign_sorted принимает заведомо отсортированный вектор без
+ * копирования и без вызова std::sort.
  *
  * Добавление элементов осуществляется методами push или replace. Метод replace
  * заменяет добавляемым первый найденный (он может быть не первым по счёту)
  * элемент, равный добавляемому. Если заменять нечего, то элемент просто
- * добавляется.
+ * добавляется. Элемент, не меньший последнего (поток отметок времени),
+ * push и emplace добавляют в конец после одного сравнения, без поиска.
+ *
+ * push_batch(first, last) и insert_range(диапазон) добавляют пакет
+ * элементов за один проход: пакет сортируется (при директиве
+ * CIM_SORTED_VECTOR_PARALLEL_SORT пакет не меньше этого размера - в
+ * нескольких потоках) и сливается с хранилищем с конца после одного
+ * reserve, так что каждый имеющийся элемент перемещается не более
+ * одного раза. Порядок равных элементов тот же, что при последовательных
+ * push. Диапазон, переданный как rvalue, и move-итераторы перемещают
+ * элементы.
+ *
+ * emplace(аргументы...) конструирует элемент непосредственно в конце
+ * хранилища и переносит его на место без временных объектов; возвращает
+ * позицию элемента. emplace_hint(позиция, аргументы...) пропускает поиск,
+ * если элемент можно поставить перед элементом в указанной позиции.
+ *
+ * Хранилище - вектор со смещённым началом (sorted_vector_buffer): удаление
+ * из начала (pop_front, erase(0), erase и erase_range префикса) смещает
+ * начало без сдвига остальных элементов, поэтому sorted_vector годится как
+ * очередь с приоритетом. Удаление и вставка сдвигают ближнюю к позиции
+ * часть элементов - конечную или начальную (вставка - начальную, только
+ * если перед ней есть место, освобождённое удалением из начала).
+ * Элементы переносятся в начало вектора, когда удалённых из начала
+ * становится не меньше, чем оставшихся, а также при обращении к storage
+ * и cstorage.
  *
  * Доступ к элементам осуществляется через оператор[], методы at, data и
  * violate. К первым и последним элементам - через front и back. Может быть
@@ -59,6 +98,218 @@
  * sorted_vector и номер позиции в нём. Для них реализован только префиксный
  * инкремент.
  *
+ * Теоретико-множественные операции set_intersection, set_difference,
+ * set_union и set_symmetric_difference (методы и одноимённые свободные
+ * функции) записывают результат в экземпляр sorted_vector, который сразу
+ * находится в отсортированном состоянии. Повторяющиеся элементы учитываются
+ * так же, как в одноимённых алгоритмах std. Если размеры операндов
+ * различаются не менее чем в CIM_SORTED_VECTOR_GALLOP_RATIO раз, вместо
+ * линейного слияния по большему операнду выполняется галопирующий
+ * (экспоненциальный + бинарный) поиск. Для sorted_vector_with_key элементы
+ * сравниваются только по ключу. Пересечение и объединение целых размером
+ * 32 и 64 бита выполняются векторными ядрами SSE4.2 / AVX2 (выбор по
+ * процессору во время выполнения), если это не отключено директивой
+ * CIM_SORTED_VECTOR_NO_SIMD.
+ *
+ * Методы range, count_range и erase_range работают с интервалом значений
+ * [lo, hi] (включая обе границы). Обе границы ищутся одним спуском
+ * бинарного поиска, который разделяется только после попадания в
+ * интервал. range возвращает лёгкое представление sorted_vector_view -
+ * пару указателей на непрерывный участок хранилища без копирования
+ * элементов; оно действительно до первого изменения экземпляра.
+ * count_range выполняется за O(log n), erase_range удаляет интервал одним
+ * вызовом vector::erase. Испорченный экземпляр range, как и erase_range,
+ * сначала восстанавливает (CIM_SORTED_VECTOR_AUTOREPAIR); константный
+ * range в этом случае возвращает пустое представление, а count_range
+ * выполняет линейный подсчёт.
+ *
+ * erase_if(предикат), erase_keys(first, last) (все элементы, равные ключам
+ * из упорядоченного диапазона) и erase_positions(first, last) (позиции
+ * из упорядоченного диапазона) удаляют элементы одним устойчивым проходом
+ * и возвращают число удалённых. Оставляемые элементы переносятся
+ * непрерывными участками (memmove для тривиально копируемых типов), так что
+ * упорядоченность сохраняется без repair.
+ *
+ * Порядковые статистики: rank возвращает число элементов, меньших ключа
+ * (O(log n)), select - k-й по возрастанию элемент, quantile - элемент,
+ * соответствующий доле q из [0, 1] (по правилу ближайшего ранга),
+ * percentile_range - представление элементов между двумя квантилями.
+ * select, quantile и percentile_range выполняются за O(1), поскольку
+ * ранг элемента совпадает с его позицией; они, как и find_floor, требуют
+ * непустого экземпляра. Неконстантные перегрузки сначала восстанавливают
+ * испорченный экземпляр (CIM_SORTED_VECTOR_AUTOREPAIR); константные select
+ * и quantile в этом случае выбирают элемент за O(n), а percentile_range
+ * возвращает пустое представление. quantile(NaN) бросает
+ * std::invalid_argument. В sorted_vector_with_key rank(key) и
+ * select(key, k) (k-й элемент, начиная с первого ключа не меньше key)
+ * принимают ключ, range и count_range - интервал ключей.
+ *
+ * find_interpolated ищет первый равный элемент интерполяционным поиском:
+ * позиция предсказывается по значениям крайних элементов интервала, от
+ * неё экспоненциальным шагом находится интервал с ответом, и шаг
+ * повторяется. На равномерно распределённых ключах (последовательные
+ * номера, отметки времени) это O(log log n) обращений вместо log2(n);
+ * после CIM_SORTED_VECTOR_INTERPOLATION_PROBES неудачных предсказаний
+ * поиск продолжается бинарным. set_search_strategy(search_interpolation)
+ * переключает на него find, find_first, find_last, find_floor, find_ceil
+ * и rank экземпляра. Для неарифметических типов используется бинарный
+ * поиск.
+ *
+ * При активной директиве CIM_SORTED_VECTOR_STATS экземпляр ведёт счётчики
+ * (stats): полные сортировки и восстановления одного элемента в repair,
+ * сдвинутые элементы, бинарные и интерполяционные поиски и число их
+ * обращений к элементам, линейные поиски в испорченном состоянии и
+ * перераспределения хранилища. reset_stats обнуляет счётчики, например
+ * в начале интервала наблюдения. Без директивы счётчиков нет, а stats
+ * возвращает нули.
+ *
+ * Директива CIM_SORTED_VECTOR_TRACE включает гистограммы задержек
+ * (latency_histogram: логарифмические корзины, 8 на степень двойки)
+ * методов find..., push, erase, repair и sort, общие для всех экземпляров.
+ * Каждый поток пишет в свои корзины без блокировок;
+ * sorted_vector_latency(операция) суммирует их, sorted_vector_latency_reset
+ * обнуляет, sorted_vector_latency_enable отключает замеры во время
+ * выполнения (остаётся одна проверка флага). Функция, установленная
+ * set_sorted_vector_trace_callback, вызывается, когда repair выполняет
+ * полную сортировку, с экземпляром, размером и длительностью сортировки.
+ * Без директивы код замеров не компилируется.
+ *
+ * Шаблонный класс sorted_vector_aggregate - потомок sorted_vector (или
+ * указанного параметром Base потомка, например sorted_vector_with_key),
+ * поддерживающий индекс агрегатов по моноиду (по умолчанию summary_monoid:
+ * количество, сумма, минимум и максимум). Элементы разбиты на блоки
+ * переменного размера (около CIM_SORTED_VECTOR_AGGREGATE_BLOCK), над
+ * размерами блоков построено дерево Фенвика, над агрегатами блоков -
+ * дерево отрезков. Вставка и удаление меняют только затронутые блоки и
+ * не пересчитывают весь индекс; после sort, merge или repair с полной
+ * сортировкой индекс перестраивается при первом запросе. aggregate,
+ * sum_range, min_range и max_range выполняются за O(log n). Запросы к
+ * испорченному экземпляру выполняются линейным проходом. Если Base -
+ * sorted_vector_with_key, aggregate принимает и интервал ключей. Base может
+ * быть и другим потомком с сопутствующими структурами
+ * (sorted_vector_filtered, sorted_vector_learned): уведомления об
+ * изменениях передаются ему.
+ *
+ * Шаблонный класс compressed_sorted_vector - неизменяемое сжатое хранилище
+ * упорядоченных целых. Значения разбиты на блоки по
+ * CIM_SORTED_VECTOR_COMPRESSED_BLOCK; в блоке хранится отклонение каждого
+ * значения от первого (frame of reference), упакованное минимальным числом
+ * бит. Первые значения блоков образуют массив пропусков: find, find_first,
+ * find_last, find_floor, find_ceil (с семантикой sorted_vector), rank и
+ * count_range выбирают блок бинарным поиском по нему и ищут внутри блока
+ * непосредственно по упакованным данным. operator[] извлекает одно
+ * значение за O(1). decode_block и decompress распаковывают блоки целиком
+ * (AVX2 при наличии). Для идентификаторов с плотным распределением размер
+ * сокращается в 4-8 раз.
+ *
+ * Класс front_coded_sorted_vector - неизменяемое хранилище упорядоченных
+ * строк с префиксным сжатием. Строки разбиты на блоки по
+ * CIM_SORTED_VECTOR_FRONT_CODING_BUCKET и записаны подряд в один буфер:
+ * первая строка блока целиком, остальные - длиной общего с предыдущей
+ * префикса и суффиксом. Поиск (find..., rank, count_range) выбирает блок
+ * бинарным поиском по первым строкам блоков и проходит блок, сравнивая с
+ * ключом только суффиксы, без восстановления строк и обращений к куче.
+ * Константный итератор возвращает string_ref - представление (data, size,
+ * сравнения) строки, восстановленной в самом итераторе; оно действительно
+ * до сдвига итератора. string_ref одинаков во всех стандартах языка,
+ * создаётся неявно из строк и std::string_view и явно преобразуется в них.
+ *
+ * Шаблонный класс sorted_vector_learned - потомок sorted_vector (или Base)
+ * для арифметических типов, ускоряющий find..., rank и count_range
+ * обученной моделью распределения ключей. Корневая линейная модель
+ * выбирает лист (в среднем CIM_SORTED_VECTOR_LEARNED_LEAF элементов),
+ * линейная модель листа предсказывает позицию; погрешность каждого листа
+ * сохраняется, и бинарный поиск выполняется только в окне погрешности.
+ * Модель обучается при первом запросе к отсортированному экземпляру
+ * (под мьютексом: константные запросы из разных потоков безопасны).
+ * Вставки и удаления не сбрасывают модель, а расширяют окно поиска на
+ * число изменений после обучения; модель переобучается, когда оно
+ * превысит size() / CIM_SORTED_VECTOR_LEARNED_DRIFT, а также после sort,
+ * merge и других полных перестроений. Для испорченного экземпляра
+ * выполняются методы базового класса.
+ *
+ * Шаблонный класс sorted_vector_filtered - потомок sorted_vector (или Base)
+ * с блочным фильтром Блума перед find, find_first и find_last: ключ,
+ * отсутствие которого фильтр гарантирует, отбрасывается проверкой одной
+ * линии кэша (64 байта, 8 бит на ключ) без бинарного поиска по хранилищу.
+ * Это выгодно, когда большинство запросов не находят элемент (списки
+ * блокировки). Фильтр строится при первом запросе к отсортированному
+ * экземпляру (CIM_SORTED_VECTOR_FILTER_BITS бит на элемент с запасом в
+ * полтора раза), пополняется при push и replace и перестраивается после
+ * sort, merge, repair с полной сортировкой, при исчерпании запаса и
+ * после удаления четверти элементов (до этого удалённые элементы
+ * остаются в фильтре и лишь дают ложные срабатывания). Фильтр строится
+ * через sorted_vector_lazy, как и модель sorted_vector_learned, поэтому
+ * константные запросы из нескольких потоков безопасны. Хеш задаётся
+ * параметром Hash (по умолчанию std::hash). sorted_vector_filtered_with_key
+ * - то же для sorted_vector_with_key с фильтром по ключу, включая find по
+ * ключу.
+ *
+ * freeze() перемещает хранилище (без копирования) в неизменяемый снимок
+ * frozen_sorted_vector, предварительно исправив испорченный экземпляр;
+ * исходный экземпляр становится пустым. Снимок предоставляет только
+ * константный доступ (operator[], at, front, back, data, begin / end -
+ * указатели), find..., rank, range и count_range с семантикой
+ * sorted_vector без проверок и записи признаков порчи: поиск выполняется
+ * без ветвлений, а одновременное чтение из нескольких потоков безопасно.
+ * thaw() возвращает хранилище в sorted_vector (или в указанный экземпляр,
+ * в том числе потомка) также без копирования и сортировки.
+ *
+ * crack() перемещает хранилище, в том числе испорченного экземпляра, в
+ * cracked_sorted_vector без сортировки (адаптивное индексирование,
+ * cracking). Каждый запрос find..., rank, range и count_range разбивает
+ * (partition) только неупорядоченный кусок, в который попадает ключ, и
+ * запоминает границу в индексе кусков; куски не больше
+ * CIM_SORTED_VECTOR_CRACKING_PIECE сортируются сразу, range сортирует
+ * куски внутри интервала. Работа пропорциональна запросам, и после
+ * достаточного их числа массив становится полностью упорядоченным
+ * (sorted), индекс кусков освобождается. Позиции и семантика find...
+ * те же, что у sorted_vector. Разбивающие запросы изменяют экземпляр и
+ * поэтому неконстантны: позиции и представления range действительны до
+ * следующего такого запроса. Константные rank и count_range не
+ * разбивают куски (элементы неупорядоченного куска подсчитываются) и,
+ * как остальные константные методы, могут вызываться из нескольких
+ * потоков одновременно. thaw() досортировывает оставшиеся куски и
+ * возвращает хранилище в sorted_vector без полной сортировки.
+ *
+ * Шаблонный класс sorted_window - упорядоченное скользящее окно для
+ * временных рядов: push добавляет элемент (не меньший последнего - в
+ * конец за O(1), иначе вставкой со сдвигом к ближнему краю окна), и при
+ * заданном max_size из начала вытесняются самые старые элементы;
+ * trim_front(k) и trim_before(ключ) вытесняют их явно (например, старше
+ * заданного интервала времени). Окно хранится в sorted_vector_buffer
+ * (см. выше), и вытеснение не сдвигает элементы (амортизированно O(1) на
+ * элемент). Доступ константный (operator[], at, front, back, data,
+ * begin / end - указатели), find..., rank, range и count_range - с
+ * семантикой sorted_vector и поиском без ветвлений.
+ *
+ * Шаблонный класс sorted_vector_indexed <T, Base, Indexes...> - потомок Base
+ * (обычно sorted_vector_with_key) со вторичными индексами по проекциям
+ * Indexes (функторы, возвращающие вторичный ключ элемента). Индекс - это
+ * перестановка 32-битных позиций хранилища, упорядоченная по проекции:
+ * 4 байта на элемент вместо второй копии записей. Индексы строятся при
+ * первом запросе (через sorted_vector_lazy, одновременные константные
+ * запросы безопасны) и поддерживаются инкрементально при вставке, удалении и
+ * перемещениях repair; после sort и merge перестраиваются. find_by <Index>
+ * (ключ) возвращает наименьшую позицию элемента с таким вторичным ключом
+ * (поиск без ветвлений), count_by и find_all_by - число и позиции всех
+ * таких элементов. Для испорченного экземпляра выполняется линейный
+ * проход. Число элементов ограничено UINT32_MAX.
+ *
+ * Шаблонные классы sorted_set и sorted_map хранят уникальные элементы
+ * (ключи). sorted_set - закрытый потомок sorted_vector, sorted_map -
+ * закрытый потомок sorted_vector <K> с массивом значений, параллельным
+ * хранилищу ключей (как flat_map). insert и try_emplace не заменяют
+ * имеющийся элемент, insert_or_assign и operator[] sorted_map заменяют
+ * (создают) его; методы возвращают пару (позиция, вставлен ли элемент).
+ * Поиск выполняется методами sorted_vector, вставка - через emplace_hint
+ * без повторного поиска, вставка диапазона - слиянием, как в push_batch,
+ * после исключения повторов и имеющихся элементов. Неконстантный доступ
+ * к элементам sorted_set не предоставляется, поэтому экземпляр не
+ * портится; значения sorted_map можно изменять через value и operator[].
+ * Исключение при вставке в sorted_map (ключа или значения) оставляет
+ * ключи и значения согласованными.
+ *
  */
 
 #ifndef CIM_SORTED_VECTOR_H
@@ -86,1588 +337,10332 @@
   //обычного, но применимо только для
   //типов, допускающих такое копирование.
 
-#include <vector>
-#include <algorithm>
-#include <iterator>
+#ifndef CIM_SORTED_VECTOR_GALLOP_RATIO
+# define CIM_SORTED_VECTOR_GALLOP_RATIO 16
+#endif
+  //Во сколько раз один операнд
+  //теоретико-множественной операции должен
+  //быть больше другого, чтобы линейное
+  //слияние было заменено галопирующим
+  //поиском по большему операнду.
+
+//#define CIM_SORTED_VECTOR_NO_SIMD
+  //Отключает векторные ядра (SSE4.2 / AVX2)
+  //пересечения и объединения для целых
+  //размером 32 и 64 бита. Набор инструкций
+  //выбирается во время выполнения, при их
+  //отсутствии работает скалярное слияние.
+
+//#define CIM_SORTED_VECTOR_STATS
+  //Включает счётчики экземпляра, доступные
+  //через stats(): полные сортировки и
+  //восстановления одного элемента, сдвинутые
+  //элементы, поиски и их пробы, линейные
+  //поиски, перераспределения хранилища. Без
+  //директивы счётчики не компилируются.
+
+//#define CIM_SORTED_VECTOR_TRACE
+  //Включает гистограммы задержек find...,
+  //push, erase, repair и sort (общие для всех
+  //экземпляров, с накоплением по потокам) и
+  //вызов функции трассировки при полной
+  //сортировке в repair. Во время выполнения
+  //отключается sorted_vector_latency_enable.
+
+#ifndef CIM_SORTED_VECTOR_INTERPOLATION_PROBES
+# define CIM_SORTED_VECTOR_INTERPOLATION_PROBES 3
+#endif
+  //Число неудачных шагов интерполяционного
+  //поиска, после которого он продолжается
+  //бинарным.
 
-#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
-# include <cstring>
+#ifndef CIM_SORTED_VECTOR_AGGREGATE_BLOCK
+# define CIM_SORTED_VECTOR_AGGREGATE_BLOCK 128
 #endif
+  //Число элементов в блоке индекса агрегатов
+  //sorted_vector_aggregate. Блок делится
+  //пополам при двукратном превышении.
 
-namespace cim{
+#ifndef CIM_SORTED_VECTOR_COMPRESSED_BLOCK
+# define CIM_SORTED_VECTOR_COMPRESSED_BLOCK 128
+#endif
+  //Число значений в блоке упаковки
+  //compressed_sorted_vector.
 
-template <class T>
-  class sorted_vector_iterator;
+#ifndef CIM_SORTED_VECTOR_FRONT_CODING_BUCKET
+# define CIM_SORTED_VECTOR_FRONT_CODING_BUCKET 16
+#endif
+  //Число строк в блоке префиксного сжатия
+  //front_coded_sorted_vector.
 
-template <class T>
-  class sorted_vector_const_iterator;
+#ifndef CIM_SORTED_VECTOR_LEARNED_LEAF
+# define CIM_SORTED_VECTOR_LEARNED_LEAF 256
+#endif
+  //Среднее число элементов на лист модели
+  //sorted_vector_learned.
 
-template <class T>
-  class sorted_vector
-{
-  public:
-    sorted_vector();
-    sorted_vector(const sorted_vector <T> &sv);
-    sorted_vector(sorted_vector <T> &&sv);
-    sorted_vector(std::initializer_list <T> ilist);
-    sorted_vector(const std::vector <T> &v);
-    sorted_vector(std::vector <T> &&v);
+#ifndef CIM_SORTED_VECTOR_LEARNED_DRIFT
+# define CIM_SORTED_VECTOR_LEARNED_DRIFT 64
+#endif
+  //Модель sorted_vector_learned переобучается, когда
+  //число изменений после обучения превышает
+  //size() / CIM_SORTED_VECTOR_LEARNED_DRIFT (и размер листа).
 
-    virtual ~sorted_vector(){};
+#ifndef CIM_SORTED_VECTOR_CRACKING_PIECE
+# define CIM_SORTED_VECTOR_CRACKING_PIECE 64
+#endif
+  //Кусок cracked_sorted_vector не больше
+  //этого размера сортируется целиком.
 
-    sorted_vector <T> &operator=(const sorted_vector <T> &sv);
-    sorted_vector <T> &operator=(sorted_vector <T> &&sv);
+#ifndef CIM_SORTED_VECTOR_SORT_RUNS
+# define CIM_SORTED_VECTOR_SORT_RUNS 16
+#endif
+  //Наибольшее число естественных серий, при
+  //котором sort сливает их вместо полной
+  //сортировки.
 
-    sorted_vector <T> operator+(const sorted_vector <T> &sv) const;
-    sorted_vector <T> operator+(const std::vector <T> &v) const;
-    sorted_vector <T> operator+(const T &t) const;
+#ifndef CIM_SORTED_VECTOR_RADIX_SORT
+# define CIM_SORTED_VECTOR_RADIX_SORT 2048
+#endif
+  //Размер, начиная с которого sort использует
+  //поразрядную сортировку для целых (и для
+  //sorted_vector_with_key с целым ключом до
+  //32 бит).
+
+//#define CIM_SORTED_VECTOR_PARALLEL_SORT 65536
+  //Размер пакета push_batch, начиная с
+  //которого он сортируется в нескольких
+  //потоках. Без директивы пакет сортируется
+  //в вызывающем потоке, а <future> и
+  //<thread> не подключаются.
+
+#ifndef CIM_SORTED_VECTOR_FILTER_BITS
+# define CIM_SORTED_VECTOR_FILTER_BITS 10
+#endif
+  //Число бит фильтра sorted_vector_filtered
+  //на элемент. 10 бит дают около 1% ложных
+  //срабатываний.
 
-    void operator+=(const sorted_vector <T> &sv);
-    void operator+=(const std::vector <T> &v);
-    void operator+=(const T &t);
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <atomic>
+#include <mutex>
+
+#ifdef CIM_SORTED_VECTOR_PARALLEL_SORT
+# include <future>
+# include <thread>
+#endif
 
-  typedef sorted_vector_iterator <T>        iterator;
-  typedef sorted_vector_const_iterator <T>  const_iterator;
+#ifdef CIM_SORTED_VECTOR_STATS
+# define CIM_SORTED_VECTOR_COUNT(counter, n) (this->_stats.counter.add(n))
+#else
+# define CIM_SORTED_VECTOR_COUNT(counter, n) ((void)0)
+#endif
 
-    void assign(iterator first, iterator last);
-    void assign(typename std::vector<T>::iterator first, typename std::vector<T>::iterator last);
-    void assign(std::initializer_list <T> ilist);
+#ifdef CIM_SORTED_VECTOR_TRACE
+# include <chrono>
+# define CIM_SORTED_VECTOR_LATENCY(op) latency::timer latency_timer(op)
+#else
+# define CIM_SORTED_VECTOR_LATENCY(op) ((void)0)
+#endif
 
-    T       &at(size_t pos);
-    const T &at(size_t pos) const;
+#if  (!defined(CIM_SORTED_VECTOR_NO_SIMD)) \
+   &&(defined(__GNUC__)) \
+   &&(defined(__x86_64__))
+# define CIM_SORTED_VECTOR_SIMD_X86
+# include <immintrin.h>
+#endif
 
-    T       &operator[](size_t pos);
-    const T &operator[](size_t pos) const;
+namespace cim{
 
-    T       &front();
-    const T &front() const;
+//***SIMD kernels***
 
-    T       &back();
-    const T &back() const;
+namespace simd{
 
-    iterator        begin();
-    const_iterator  begin()   const;
-    const_iterator  cbegin()  const;
+enum isa
+{
+  isa_scalar,
+  isa_sse42,
+  isa_avx2
+};
 
-    iterator        end();
-    const_iterator  end()     const;
-    const_iterator  cend()    const;
+inline isa detected_isa()
+{
+#ifdef CIM_SORTED_VECTOR_SIMD_X86
+  static const isa level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return isa_avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+      return isa_sse42;
+    return isa_scalar;
+  }();
+  return level;
+#else
+  return isa_scalar;
+#endif // CIM_SORTED_VECTOR_SIMD_X86
+}
 
-    bool empty()      const;
-    size_t size()     const;
-    size_t max_size() const;
+template <class T>
+  size_t finish(
+    const T *a, size_t na, size_t i,
+    const T *b, size_t nb, size_t j,
+    T *out, size_t pos,
+    const T *pending, size_t n_pending,
+    bool is_union)
+{
+  //Векторная часть обработала без ошибок все значения,
+  //меньшие t - наименьшего ещё не загруженного элемента.
+  //Результат для значений не меньше t пересчитывается
+  //скалярным слиянием, учитывающим повторы элементов
+  bool has_t = false;
+  T t = T();
+  if (i < na) {
+    t = a[i];
+    has_t = true;
+  }
+  if (  (j < nb)
+      &&((!has_t) || (b[j] < t))) {
+    t = b[j];
+    has_t = true;
+  }
 
-    void reserve(size_t n);
+  if (has_t)
+    while (  (pos > 0)
+           &&(!(out[pos - 1] < t)))
+      pos--;
+
+  for (size_t k = 0; k < n_pending; k++)
+    if (  ((!has_t) || (pending[k] < t))
+        &&((pos == 0) || (out[pos - 1] != pending[k])))
+      out[pos++] = pending[k];
+
+  if (!has_t)
+    return pos;
+
+  i = std::lower_bound(a, a + na, t) - a;
+  j = std::lower_bound(b, b + nb, t) - b;
+
+  while (  (i < na)
+         &&(j < nb)) {
+    if (a[i] < b[j]) {
+      if (is_union)
+        out[pos++] = a[i];
+      i++;
+    } else if (b[j] < a[i]) {
+      if (is_union)
+        out[pos++] = b[j];
+      j++;
+    } else {
+      out[pos++] = a[i];
+      i++;
+      j++;
+    }
+  }
+  if (is_union) {
+    while (i < na)
+      out[pos++] = a[i++];
+    while (j < nb)
+      out[pos++] = b[j++];
+  }
+  return pos;
+}
 
-    size_t capacity() const;
+#ifdef CIM_SORTED_VECTOR_SIMD_X86
 
-    void shrink_to_fit();
+struct shuffle_tables
+{
+  //Маски перестановок для уплотнения выбранных
+  //элементов вектора в его начало
+  alignas(32) uint8_t   sse_epi32[16][16];
+  alignas(32) uint8_t   sse_epi64[4][16];
+  alignas(32) uint32_t  avx_epi32[256][8];
+  alignas(32) uint32_t  avx_epi64[16][8];
+
+  shuffle_tables()
+  {
+    for (int m = 0; m < 16; m++) {
+      int k = 0;
+      for (int l = 0; l < 4; l++)
+        if (m & (1 << l)) {
+          for (int b = 0; b < 4; b++)
+            sse_epi32[m][k * 4 + b] = (uint8_t)(l * 4 + b);
+          for (int b = 0; b < 2; b++) {
+            avx_epi64[m][k * 2 + b] = (uint32_t)(l * 2 + b);
+          }
+          k++;
+        }
+      for (int b = k * 4; b < 16; b++)
+        sse_epi32[m][b] = 0x80;
+      for (int b = k * 2; b < 8; b++)
+        avx_epi64[m][b] = 0;
+    }
+    for (int m = 0; m < 4; m++) {
+      int k = 0;
+      for (int l = 0; l < 2; l++)
+        if (m & (1 << l)) {
+          for (int b = 0; b < 8; b++)
+            sse_epi64[m][k * 8 + b] = (uint8_t)(l * 8 + b);
+          k++;
+        }
+      for (int b = k * 8; b < 16; b++)
+        sse_epi64[m][b] = 0x80;
+    }
+    for (int m = 0; m < 256; m++) {
+      int k = 0;
+      for (int l = 0; l < 8; l++)
+        if (m & (1 << l))
+          avx_epi32[m][k++] = (uint32_t)l;
+      while (k < 8)
+        avx_epi32[m][k++] = 0;
+    }
+  }
+};
 
-    void clear();
+inline const shuffle_tables &tables()
+{
+  static const shuffle_tables t;
+  return t;
+}
 
-    void erase(size_t pos);
-    void erase(iterator first, iterator last);
-    void erase(size_t pos_start, size_t pos_end);
+//Проверка строгого возрастания блока x[k, k + W):
+//векторные ядра реализуют семантику множеств, поэтому
+//при обнаружении повторов работа передаётся в finish
 
-    void push(const T &t);
-    void push(T &&t);
+template <class T>
+  __attribute__((target("sse4.2")))
+  inline bool strict_sse(const T *x, size_t k)
+{
+  if (k == 0) {
+    for (size_t l = 1; l < 16 / sizeof(T); l++)
+      if (x[l - 1] == x[l])
+        return false;
+    return true;
+  }
+  __m128i v = _mm_loadu_si128(reinterpret_cast <const __m128i *> (x + k));
+  __m128i p = _mm_loadu_si128(reinterpret_cast <const __m128i *> (x + k - 1));
+  __m128i eq = (sizeof(T) == 4) ? _mm_cmpeq_epi32(v, p) : _mm_cmpeq_epi64(v, p);
+  return _mm_testz_si128(eq, eq);
+}
 
-    void replace(const T &t);
-    void replace(T &&t);
+template <class T>
+  __attribute__((target("avx2")))
+  inline bool strict_avx(const T *x, size_t k)
+{
+  if (k == 0) {
+    for (size_t l = 1; l < 32 / sizeof(T); l++)
+      if (x[l - 1] == x[l])
+        return false;
+    return true;
+  }
+  __m256i v = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (x + k));
+  __m256i p = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (x + k - 1));
+  __m256i eq = (sizeof(T) == 4) ? _mm256_cmpeq_epi32(v, p) : _mm256_cmpeq_epi64(v, p);
+  return _mm256_testz_si256(eq, eq);
+}
 
-    size_t find(const T &t, size_t start_pos = 0, size_t end_pos = -1)              const;
+//Пересечение блоками 4x4 (32 бита) или 2x2 (64 бита):
+//сравнение всех пар поворотами блока b, уплотнение
+//совпавших элементов a перестановкой байт (Schlegel)
 
-    size_t find_first(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
-    size_t find_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)         const;
-    size_t find_next(size_t current_pos, size_t end_pos = -1)                       const;
-    size_t find_prev(size_t current_pos, size_t start_pos = 0)                      const;
+template <class T>
+  __attribute__((target("sse4.2")))
+  size_t intersect_sse(const T *a, size_t na, const T *b, size_t nb, T *out)
+{
+  const size_t w = 16 / sizeof(T);
+  const shuffle_tables &tb = tables();
+  size_t i = 0;
+  size_t j = 0;
+  size_t pos = 0;
+
+  if (  (na >= w)
+      &&(nb >= w)
+      &&(strict_sse(a, 0))
+      &&(strict_sse(b, 0))) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast <const __m128i *> (a));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast <const __m128i *> (b));
+    for (;;) {
+      int mask;
+      __m128i packed;
+      if (sizeof(T) == 4) {
+        __m128i m = _mm_cmpeq_epi32(va, vb);
+        m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+        packed = _mm_shuffle_epi8(va, _mm_load_si128(reinterpret_cast <const __m128i *> (tb.sse_epi32[mask])));
+      } else {
+        __m128i m = _mm_cmpeq_epi64(va, vb);
+        m = _mm_or_si128(m, _mm_cmpeq_epi64(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        mask = _mm_movemask_pd(_mm_castsi128_pd(m));
+        packed = _mm_shuffle_epi8(va, _mm_load_si128(reinterpret_cast <const __m128i *> (tb.sse_epi64[mask])));
+      }
+      _mm_storeu_si128(reinterpret_cast <__m128i *> (out + pos), packed);
+      pos += __builtin_popcount(mask);
+
+      T a_max = a[i + w - 1];
+      T b_max = b[j + w - 1];
+      if (!(b_max < a_max)) {
+        i += w;
+        if (  (i + w > na)
+            ||(!strict_sse(a, i)))
+          break;
+        va = _mm_loadu_si128(reinterpret_cast <const __m128i *> (a + i));
+      }
+      if (!(a_max < b_max)) {
+        j += w;
+        if (  (j + w > nb)
+            ||(!strict_sse(b, j)))
+          break;
+        vb = _mm_loadu_si128(reinterpret_cast <const __m128i *> (b + j));
+      }
+    }
+  }
 
-    size_t find_linear(const T &t, size_t start_pos = 0, size_t end_pos = -1)       const;
-    size_t find_linear_first(const T &t, size_t start_pos = 0, size_t end_pos = -1) const;
-    size_t find_linear_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+  return finish(a, na, i, b, nb, j, out, pos, (const T *)nullptr, 0, false);
+}
 
-    size_t find_floor(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
-    size_t find_ceil(const T &t, size_t start_pos = 0, size_t end_pos = -1)         const;
+//Пересечение блоками 8x8 (32 бита) или 4x4 (64 бита)
 
-    void sort();
-    void repair();
+template <class T>
+  __attribute__((target("avx2")))
+  size_t intersect_avx(const T *a, size_t na, const T *b, size_t nb, T *out)
+{
+  const size_t w = 32 / sizeof(T);
+  const shuffle_tables &tb = tables();
+  size_t i = 0;
+  size_t j = 0;
+  size_t pos = 0;
+
+  const __m256i rot1 = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+  const __m256i rot2 = _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1);
+  const __m256i rot3 = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
+  const __m256i rot4 = _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3);
+  const __m256i rot5 = _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4);
+  const __m256i rot6 = _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5);
+  const __m256i rot7 = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+
+  if (  (na >= w)
+      &&(nb >= w)
+      &&(strict_avx(a, 0))
+      &&(strict_avx(b, 0))) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (a));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (b));
+    for (;;) {
+      int mask;
+      __m256i packed;
+      if (sizeof(T) == 4) {
+        __m256i m = _mm256_cmpeq_epi32(va, vb);
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot1)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot2)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot3)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot4)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot5)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot6)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot7)));
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+        packed = _mm256_permutevar8x32_epi32(va, _mm256_load_si256(reinterpret_cast <const __m256i *> (tb.avx_epi32[mask])));
+      } else {
+        __m256i m = _mm256_cmpeq_epi64(va, vb);
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(m));
+        packed = _mm256_permutevar8x32_epi32(va, _mm256_load_si256(reinterpret_cast <const __m256i *> (tb.avx_epi64[mask])));
+      }
+      _mm256_storeu_si256(reinterpret_cast <__m256i *> (out + pos), packed);
+      pos += __builtin_popcount(mask);
+
+      T a_max = a[i + w - 1];
+      T b_max = b[j + w - 1];
+      if (!(b_max < a_max)) {
+        i += w;
+        if (  (i + w > na)
+            ||(!strict_avx(a, i)))
+          break;
+        va = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (a + i));
+      }
+      if (!(a_max < b_max)) {
+        j += w;
+        if (  (j + w > nb)
+            ||(!strict_avx(b, j)))
+          break;
+        vb = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (b + j));
+      }
+    }
+  }
 
-    void merge(const sorted_vector <T> &sv);
-    void merge(sorted_vector <T> &&sv);
-    void merge(const std::vector <T> &v);
-    void merge(std::vector <T> &&v);
+  return finish(a, na, i, b, nb, j, out, pos, (const T *)nullptr, 0, false);
+}
 
-    void merge_replace(const sorted_vector <T> &sv);
-    void merge_replace(sorted_vector <T> &&sv);
-    void merge_replace(const std::vector <T> &sv);
-    void merge_replace(std::vector <T> &&sv);
+//Объединение 32-битных элементов блоками по 4:
+//сеть слияния из min/max и поворотов (Inoue, Lemire),
+//повторы отбрасываются сравнением с соседним элементом.
+//Знаковые значения сдвигаются в беззнаковый порядок
 
-    bool corrupted() const;
+__attribute__((target("sse4.2")))
+  inline void merge_sse(__m128i a, __m128i b, __m128i &vmin, __m128i &vmax)
+{
+  __m128i tmp = _mm_min_epu32(a, b);
+  vmax = _mm_max_epu32(a, b);
+  tmp = _mm_alignr_epi8(tmp, tmp, 4);
+  vmin = _mm_min_epu32(tmp, vmax);
+  vmax = _mm_max_epu32(tmp, vmax);
+  tmp = _mm_alignr_epi8(vmin, vmin, 4);
+  vmin = _mm_min_epu32(tmp, vmax);
+  vmax = _mm_max_epu32(tmp, vmax);
+  tmp = _mm_alignr_epi8(vmin, vmin, 4);
+  vmin = _mm_min_epu32(tmp, vmax);
+  vmax = _mm_max_epu32(tmp, vmax);
+  vmin = _mm_alignr_epi8(vmin, vmin, 4);
+}
 
-    std::vector <T> &storage();
-    const std::vector <T> &cstorage();
+template <class T>
+  __attribute__((target("sse4.2")))
+  inline size_t store_unique_sse(__m128i prev, __m128i v, __m128i bias, T *out)
+{
+  __m128i shifted = _mm_alignr_epi8(v, prev, 12);
+  int keep = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(shifted, v))) & 0xF;
+  __m128i packed = _mm_shuffle_epi8(v, _mm_load_si128(reinterpret_cast <const __m128i *> (tables().sse_epi32[keep])));
+  _mm_storeu_si128(reinterpret_cast <__m128i *> (out), _mm_xor_si128(packed, bias));
+  return __builtin_popcount(keep);
+}
 
-    T *data();
-    const T *data() const;
+template <class T>
+  __attribute__((target("sse4.2")))
+  size_t union_sse(const T *a, size_t na, const T *b, size_t nb, T *out)
+{
+  const __m128i bias = _mm_set1_epi32(std::is_signed <T>::value ? (int)0x80000000u : 0);
+  size_t i = 0;
+  size_t j = 0;
+  size_t pos = 0;
+  T pending[4];
+
+  if (  (na < 4)
+      ||(nb < 4)
+      ||(!strict_sse(a, 0))
+      ||(!strict_sse(b, 0)))
+    return finish(a, na, i, b, nb, j, out, pos, (const T *)nullptr, 0, true);
+
+  __m128i vmin;
+  __m128i vmax;
+  merge_sse(
+    _mm_xor_si128(_mm_loadu_si128(reinterpret_cast <const __m128i *> (a)), bias),
+    _mm_xor_si128(_mm_loadu_si128(reinterpret_cast <const __m128i *> (b)), bias),
+    vmin,
+    vmax);
+  i = 4;
+  j = 4;
+  __m128i prev = _mm_set1_epi32(~_mm_cvtsi128_si32(vmin));
+  pos += store_unique_sse(prev, vmin, bias, out + pos);
+  prev = vmin;
+
+  for (;;) {
+    __m128i v;
+    if (  (i < na)
+        &&((j >= nb) || (!(b[j] < a[i])))) {
+      if (  (i + 4 > na)
+          ||(!strict_sse(a, i)))
+        break;
+      v = _mm_loadu_si128(reinterpret_cast <const __m128i *> (a + i));
+      i += 4;
+    } else if (j < nb) {
+      if (  (j + 4 > nb)
+          ||(!strict_sse(b, j)))
+        break;
+      v = _mm_loadu_si128(reinterpret_cast <const __m128i *> (b + j));
+      j += 4;
+    } else
+      break;
+    merge_sse(_mm_xor_si128(v, bias), vmax, vmin, vmax);
+    pos += store_unique_sse(prev, vmin, bias, out + pos);
+    prev = vmin;
+  }
 
-    void suspend_autorepair();
-    void resume_autorepair();
+  _mm_storeu_si128(reinterpret_cast <__m128i *> (pending), _mm_xor_si128(vmax, bias));
+  return finish(a, na, i, b, nb, j, out, pos, pending, 4, true);
+}
 
-  protected:
-    void single_shift_left(size_t start_pos = 0, size_t end_pos = -1);
-    void single_shift_right(size_t start_pos = 0, size_t end_pos = -1);
+//Объединение 64-битных элементов блоками по 4 той же
+//сетью слияния; беззнаковые значения сдвигаются в
+//знаковый порядок для сравнения _mm256_cmpgt_epi64
 
-  private:
-    std::vector <T> _storage;
-    size_t          _last_modified            = (size_t)-1;
-    bool            _is_corrupted             = false;
-    bool            _flag_suspend_autorepair  = false;
-};
+__attribute__((target("avx2")))
+  inline void minmax_avx(__m256i a, __m256i b, __m256i &vmin, __m256i &vmax)
+{
+  __m256i gt = _mm256_cmpgt_epi64(a, b);
+  vmin = _mm256_blendv_epi8(a, b, gt);
+  vmax = _mm256_blendv_epi8(b, a, gt);
+}
 
-template <class T>
-  sorted_vector <T>:: sorted_vector() {};
+__attribute__((target("avx2")))
+  inline void merge_avx(__m256i a, __m256i b, __m256i &vmin, __m256i &vmax)
+{
+  __m256i tmp;
+  minmax_avx(a, b, tmp, vmax);
+  tmp = _mm256_permute4x64_epi64(tmp, _MM_SHUFFLE(0, 3, 2, 1));
+  minmax_avx(tmp, vmax, vmin, vmax);
+  tmp = _mm256_permute4x64_epi64(vmin, _MM_SHUFFLE(0, 3, 2, 1));
+  minmax_avx(tmp, vmax, vmin, vmax);
+  tmp = _mm256_permute4x64_epi64(vmin, _MM_SHUFFLE(0, 3, 2, 1));
+  minmax_avx(tmp, vmax, vmin, vmax);
+  vmin = _mm256_permute4x64_epi64(vmin, _MM_SHUFFLE(0, 3, 2, 1));
+}
 
 template <class T>
-  sorted_vector <T>:: sorted_vector(
-    const sorted_vector <T> &sv)
+  __attribute__((target("avx2")))
+  inline size_t store_unique_avx(__m256i prev, __m256i v, __m256i bias, T *out)
 {
-  _storage = sv._storage;
-  _last_modified = sv._last_modified;
-  _is_corrupted = sv._is_corrupted;
-  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
+  __m256i shifted = _mm256_blend_epi32(
+    _mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 1, 0, 3)),
+    _mm256_permute4x64_epi64(prev, _MM_SHUFFLE(3, 3, 3, 3)),
+    0x03);
+  int keep = ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(shifted, v))) & 0xF;
+  __m256i packed = _mm256_permutevar8x32_epi32(v, _mm256_load_si256(reinterpret_cast <const __m256i *> (tables().avx_epi64[keep])));
+  _mm256_storeu_si256(reinterpret_cast <__m256i *> (out), _mm256_xor_si256(packed, bias));
+  return __builtin_popcount(keep);
 }
 
 template <class T>
-  sorted_vector <T>:: sorted_vector(
-    sorted_vector <T> &&sv)
+  __attribute__((target("avx2")))
+  size_t union_avx(const T *a, size_t na, const T *b, size_t nb, T *out)
 {
-  _storage = static_cast <std::vector <T> &&> (sv._storage);
-  _last_modified = sv._last_modified;
-  _is_corrupted = sv._is_corrupted;
-  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
+  const __m256i bias = _mm256_set1_epi64x(std::is_signed <T>::value ? 0 : (long long)0x8000000000000000ull);
+  size_t i = 0;
+  size_t j = 0;
+  size_t pos = 0;
+  T pending[4];
+
+  if (  (na < 4)
+      ||(nb < 4)
+      ||(!strict_avx(a, 0))
+      ||(!strict_avx(b, 0)))
+    return finish(a, na, i, b, nb, j, out, pos, (const T *)nullptr, 0, true);
+
+  __m256i vmin;
+  __m256i vmax;
+  merge_avx(
+    _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast <const __m256i *> (a)), bias),
+    _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast <const __m256i *> (b)), bias),
+    vmin,
+    vmax);
+  i = 4;
+  j = 4;
+  __m256i prev = _mm256_set1_epi64x(~_mm256_extract_epi64(vmin, 0));
+  pos += store_unique_avx(prev, vmin, bias, out + pos);
+  prev = vmin;
+
+  for (;;) {
+    __m256i v;
+    if (  (i < na)
+        &&((j >= nb) || (!(b[j] < a[i])))) {
+      if (  (i + 4 > na)
+          ||(!strict_avx(a, i)))
+        break;
+      v = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (a + i));
+      i += 4;
+    } else if (j < nb) {
+      if (  (j + 4 > nb)
+          ||(!strict_avx(b, j)))
+        break;
+      v = _mm256_loadu_si256(reinterpret_cast <const __m256i *> (b + j));
+      j += 4;
+    } else
+      break;
+    merge_avx(_mm256_xor_si256(v, bias), vmax, vmin, vmax);
+    pos += store_unique_avx(prev, vmin, bias, out + pos);
+    prev = vmin;
+  }
 
-  sv._last_modified = (size_t)-1;
-  sv._is_corrupted = false;
-  sv._flag_suspend_autorepair = false;
+  _mm256_storeu_si256(reinterpret_cast <__m256i *> (pending), _mm256_xor_si256(vmax, bias));
+  return finish(a, na, i, b, nb, j, out, pos, pending, 4, true);
 }
 
 template <class T>
-  sorted_vector <T>:: sorted_vector(
-    std::initializer_list <T> ilist)
+  size_t union_kernel(const T *a, size_t na, const T *b, size_t nb, T *out, std::integral_constant <size_t, 4>)
 {
-  assign(ilist);
+  return union_sse(a, na, b, nb, out);
 }
 
 template <class T>
-  sorted_vector <T>:: sorted_vector(
-    const std::vector <T> &v)
+  size_t union_kernel(const T *a, size_t na, const T *b, size_t nb, T *out, std::integral_constant <size_t, 8>)
 {
-  _storage = v;
-  sort();
+  return union_avx(a, na, b, nb, out);
 }
 
-template <class T>
-  sorted_vector <T>:: sorted_vector(
-    std::vector <T> &&v)
+template <class U>
+  __attribute__((target("avx2")))
+  size_t unpack_avx(
+    const uint8_t *p,
+    unsigned width,
+    size_t count,
+    U first,
+    U *out)
 {
-  _storage = static_cast <std::vector <T> &&>(v);
-  sort();
+  //Распаковка по 4 значения: 64-битная выборка с байтового
+  //смещения каждого значения, сдвиг на остаток и маска.
+  //Требует width <= 56 и 8 байт запаса после данных
+  const __m256i mask = _mm256_set1_epi64x((long long)((uint64_t(1) << width) - 1));
+  const __m256i step = _mm256_set1_epi64x((long long)(4 * width));
+  const __m256i seven = _mm256_set1_epi64x(7);
+  const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  __m256i bit = _mm256_setr_epi64x(0, width, 2 * width, 3 * width);
+  size_t j = 0;
+  for (; j + 4 <= count; j += 4) {
+    __m256i v = _mm256_i64gather_epi64(
+      reinterpret_cast <const long long *> (p),
+      _mm256_srli_epi64(bit, 3),
+      1);
+    v = _mm256_and_si256(_mm256_srlv_epi64(v, _mm256_and_si256(bit, seven)), mask);
+    if (sizeof(U) == 8) {
+      v = _mm256_add_epi64(v, _mm256_set1_epi64x((long long)first));
+      _mm256_storeu_si256(reinterpret_cast <__m256i *> (out + j), v);
+    } else {
+      __m128i w = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, pack));
+      w = _mm_add_epi32(w, _mm_set1_epi32((int)first));
+      _mm_storeu_si128(reinterpret_cast <__m128i *> (out + j), w);
+    }
+    bit = _mm256_add_epi64(bit, step);
+  }
+  return j;
 }
 
+#endif // CIM_SORTED_VECTOR_SIMD_X86
+
 template <class T>
-  sorted_vector <T> &sorted_vector <T>::  operator=(
-    const sorted_vector <T> &sv)
+  bool set_operation(
+    const T *,
+    size_t,
+    const T *,
+    size_t,
+    std::vector <T> &,
+    bool,
+    std::false_type)
 {
-  if (this == &sv)
-    return *this;
+  return false;
+}
 
-  _storage = sv._storage;
-  _last_modified = sv._last_modified;
-  _is_corrupted = sv._is_corrupted;
-  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
+template <class T>
+  bool set_operation(
+    const T *a,
+    size_t na,
+    const T *b,
+    size_t nb,
+    std::vector <T> &out,
+    bool is_union,
+    std::true_type)
+{
+#ifdef CIM_SORTED_VECTOR_SIMD_X86
+  isa level = detected_isa();
+  if (level == isa_scalar)
+    return false;
+  if (  (is_union)
+      &&(sizeof(T) == 8)
+      &&(level != isa_avx2))
+    return false;
+
+  //Запас в 8 элементов под запись полного вектора
+  out.resize((is_union ? na + nb : std::min(na, nb)) + 8);
+  size_t n;
+  if (is_union) {
+    n = union_kernel(
+      a, na,
+      b, nb,
+      out.data(),
+      std::integral_constant <size_t, sizeof(T)> ());
+  } else {
+    if (level == isa_avx2)
+      n = intersect_avx(a, na, b, nb, out.data());
+    else
+      n = intersect_sse(a, na, b, nb, out.data());
+  }
+  out.resize(n);
+  return true;
+#else
+  (void)a;
+  (void)na;
+  (void)b;
+  (void)nb;
+  (void)out;
+  (void)is_union;
+  return false;
+#endif // CIM_SORTED_VECTOR_SIMD_X86
+}
 
-  return *this;
+template <class T, class Less>
+  bool set_operation(
+    const T *a,
+    size_t na,
+    const T *b,
+    size_t nb,
+    std::vector <T> &out,
+    bool is_union,
+    Less)
+{
+  //Векторные ядра применяются только к целым
+  //размером 32 и 64 бита в естественном порядке
+  return set_operation(
+    a,
+    na,
+    b,
+    nb,
+    out,
+    is_union,
+    std::integral_constant <bool,
+         (std::is_integral <T>::value)
+      && (!std::is_same <T, bool>::value)
+      && ((sizeof(T) == 4) || (sizeof(T) == 8))
+      && (std::is_same <Less, std::less <T> >::value)> ());
 }
 
-template <class T>
-  sorted_vector <T> &sorted_vector <T>::  operator=(
-    sorted_vector <T> &&sv)
+template <class T, class Less>
+  bool set_operation(
+    const std::vector <T> &a,
+    const std::vector <T> &b,
+    std::vector <T> &out,
+    bool is_union,
+    Less less)
 {
-  if (this == &sv)
-    return *this;
+  return set_operation(a.data(), a.size(), b.data(), b.size(), out, is_union, less);
+}
 
-  _storage = static_cast <std::vector <T> &&> (sv._storage);
-  _last_modified = sv._last_modified;
-  _is_corrupted = sv._is_corrupted;
-  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
-
-  sv._last_modified = (size_t)-1;
-  sv._is_corrupted = false;
-  sv._flag_suspend_autorepair = false;
-
-  return *this;
-}
-
-template <class T>
-  sorted_vector <T> sorted_vector <T>:: operator+(
-    const sorted_vector <T> &sv)
-    const
+template <class U>
+  size_t unpack(
+    const uint8_t *,
+    unsigned,
+    size_t,
+    U,
+    U *,
+    std::false_type)
 {
-  sorted_vector <T> rsv(*this);
-  rsv.merge(sv);
-  return rsv;
+  return 0;
 }
 
-template <class T>
-  sorted_vector <T> sorted_vector <T>:: operator+(
-    const std::vector <T> &v)
-    const
+template <class U>
+  size_t unpack(
+    const uint8_t *p,
+    unsigned width,
+    size_t count,
+    U first,
+    U *out,
+    std::true_type)
 {
-  sorted_vector <T> rsv(*this);
-  rsv.merge(v);
-  return rsv;
+#ifdef CIM_SORTED_VECTOR_SIMD_X86
+  if (detected_isa() != isa_avx2)
+    return 0;
+  return unpack_avx(p, width, count, first, out);
+#else
+  (void)p;
+  (void)width;
+  (void)count;
+  (void)first;
+  (void)out;
+  return 0;
+#endif // CIM_SORTED_VECTOR_SIMD_X86
 }
 
-template <class T>
-  sorted_vector <T> sorted_vector <T>:: operator+(
-    const T &t)
-    const
+template <class U>
+  size_t unpack(
+    const uint8_t *p,
+    unsigned width,
+    size_t count,
+    U first,
+    U *out)
 {
-  sorted_vector <T> rsv(*this);
-  rsv.push(t);
-  return rsv;
+  //Возвращает число распакованных значений;
+  //остаток распаковывается скалярно
+  return unpack(
+    p,
+    width,
+    count,
+    first,
+    out,
+    std::integral_constant <bool, (sizeof(U) == 4) || (sizeof(U) == 8)> ());
 }
 
-template <class T>
-  void sorted_vector <T>:: operator+=(
-    const sorted_vector <T> &sv)
-{
-  merge(sv);
 }
 
-template <class T>
-  void sorted_vector <T>:: operator+=(
-    const std::vector <T> &v)
+//***end SIMD kernels***
+
+enum search_strategy
 {
-  merge(v);
-}
+  search_binary,
+  search_interpolation
+};
 
-template <class T>
-  void sorted_vector <T>:: operator+=(
-    const T &t)
+struct sorted_vector_stats
 {
-  push(t);
-}
+  size_t full_sorts       = 0;  //Сортировки всего хранилища
+  size_t repairs          = 0;  //Восстановления одного элемента
+  size_t moved            = 0;  //Элементы, сдвинутые вставкой,
+                                //удалением и восстановлением
+  size_t searches         = 0;  //Поиски find, find_floor,
+                                //find_ceil, find_interpolated
+  size_t probes           = 0;  //Обращения к элементам в них
+  size_t linear_searches  = 0;  //Линейные поиски в испорченном
+                                //состоянии
+  size_t reallocations    = 0;  //Перераспределения хранилища
+};
 
-template <class T>
-  void sorted_vector <T>::  assign(
-    iterator first,
-    iterator last)
+#ifdef CIM_SORTED_VECTOR_STATS
+struct sorted_vector_counter
 {
-  if (  (first._owner == last._owner)
-      &&(first._owner != nullptr))
-  {
+  //Приращение - отдельные загрузка и запись: гонки данных
+  //нет, но при одновременном поиске из нескольких потоков
+  //часть приращений может потеряться. Атомарное приращение
+  //обошлось бы каждому поиску блокировкой шины
+  std::atomic <size_t> value{0};
 
-    _storage.assign(
-      first._owner->_storage.begin() + first._pos,
-      first._owner->_storage.begin() + last._pos);
+  void add(size_t n)
+  {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
 
-    sort();
+  size_t get() const
+  {
+    return value.load(std::memory_order_relaxed);
   }
+};
+#endif // CIM_SORTED_VECTOR_STATS
 
-}
+#ifdef CIM_SORTED_VECTOR_TRACE
 
-template <class T>
-  void sorted_vector <T>::  assign(
-    typename std::vector<T>::iterator first,
-    typename std::vector<T>::iterator last)
-{
-  _storage.assign(first, last);
-  sort();
-}
+//***Latency histograms***
 
-template <class T>
-  void sorted_vector <T>::  assign(
-    std::initializer_list <T> ilist)
+enum latency_operation
 {
-  _storage.assign(ilist);
-  sort();
-}
+  latency_find,
+  latency_push,
+  latency_erase,
+  latency_repair,
+  latency_sort,
+  latency_operations
+};
 
-template <class T>
-  T &sorted_vector <T>::  at(
-    size_t pos)
+class latency_histogram
 {
-  return _storage.at(pos);
-}
+  //Логарифмические корзины в духе HDR: значения до 8 нс
+  //точно, далее 8 корзин на каждую степень двойки
+  //(относительная погрешность не более 12.5%)
+  public:
+    static const size_t buckets = 496;
 
-template <class T>
-  const T &sorted_vector <T>::  at(
-    size_t pos)
-    const
+    latency_histogram();
+
+    void record(uint64_t ns, uint64_t count = 1);
+    void add(const latency_histogram &h);
+
+    uint64_t count()                const;
+    uint64_t bucket(size_t b)       const;
+    uint64_t percentile(double q)   const;
+    uint64_t max()                  const;
+
+    static size_t bucket_of(uint64_t ns);
+    static uint64_t lower_bound(size_t b);
+    static uint64_t upper_bound(size_t b);
+
+  private:
+    uint64_t _bucket[buckets];
+    uint64_t _count;
+};
+
+inline latency_histogram::  latency_histogram()
+  : _count(0)
 {
-  return _storage.at(pos);
+  std::fill(_bucket, _bucket + buckets, (uint64_t)0);
 }
 
-template <class T>
-  T &sorted_vector <T>:: operator[](
-    size_t pos)
+inline void latency_histogram:: record(
+  uint64_t ns,
+  uint64_t count)
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-  if (!_flag_suspend_autorepair)
-    repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  if (_is_corrupted)
-    _last_modified = -1;
-  else
-    _last_modified = pos;
-  _is_corrupted = true;
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-
-  return _storage[pos];
+  _bucket[bucket_of(ns)] += count;
+  _count += count;
 }
 
-template <class T>
-  const T &sorted_vector <T>:: operator[](
-    size_t pos)
-    const
+inline void latency_histogram:: add(
+  const latency_histogram &h)
 {
-  return static_cast <const T &> (_storage[pos]);
+  for (size_t b = 0; b < buckets; b++)
+    _bucket[b] += h._bucket[b];
+  _count += h._count;
 }
 
-template <class T>
-  T &sorted_vector <T>:: front()
+inline uint64_t latency_histogram:: count()
+  const
 {
-  return (*this)[0];
+  return _count;
 }
 
-template <class T>
-  const T &sorted_vector <T>:: front()
+inline uint64_t latency_histogram:: bucket(
+  size_t b)
   const
 {
-  return (*this)[0];
+  return _bucket[b];
 }
 
-template <class T>
-  T &sorted_vector <T>:: back()
+inline uint64_t latency_histogram:: percentile(
+  double q)
+  const
 {
-  return (*this)[_storage.size() - 1];
+  //Верхняя граница корзины, в которую попадает доля q
+  //значений; 0 для пустой гистограммы
+  if (_count == 0)
+    return 0;
+  uint64_t rank = (uint64_t)(q * (double)_count);
+  if (rank >= _count)
+    rank = _count - 1;
+  uint64_t seen = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    seen += _bucket[b];
+    if (seen > rank)
+      return upper_bound(b);
+  }
+  return 0;
 }
 
-template <class T>
-  const T &sorted_vector <T>:: back()
+inline uint64_t latency_histogram:: max()
   const
 {
-  return (*this)[_storage.size() - 1];
+  for (size_t b = buckets; b > 0; b--)
+    if (_bucket[b - 1] != 0)
+      return upper_bound(b - 1);
+  return 0;
 }
 
-template <class T>
-  typename sorted_vector <T>::iterator sorted_vector <T>:: begin()
+inline size_t latency_histogram:: bucket_of(
+  uint64_t ns)
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-  if (!_flag_suspend_autorepair)
-    repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  if (_is_corrupted)
-    _last_modified = -1;
-  else
-    _last_modified = 0;
-  _is_corrupted = true;
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  return iterator(0, this);
+  if (ns < 8)
+    return (size_t)ns;
+  unsigned e = 63;
+  while (!(ns >> e))
+    e--;
+  return (e - 2) * 8 + (size_t)((ns >> (e - 3)) & 7);
 }
 
-template <class T>
-  typename sorted_vector <T>::const_iterator sorted_vector <T>::  begin()
-  const
+inline uint64_t latency_histogram:: lower_bound(
+  size_t b)
 {
-  return cbegin();
+  if (b < 8)
+    return b;
+  unsigned e = (unsigned)(b / 8) + 2;
+  return (uint64_t)(8 + b % 8) << (e - 3);
 }
 
-template <class T>
-  typename sorted_vector <T>::const_iterator sorted_vector <T>::  cbegin()
-  const
+inline uint64_t latency_histogram:: upper_bound(
+  size_t b)
 {
-  return const_iterator(0, this);
+  if (b < 8)
+    return b;
+  unsigned e = (unsigned)(b / 8) + 2;
+  return lower_bound(b) + ((uint64_t)1 << (e - 3)) - 1;
 }
 
-template <class T>
-  typename sorted_vector <T>::iterator sorted_vector <T>:: end()
+//***Trace events***
+
+enum trace_event
 {
-  return iterator(size(), this);
-}
+  trace_repair_sort   //repair выполнил полную сортировку
+};
 
-template <class T>
-  typename sorted_vector <T>::const_iterator sorted_vector <T>::  end()
-  const
+struct sorted_vector_trace
 {
-  return cend();
-}
+  trace_event event;
+  const void  *instance;
+  size_t      size;
+  uint64_t    nanoseconds;
+};
 
-template <class T>
-  typename sorted_vector <T>::const_iterator sorted_vector <T>::  cend()
-  const
+typedef void (*sorted_vector_trace_callback)(const sorted_vector_trace &trace);
+
+namespace latency{
+
+struct thread_buckets
 {
-  return const_iterator(size(), this);
+  //Пишет только поток-владелец (загрузка и запись без
+  //атомарного приращения), читает снимок
+  std::atomic <uint64_t> bucket[latency_operations][latency_histogram::buckets];
+
+  thread_buckets()
+  {
+    for (size_t op = 0; op < latency_operations; op++)
+      for (size_t b = 0; b < latency_histogram::buckets; b++)
+        bucket[op][b].store(0, std::memory_order_relaxed);
+  }
+};
+
+struct registry
+{
+  std::mutex                      mutex;
+  std::vector <thread_buckets *>  threads;
+  latency_histogram               retired[latency_operations];
+};
+
+inline registry &instance()
+{
+  static registry r;
+  return r;
 }
 
-template <class T>
-  bool sorted_vector <T>::  empty()
-    const
+inline std::atomic <bool> &enabled()
 {
-  return _storage.empty();
+  static std::atomic <bool> flag(true);
+  return flag;
 }
 
-template <class T>
-  size_t sorted_vector <T>:: size()
-    const
+inline std::atomic <sorted_vector_trace_callback> &callback()
 {
-  return _storage.size();
+  static std::atomic <sorted_vector_trace_callback> cb(nullptr);
+  return cb;
 }
 
-template <class T>
-  size_t sorted_vector <T>::  max_size()
-  const
+struct thread_state
 {
-  return _storage.max_size();
+  //Корзины потока регистрируются при первом замере в
+  //потоке; при завершении потока его значения
+  //переносятся в общие гистограммы
+  thread_buckets  buckets;
+  unsigned        active = 0;
+
+  thread_state()
+  {
+    registry &r = instance();
+    std::lock_guard <std::mutex> lock(r.mutex);
+    r.threads.push_back(&buckets);
+  }
+
+  ~thread_state()
+  {
+    registry &r = instance();
+    std::lock_guard <std::mutex> lock(r.mutex);
+    for (size_t op = 0; op < latency_operations; op++)
+      for (size_t b = 0; b < latency_histogram::buckets; b++) {
+        uint64_t n = buckets.bucket[op][b].load(std::memory_order_relaxed);
+        if (n != 0)
+          r.retired[op].record(latency_histogram::lower_bound(b), n);
+      }
+    r.threads.erase(std::find(r.threads.begin(), r.threads.end(), &buckets));
+  }
+
+  static thread_state &current()
+  {
+    static thread_local thread_state state;
+    return state;
+  }
+};
+
+class timer
+{
+  //Замер от создания до уничтожения. Вложенный вызов
+  //той же операции (find_first -> find) не замеряется
+  public:
+    explicit timer(latency_operation op)
+      : _op(op), _state(nullptr)
+    {
+      if (!enabled().load(std::memory_order_relaxed))
+        return;
+      thread_state &s = thread_state::current();
+      if (s.active & (1u << op))
+        return;
+      s.active |= 1u << op;
+      _state = &s;
+      _start = std::chrono::steady_clock::now();
+    }
+
+    ~timer()
+    {
+      if (_state == nullptr)
+        return;
+      uint64_t ns = (uint64_t)std::chrono::duration_cast <std::chrono::nanoseconds> (
+        std::chrono::steady_clock::now() - _start).count();
+      std::atomic <uint64_t> &b = _state->buckets.bucket[_op][latency_histogram::bucket_of(ns)];
+      b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      _state->active &= ~(1u << _op);
+    }
+
+    timer(const timer &) = delete;
+    timer &operator=(const timer &) = delete;
+
+  private:
+    latency_operation                       _op;
+    thread_state                            *_state;
+    std::chrono::steady_clock::time_point   _start;
+};
+
+inline void trace(trace_event event, const void *instance, size_t size, uint64_t ns)
+{
+  sorted_vector_trace_callback cb = callback().load(std::memory_order_acquire);
+  if (cb == nullptr)
+    return;
+  sorted_vector_trace trace;
+  trace.event = event;
+  trace.instance = instance;
+  trace.size = size;
+  trace.nanoseconds = ns;
+  cb(trace);
 }
 
-template <class T>
-  void sorted_vector <T>::  reserve(
-    size_t n)
+}
+
+inline latency_histogram sorted_vector_latency(
+  latency_operation op)
 {
-  _storage.reserve(n);
+  //Сумма по всем потокам, включая завершившиеся
+  latency::registry &r = latency::instance();
+  std::lock_guard <std::mutex> lock(r.mutex);
+  latency_histogram h = r.retired[op];
+  for (size_t t = 0; t < r.threads.size(); t++)
+    for (size_t b = 0; b < latency_histogram::buckets; b++) {
+      uint64_t n = r.threads[t]->bucket[op][b].load(std::memory_order_relaxed);
+      if (n != 0)
+        h.record(latency_histogram::lower_bound(b), n);
+    }
+  return h;
 }
 
-template <class T>
-  size_t sorted_vector <T>::  capacity()
-    const
+inline void sorted_vector_latency_reset()
 {
-  return _storage.capacity();
+  //Замер, завершающийся одновременно со сбросом, может
+  //остаться в гистограмме
+  latency::registry &r = latency::instance();
+  std::lock_guard <std::mutex> lock(r.mutex);
+  for (size_t op = 0; op < latency_operations; op++) {
+    r.retired[op] = latency_histogram();
+    for (size_t t = 0; t < r.threads.size(); t++)
+      for (size_t b = 0; b < latency_histogram::buckets; b++)
+        r.threads[t]->bucket[op][b].store(0, std::memory_order_relaxed);
+  }
 }
 
-template <class T>
-  void sorted_vector <T>::  shrink_to_fit()
+inline void sorted_vector_latency_enable(
+  bool enable)
 {
-  _storage.shrink_to_fit();
+  latency::enabled().store(enable, std::memory_order_relaxed);
 }
 
-template <class T>
-  void sorted_vector <T>:: clear()
+inline void set_sorted_vector_trace_callback(
+  sorted_vector_trace_callback cb)
 {
-  _storage.clear();
-  _last_modified = (size_t)-1;
-  _is_corrupted = false;
+  latency::callback().store(cb, std::memory_order_release);
 }
 
-template <class T>
-  void sorted_vector <T>:: erase(
-    size_t pos)
+#endif // CIM_SORTED_VECTOR_TRACE
+
+//***Branchless search***
+
+//Число начальных позиций [0, n), для которых before
+//истинно (before монотонно: истинно на начальном
+//участке). Поиск без ветвлений: на каждом шаге начало
+//окна сдвигается на половину условной пересылкой, так
+//что число шагов зависит только от n
+template <class Before>
+  size_t sorted_vector_partition_point(
+    size_t n,
+    Before before)
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  if (n == 0)
+    return 0;
+  size_t first = 0;
+  size_t len = n;
+  while (len > 1) {
+    size_t half = len / 2;
+    first = before(first + half - 1) ? first + half : first;
+    len -= half;
   }
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  return first + (before(first) ? 1 : 0);
+}
 
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-  _storage.erase(_storage.begin() + pos);
-#else
-  single_shift_left(pos);
-  _storage.pop_back();
-#endif
-}
+//***Storage buffer***
 
 template <class T>
-  void sorted_vector <T>::  erase(
-    iterator first,
-    iterator last)
+  class sorted_vector_buffer
 {
-  if (  (first._owner == this)
-      &&(last._owner == this))
-    erase(first.pos(), last.pos() - 1);
-}
+  //Хранилище sorted_vector: std::vector со смещённым
+  //началом. Элементы [0, _head) удалены из начала
+  //(перемещены, но не разрушены), поэтому удаление и
+  //вставка сдвигают ближнюю к позиции часть - начальную
+  //или конечную, как в std::deque. Удалённых из начала
+  //всегда меньше, чем оставшихся: иначе элементы
+  //переносятся в начало вектора. В плотном режиме
+  //(set_packed) начало не смещается, и cvector
+  //содержит ровно элементы буфера
+  public:
+    typedef T *       iterator;
+    typedef const T * const_iterator;
 
-template <class T>
-  void sorted_vector <T>::  erase(
-    size_t pos_start,
-    size_t pos_end)
-{
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-#ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-#endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  }
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+    sorted_vector_buffer();
+    sorted_vector_buffer(const sorted_vector_buffer <T> &b);
+    sorted_vector_buffer(sorted_vector_buffer <T> &&b);
 
-  _storage.erase(
-    _storage.begin() + pos_start,
-    _storage.begin() + pos_end + 1);
-}
+    sorted_vector_buffer <T> &operator=(const sorted_vector_buffer <T> &b);
+    sorted_vector_buffer <T> &operator=(sorted_vector_buffer <T> &&b);
+    sorted_vector_buffer <T> &operator=(const std::vector <T> &v);
+    sorted_vector_buffer <T> &operator=(std::vector <T> &&v);
 
-template <class T>
-  void sorted_vector <T>:: push(
-    const T &t)
-{
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-#ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-#endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  }
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (!_is_corrupted) {
-    if (_storage.size() == 0) {
-      _storage.push_back(t);
-      return;
-    }
-    size_t pos = find_ceil(t);
-    if (pos == (size_t)-1)
-      _storage.push_back(t);
-    else {
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-      if (_storage[pos] == t)
+    std::vector <T> &vector();
+    const std::vector <T> &cvector() const;
+    size_t head()                     const;
 
-        _storage.insert(
-          _storage.begin() + pos + 1,
-          t);
+    void set_packed(bool packed);
+    bool packed()                     const;
 
-      else
+    iterator begin();
+    iterator end();
+    const_iterator begin()  const;
+    const_iterator end()    const;
 
-        _storage.insert(
-          _storage.begin() + pos,
-          t);
+    T *data();
+    const T *data() const;
 
-#else
-      _storage.push_back(t);
-      char buf[sizeof(T)];
-      if (_storage[pos] == t) {
+    bool empty()        const;
+    size_t size()       const;
+    size_t capacity()   const;
+    size_t max_size()   const;
 
-        memcpy(
-          reinterpret_cast <void *> (buf),
-          reinterpret_cast <void *> (&_storage.back()),
-          sizeof(T));
+    T &operator[](size_t pos);
+    const T &operator[](size_t pos) const;
+    T &at(size_t pos);
+    const T &at(size_t pos)         const;
+    T &front();
+    const T &front()                const;
+    T &back();
+    const T &back()                 const;
 
-        single_shift_right(pos + 1);
+    void reserve(size_t n);
+    void shrink_to_fit();
+    void clear();
 
-        memcpy(
-          reinterpret_cast <void *> (&_storage[pos + 1]),
-          reinterpret_cast <void *> (&buf),
-          sizeof(T));
+    void push_back(const T &t);
+    void push_back(T &&t);
+    template <class... Args>
+      void emplace_back(Args &&... args);
+    void pop_back();
+
+    iterator insert(const_iterator pos, const T &t);
+    iterator insert(const_iterator pos, T &&t);
+    template <class InputIt>
+      void insert(const_iterator pos, InputIt first, InputIt last);
+    iterator erase(const_iterator pos);
+    iterator erase(const_iterator first, const_iterator last);
+
+    template <class InputIt>
+      void assign(InputIt first, InputIt last);
+    void assign(std::initializer_list <T> ilist);
+    void swap(std::vector <T> &v);
 
-      } else {
+    size_t insert_moves(size_t pos)               const;
+    size_t erase_moves(size_t first, size_t last) const;
 
-        memcpy(
-          reinterpret_cast <void *> (buf),
-          reinterpret_cast <void *> (&_storage.back()),
-          sizeof(T));
+  private:
+    template <class U>
+      iterator insert_one(size_t pos, U &&t);
 
-        single_shift_right(pos);
+    void release(size_t first, size_t last);
 
-        memcpy(
-          reinterpret_cast <void *> (&_storage[pos]),
-          reinterpret_cast <void *> (&buf),
-          sizeof(T));
-      }
-#endif
-    }
-  } else {
-    _storage.push_back(t);
-  }
+    std::vector <T> _storage;
+    size_t          _head;
+    bool            _packed;
+};
+
+template <class T>
+  sorted_vector_buffer <T>::  sorted_vector_buffer()
+  : _head(0), _packed(false)
+{}
+
+template <class T>
+  sorted_vector_buffer <T>::  sorted_vector_buffer(
+    const sorted_vector_buffer <T> &b)
+  : _storage(b.begin(), b.end()), _head(0), _packed(b._packed)
+{}
+
+template <class T>
+  sorted_vector_buffer <T>::  sorted_vector_buffer(
+    sorted_vector_buffer <T> &&b)
+  : _storage(static_cast <std::vector <T> &&> (b._storage)), _head(b._head), _packed(b._packed)
+{
+  b._storage.clear();
+  b._head = 0;
 }
 
 template <class T>
-  void sorted_vector <T>:: push(
-    T &&t)
+  sorted_vector_buffer <T> &sorted_vector_buffer <T>::  operator=(
+    const sorted_vector_buffer <T> &b)
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  //Режим остаётся прежним: он задаётся владельцем
+  if (this != &b) {
+    _storage.assign(b.begin(), b.end());
+    _head = 0;
   }
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (!_is_corrupted) {
-    if (_storage.size() == 0) {
-      _storage.push_back(static_cast <T &&> (t));
-      return;
-    }
-    size_t pos = find_ceil(t);
-    if (pos == -1)
-      _storage.push_back(static_cast <T &&> (t));
-    else
-    {
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-      if (_storage[pos] == t)
+  return *this;
+}
 
-        _storage.insert(
-          _storage.begin() + pos + 1,
-          static_cast <T &&> (t));
+template <class T>
+  sorted_vector_buffer <T> &sorted_vector_buffer <T>::  operator=(
+    sorted_vector_buffer <T> &&b)
+{
+  //Режим остаётся прежним: он задаётся владельцем
+  if (this != &b) {
+    _storage = static_cast <std::vector <T> &&> (b._storage);
+    _head = b._head;
+    b._storage.clear();
+    b._head = 0;
+    if (_packed)
+      vector();
+  }
+  return *this;
+}
 
-      else
+template <class T>
+  sorted_vector_buffer <T> &sorted_vector_buffer <T>::  operator=(
+    const std::vector <T> &v)
+{
+  _storage = v;
+  _head = 0;
+  return *this;
+}
 
-        _storage.insert(
-          _storage.begin() + pos,
-          static_cast <T &&> (t));
+template <class T>
+  sorted_vector_buffer <T> &sorted_vector_buffer <T>::  operator=(
+    std::vector <T> &&v)
+{
+  _storage = static_cast <std::vector <T> &&> (v);
+  _head = 0;
+  return *this;
+}
 
-#else
-      _storage.push_back(static_cast <T &&> (t));
+template <class T>
+  std::vector <T> &sorted_vector_buffer <T>::  vector()
+{
+  //Вектор без удалённого начала: элементы
+  //переносятся в начало
+  if (_head > 0) {
+    _storage.erase(_storage.begin(), _storage.begin() + _head);
+    _head = 0;
+  }
+  return _storage;
+}
 
-      char buf[sizeof(T)];
+template <class T>
+  const std::vector <T> &sorted_vector_buffer <T>::  cvector()
+  const
+{
+  //Вектор целиком, включая удалённое начало
+  //(head элементов)
+  return _storage;
+}
 
-      if (_storage[pos] == t)
-      {
-        memcpy(
-          reinterpret_cast <void *> (buf),
-          reinterpret_cast <void *> (&_storage.back()),
-          sizeof(T));
+template <class T>
+  size_t sorted_vector_buffer <T>::  head()
+  const
+{
+  return _head;
+}
 
-        single_shift_right(pos + 1);
+template <class T>
+  void sorted_vector_buffer <T>::  set_packed(
+    bool packed)
+{
+  _packed = packed;
+  if (_packed)
+    vector();
+}
 
-        memcpy(
-          reinterpret_cast <void *> (&_storage[pos + 1]),
-          reinterpret_cast <void *> (&buf),
-          sizeof(T));
+template <class T>
+  bool sorted_vector_buffer <T>::  packed()
+  const
+{
+  return _packed;
+}
 
-      } else {
+template <class T>
+  typename sorted_vector_buffer <T>::iterator sorted_vector_buffer <T>::  begin()
+{
+  return _storage.data() + _head;
+}
 
-        memcpy(
-          reinterpret_cast <void *> (buf),
-          reinterpret_cast <void *> (&_storage.back()),
-          sizeof(T));
+template <class T>
+  typename sorted_vector_buffer <T>::iterator sorted_vector_buffer <T>::  end()
+{
+  return _storage.data() + _storage.size();
+}
 
-        single_shift_right(pos);
+template <class T>
+  typename sorted_vector_buffer <T>::const_iterator sorted_vector_buffer <T>::  begin()
+  const
+{
+  return _storage.data() + _head;
+}
 
-        memcpy(
-          reinterpret_cast <void *> (&_storage[pos]),
-          reinterpret_cast <void *> (&buf),
-          sizeof(T));
-      }
-#endif
-    }
-  } else {  //corrupted
-    _storage.push_back(static_cast <T &&> (t));
-  }
+template <class T>
+  typename sorted_vector_buffer <T>::const_iterator sorted_vector_buffer <T>::  end()
+  const
+{
+  return _storage.data() + _storage.size();
 }
 
 template <class T>
-  void sorted_vector <T>:: replace(
-    const T &t)
+  T *sorted_vector_buffer <T>::  data()
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  }
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  size_t pos = find(t);
-  if (pos != (size_t)-1)
-    _storage[pos] = t;
-  else
-    push(t);
+  return _storage.data() + _head;
 }
 
 template <class T>
-  void sorted_vector <T>:: replace(
-    T &&t)
+  const T *sorted_vector_buffer <T>::  data()
+  const
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  }
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  size_t pos = find(t);
-  if (pos != (size_t)-1)
-    _storage[pos] = static_cast <T &&>(t);
-  else
-    push(static_cast <T &&>(t));
+  return _storage.data() + _head;
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
-    const
+  bool sorted_vector_buffer <T>::  empty()
+  const
 {
-  if (_storage.empty())
-    return -1;
-  if (!_is_corrupted) {
-    size_t f = start_pos;
-    size_t l = (end_pos == (size_t)-1) ? _storage.size() - 1 : end_pos;
-    size_t m = (f + l) / 2;
-    while (f <= l) {
-      if (_storage[m] == t)
-        return m;
-      else if (_storage[f] == t)
-        return f;
-      else if (_storage[l] == t)
-        return l;
-      else {
-        if (_storage[m] < t) {
-          f = m + 1;
-        } else {
-          {
-            if (m == 0)
-              return -1;
-            l = m - 1;
-          }
-        }
-        m = (l + f) / 2;
-      }
-    }
-    return -1;
-  } else {
-    return find_linear(t, start_pos, end_pos);
-  }
+  return _storage.size() == _head;
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find_first(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
-    const
+  size_t sorted_vector_buffer <T>::  size()
+  const
 {
-  if (_storage.empty())
-    return -1;
-  if (end_pos == -1)
-    end_pos = _storage.size() - 1;
-  if (!_is_corrupted) {
-    size_t pos = find(t, start_pos, end_pos);
-    if (pos == -1)
-      return -1;
-    size_t prev_pos;
-    while (   (t == _storage[pos])
-           && (pos >= start_pos))
-      prev_pos = pos--;
-    return prev_pos;
-  } else {
-    return find_linear_first(t, start_pos, end_pos);
-  }
+  return _storage.size() - _head;
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find_last(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
-    const
+  size_t sorted_vector_buffer <T>::  capacity()
+  const
 {
-  if (end_pos == -1)
-    end_pos = _storage.size() - 1;
-  if (!_is_corrupted) {
-    size_t pos = find(t, start_pos, end_pos);
-    if (pos == -1)
-      return -1;
-    size_t prev_pos;
-    while (   (t == _storage[pos])
-           && (pos <= end_pos))
-      prev_pos = pos++;
-    return prev_pos;
-  } else {
-    return find_linear_last(t);
-  }
+  return _storage.capacity() - _head;
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find_next(
-    size_t current_pos,
-    size_t end_pos)
-    const
+  size_t sorted_vector_buffer <T>::  max_size()
+  const
 {
-  if (end_pos == -1)
-    end_pos = _storage.size() - 1;
-  if (current_pos == end_pos)
-    return -1;
-  if (!_is_corrupted) {
-    if (  _storage[current_pos]
-        ==_storage[current_pos + 1])
-      return ++current_pos;
-    else
-      return -1;
-  } else {
-    return find_first(_storage[current_pos], current_pos + 1, end_pos);
-  }
+  return _storage.max_size();
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find_prev(
-    size_t current_pos,
-    size_t start_pos)
+  T &sorted_vector_buffer <T>::  operator[](
+    size_t pos)
+{
+  return _storage[_head + pos];
+}
+
+template <class T>
+  const T &sorted_vector_buffer <T>::  operator[](
+    size_t pos)
     const
 {
-  if (current_pos <= start_pos)
-    return -1;
-  if (!_is_corrupted)
-  {
-    if (  _storage[current_pos]
-        ==_storage[current_pos - 1])
-      return --current_pos;
-    else
-      return -1;
-  } else {
+  return _storage[_head + pos];
+}
 
-    return find_last(
-      _storage[current_pos],
-      start_pos,
-      current_pos - 1);
-  }
+template <class T>
+  T &sorted_vector_buffer <T>::  at(
+    size_t pos)
+{
+  return _storage.at(_head + pos);
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find_linear(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
+  const T &sorted_vector_buffer <T>::  at(
+    size_t pos)
     const
 {
-  if (size() == 0)
-    return (size_t)-1;
+  return _storage.at(_head + pos);
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = size() - 1;
+template <class T>
+  T &sorted_vector_buffer <T>::  front()
+{
+  return _storage[_head];
+}
 
-  if (start_pos > end_pos)
-    return -1;
+template <class T>
+  const T &sorted_vector_buffer <T>::  front()
+  const
+{
+  return _storage[_head];
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = _storage.size() - 1;
+template <class T>
+  T &sorted_vector_buffer <T>::  back()
+{
+  return _storage.back();
+}
 
-  while (start_pos != end_pos)
-  {
-    if (_storage[start_pos++] == t)
-      return start_pos - 1;
-  }
-  return -1;
+template <class T>
+  const T &sorted_vector_buffer <T>::  back()
+  const
+{
+  return _storage.back();
 }
 
 template <class T>
-  size_t sorted_vector <T>::  find_linear_first(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
-    const
+  void sorted_vector_buffer <T>::  reserve(
+    size_t n)
 {
-  if (size() == 0)
-    return -1;
+  if (_head + n > _storage.capacity())
+    vector().reserve(n);
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = size() - 1;
+template <class T>
+  void sorted_vector_buffer <T>::  shrink_to_fit()
+{
+  vector().shrink_to_fit();
+}
 
-  if (start_pos > end_pos)
-    return -1;
+template <class T>
+  void sorted_vector_buffer <T>::  clear()
+{
+  _storage.clear();
+  _head = 0;
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = _storage.size() - 1;
+template <class T>
+  void sorted_vector_buffer <T>::  push_back(
+    const T &t)
+{
+  _storage.push_back(t);
+}
 
-  while (start_pos != end_pos)
-  {
-    if (_storage[start_pos++] == t)
-      return start_pos - 1;
-  }
-  return -1;
+template <class T>
+  void sorted_vector_buffer <T>::  push_back(
+    T &&t)
+{
+  _storage.push_back(static_cast <T &&> (t));
 }
 
 template <class T>
-  size_t sorted_vector <T>::  find_linear_last(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
-    const
+  template <class... Args>
+  void sorted_vector_buffer <T>::  emplace_back(
+    Args &&... args)
 {
-  if (size() == 0)
-    return -1;
+  _storage.emplace_back(static_cast <Args &&> (args)...);
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = size() - 1;
+template <class T>
+  void sorted_vector_buffer <T>::  pop_back()
+{
+  _storage.pop_back();
+  if (_storage.size() == _head)
+    clear();
+}
 
-  if (start_pos > end_pos)
-    return -1;
+template <class T>
+  typename sorted_vector_buffer <T>::iterator sorted_vector_buffer <T>::  insert(
+    const_iterator pos,
+    const T &t)
+{
+  //Вставляемый элемент может принадлежать буферу,
+  //и сдвиг начала переместил бы его
+  if (  (&t >= data())
+      &&(&t < data() + size()))
+    return insert_one(pos - data(), T(t));
+  return insert_one(pos - data(), t);
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = _storage.size() - 1;
+template <class T>
+  typename sorted_vector_buffer <T>::iterator sorted_vector_buffer <T>::  insert(
+    const_iterator pos,
+    T &&t)
+{
+  return insert_one(pos - data(), static_cast <T &&> (t));
+}
 
-  while (start_pos != end_pos)
-  {
-    if (_storage[end_pos--] == t)
-      return end_pos + 1;
-  }
-  return -1;
+template <class T>
+  template <class InputIt>
+  void sorted_vector_buffer <T>::  insert(
+    const_iterator pos,
+    InputIt first,
+    InputIt last)
+{
+  _storage.insert(_storage.begin() + _head + (pos - data()), first, last);
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find_floor(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
-    const
+  typename sorted_vector_buffer <T>::iterator sorted_vector_buffer <T>::  erase(
+    const_iterator pos)
 {
-  if (_storage.empty())
-    return -1;
-  end_pos = (end_pos == (size_t)-1 ? _storage.size() - 1 : end_pos);
-  if (!_is_corrupted) {
-    if (_storage[start_pos] > t)
-      return -1;
-    if (_storage[end_pos] < t)
-      return end_pos;
-    size_t f = start_pos;
-    size_t l = end_pos;
-    size_t m = (f + l) / 2;
-    while (f < l) {
-      if (_storage[m] == t) {
-        while (m-- > f) {
-          if (!(_storage[m] == t))
-            return m + 1;
-        }
-        return f;
-      }
-      if (_storage[m] < t)
-        f = m + 1;
-      else
-        l = m - 1;
-      m = (l + f) / 2;
-    }
-    if (_storage[m] == t)
-      return m;
-    else
-    if (_storage[m] < t)
-      return m;
-    else
-      return m - 1;
-  } else {  //is_corrupted
-    return -1;
-  }
+  return erase(pos, pos + 1);
 }
 
 template <class T>
-  size_t sorted_vector <T>:: find_ceil(
-    const T &t,
-    size_t start_pos,
-    size_t end_pos)
-    const
+  typename sorted_vector_buffer <T>::iterator sorted_vector_buffer <T>::  erase(
+    const_iterator first,
+    const_iterator last)
 {
-  if (_storage.empty())
-    return -1;
-  end_pos = (end_pos == (size_t)-1 ? _storage.size() - 1 : end_pos);
-  if (!_is_corrupted)
-  {
-    if (_storage[0] > t)
-      return 0;
-    if (_storage[end_pos] < t)
-      return -1;
-    size_t f = start_pos;
-    size_t l = end_pos;
-    size_t m = (f + l) / 2;
-    while (f < l) {
-      if (_storage[m] == t) {
-        while (m++ < l) {
-          if (!(_storage[m] == t))
-            return m - 1;
-        }
-        return l;
-      }
-      if (_storage[m] < t)
-        f = m + 1;
-      else
-        l = m - 1;
-      m = (f + l) / 2;
-    }
-    if (_storage[m] == t)
-      return m;
-    else if (_storage[m] > t)
-      return m;
-    else
-      return m + 1;
-  } else {
-    return -1;
+  size_t a = first - data();
+  size_t b = last - data();
+  if (a == b)
+    return data() + a;
+  if (  (!_packed)
+      &&(a < size() - b)) {
+    //Начальная часть сдвигается вправо на место
+    //удалённых, начало буфера смещается
+    T *d = data();
+    std::move_backward(d, d + a, d + b);
+    release(_head, _head + (b - a));
+    _head += b - a;
+    if (_head >= size())
+      vector();
+    return data() + a;
   }
+  _storage.erase(_storage.begin() + _head + a, _storage.begin() + _head + b);
+  if (_storage.size() == _head)
+    clear();
+  return data() + a;
 }
 
 template <class T>
-  void sorted_vector <T>:: sort()
+  template <class InputIt>
+  void sorted_vector_buffer <T>::  assign(
+    InputIt first,
+    InputIt last)
 {
-  std::sort(_storage.begin(), _storage.end());
-  _is_corrupted = false;
+  _storage.assign(first, last);
+  _head = 0;
 }
 
 template <class T>
-  void sorted_vector <T>:: repair()
+  void sorted_vector_buffer <T>::  assign(
+    std::initializer_list <T> ilist)
 {
-  if (_is_corrupted) {
-    if (_last_modified == (size_t)-1)
-      sort();
-    else {
-      _is_corrupted = false;
+  _storage.assign(ilist);
+  _head = 0;
+}
 
-      if (  (_last_modified > 0)
-          &&(   _storage[_last_modified]
-              < _storage[_last_modified - 1])) {
+template <class T>
+  void sorted_vector_buffer <T>::  swap(
+    std::vector <T> &v)
+{
+  vector().swap(v);
+}
 
-        size_t pos_ceil = find_ceil(
-          _storage[_last_modified],
-          0,
-          _last_modified-1);
+template <class T>
+  size_t sorted_vector_buffer <T>::  insert_moves(
+    size_t pos)
+    const
+{
+  //Число элементов, которые сдвинет вставка в pos
+  if (  (_head > 0)
+      &&(pos < size() - pos))
+    return pos;
+  return size() - pos;
+}
 
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-        T t(static_cast <T &&> (_storage[_last_modified]));
-#endif
-#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
-        char t[sizeof(T)];
-        memcpy(t, &_storage[_last_modified], sizeof(T));
-#endif
+template <class T>
+  size_t sorted_vector_buffer <T>::  erase_moves(
+    size_t first,
+    size_t last)
+    const
+{
+  //Число элементов, которые сдвинет удаление
+  //[first, last)
+  if (  (!_packed)
+      &&(first < size() - last))
+    return first;
+  return size() - last;
+}
+
+//***private methods***
+
+template <class T>
+  template <class U>
+  typename sorted_vector_buffer <T>::iterator sorted_vector_buffer <T>::  insert_one(
+    size_t pos,
+    U &&t)
+{
+  if (  (_head > 0)
+      &&(pos < size() - pos)) {
+    //Начальная часть сдвигается влево на место
+    //последнего удалённого из начала элемента
+    T *first = _storage.data() + _head - 1;
+    std::move(first + 1, first + 1 + pos, first);
+    first[pos] = static_cast <U &&> (t);
+    _head--;
+    return first + pos;
+  }
+  return &*_storage.insert(_storage.begin() + _head + pos, static_cast <U &&> (t));
+}
+
+template <class T>
+  void sorted_vector_buffer <T>::  release(
+    size_t first,
+    size_t last)
+{
+  //Удалённые из начала элементы остаются в векторе
+  //перемещёнными, освобождая свои ресурсы
+  if (!std::is_trivially_destructible <T>::value)
+    for (size_t i = first; i < last; i++) {
+      T released(static_cast <T &&> (_storage[i]));
+      (void)released;
+    }
+}
+
+template <class T>
+  class sorted_vector_iterator;
+
+template <class T>
+  class sorted_vector_const_iterator;
+
+template <class T>
+  class sorted_vector_view;
+
+template <class T>
+  class frozen_sorted_vector;
+
+template <class T>
+  class cracked_sorted_vector;
+
+template <class T>
+  class sorted_set;
+
+template <class K, class V>
+  class sorted_map;
+
+template <class T>
+  class sorted_vector
+{
+  public:
+    sorted_vector();
+    sorted_vector(const sorted_vector <T> &sv);
+    sorted_vector(sorted_vector <T> &&sv);
+    sorted_vector(std::initializer_list <T> ilist);
+    sorted_vector(const std::vector <T> &v);
+    sorted_vector(std::vector <T> &&v);
+
+    virtual ~sorted_vector(){};
+
+    sorted_vector <T> &operator=(const sorted_vector <T> &sv);
+    sorted_vector <T> &operator=(sorted_vector <T> &&sv);
+
+    sorted_vector <T> operator+(const sorted_vector <T> &sv) const;
+    sorted_vector <T> operator+(const std::vector <T> &v) const;
+    sorted_vector <T> operator+(const T &t) const;
+
+    void operator+=(const sorted_vector <T> &sv);
+    void operator+=(const std::vector <T> &v);
+    void operator+=(const T &t);
+
+  typedef sorted_vector_iterator <T>        iterator;
+  typedef sorted_vector_const_iterator <T>  const_iterator;
+
+    void assign(iterator first, iterator last);
+    void assign(typename std::vector<T>::iterator first, typename std::vector<T>::iterator last);
+    void assign(std::initializer_list <T> ilist);
+    void assign_sorted(std::vector <T> &&v);
+
+    frozen_sorted_vector <T> freeze();
+    cracked_sorted_vector <T> crack();
+
+    T       &at(size_t pos);
+    const T &at(size_t pos) const;
+
+    T       &operator[](size_t pos);
+    const T &operator[](size_t pos) const;
+
+    T       &front();
+    const T &front() const;
+
+    T       &back();
+    const T &back() const;
+
+    iterator        begin();
+    const_iterator  begin()   const;
+    const_iterator  cbegin()  const;
+
+    iterator        end();
+    const_iterator  end()     const;
+    const_iterator  cend()    const;
+
+    bool empty()      const;
+    size_t size()     const;
+    size_t max_size() const;
+
+    void reserve(size_t n);
+
+    size_t capacity() const;
+
+    void shrink_to_fit();
+
+    void clear();
+
+    void erase(size_t pos);
+    void erase(iterator first, iterator last);
+    void erase(size_t pos_start, size_t pos_end);
+    void pop_front();
+
+    template <class Pred>
+      size_t erase_if(Pred pred);
+
+    template <class InputIt>
+      size_t erase_keys(InputIt first, InputIt last);
+
+    template <class InputIt>
+      size_t erase_positions(InputIt first, InputIt last);
+
+    void push(const T &t);
+    void push(T &&t);
+
+    void replace(const T &t);
+    void replace(T &&t);
+
+    template <class InputIt>
+      void push_batch(InputIt first, InputIt last);
+
+    template <class Range>
+      void insert_range(Range &&range);
+
+    template <class... Args>
+      size_t emplace(Args &&... args);
+
+    template <class... Args>
+      size_t emplace_hint(size_t hint, Args &&... args);
+
+    size_t find(const T &t, size_t start_pos = 0, size_t end_pos = -1)              const;
+
+    size_t find_first(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)         const;
+    size_t find_next(size_t current_pos, size_t end_pos = -1)                       const;
+    size_t find_prev(size_t current_pos, size_t start_pos = 0)                      const;
+
+    size_t find_linear(const T &t, size_t start_pos = 0, size_t end_pos = -1)       const;
+    size_t find_linear_first(const T &t, size_t start_pos = 0, size_t end_pos = -1) const;
+    size_t find_linear_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+
+    size_t find_floor(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_ceil(const T &t, size_t start_pos = 0, size_t end_pos = -1)         const;
+
+    size_t find_interpolated(const T &t, size_t start_pos = 0, size_t end_pos = -1) const;
+
+    void set_search_strategy(search_strategy strategy);
+    search_strategy get_search_strategy() const;
+
+    sorted_vector_view <T> range(const T &lo, const T &hi)  const;
+    sorted_vector_view <T> range(const T &lo, const T &hi);
+    size_t count_range(const T &lo, const T &hi)             const;
+    size_t erase_range(const T &lo, const T &hi);
+
+    size_t rank(const T &t)                                               const;
+    const T &select(size_t k)                                             const;
+    const T &select(size_t k);
+    const T &quantile(double q)                                           const;
+    const T &quantile(double q);
+    sorted_vector_view <T> percentile_range(double q_lo, double q_hi)     const;
+    sorted_vector_view <T> percentile_range(double q_lo, double q_hi);
+
+    void sort();
+    void repair();
+
+    void merge(const sorted_vector <T> &sv);
+    void merge(sorted_vector <T> &&sv);
+    void merge(const std::vector <T> &v);
+    void merge(std::vector <T> &&v);
+
+    void merge_replace(const sorted_vector <T> &sv);
+    void merge_replace(sorted_vector <T> &&sv);
+    void merge_replace(const std::vector <T> &sv);
+    void merge_replace(std::vector <T> &&sv);
+
+    void set_intersection(const sorted_vector <T> &sv, sorted_vector <T> &result)          const;
+    void set_difference(const sorted_vector <T> &sv, sorted_vector <T> &result)            const;
+    void set_union(const sorted_vector <T> &sv, sorted_vector <T> &result)                 const;
+    void set_symmetric_difference(const sorted_vector <T> &sv, sorted_vector <T> &result)  const;
+
+    bool corrupted() const;
+
+    sorted_vector_stats stats() const;
+    void reset_stats();
+
+    std::vector <T> &storage();
+    const std::vector <T> &cstorage();
+
+    T *data();
+    const T *data() const;
+
+    void suspend_autorepair();
+    void resume_autorepair();
+
+  protected:
+    void single_shift_left(size_t start_pos = 0, size_t end_pos = -1);
+    void single_shift_right(size_t start_pos = 0, size_t end_pos = -1);
+
+    //Сортировка хранилища в sort; потомок может
+    //заменить её (sorted_vector_with_key сортирует
+    //по целочисленному ключу поразрядно)
+    virtual void sort_elements(std::vector <T> &v) const;
+
+    static bool sort_runs(std::vector <T> &v);
+    static void sort_values(std::vector <T> &v, std::false_type);
+    static void sort_values(std::vector <T> &v, std::true_type);
+
+    template <class K>
+      static uint64_t radix_key(K k);
+
+    template <class X, class KeyOf>
+      static void radix_sort(std::vector <X> &v, std::vector <X> &tmp, size_t key_bytes, KeyOf key_of);
+
+    template <class KeyOf>
+      static void radix_sort_by(std::vector <T> &v, KeyOf key_of);
+
+    //Уведомления об изменении хранилища для потомков,
+    //поддерживающих сопутствующие структуры. Вызываются
+    //после изменения; позиции относятся к состоянию до
+    //изменения (on_erase) или после него (on_insert)
+    virtual void on_insert(size_t)          {}
+    virtual void on_erase(size_t, size_t)   {}
+    virtual void on_change(size_t)          {}
+    virtual void on_reset()                 {}
+
+    struct identity
+    {
+      const T &operator()(const T &t) const
+      {
+        return t;
+      }
+    };
+
+    template <class K, class Proj>
+      void bounds(const K &lo, const K &hi, Proj proj, size_t &first, size_t &last) const;
+
+    template <class K, class Proj>
+      sorted_vector_view <T> range_by(const K &lo, const K &hi, Proj proj) const;
+
+    template <class K, class Proj>
+      sorted_vector_view <T> range_by(const K &lo, const K &hi, Proj proj);
+
+    template <class K, class Proj>
+      size_t count_range_by(const K &lo, const K &hi, Proj proj) const;
+
+    template <class K, class Proj>
+      size_t erase_range_by(const K &lo, const K &hi, Proj proj);
+
+    template <class Remove>
+      size_t compact(size_t start, Remove remove);
+
+    void relocate(size_t to, size_t from, size_t count, std::true_type);
+    void relocate(size_t to, size_t from, size_t count, std::false_type);
+
+    template <class K, class Proj>
+      size_t rank_by(const K &k, Proj proj) const;
+
+    size_t quantile_pos(double q) const;
+    const T &select_unordered(size_t k) const;
+
+    size_t interpolation_bound(const T &t, size_t first, size_t last, bool upper) const;
+    size_t interpolation_bound(const T &t, size_t first, size_t last, bool upper, std::false_type) const;
+    size_t interpolation_bound(const T &t, size_t first, size_t last, bool upper, std::true_type) const;
+
+    template <class Less>
+      sorted_vector_view <T> sorted_storage(std::vector <T> &tmp, Less less) const;
+
+    template <class Less>
+      static size_t gallop_lower(const sorted_vector_view <T> &v, size_t from, const T &t, Less less);
+
+    template <class Less>
+      static void set_operation(
+        const sorted_vector <T> &a,
+        const sorted_vector <T> &b,
+        sorted_vector <T> &result,
+        bool emit_a,
+        bool emit_b,
+        bool emit_both,
+        Less less);
+
+    void count_reallocation(size_t old_capacity) const;
+
+    template <class Range>
+      void insert_range(Range &range, std::false_type);
+
+    template <class Range>
+      void insert_range(Range &range, std::true_type);
+
+    static void sort_batch(std::vector <T> &batch);
+
+    template <class X, class Before>
+      static size_t merge_backward(std::vector <X> &s, std::vector <X> &b, Before before);
+
+    void place_back(size_t pos);
+
+#ifdef CIM_SORTED_VECTOR_STATS
+    //Счётчики не копируются и не перемещаются вместе
+    //с экземпляром
+    mutable struct
+    {
+      sorted_vector_counter full_sorts;
+      sorted_vector_counter repairs;
+      sorted_vector_counter moved;
+      sorted_vector_counter searches;
+      sorted_vector_counter probes;
+      sorted_vector_counter linear_searches;
+      sorted_vector_counter reallocations;
+    } _stats;
+#endif // CIM_SORTED_VECTOR_STATS
+
+  private:
+    friend sorted_set <T>;
+    template <class K, class V>
+      friend class sorted_map;
+
+    sorted_vector_buffer <T>  _storage;
+    size_t                    _last_modified            = (size_t)-1;
+    bool                      _is_corrupted             = false;
+    bool                      _flag_suspend_autorepair  = false;
+    search_strategy           _search_strategy          = search_binary;
+};
+
+template <class T>
+  sorted_vector <T>:: sorted_vector() {};
+
+template <class T>
+  sorted_vector <T>:: sorted_vector(
+    const sorted_vector <T> &sv)
+  : _storage(sv._storage)
+{
+  //Буфер создаётся копированием, а не присваиванием:
+  //копия sorted_set и sorted_map сохраняет режим
+  //без смещения начала (set_packed)
+  _last_modified = sv._last_modified;
+  _is_corrupted = sv._is_corrupted;
+  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
+  _search_strategy = sv._search_strategy;
+}
+
+template <class T>
+  sorted_vector <T>:: sorted_vector(
+    sorted_vector <T> &&sv)
+  : _storage(static_cast <sorted_vector_buffer <T> &&> (sv._storage))
+{
+  _last_modified = sv._last_modified;
+  _is_corrupted = sv._is_corrupted;
+  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
+  _search_strategy = sv._search_strategy;
+
+  sv._last_modified = (size_t)-1;
+  sv._is_corrupted = false;
+  sv._flag_suspend_autorepair = false;
+  sv.on_reset();
+}
+
+template <class T>
+  sorted_vector <T>:: sorted_vector(
+    std::initializer_list <T> ilist)
+{
+  assign(ilist);
+}
+
+template <class T>
+  sorted_vector <T>:: sorted_vector(
+    const std::vector <T> &v)
+{
+  _storage = v;
+  sort();
+}
+
+template <class T>
+  sorted_vector <T>:: sorted_vector(
+    std::vector <T> &&v)
+{
+  _storage = static_cast <std::vector <T> &&>(v);
+  sort();
+}
+
+template <class T>
+  sorted_vector <T> &sorted_vector <T>::  operator=(
+    const sorted_vector <T> &sv)
+{
+  if (this == &sv)
+    return *this;
+
+  _storage = sv._storage;
+  _last_modified = sv._last_modified;
+  _is_corrupted = sv._is_corrupted;
+  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
+  _search_strategy = sv._search_strategy;
+  on_reset();
+
+  return *this;
+}
+
+template <class T>
+  sorted_vector <T> &sorted_vector <T>::  operator=(
+    sorted_vector <T> &&sv)
+{
+  if (this == &sv)
+    return *this;
+
+  _storage = static_cast <sorted_vector_buffer <T> &&> (sv._storage);
+  _last_modified = sv._last_modified;
+  _is_corrupted = sv._is_corrupted;
+  _flag_suspend_autorepair = sv._flag_suspend_autorepair;
+  _search_strategy = sv._search_strategy;
+
+  sv._last_modified = (size_t)-1;
+  sv._is_corrupted = false;
+  sv._flag_suspend_autorepair = false;
+  on_reset();
+  sv.on_reset();
+
+  return *this;
+}
+
+template <class T>
+  sorted_vector <T> sorted_vector <T>:: operator+(
+    const sorted_vector <T> &sv)
+    const
+{
+  sorted_vector <T> rsv(*this);
+  rsv.merge(sv);
+  return rsv;
+}
+
+template <class T>
+  sorted_vector <T> sorted_vector <T>:: operator+(
+    const std::vector <T> &v)
+    const
+{
+  sorted_vector <T> rsv(*this);
+  rsv.merge(v);
+  return rsv;
+}
+
+template <class T>
+  sorted_vector <T> sorted_vector <T>:: operator+(
+    const T &t)
+    const
+{
+  sorted_vector <T> rsv(*this);
+  rsv.push(t);
+  return rsv;
+}
+
+template <class T>
+  void sorted_vector <T>:: operator+=(
+    const sorted_vector <T> &sv)
+{
+  merge(sv);
+}
+
+template <class T>
+  void sorted_vector <T>:: operator+=(
+    const std::vector <T> &v)
+{
+  merge(v);
+}
+
+template <class T>
+  void sorted_vector <T>:: operator+=(
+    const T &t)
+{
+  push(t);
+}
+
+template <class T>
+  void sorted_vector <T>::  assign(
+    iterator first,
+    iterator last)
+{
+  if (  (first._owner == last._owner)
+      &&(first._owner != nullptr))
+  {
+
+    _storage.assign(
+      first._owner->_storage.begin() + first._pos,
+      first._owner->_storage.begin() + last._pos);
+
+    sort();
+  }
+
+}
+
+template <class T>
+  void sorted_vector <T>::  assign(
+    typename std::vector<T>::iterator first,
+    typename std::vector<T>::iterator last)
+{
+  _storage.assign(first, last);
+  sort();
+}
+
+template <class T>
+  void sorted_vector <T>::  assign(
+    std::initializer_list <T> ilist)
+{
+  _storage.assign(ilist);
+  sort();
+}
+
+template <class T>
+  void sorted_vector <T>::  assign_sorted(
+    std::vector <T> &&v)
+{
+  //v должен быть уже отсортирован по возрастанию
+  _storage = static_cast <std::vector <T> &&> (v);
+  _last_modified = (size_t)-1;
+  _is_corrupted = false;
+  on_reset();
+}
+
+template <class T>
+  T &sorted_vector <T>::  at(
+    size_t pos)
+{
+  return _storage.at(pos);
+}
+
+template <class T>
+  const T &sorted_vector <T>::  at(
+    size_t pos)
+    const
+{
+  return _storage.at(pos);
+}
+
+template <class T>
+  T &sorted_vector <T>:: operator[](
+    size_t pos)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+  if (!_flag_suspend_autorepair)
+    repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  if (_is_corrupted)
+    _last_modified = -1;
+  else
+    _last_modified = pos;
+  _is_corrupted = true;
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+
+  return _storage[pos];
+}
+
+template <class T>
+  const T &sorted_vector <T>:: operator[](
+    size_t pos)
+    const
+{
+  return static_cast <const T &> (_storage[pos]);
+}
+
+template <class T>
+  T &sorted_vector <T>:: front()
+{
+  return (*this)[0];
+}
+
+template <class T>
+  const T &sorted_vector <T>:: front()
+  const
+{
+  return (*this)[0];
+}
+
+template <class T>
+  T &sorted_vector <T>:: back()
+{
+  return (*this)[_storage.size() - 1];
+}
+
+template <class T>
+  const T &sorted_vector <T>:: back()
+  const
+{
+  return (*this)[_storage.size() - 1];
+}
+
+template <class T>
+  typename sorted_vector <T>::iterator sorted_vector <T>:: begin()
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+  if (!_flag_suspend_autorepair)
+    repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  if (_is_corrupted)
+    _last_modified = -1;
+  else
+    _last_modified = 0;
+  _is_corrupted = true;
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  return iterator(0, this);
+}
+
+template <class T>
+  typename sorted_vector <T>::const_iterator sorted_vector <T>::  begin()
+  const
+{
+  return cbegin();
+}
+
+template <class T>
+  typename sorted_vector <T>::const_iterator sorted_vector <T>::  cbegin()
+  const
+{
+  return const_iterator(0, this);
+}
+
+template <class T>
+  typename sorted_vector <T>::iterator sorted_vector <T>:: end()
+{
+  return iterator(size(), this);
+}
+
+template <class T>
+  typename sorted_vector <T>::const_iterator sorted_vector <T>::  end()
+  const
+{
+  return cend();
+}
+
+template <class T>
+  typename sorted_vector <T>::const_iterator sorted_vector <T>::  cend()
+  const
+{
+  return const_iterator(size(), this);
+}
+
+template <class T>
+  bool sorted_vector <T>::  empty()
+    const
+{
+  return _storage.empty();
+}
+
+template <class T>
+  size_t sorted_vector <T>:: size()
+    const
+{
+  return _storage.size();
+}
+
+template <class T>
+  size_t sorted_vector <T>::  max_size()
+  const
+{
+  return _storage.max_size();
+}
+
+template <class T>
+  void sorted_vector <T>::  reserve(
+    size_t n)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(n);
+  count_reallocation(capacity);
+}
+
+template <class T>
+  size_t sorted_vector <T>::  capacity()
+    const
+{
+  return _storage.capacity();
+}
+
+template <class T>
+  void sorted_vector <T>::  shrink_to_fit()
+{
+  _storage.shrink_to_fit();
+}
+
+template <class T>
+  void sorted_vector <T>:: clear()
+{
+  _storage.clear();
+  _last_modified = (size_t)-1;
+  _is_corrupted = false;
+  on_reset();
+}
+
+template <class T>
+  void sorted_vector <T>:: erase(
+    size_t pos)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_erase);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.erase_moves(pos, pos + 1));
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+  _storage.erase(_storage.begin() + pos);
+#else
+  //Побитово сдвигается только конечная часть
+  if (pos < _storage.size() - pos - 1)
+    _storage.erase(_storage.begin() + pos);
+  else {
+    single_shift_left(pos);
+    _storage.pop_back();
+  }
+#endif
+  on_erase(pos, pos + 1);
+}
+
+template <class T>
+  void sorted_vector <T>::  pop_front()
+{
+  //Начало хранилища смещается, остальные элементы
+  //не сдвигаются
+  erase(0);
+}
+
+template <class T>
+  void sorted_vector <T>::  erase(
+    iterator first,
+    iterator last)
+{
+  if (  (first._owner == this)
+      &&(last._owner == this))
+    erase(first.pos(), last.pos() - 1);
+}
+
+template <class T>
+  void sorted_vector <T>::  erase(
+    size_t pos_start,
+    size_t pos_end)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_erase);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+#ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+#endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.erase_moves(pos_start, pos_end + 1));
+  _storage.erase(
+    _storage.begin() + pos_start,
+    _storage.begin() + pos_end + 1);
+  on_erase(pos_start, pos_end + 1);
+}
+
+template <class T>
+  template <class Pred>
+  size_t sorted_vector <T>::  erase_if(
+    Pred pred)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_erase);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  const sorted_vector_buffer <T> &s = _storage;
+  return compact(
+    0,
+    [&](size_t i) { return pred(s[i]); });
+}
+
+template <class T>
+  template <class InputIt>
+  size_t sorted_vector <T>::  erase_keys(
+    InputIt first,
+    InputIt last)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_erase);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (first == last)
+    return 0;
+  const sorted_vector_buffer <T> &s = _storage;
+  if (_is_corrupted) {
+    std::vector <T> keys(first, last);
+    return compact(
+      0,
+      [&](size_t i) { return std::binary_search(keys.begin(), keys.end(), s[i]); });
+  }
+
+  //Ключи и элементы просматриваются одним
+  //совместным проходом, начиная с первого элемента,
+  //не меньшего наименьшего ключа
+  size_t start = std::lower_bound(s.begin(), s.end(), *first) - s.begin();
+  return compact(
+    start,
+    [&](size_t i) {
+      while (  (first != last)
+             &&(*first < s[i]))
+        ++first;
+      return (first != last) && (!(s[i] < *first));
+    });
+}
+
+template <class T>
+  template <class InputIt>
+  size_t sorted_vector <T>::  erase_positions(
+    InputIt first,
+    InputIt last)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_erase);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (first == last)
+    return 0;
+  size_t start = *first;
+  return compact(
+    start,
+    [&](size_t i) {
+      while (  (first != last)
+             &&(size_t(*first) < i))
+        ++first;
+      return (first != last) && (size_t(*first) == i);
+    });
+}
+
+template <class T>
+  void sorted_vector <T>:: push(
+    const T &t)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_push);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  size_t capacity = _storage.cvector().capacity();
+  //Элемент не меньше последнего (поток отметок времени)
+  //добавляется в конец после одного сравнения, без поиска
+  if (  (_is_corrupted)
+      ||(_storage.empty())
+      ||(!(t < _storage.back()))) {
+    _storage.push_back(t);
+    count_reallocation(capacity);
+    on_insert(_storage.size() - 1);
+    return;
+  }
+  size_t pos = find_ceil(t);
+  if (_storage[pos] == t)
+    pos++;
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.insert_moves(pos));
+  _storage.insert(
+    _storage.begin() + pos,
+    t);
+
+#else
+  _storage.push_back(t);
+
+  char buf[sizeof(T)];
+
+  memcpy(
+    reinterpret_cast <void *> (buf),
+    reinterpret_cast <void *> (&_storage.back()),
+    sizeof(T));
+
+  single_shift_right(pos);
+
+  memcpy(
+    reinterpret_cast <void *> (&_storage[pos]),
+    reinterpret_cast <void *> (&buf),
+    sizeof(T));
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.size() - pos - 1);
+#endif
+  count_reallocation(capacity);
+  on_insert(pos);
+}
+
+template <class T>
+  void sorted_vector <T>:: push(
+    T &&t)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_push);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  size_t capacity = _storage.cvector().capacity();
+  //Элемент не меньше последнего (поток отметок времени)
+  //добавляется в конец после одного сравнения, без поиска
+  if (  (_is_corrupted)
+      ||(_storage.empty())
+      ||(!(t < _storage.back()))) {
+    _storage.push_back(static_cast <T &&> (t));
+    count_reallocation(capacity);
+    on_insert(_storage.size() - 1);
+    return;
+  }
+  size_t pos = find_ceil(t);
+  if (_storage[pos] == t)
+    pos++;
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.insert_moves(pos));
+  _storage.insert(
+    _storage.begin() + pos,
+    static_cast <T &&> (t));
+
+#else
+  _storage.push_back(static_cast <T &&> (t));
+
+  char buf[sizeof(T)];
+
+  memcpy(
+    reinterpret_cast <void *> (buf),
+    reinterpret_cast <void *> (&_storage.back()),
+    sizeof(T));
+
+  single_shift_right(pos);
+
+  memcpy(
+    reinterpret_cast <void *> (&_storage[pos]),
+    reinterpret_cast <void *> (&buf),
+    sizeof(T));
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.size() - pos - 1);
+#endif
+  count_reallocation(capacity);
+  on_insert(pos);
+}
+
+template <class T>
+  void sorted_vector <T>:: replace(
+    const T &t)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  size_t pos = find(t);
+  if (pos != (size_t)-1) {
+    _storage[pos] = t;
+    on_change(pos);
+  } else
+    push(t);
+}
+
+template <class T>
+  void sorted_vector <T>:: replace(
+    T &&t)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  size_t pos = find(t);
+  if (pos != (size_t)-1) {
+    _storage[pos] = static_cast <T &&>(t);
+    on_change(pos);
+  } else
+    push(static_cast <T &&>(t));
+}
+
+template <class T>
+  template <class InputIt>
+  void sorted_vector <T>::  push_batch(
+    InputIt first,
+    InputIt last)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_push);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  std::vector <T> batch(first, last);
+  if (batch.empty())
+    return;
+  size_t capacity = _storage.cvector().capacity();
+  if (_is_corrupted) {
+    _storage.insert(
+      _storage.end(),
+      std::make_move_iterator(batch.begin()),
+      std::make_move_iterator(batch.end()));
+    count_reallocation(capacity);
+    _last_modified = (size_t)-1;
+    on_reset();
+    return;
+  }
+
+  sort_batch(batch);
+
+  _storage.reserve(_storage.size() + batch.size());
+  count_reallocation(capacity);
+  size_t shifted = merge_backward(
+    _storage.vector(),
+    batch,
+    [&](size_t j, size_t i) { return batch[j] < _storage[i]; });
+  CIM_SORTED_VECTOR_COUNT(moved, shifted);
+  (void)shifted;
+  on_reset();
+}
+
+template <class T>
+  template <class Range>
+  void sorted_vector <T>::  insert_range(
+    Range &&range)
+{
+  //Элементы диапазона, переданного как rvalue,
+  //перемещаются
+  insert_range(
+    range,
+    std::integral_constant <bool, !std::is_lvalue_reference <Range>::value> ());
+}
+
+template <class T>
+  template <class... Args>
+  size_t sorted_vector <T>::  emplace(
+    Args &&... args)
+{
+  //Подсказка - конец хранилища: элемент не меньше
+  //последнего ставится без поиска
+  return emplace_hint(_storage.size(), static_cast <Args &&> (args)...);
+}
+
+template <class T>
+  template <class... Args>
+  size_t sorted_vector <T>::  emplace_hint(
+    size_t hint,
+    Args &&... args)
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_push);
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  size_t capacity = _storage.cvector().capacity();
+  _storage.emplace_back(static_cast <Args &&> (args)...);
+  count_reallocation(capacity);
+
+  size_t last = _storage.size() - 1;
+  if (  (_is_corrupted)
+      ||(last == 0)) {
+    on_insert(last);
+    return last;
+  }
+
+  //Подсказка верна, если элемент не меньше
+  //предыдущего и меньше следующего: равные
+  //элементы располагаются так же, как при push
+  size_t pos = hint;
+  if (  (pos > last)
+      ||(  (pos > 0)
+         &&(_storage[last] < _storage[pos - 1]))
+      ||(  (pos < last)
+         &&(!(_storage[last] < _storage[pos])))) {
+    pos = find_ceil(_storage[last], 0, last - 1);
+    if (pos == (size_t)-1)
+      pos = last;
+    else if (_storage[pos] == _storage[last])
+      pos++;
+  }
+  place_back(pos);
+  on_insert(pos);
+  return pos;
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_find);
+  if (_storage.empty())
+    return -1;
+  if (!_is_corrupted) {
+    if (_search_strategy == search_interpolation)
+      return find_interpolated(t, start_pos, end_pos);
+    CIM_SORTED_VECTOR_COUNT(searches, 1);
+    size_t f = start_pos;
+    size_t l = (end_pos == (size_t)-1) ? _storage.size() - 1 : end_pos;
+    size_t m = (f + l) / 2;
+    while (f <= l) {
+      CIM_SORTED_VECTOR_COUNT(probes, 1);
+      if (_storage[m] == t)
+        return m;
+      else if (_storage[f] == t)
+        return f;
+      else if (_storage[l] == t)
+        return l;
+      else {
+        if (_storage[m] < t) {
+          f = m + 1;
+        } else {
+          {
+            if (m == 0)
+              return -1;
+            l = m - 1;
+          }
+        }
+        m = (l + f) / 2;
+      }
+    }
+    return -1;
+  } else {
+    return find_linear(t, start_pos, end_pos);
+  }
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_first(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_find);
+  if (_storage.empty())
+    return -1;
+  if (end_pos == -1)
+    end_pos = _storage.size() - 1;
+  if (!_is_corrupted) {
+    if (_search_strategy == search_interpolation)
+      return find_interpolated(t, start_pos, end_pos);
+    size_t pos = find(t, start_pos, end_pos);
+    if (pos == -1)
+      return -1;
+    while (  (pos > start_pos)
+           &&(t == _storage[pos - 1]))
+      pos--;
+    return pos;
+  } else {
+    return find_linear_first(t, start_pos, end_pos);
+  }
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_last(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_find);
+  if (end_pos == -1)
+    end_pos = _storage.size() - 1;
+  if (!_is_corrupted) {
+    if (_search_strategy == search_interpolation) {
+      size_t pos = interpolation_bound(t, start_pos, end_pos + 1, true);
+      if (  (pos <= start_pos)
+          ||(!(_storage[pos - 1] == t)))
+        return -1;
+      return pos - 1;
+    }
+    size_t pos = find(t, start_pos, end_pos);
+    if (pos == -1)
+      return -1;
+    while (  (pos < end_pos)
+           &&(t == _storage[pos + 1]))
+      pos++;
+    return pos;
+  } else {
+    return find_linear_last(t);
+  }
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_next(
+    size_t current_pos,
+    size_t end_pos)
+    const
+{
+  if (end_pos == -1)
+    end_pos = _storage.size() - 1;
+  if (current_pos == end_pos)
+    return -1;
+  if (!_is_corrupted) {
+    if (  _storage[current_pos]
+        ==_storage[current_pos + 1])
+      return ++current_pos;
+    else
+      return -1;
+  } else {
+    return find_first(_storage[current_pos], current_pos + 1, end_pos);
+  }
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_prev(
+    size_t current_pos,
+    size_t start_pos)
+    const
+{
+  if (current_pos <= start_pos)
+    return -1;
+  if (!_is_corrupted)
+  {
+    if (  _storage[current_pos]
+        ==_storage[current_pos - 1])
+      return --current_pos;
+    else
+      return -1;
+  } else {
+
+    return find_last(
+      _storage[current_pos],
+      start_pos,
+      current_pos - 1);
+  }
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_linear(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_COUNT(linear_searches, 1);
+  if (size() == 0)
+    return (size_t)-1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = size() - 1;
+
+  if (start_pos > end_pos)
+    return -1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = _storage.size() - 1;
+
+  while (start_pos != end_pos)
+  {
+    if (_storage[start_pos++] == t)
+      return start_pos - 1;
+  }
+  return (_storage[end_pos] == t) ? end_pos : (size_t)-1;
+}
+
+template <class T>
+  size_t sorted_vector <T>::  find_linear_first(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_COUNT(linear_searches, 1);
+  if (size() == 0)
+    return -1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = size() - 1;
+
+  if (start_pos > end_pos)
+    return -1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = _storage.size() - 1;
+
+  while (start_pos != end_pos)
+  {
+    if (_storage[start_pos++] == t)
+      return start_pos - 1;
+  }
+  return (_storage[end_pos] == t) ? end_pos : (size_t)-1;
+}
+
+template <class T>
+  size_t sorted_vector <T>::  find_linear_last(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_COUNT(linear_searches, 1);
+  if (size() == 0)
+    return -1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = size() - 1;
+
+  if (start_pos > end_pos)
+    return -1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = _storage.size() - 1;
+
+  while (start_pos != end_pos)
+  {
+    if (_storage[end_pos--] == t)
+      return end_pos + 1;
+  }
+  return (_storage[start_pos] == t) ? start_pos : (size_t)-1;
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_floor(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_find);
+  if (_storage.empty())
+    return -1;
+  end_pos = (end_pos == (size_t)-1 ? _storage.size() - 1 : end_pos);
+  if (!_is_corrupted) {
+    if (_search_strategy == search_interpolation) {
+      size_t pos = interpolation_bound(t, start_pos, end_pos + 1, false);
+      if (  (pos <= end_pos)
+          &&(_storage[pos] == t))
+        return pos;
+      return (pos == start_pos) ? (size_t)-1 : pos - 1;
+    }
+    CIM_SORTED_VECTOR_COUNT(searches, 1);
+    if (_storage[start_pos] > t)
+      return -1;
+    if (_storage[end_pos] < t)
+      return end_pos;
+    size_t f = start_pos;
+    size_t l = end_pos;
+    size_t m = (f + l) / 2;
+    while (f < l) {
+      CIM_SORTED_VECTOR_COUNT(probes, 1);
+      if (_storage[m] == t) {
+        while (m-- > f) {
+          if (!(_storage[m] == t))
+            return m + 1;
+        }
+        return f;
+      }
+      if (_storage[m] < t)
+        f = m + 1;
+      else
+        l = m - 1;
+      m = (l + f) / 2;
+    }
+    if (_storage[m] == t)
+      return m;
+    else
+    if (_storage[m] < t)
+      return m;
+    else
+      return m - 1;
+  } else {  //is_corrupted
+    return -1;
+  }
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_ceil(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_find);
+  if (_storage.empty())
+    return -1;
+  end_pos = (end_pos == (size_t)-1 ? _storage.size() - 1 : end_pos);
+  if (!_is_corrupted)
+  {
+    if (_search_strategy == search_interpolation) {
+      size_t pos = interpolation_bound(t, start_pos, end_pos + 1, true);
+      if (  (pos > start_pos)
+          &&(_storage[pos - 1] == t))
+        return pos - 1;
+      return (pos > end_pos) ? (size_t)-1 : pos;
+    }
+    CIM_SORTED_VECTOR_COUNT(searches, 1);
+    if (_storage[0] > t)
+      return 0;
+    if (_storage[end_pos] < t)
+      return -1;
+    size_t f = start_pos;
+    size_t l = end_pos;
+    size_t m = (f + l) / 2;
+    while (f < l) {
+      CIM_SORTED_VECTOR_COUNT(probes, 1);
+      if (_storage[m] == t) {
+        while (m++ < l) {
+          if (!(_storage[m] == t))
+            return m - 1;
+        }
+        return l;
+      }
+      if (_storage[m] < t)
+        f = m + 1;
+      else
+        l = m - 1;
+      m = (f + l) / 2;
+    }
+    if (_storage[m] == t)
+      return m;
+    else if (_storage[m] > t)
+      return m;
+    else
+      return m + 1;
+  } else {
+    return -1;
+  }
+}
+
+template <class T>
+  sorted_vector_view <T> sorted_vector <T>::  range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  return range_by(lo, hi, identity());
+}
+
+template <class T>
+  sorted_vector_view <T> sorted_vector <T>::  range(
+    const T &lo,
+    const T &hi)
+{
+  return range_by(lo, hi, identity());
+}
+
+template <class T>
+  size_t sorted_vector <T>::  count_range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  return count_range_by(lo, hi, identity());
+}
+
+template <class T>
+  size_t sorted_vector <T>::  erase_range(
+    const T &lo,
+    const T &hi)
+{
+  return erase_range_by(lo, hi, identity());
+}
+
+template <class T>
+  size_t sorted_vector <T>:: find_interpolated(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_find);
+  //Первый равный элемент, как find_first
+  if (_storage.empty())
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _storage.size() - 1;
+  if (_is_corrupted)
+    return find_linear_first(t, start_pos, end_pos);
+  size_t pos = interpolation_bound(t, start_pos, end_pos + 1, false);
+  if (  (pos > end_pos)
+      ||(!(_storage[pos] == t)))
+    return -1;
+  return pos;
+}
+
+template <class T>
+  void sorted_vector <T>::  set_search_strategy(
+    search_strategy strategy)
+{
+  _search_strategy = strategy;
+}
+
+template <class T>
+  search_strategy sorted_vector <T>::  get_search_strategy()
+    const
+{
+  return _search_strategy;
+}
+
+template <class T>
+  size_t sorted_vector <T>:: rank(
+    const T &t)
+    const
+{
+  if (  (!_is_corrupted)
+      &&(_search_strategy == search_interpolation))
+    return interpolation_bound(t, 0, _storage.size(), false);
+  return rank_by(t, identity());
+}
+
+template <class T>
+  const T &sorted_vector <T>::  select(
+    size_t k)
+    const
+{
+  if (_is_corrupted)
+    return select_unordered(k);
+  return _storage[k];
+}
+
+template <class T>
+  const T &sorted_vector <T>::  select(
+    size_t k)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  const sorted_vector <T> &self = *this;
+  return self.select(k);
+}
+
+template <class T>
+  const T &sorted_vector <T>::  quantile(
+    double q)
+    const
+{
+  return select(quantile_pos(q));
+}
+
+template <class T>
+  const T &sorted_vector <T>::  quantile(
+    double q)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  const sorted_vector <T> &self = *this;
+  return self.quantile(q);
+}
+
+template <class T>
+  sorted_vector_view <T> sorted_vector <T>::  percentile_range(
+    double q_lo,
+    double q_hi)
+    const
+{
+  if (  (_storage.empty())
+      ||(_is_corrupted)
+      ||(q_hi < q_lo))
+    return sorted_vector_view <T> ();
+  return sorted_vector_view <T> (
+    _storage.data() + quantile_pos(q_lo),
+    _storage.data() + quantile_pos(q_hi) + 1);
+}
+
+template <class T>
+  sorted_vector_view <T> sorted_vector <T>::  percentile_range(
+    double q_lo,
+    double q_hi)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  const sorted_vector <T> &self = *this;
+  return self.percentile_range(q_lo, q_hi);
+}
+
+template <class T>
+  void sorted_vector <T>:: sort()
+{
+  CIM_SORTED_VECTOR_LATENCY(latency_sort);
+  CIM_SORTED_VECTOR_COUNT(full_sorts, 1);
+  sort_elements(_storage.vector());
+  _is_corrupted = false;
+  on_reset();
+}
+
+template <class T>
+  void sorted_vector <T>:: repair()
+{
+  if (_is_corrupted) {
+    CIM_SORTED_VECTOR_LATENCY(latency_repair);
+    if (_last_modified == (size_t)-1) {
+#ifdef CIM_SORTED_VECTOR_TRACE
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      sort();
+      latency::trace(
+        trace_repair_sort,
+        this,
+        _storage.size(),
+        (uint64_t)std::chrono::duration_cast <std::chrono::nanoseconds> (
+          std::chrono::steady_clock::now() - start).count());
+#else
+      sort();
+#endif // CIM_SORTED_VECTOR_TRACE
+    } else {
+      _is_corrupted = false;
+
+      if (  (_last_modified > 0)
+          &&(   _storage[_last_modified]
+              < _storage[_last_modified - 1])) {
+
+        size_t pos_ceil = find_ceil(
+          _storage[_last_modified],
+          0,
+          _last_modified-1);
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+        T t(static_cast <T &&> (_storage[_last_modified]));
+#endif
+#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
+        char t[sizeof(T)];
+        memcpy(t, &_storage[_last_modified], sizeof(T));
+#endif
         single_shift_right(pos_ceil, _last_modified);
 #ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-        _storage[pos_ceil] = static_cast <T &&> (t);
+        _storage[pos_ceil] = static_cast <T &&> (t);
+#endif
+#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
+        memcpy(&_storage[pos_ceil], t, sizeof(T));
+#endif
+        CIM_SORTED_VECTOR_COUNT(repairs, 1);
+        CIM_SORTED_VECTOR_COUNT(moved, _last_modified - pos_ceil);
+        on_erase(_last_modified, _last_modified + 1);
+        on_insert(pos_ceil);
+
+      } else
+
+      if (  (_last_modified < _storage.size() - 1)
+          &&(   _storage[_last_modified]
+              > _storage[_last_modified + 1])) {
+
+        size_t pos_floor = find_floor(
+          _storage[_last_modified],
+          _last_modified + 1,
+          _storage.size() - 1);
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+        T t(static_cast <T &&> (_storage[_last_modified]));
+#endif
+#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
+        char t[sizeof(T)];
+        memcpy(t, &_storage[_last_modified], sizeof(T));
+#endif
+        single_shift_left(_last_modified, pos_floor);
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+        _storage[pos_floor] = static_cast <T &&> (t);
+#endif
+#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
+        memcpy(&_storage[pos_floor], t, sizeof(T));
+#endif
+        CIM_SORTED_VECTOR_COUNT(repairs, 1);
+        CIM_SORTED_VECTOR_COUNT(moved, pos_floor - _last_modified);
+        on_erase(_last_modified, _last_modified + 1);
+        on_insert(pos_floor);
+
+      } else {
+        CIM_SORTED_VECTOR_COUNT(repairs, 1);
+        on_change(_last_modified);
+      }
+    }
+    _last_modified = -1;
+  }
+}
+
+template <class T>
+  void sorted_vector <T>::  merge(
+    const sorted_vector <T> &sv)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(sv.size() + size());
+  count_reallocation(capacity);
+  _storage.insert(_storage.end(), sv._storage.begin(), sv._storage.end());
+  _last_modified = (size_t)-1;
+  _is_corrupted = true;
+  repair();
+}
+
+template <class T>
+  void sorted_vector <T>::  merge(
+    sorted_vector <T> &&sv)
+{
+  merge(static_cast <std::vector<T> &&> (sv._storage.vector()));
+}
+
+template <class T>
+  void sorted_vector <T>::  merge(
+    const std::vector <T> &v)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(v.size() + size());
+  count_reallocation(capacity);
+  _storage.insert(_storage.end(), v.begin(), v.end());
+  _last_modified = (size_t)-1;
+  _is_corrupted = true;
+  repair();
+}
+
+template <class T>
+  void sorted_vector <T>::  merge(
+    std::vector <T> &&v)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(v.size() + size());
+  count_reallocation(capacity);
+
+  _storage.insert(
+    _storage.end(),
+    std::make_move_iterator(v.begin()),
+    std::make_move_iterator(v.end()));
+
+  _last_modified = (size_t)-1;
+  _is_corrupted = true;
+  repair();
+}
+
+template <class T>
+  void sorted_vector <T>::  merge_replace(
+    const sorted_vector <T> &sv)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(sv.size() + size());
+  count_reallocation(capacity);
+  for (size_t i = 0; i < sv.size(); i++)
+    replace(sv[i]);
+}
+
+template <class T>
+  void sorted_vector <T>::  merge_replace(
+    sorted_vector <T> &&sv)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(sv.size() + size());
+  count_reallocation(capacity);
+  for (size_t i = 0; i < sv.size(); i++)
+    replace(static_cast <T &&> (sv[i]));
+}
+
+template <class T>
+  void sorted_vector <T>::  merge_replace(
+    const std::vector <T> &v)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(v.size() + size());
+  count_reallocation(capacity);
+  for (size_t i = 0; i < v.size(); i++)
+    replace(v[i]);
+}
+
+template <class T>
+  void sorted_vector <T>::  merge_replace(
+    std::vector <T> &&v)
+{
+  size_t capacity = _storage.cvector().capacity();
+  _storage.reserve(v.size() + size());
+  count_reallocation(capacity);
+  for (size_t i = 0; i < v.size(); i++)
+    replace(static_cast <T &&> (v[i]));
+}
+
+template <class T>
+  void sorted_vector <T>::  set_intersection(
+    const sorted_vector <T> &sv,
+    sorted_vector <T> &result)
+    const
+{
+  set_operation(*this, sv, result, false, false, true, std::less <T>());
+}
+
+template <class T>
+  void sorted_vector <T>::  set_difference(
+    const sorted_vector <T> &sv,
+    sorted_vector <T> &result)
+    const
+{
+  set_operation(*this, sv, result, true, false, false, std::less <T>());
+}
+
+template <class T>
+  void sorted_vector <T>::  set_union(
+    const sorted_vector <T> &sv,
+    sorted_vector <T> &result)
+    const
+{
+  set_operation(*this, sv, result, true, true, true, std::less <T>());
+}
+
+template <class T>
+  void sorted_vector <T>::  set_symmetric_difference(
+    const sorted_vector <T> &sv,
+    sorted_vector <T> &result)
+    const
+{
+  set_operation(*this, sv, result, true, true, false, std::less <T>());
+}
+
+template <class T>
+  bool sorted_vector <T>:: corrupted()
+  const
+{
+  return _is_corrupted;
+}
+
+template <class T>
+  sorted_vector_stats sorted_vector <T>:: stats()
+  const
+{
+  //Без CIM_SORTED_VECTOR_STATS все счётчики нулевые
+  sorted_vector_stats st;
+#ifdef CIM_SORTED_VECTOR_STATS
+  st.full_sorts = _stats.full_sorts.get();
+  st.repairs = _stats.repairs.get();
+  st.moved = _stats.moved.get();
+  st.searches = _stats.searches.get();
+  st.probes = _stats.probes.get();
+  st.linear_searches = _stats.linear_searches.get();
+  st.reallocations = _stats.reallocations.get();
+#endif // CIM_SORTED_VECTOR_STATS
+  return st;
+}
+
+template <class T>
+  void sorted_vector <T>:: reset_stats()
+{
+#ifdef CIM_SORTED_VECTOR_STATS
+  _stats.full_sorts.value = 0;
+  _stats.repairs.value = 0;
+  _stats.moved.value = 0;
+  _stats.searches.value = 0;
+  _stats.probes.value = 0;
+  _stats.linear_searches.value = 0;
+  _stats.reallocations.value = 0;
+#endif // CIM_SORTED_VECTOR_STATS
+}
+
+template <class T>
+  std::vector <T> &sorted_vector <T>::  storage()
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+#ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+#endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+  _is_corrupted = true;
+  _last_modified = -1;
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  return _storage.vector();
+}
+
+template <class T>
+  const std::vector <T> &sorted_vector <T>::  cstorage()
+{
+  return _storage.vector();
+}
+
+template <class T>
+  T *sorted_vector <T>::  data()
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+  _is_corrupted = true;
+  _last_modified = -1;
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  return _storage.data();
+}
+
+template <class T>
+  const T *sorted_vector <T>::  data()
+  const
+{
+  return _storage.data();
+}
+
+template <class T>
+  void sorted_vector <T>::  suspend_autorepair()
+{
+  _flag_suspend_autorepair = true;
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  _last_modified = -1;
+  _is_corrupted = true;
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+}
+
+template <class T>
+  void sorted_vector <T>::  resume_autorepair()
+{
+  _flag_suspend_autorepair = false;
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+  repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+}
+
+//***protected methods***
+
+template <class T>
+  void sorted_vector <T>::  count_reallocation(
+    size_t old_capacity)
+  const
+{
+  //Вызывается после операции, которая могла увеличить
+  //хранилище; без CIM_SORTED_VECTOR_STATS пуст.
+  //Сравнивается ёмкость всего вектора (cvector): сдвиг
+  //начала меняет capacity() без перераспределения
+#ifdef CIM_SORTED_VECTOR_STATS
+  if (_storage.cvector().capacity() != old_capacity)
+    CIM_SORTED_VECTOR_COUNT(reallocations, 1);
+#else
+  (void)old_capacity;
+#endif // CIM_SORTED_VECTOR_STATS
+}
+
+template <class T>
+  template <class Range>
+  void sorted_vector <T>::  insert_range(
+    Range &range,
+    std::false_type)
+{
+  using std::begin;
+  using std::end;
+  push_batch(begin(range), end(range));
+}
+
+template <class T>
+  template <class Range>
+  void sorted_vector <T>::  insert_range(
+    Range &range,
+    std::true_type)
+{
+  using std::begin;
+  using std::end;
+  push_batch(
+    std::make_move_iterator(begin(range)),
+    std::make_move_iterator(end(range)));
+}
+
+template <class T>
+  template <class X, class Before>
+  size_t sorted_vector <T>::  merge_backward(
+    std::vector <X> &s,
+    std::vector <X> &b,
+    Before before)
+{
+  //Слияние упорядоченного пакета b в s; before(j, i) -
+  //b[j] должен стоять перед s[i], иначе (в том числе
+  //при равенстве) s[i] идёт раньше. Вместимость s
+  //должна быть достаточной заранее.
+  //Хвост [n, n + k) займут k последних элементов
+  //слияния: n - i0 старых и k - j0 новых. Граница
+  //ищется бинарным поиском по пути слияния
+  size_t n = s.size();
+  size_t k = b.size();
+  size_t lo = (n > k) ? n - k : 0;
+  size_t hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (!before(n - mid - 1, mid))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  size_t i0 = lo;
+  size_t j0 = n - i0;
+
+  //Хвост конструируется слиянием вперёд, начало
+  //[0, n) - слиянием назад; каждый старый элемент
+  //перемещается не более одного раза
+  size_t i = i0;
+  size_t j = j0;
+  while (  (i < n)
+         ||(j < k)) {
+    if (  (j == k)
+        ||(  (i < n)
+           &&(!before(j, i))))
+      s.push_back(static_cast <X &&> (s[i++]));
+    else
+      s.push_back(static_cast <X &&> (b[j++]));
+  }
+
+  size_t w = n;
+  i = i0;
+  j = j0;
+  while (j > 0) {
+    if (  (i > 0)
+        &&(before(j - 1, i - 1)))
+      s[--w] = static_cast <X &&> (s[--i]);
+    else
+      s[--w] = static_cast <X &&> (b[--j]);
+  }
+  return n - i;
+}
+
+template <class T>
+  void sorted_vector <T>::  sort_batch(
+    std::vector <T> &batch)
+{
+  //Устойчивая сортировка: равные элементы пакета
+  //сохраняют порядок, как при последовательных push.
+  //Большой пакет делится на части, сортируемые в
+  //отдельных потоках, затем части попарно сливаются
+#ifndef CIM_SORTED_VECTOR_PARALLEL_SORT
+  std::stable_sort(batch.begin(), batch.end());
+#else
+  size_t threads = std::thread::hardware_concurrency();
+  if (  (batch.size() < CIM_SORTED_VECTOR_PARALLEL_SORT)
+      ||(threads < 2)) {
+    std::stable_sort(batch.begin(), batch.end());
+    return;
+  }
+  threads = std::min(threads, batch.size() / (CIM_SORTED_VECTOR_PARALLEL_SORT / 2));
+
+  std::vector <size_t> bound(threads + 1);
+  for (size_t t = 0; t <= threads; t++)
+    bound[t] = batch.size() * t / threads;
+
+  std::vector <std::future <void> > parts;
+  for (size_t t = 1; t < threads; t++)
+    parts.push_back(std::async(
+      std::launch::async,
+      [&batch, &bound, t]() {
+        std::stable_sort(batch.begin() + bound[t], batch.begin() + bound[t + 1]);
+      }));
+  std::stable_sort(batch.begin(), batch.begin() + bound[1]);
+  for (size_t t = 0; t < parts.size(); t++)
+    parts[t].get();
+
+  for (size_t width = 1; width < threads; width *= 2)
+    for (size_t t = 0; t + width < threads; t += 2 * width)
+      std::inplace_merge(
+        batch.begin() + bound[t],
+        batch.begin() + bound[t + width],
+        batch.begin() + bound[std::min(t + 2 * width, threads)]);
+#endif // CIM_SORTED_VECTOR_PARALLEL_SORT
+}
+
+template <class T>
+  void sorted_vector <T>::  sort_elements(
+    std::vector <T> &v)
+    const
+{
+  if (sort_runs(v))
+    return;
+  sort_values(
+    v,
+    std::integral_constant <bool,
+         std::is_integral <T>::value
+      && !std::is_same <T, bool>::value> ());
+}
+
+template <class T>
+  bool sorted_vector <T>::  sort_runs(
+    std::vector <T> &v)
+{
+  //Естественные серии: неубывающие и строго убывающие
+  //(последние разворачиваются). Если их не больше
+  //CIM_SORTED_VECTOR_SORT_RUNS, соседние серии попарно
+  //сливаются, иначе просмотр прекращается сразу после
+  //превышения порога
+  size_t n = v.size();
+  if (n < 2)
+    return true;
+  std::vector <size_t> runs(1, 0);
+  size_t i = 0;
+  while (i < n) {
+    size_t j = i + 1;
+    if (  (j < n)
+        &&(v[j] < v[i])) {
+      while (  (j + 1 < n)
+             &&(v[j + 1] < v[j]))
+        j++;
+      j++;
+      std::reverse(v.begin() + i, v.begin() + j);
+    } else {
+      while (  (j < n)
+             &&(!(v[j] < v[j - 1])))
+        j++;
+    }
+    runs.push_back(j);
+    if (runs.size() - 1 > CIM_SORTED_VECTOR_SORT_RUNS)
+      return false;
+    i = j;
+  }
+
+  while (runs.size() > 2) {
+    std::vector <size_t> merged;
+    for (size_t k = 0; k + 1 < runs.size(); k += 2) {
+      merged.push_back(runs[k]);
+      if (k + 2 < runs.size())
+        std::inplace_merge(
+          v.begin() + runs[k],
+          v.begin() + runs[k + 1],
+          v.begin() + runs[k + 2]);
+    }
+    merged.push_back(n);
+    runs.swap(merged);
+  }
+  return true;
+}
+
+template <class T>
+  void sorted_vector <T>::  sort_values(
+    std::vector <T> &v,
+    std::false_type)
+{
+  std::sort(v.begin(), v.end());
+}
+
+template <class T>
+  void sorted_vector <T>::  sort_values(
+    std::vector <T> &v,
+    std::true_type)
+{
+  if (v.size() < CIM_SORTED_VECTOR_RADIX_SORT) {
+    std::sort(v.begin(), v.end());
+    return;
+  }
+  std::vector <T> tmp(v.size());
+  radix_sort(
+    v,
+    tmp,
+    sizeof(T),
+    [](const T &t) { return radix_key(t); });
+}
+
+template <class T>
+  template <class K>
+  uint64_t sorted_vector <T>::  radix_key(
+    K k)
+{
+  //Знаковые значения отображаются в беззнаковые с
+  //сохранением порядка инверсией старшего бита
+  typedef typename std::make_unsigned <K>::type unsigned_key;
+  uint64_t key = (uint64_t)(unsigned_key)k;
+  if (std::is_signed <K>::value)
+    key ^= (uint64_t)1 << (8 * sizeof(K) - 1);
+  return key;
+}
+
+template <class T>
+  template <class X, class KeyOf>
+  void sorted_vector <T>::  radix_sort(
+    std::vector <X> &v,
+    std::vector <X> &tmp,
+    size_t key_bytes,
+    KeyOf key_of)
+{
+  //LSD по разрядам в 11 бит: гистограммы всех
+  //разрядов строятся одним проходом, разряд,
+  //одинаковый у всех элементов, пропускается
+  const size_t digit_bits = 11;
+  const size_t digits = 1 << digit_bits;
+  size_t n = v.size();
+  size_t passes = (8 * key_bytes + digit_bits - 1) / digit_bits;
+  std::vector <size_t> count(passes * digits, 0);
+  for (size_t i = 0; i < n; i++) {
+    uint64_t key = key_of(v[i]);
+    for (size_t p = 0; p < passes; p++)
+      count[p * digits + ((key >> (p * digit_bits)) & (digits - 1))]++;
+  }
+
+  X *src = v.data();
+  X *dst = tmp.data();
+  for (size_t p = 0; p < passes; p++) {
+    size_t *c = &count[p * digits];
+    size_t shift = p * digit_bits;
+    if (c[(key_of(src[0]) >> shift) & (digits - 1)] == n)
+      continue;
+    size_t sum = 0;
+    for (size_t d = 0; d < digits; d++) {
+      size_t k = c[d];
+      c[d] = sum;
+      sum += k;
+    }
+    for (size_t i = 0; i < n; i++)
+      dst[c[(key_of(src[i]) >> shift) & (digits - 1)]++] = static_cast <X &&> (src[i]);
+    std::swap(src, dst);
+  }
+  if (src != v.data())
+    v.swap(tmp);
+}
+
+template <class T>
+  template <class KeyOf>
+  void sorted_vector <T>::  radix_sort_by(
+    std::vector <T> &v,
+    KeyOf key_of)
+{
+  //Сортируются пары (ключ, позиция), затем элементы
+  //собираются в новый массив в порядке пар - каждый
+  //перемещается один раз, запись последовательная
+  size_t n = v.size();
+  typedef typename std::decay <decltype(key_of(v[0]))>::type key_type;
+  std::vector <std::pair <uint64_t, size_t> > keys(n);
+  for (size_t i = 0; i < n; i++)
+    keys[i] = std::make_pair(radix_key(key_of(v[i])), i);
+  std::vector <std::pair <uint64_t, size_t> > tmp(n);
+  radix_sort(
+    keys,
+    tmp,
+    sizeof(key_type),
+    [](const std::pair <uint64_t, size_t> &k) { return k.first; });
+
+  std::vector <T> sorted;
+  sorted.reserve(n);
+  for (size_t i = 0; i < n; i++)
+    sorted.push_back(static_cast <T &&> (v[keys[i].second]));
+  v.swap(sorted);
+}
+
+template <class T>
+  void sorted_vector <T>::  place_back(
+    size_t pos)
+{
+  //Последний элемент переносится в позицию pos,
+  //элементы [pos, size() - 1) сдвигаются вправо
+  //(или [0, pos) - влево, если перед началом есть
+  //место и оно ближе), каждый - одним перемещением
+  size_t last = _storage.size() - 1;
+  if (pos == last)
+    return;
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+  T t(static_cast <T &&> (_storage[last]));
+  _storage.pop_back();
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.insert_moves(pos));
+  _storage.insert(
+    _storage.begin() + pos,
+    static_cast <T &&> (t));
+#else
+  char buf[sizeof(T)];
+
+  memcpy(
+    reinterpret_cast <void *> (buf),
+    reinterpret_cast <void *> (&_storage[last]),
+    sizeof(T));
+
+  single_shift_right(pos, last);
+
+  memcpy(
+    reinterpret_cast <void *> (&_storage[pos]),
+    reinterpret_cast <void *> (&buf),
+    sizeof(T));
+  CIM_SORTED_VECTOR_COUNT(moved, last - pos);
 #endif
+}
+
+template <class T>
+  void sorted_vector <T>::  single_shift_left(
+    size_t start_pos,
+    size_t end_pos)
+{
+  if (start_pos == end_pos)
+    return;
+
+  if (end_pos == (size_t)-1)
+    end_pos = size() - 1;
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+  T t = static_cast <T &&> (_storage[start_pos]);
+  _storage.erase(_storage.begin() + start_pos);
+
+  _storage.insert(
+    _storage.begin() + end_pos,
+    static_cast <T &&> (t));
+
+#endif // !CIM_SORTED_VECTOR_USE_MEMMOVE
+
 #ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
-        memcpy(&_storage[pos_ceil], t, sizeof(T));
-#endif
 
-      } else
+  memmove(
+    reinterpret_cast <void *> (&_storage[start_pos]),
+    reinterpret_cast <void *> (&_storage[start_pos + 1]),
+    sizeof(T) * (end_pos - start_pos));
+
+#endif // CIM_SORTED_VECTOR_USE_MEMMOVE
+}
+
+template <class T>
+  void sorted_vector <T>::  single_shift_right(
+    size_t start_pos,
+    size_t end_pos)
+{
+  if (start_pos == end_pos)
+    return;
+
+  if (end_pos == (size_t)-1)
+    end_pos = size() - 1;
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+  T t = static_cast <T &&> (_storage[end_pos]);
+  _storage.erase(_storage.begin() + end_pos);
+
+  _storage.insert(
+    _storage.begin() + start_pos,
+    static_cast <T &&> (t));
+#endif // !CIM_SORTED_VECTOR_USE_MEMMOVE
+#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
+  memmove(
+    reinterpret_cast <void *> (&_storage[start_pos + 1]),
+    reinterpret_cast <void *> (&_storage[start_pos]),
+    sizeof(T) * (end_pos - start_pos));
+#endif // !CIM_SORTED_VECTOR_USE_MEMMOVE
+}
+
+template <class T>
+  template <class K, class Proj>
+  void sorted_vector <T>::  bounds(
+    const K &lo,
+    const K &hi,
+    Proj proj,
+    size_t &first,
+    size_t &last)
+    const
+{
+  //Полуинтервал [first, last) элементов, проекция
+  //которых лежит в [lo, hi]. Пока середина лежит вне
+  //интервала, обе границы ищутся общим спуском
+  size_t f = 0;
+  size_t l = _storage.size();
+  while (f < l) {
+    size_t m = f + (l - f) / 2;
+    if (proj(_storage[m]) < lo)
+      f = m + 1;
+    else if (hi < proj(_storage[m]))
+      l = m;
+    else {
+
+      first = std::lower_bound(
+        _storage.begin() + f,
+        _storage.begin() + m,
+        lo,
+        [&proj](const T &t, const K &k) { return proj(t) < k; }) - _storage.begin();
+
+      last = std::upper_bound(
+        _storage.begin() + m + 1,
+        _storage.begin() + l,
+        hi,
+        [&proj](const K &k, const T &t) { return k < proj(t); }) - _storage.begin();
+
+      return;
+    }
+  }
+  first = f;
+  last = f;
+}
+
+template <class T>
+  template <class K, class Proj>
+  sorted_vector_view <T> sorted_vector <T>::  range_by(
+    const K &lo,
+    const K &hi,
+    Proj proj)
+    const
+{
+  if (  (_storage.empty())
+      ||(_is_corrupted))
+    return sorted_vector_view <T> ();
+  size_t first;
+  size_t last;
+  bounds(lo, hi, proj, first, last);
+  return sorted_vector_view <T> (
+    _storage.data() + first,
+    _storage.data() + last);
+}
+
+template <class T>
+  template <class K, class Proj>
+  sorted_vector_view <T> sorted_vector <T>::  range_by(
+    const K &lo,
+    const K &hi,
+    Proj proj)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  const sorted_vector <T> &self = *this;
+  return self.range_by(lo, hi, proj);
+}
+
+template <class T>
+  template <class K, class Proj>
+  size_t sorted_vector <T>::  count_range_by(
+    const K &lo,
+    const K &hi,
+    Proj proj)
+    const
+{
+  if (_is_corrupted) {
+    size_t n = 0;
+    for (size_t i = 0; i < _storage.size(); i++)
+      if (  (!(proj(_storage[i]) < lo))
+          &&(!(hi < proj(_storage[i]))))
+        n++;
+    return n;
+  }
+  size_t first;
+  size_t last;
+  bounds(lo, hi, proj, first, last);
+  return last - first;
+}
+
+template <class T>
+  template <class K, class Proj>
+  size_t sorted_vector <T>::  erase_range_by(
+    const K &lo,
+    const K &hi,
+    Proj proj)
+{
+#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
+    if (!_flag_suspend_autorepair)
+      repair();
+# endif // CIM_SORTED_VECTOR_AUTOREPAIR
+  }
+#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  if (_is_corrupted) {
+    size_t n = _storage.size();
+    _storage.erase(
+      std::remove_if(
+        _storage.begin(),
+        _storage.end(),
+        [&](const T &t) { return (!(proj(t) < lo)) && (!(hi < proj(t))); }),
+      _storage.end());
+    _last_modified = (size_t)-1;
+    on_reset();
+    return n - _storage.size();
+  }
+  size_t first;
+  size_t last;
+  bounds(lo, hi, proj, first, last);
+  CIM_SORTED_VECTOR_COUNT(moved, _storage.erase_moves(first, last));
+  _storage.erase(
+    _storage.begin() + first,
+    _storage.begin() + last);
+  on_erase(first, last);
+  return last - first;
+}
+
+template <class T>
+  template <class Remove>
+  size_t sorted_vector <T>::  compact(
+    size_t start,
+    Remove remove)
+{
+  //Один устойчивый проход: непрерывные участки
+  //оставляемых элементов переносятся влево целиком.
+  //remove вызывается для каждой позиции не более
+  //одного раза и в порядке возрастания
+  size_t n = _storage.size();
+  size_t w = start;
+  size_t r = start;
+  while (r < n) {
+    size_t b = r;
+    while (  (b < n)
+           &&(!remove(b)))
+      b++;
+    if (  (w != r)
+        &&(b > r)) {
+      relocate(w, r, b - r, std::integral_constant <bool, std::is_trivially_copyable <T>::value> ());
+      CIM_SORTED_VECTOR_COUNT(moved, b - r);
+    }
+    w += b - r;
+    r = b + 1;
+  }
+  if (w >= n)
+    return 0;
+  _storage.erase(
+    _storage.begin() + w,
+    _storage.end());
+  if (_is_corrupted)
+    _last_modified = (size_t)-1;
+  on_reset();
+  return n - w;
+}
+
+template <class T>
+  void sorted_vector <T>::  relocate(
+    size_t to,
+    size_t from,
+    size_t count,
+    std::true_type)
+{
+  memmove(
+    reinterpret_cast <void *> (&_storage[to]),
+    reinterpret_cast <const void *> (&_storage[from]),
+    sizeof(T) * count);
+}
+
+template <class T>
+  void sorted_vector <T>::  relocate(
+    size_t to,
+    size_t from,
+    size_t count,
+    std::false_type)
+{
+  std::move(
+    _storage.begin() + from,
+    _storage.begin() + from + count,
+    _storage.begin() + to);
+}
+
+template <class T>
+  template <class K, class Proj>
+  size_t sorted_vector <T>::  rank_by(
+    const K &k,
+    Proj proj)
+    const
+{
+  if (_is_corrupted) {
+    size_t n = 0;
+    for (size_t i = 0; i < _storage.size(); i++)
+      if (proj(_storage[i]) < k)
+        n++;
+    return n;
+  }
+
+  return std::lower_bound(
+    _storage.begin(),
+    _storage.end(),
+    k,
+    [&proj](const T &t, const K &key) { return proj(t) < key; }) - _storage.begin();
+}
+
+template <class T>
+  size_t sorted_vector <T>::  quantile_pos(
+    double q)
+    const
+{
+  //Ближайший ранг: наименьшая позиция, до которой
+  //включительно лежит не менее доли q элементов.
+  //NaN не приводится к целому
+  if (q != q)
+    throw std::invalid_argument("sorted_vector::quantile");
+  if (q <= 0.0)
+    return 0;
+  if (q >= 1.0)
+    return _storage.size() - 1;
+  size_t pos = (size_t)(q * _storage.size());
+  if ((double)pos < q * _storage.size())
+    pos++;
+  return (pos == 0) ? 0 : pos - 1;
+}
+
+template <class T>
+  const T &sorted_vector <T>::  select_unordered(
+    size_t k)
+    const
+{
+  //Испорченный экземпляр: k-й по возрастанию элемент
+  //выбирается за O(n) по указателям, хранилище не меняется
+  std::vector <const T *> p(_storage.size());
+  for (size_t i = 0; i < p.size(); i++)
+    p[i] = &_storage[i];
+  std::nth_element(
+    p.begin(),
+    p.begin() + k,
+    p.end(),
+    [](const T *a, const T *b) { return *a < *b; });
+  return *p[k];
+}
+
+template <class T>
+  size_t sorted_vector <T>::  interpolation_bound(
+    const T &t,
+    size_t first,
+    size_t last,
+    bool upper)
+    const
+{
+  //Интерполяционный поиск доступен только арифметическим типам
+  CIM_SORTED_VECTOR_COUNT(searches, 1);
+  return interpolation_bound(
+    t,
+    first,
+    last,
+    upper,
+    std::integral_constant <bool, std::is_arithmetic <T>::value> ());
+}
+
+template <class T>
+  size_t sorted_vector <T>::  interpolation_bound(
+    const T &t,
+    size_t first,
+    size_t last,
+    bool upper,
+    std::false_type)
+    const
+{
+  if (upper)
+    return std::upper_bound(_storage.begin() + first, _storage.begin() + last, t) - _storage.begin();
+  return std::lower_bound(_storage.begin() + first, _storage.begin() + last, t) - _storage.begin();
+}
+
+template <class T>
+  size_t sorted_vector <T>::  interpolation_bound(
+    const T &t,
+    size_t first,
+    size_t last,
+    bool upper,
+    std::true_type)
+    const
+{
+  //Первая позиция в [first, last], элемент в которой не меньше
+  //(при upper - больше) t. Позиция предсказывается линейной
+  //интерполяцией между крайними элементами интервала, затем
+  //от неё экспоненциальным шагом ищется интервал с ответом.
+  //Если интервал сокращается меньше чем в 8 раз
+  //CIM_SORTED_VECTOR_INTERPOLATION_PROBES раз, поиск
+  //завершается бинарным
+  const T *d = _storage.data();
+  auto before = [&t, upper](const T &x) {
+    return upper ? !(t < x) : (x < t);
+  };
+
+  size_t lo = first;
+  size_t hi = last;
+  unsigned bad = 0;
+  while (  (hi - lo > 16)
+         &&(bad < CIM_SORTED_VECTOR_INTERPOLATION_PROBES)) {
+    CIM_SORTED_VECTOR_COUNT(probes, 3);
+    if (!before(d[lo]))
+      return lo;
+    if (before(d[hi - 1]))
+      return hi;
+    double a = (double)d[lo];
+    double b = (double)d[hi - 1];
+    //Бесконечный край интервала (или переполнение b - a)
+    //не даёт предсказания: inf / inf - NaN
+    if (  (!(b > a))
+        ||(!(b - a < HUGE_VAL)))
+      break;
+
+    size_t span = hi - lo;
+    size_t m = lo + (size_t)(((double)t - a) / (b - a) * (double)(span - 1));
+    if (m >= hi)
+      m = hi - 1;
+
+    size_t step = 1;
+    if (before(d[m])) {
+      lo = m + 1;
+      while (  (m + step < hi)
+             &&(before(d[m + step]))) {
+        CIM_SORTED_VECTOR_COUNT(probes, 1);
+        lo = m + step + 1;
+        step *= 2;
+      }
+      if (m + step < hi)
+        hi = m + step;
+    } else {
+      hi = m;
+      while (  (m >= lo + step)
+             &&(!before(d[m - step]))) {
+        CIM_SORTED_VECTOR_COUNT(probes, 1);
+        hi = m - step;
+        step *= 2;
+      }
+      if (m >= lo + step)
+        lo = m - step + 1;
+    }
+    if ((hi - lo) * 8 > span)
+      bad++;
+  }
+
+#ifdef CIM_SORTED_VECTOR_STATS
+  for (size_t n = hi - lo; n > 0; n /= 2)
+    CIM_SORTED_VECTOR_COUNT(probes, 1);
+#endif // CIM_SORTED_VECTOR_STATS
+  if (upper)
+    return std::upper_bound(d + lo, d + hi, t) - d;
+  return std::lower_bound(d + lo, d + hi, t) - d;
+}
+
+template <class T>
+  template <class Less>
+  sorted_vector_view <T> sorted_vector <T>::  sorted_storage(
+    std::vector <T> &tmp,
+    Less less)
+    const
+{
+  //Константный метод не может исправить экземпляр,
+  //поэтому испорченный экземпляр сортируется в копии.
+  //Хранилище со смещённым началом используется без
+  //копирования
+  if (!_is_corrupted)
+    return sorted_vector_view <T> (_storage.begin(), _storage.end());
+  tmp.assign(_storage.begin(), _storage.end());
+  std::sort(tmp.begin(), tmp.end(), less);
+  return sorted_vector_view <T> (tmp.data(), tmp.data() + tmp.size());
+}
+
+template <class T>
+  template <class Less>
+  size_t sorted_vector <T>::  gallop_lower(
+    const sorted_vector_view <T> &v,
+    size_t from,
+    const T &t,
+    Less less)
+{
+  //Экспоненциальный поиск окна, содержащего первый
+  //элемент не меньше t, затем бинарный поиск в окне
+  size_t lo = from;
+  size_t hi = from;
+  size_t step = 1;
+  while (  (hi < v.size())
+         &&(less(v[hi], t))) {
+    lo = hi + 1;
+    hi += step;
+    step <<= 1;
+  }
+  if (hi > v.size())
+    hi = v.size();
+
+  return std::lower_bound(
+    v.begin() + lo,
+    v.begin() + hi,
+    t,
+    less) - v.begin();
+}
+
+template <class T>
+  template <class Less>
+  void sorted_vector <T>::  set_operation(
+    const sorted_vector <T> &a,
+    const sorted_vector <T> &b,
+    sorted_vector <T> &result,
+    bool emit_a,
+    bool emit_b,
+    bool emit_both,
+    Less less)
+{
+  //emit_a - выводить элементы, которые есть только в a,
+  //emit_b - только в b, emit_both - есть в обоих (берутся из a)
+  std::vector <T> tmp_a;
+  std::vector <T> tmp_b;
+  sorted_vector_view <T> va = a.sorted_storage(tmp_a, less);
+  sorted_vector_view <T> vb = b.sorted_storage(tmp_b, less);
+
+  //Если результат не совпадает с операндами,
+  //используется уже выделенная им память
+  std::vector <T> out;
+  if (  (&result != &a)
+      &&(&result != &b))
+    result._storage.swap(out);
+  out.clear();
+
+  size_t n = 0;
+  if (emit_a)
+    n += va.size();
+  if (emit_b)
+    n += vb.size();
+  if (  (!emit_a)
+      &&(!emit_b))
+    n = std::min(va.size(), vb.size());
+  out.reserve(n);
+
+  size_t i = 0;
+  size_t j = 0;
+
+  if (vb.size() * CIM_SORTED_VECTOR_GALLOP_RATIO <= va.size()) {
+
+    //a много больше b: галопирующий поиск по a
+    for (; j < vb.size(); j++) {
+      size_t k = gallop_lower(va, i, vb[j], less);
+      if (emit_a)
+        out.insert(out.end(), va.begin() + i, va.begin() + k);
+      i = k;
+      if (  (i < va.size())
+          &&(!less(vb[j], va[i]))) {
+        if (emit_both)
+          out.push_back(va[i]);
+        i++;
+      } else if (emit_b)
+        out.push_back(vb[j]);
+    }
+
+  } else if (va.size() * CIM_SORTED_VECTOR_GALLOP_RATIO <= vb.size()) {
+
+    //b много больше a: галопирующий поиск по b
+    for (; i < va.size(); i++) {
+      size_t k = gallop_lower(vb, j, va[i], less);
+      if (emit_b)
+        out.insert(out.end(), vb.begin() + j, vb.begin() + k);
+      j = k;
+      if (  (j < vb.size())
+          &&(!less(va[i], vb[j]))) {
+        if (emit_both)
+          out.push_back(va[i]);
+        j++;
+      } else if (emit_a)
+        out.push_back(va[i]);
+    }
+
+  } else if (  (emit_both)
+             &&(emit_a == emit_b)
+             &&(simd::set_operation(va.data(), va.size(), vb.data(), vb.size(), out, emit_a, less))) {
+
+    //Пересечение или объединение целых выполнено
+    //векторным ядром
+    i = va.size();
+    j = vb.size();
+
+  } else {
+
+    //Размеры сравнимы: линейное слияние
+    while (  (i < va.size())
+           &&(j < vb.size())) {
+      if (less(va[i], vb[j])) {
+        if (emit_a)
+          out.push_back(va[i]);
+        i++;
+      } else if (less(vb[j], va[i])) {
+        if (emit_b)
+          out.push_back(vb[j]);
+        j++;
+      } else {
+        if (emit_both)
+          out.push_back(va[i]);
+        i++;
+        j++;
+      }
+    }
+
+  }
+
+  if (emit_a)
+    out.insert(out.end(), va.begin() + i, va.end());
+  if (emit_b)
+    out.insert(out.end(), vb.begin() + j, vb.end());
+
+  result._storage.swap(out);
+  result._last_modified = (size_t)-1;
+  result._is_corrupted = false;
+  result.on_reset();
+}
+
+//***end sorted_vector***
+
+//***Iterators***
+
+template <class T>
+  class sorted_vector_iterator : public std::iterator<std::input_iterator_tag, T>
+{
+  friend sorted_vector <T>;
+
+  typedef T & reference;
+
+  sorted_vector_iterator(size_t pos, sorted_vector <T> *owner);
+
+  public:
+    sorted_vector_iterator(const sorted_vector_iterator &it);
+
+    bool operator!=(const sorted_vector_iterator &it) const;
+    bool operator==(const sorted_vector_iterator &it) const;
+
+    typename sorted_vector_iterator::reference operator*() const;
+
+    sorted_vector_iterator &operator++();
+
+    sorted_vector_iterator operator+(size_t inc) const;
+    sorted_vector_iterator operator-(size_t dec) const;
+
+    size_t pos() const;
+
+  private:
+    size_t _pos = (size_t)-1;
+    sorted_vector <T> *_owner = nullptr;
+};
+
+template <class T>
+  sorted_vector_iterator <T>::  sorted_vector_iterator(
+    size_t pos,
+    sorted_vector <T> *owner)
+    : _pos(pos), _owner(owner)
+{}
+
+template <class T>
+  sorted_vector_iterator <T>::  sorted_vector_iterator(
+    const sorted_vector_iterator &it)
+    : _pos(it._pos), _owner(it._owner)
+{}
+
+
+template <class T>
+  bool sorted_vector_iterator <T>:: operator!=(
+    const sorted_vector_iterator &it)
+    const
+{
+  return (  (_owner != it._owner)
+          ||(_pos != it._pos));
+}
+
+template <class T>
+  bool sorted_vector_iterator <T>:: operator==(
+    const sorted_vector_iterator &it)
+    const
+{
+  return (  (_owner == it._owner)
+          &&(_pos == it._pos));
+}
+
+template <class T>
+  typename sorted_vector_iterator <T>::reference
+  sorted_vector_iterator <T>:: operator*()
+  const
+{
+  return _owner->operator[](_pos);
+}
+
+template <class T>
+  sorted_vector_iterator <T> &sorted_vector_iterator <T>::  operator++()
+{
+  _pos++;
+  return *this;
+}
+
+template <class T>
+  sorted_vector_iterator <T> sorted_vector_iterator <T>:: operator+(
+  size_t inc)
+  const
+{
+  return sorted_vector_iterator(_pos + inc, _owner);
+}
+
+template <class T>
+  sorted_vector_iterator <T> sorted_vector_iterator <T>:: operator-(
+  size_t dec)
+  const
+{
+  return sorted_vector_iterator(_pos - dec, _owner);
+}
+
+template <class T>
+  size_t sorted_vector_iterator <T>:: pos()
+    const
+{
+  return _pos;
+}
+
+template <class T>
+  class sorted_vector_const_iterator : public std::iterator<std::input_iterator_tag, T>
+{
+  friend sorted_vector <T>;
+
+  typedef const T & const_reference;
+
+  sorted_vector_const_iterator(size_t pos, const sorted_vector <T> *owner);
+
+  public:
+    sorted_vector_const_iterator(const sorted_vector_const_iterator &it);
+
+    bool operator!=(const sorted_vector_const_iterator &it) const;
+    bool operator==(const sorted_vector_const_iterator &it) const;
+
+    typename sorted_vector_const_iterator::const_reference operator*() const;
+
+    sorted_vector_const_iterator &operator++();
+
+    sorted_vector_const_iterator operator+(size_t inc) const;
+    sorted_vector_const_iterator operator-(size_t dec) const;
+
+    size_t pos() const;
+
+  private:
+    size_t _pos = (size_t)-1;
+    const sorted_vector <T> *_owner = nullptr;
+};
+
+
+template <class T>
+  sorted_vector_const_iterator <T>::  sorted_vector_const_iterator(
+    size_t pos,
+    const sorted_vector <T> *owner)
+    : _pos(pos), _owner(owner)
+{}
+
+template <class T>
+  sorted_vector_const_iterator <T>::  sorted_vector_const_iterator(
+    const sorted_vector_const_iterator &it)
+    : _pos(it._pos), _owner(it._owner)
+{}
+
+
+template <class T>
+  bool sorted_vector_const_iterator <T>:: operator!=(
+    const sorted_vector_const_iterator &it)
+    const
+{
+  return (  (_owner != it._owner)
+          ||(_pos != it._pos));
+}
+
+template <class T>
+  bool sorted_vector_const_iterator <T>:: operator==(
+    const sorted_vector_const_iterator &it)
+    const
+{
+  return (  (_owner == it._owner)
+          &&(_pos == it._pos));
+}
+
+template <class T>
+  typename sorted_vector_const_iterator <T>::const_reference
+  sorted_vector_const_iterator <T>:: operator*()
+  const
+{
+  return _owner->operator[](_pos);
+}
+
+template <class T>
+  sorted_vector_const_iterator <T> &sorted_vector_const_iterator <T>::  operator++()
+{
+  _pos++;
+  return *this;
+}
+
+template <class T>
+  sorted_vector_const_iterator <T> sorted_vector_const_iterator <T>:: operator+(
+    size_t inc)
+    const
+{
+  return sorted_vector_const_iterator(_pos + inc, _owner);
+}
+
+template <class T>
+  sorted_vector_const_iterator <T> sorted_vector_const_iterator <T>:: operator-(
+    size_t dec)
+    const
+{
+  return sorted_vector_const_iterator(_pos - dec, _owner);
+}
+
+template <class T>
+  size_t sorted_vector_const_iterator <T>:: pos()
+    const
+{
+  return _pos;
+}
+
+//***Range view***
+
+template <class T>
+  class sorted_vector_view
+{
+  public:
+    sorted_vector_view();
+    sorted_vector_view(const T *first, const T *last);
+
+    typedef const T * const_iterator;
+
+    const_iterator begin()  const;
+    const_iterator end()    const;
+
+    bool empty()  const;
+    size_t size() const;
+
+    const T &operator[](size_t pos) const;
+    const T &front()                const;
+    const T &back()                 const;
+    const T *data()                 const;
+
+  private:
+    const T *_first = nullptr;
+    const T *_last  = nullptr;
+};
+
+template <class T>
+  sorted_vector_view <T>::  sorted_vector_view()
+{}
+
+template <class T>
+  sorted_vector_view <T>::  sorted_vector_view(
+    const T *first,
+    const T *last)
+    : _first(first), _last(last)
+{}
+
+template <class T>
+  typename sorted_vector_view <T>::const_iterator sorted_vector_view <T>::  begin()
+  const
+{
+  return _first;
+}
+
+template <class T>
+  typename sorted_vector_view <T>::const_iterator sorted_vector_view <T>::  end()
+  const
+{
+  return _last;
+}
+
+template <class T>
+  bool sorted_vector_view <T>:: empty()
+  const
+{
+  return _first == _last;
+}
+
+template <class T>
+  size_t sorted_vector_view <T>:: size()
+  const
+{
+  return _last - _first;
+}
+
+template <class T>
+  const T &sorted_vector_view <T>:: operator[](
+    size_t pos)
+    const
+{
+  return _first[pos];
+}
+
+template <class T>
+  const T &sorted_vector_view <T>:: front()
+  const
+{
+  return *_first;
+}
+
+template <class T>
+  const T &sorted_vector_view <T>:: back()
+  const
+{
+  return *(_last - 1);
+}
+
+template <class T>
+  const T *sorted_vector_view <T>:: data()
+  const
+{
+  return _first;
+}
+
+#define CIM_KEYNAME _key
+  //Макрос определяет название поля в классе,
+  //хранимом sorted_vector_with_key, по
+  //которому происходит сравнение для поиска
+  //без вызова конструктора хранимого класса.
+  // !Должно совпадать с полем, по которому !
+  // !происходит сортировка!                !
+
+template <class T, class Key>
+  class sorted_vector_with_key : public sorted_vector <T>
+{
+  public:
+    sorted_vector_with_key();
+    sorted_vector_with_key(std::initializer_list <T> ilist);
+    sorted_vector_with_key(const std::vector <T> &v);
+    sorted_vector_with_key(std::vector <T> &&v);
+
+    size_t find(const Key &key, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_linear(const Key &key, size_t start_pos = 0, size_t end_pos = -1) const;
+
+    void set_intersection(const sorted_vector_with_key <T, Key> &sv, sorted_vector_with_key <T, Key> &result)          const;
+    void set_difference(const sorted_vector_with_key <T, Key> &sv, sorted_vector_with_key <T, Key> &result)            const;
+    void set_union(const sorted_vector_with_key <T, Key> &sv, sorted_vector_with_key <T, Key> &result)                 const;
+    void set_symmetric_difference(const sorted_vector_with_key <T, Key> &sv, sorted_vector_with_key <T, Key> &result)  const;
+
+    sorted_vector_view <T> range(const Key &lo, const Key &hi)  const;
+    sorted_vector_view <T> range(const Key &lo, const Key &hi);
+    size_t count_range(const Key &lo, const Key &hi)             const;
+    size_t erase_range(const Key &lo, const Key &hi);
+
+    size_t rank(const Key &key) const;
+    const T &select(const Key &key, size_t k) const;
+
+    using sorted_vector <T>::find;
+    using sorted_vector <T>::find_linear;
+    using sorted_vector <T>::range;
+    using sorted_vector <T>::count_range;
+    using sorted_vector <T>::erase_range;
+    using sorted_vector <T>::rank;
+    using sorted_vector <T>::select;
+
+  protected:
+    struct key_of
+    {
+      const Key &operator()(const T &t) const
+      {
+        return t.CIM_KEYNAME;
+      }
+    };
+
+    struct key_less
+    {
+      bool operator()(const T &a, const T &b) const
+      {
+        return a.CIM_KEYNAME < b.CIM_KEYNAME;
+      }
+    };
+
+    void sort_elements(std::vector <T> &v) const;
+
+  private:
+    static void sort_keys(std::vector <T> &v, std::false_type);
+    static void sort_keys(std::vector <T> &v, std::true_type);
+};
+
+//Конструктор sorted_vector сортирует до того, как
+//становится доступен sort_elements потомка, поэтому
+//элементы сортируются здесь
+template <class T, class Key>
+  sorted_vector_with_key <T, Key>::  sorted_vector_with_key()
+{}
+
+template <class T, class Key>
+  sorted_vector_with_key <T, Key>::  sorted_vector_with_key(
+    std::initializer_list <T> ilist)
+{
+  this->assign(ilist);
+}
+
+template <class T, class Key>
+  sorted_vector_with_key <T, Key>::  sorted_vector_with_key(
+    const std::vector <T> &v)
+{
+  this->merge(v);
+}
+
+template <class T, class Key>
+  sorted_vector_with_key <T, Key>::  sorted_vector_with_key(
+    std::vector <T> &&v)
+{
+  this->merge(static_cast <std::vector <T> &&> (v));
+}
+
+template <class T, class Key>
+  size_t sorted_vector_with_key <T, Key>:: find(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (this->size() == 0)
+    return -1;
+  if (!this->corrupted()) {
+    CIM_SORTED_VECTOR_COUNT(searches, 1);
+    size_t f = start_pos;
+    size_t l = (end_pos == (size_t)-1) ? this->size() - 1 : end_pos;
+    size_t m = (f + l) / 2;
+    while (f <= l) {
+      CIM_SORTED_VECTOR_COUNT(probes, 1);
+      if (this->operator[](m).CIM_KEYNAME == key)
+        return m;
+      else if (this->operator[](f).CIM_KEYNAME == key)
+        return f;
+      else if (this->operator[](l).CIM_KEYNAME == key)
+        return l;
+      else {
+        if (this->operator[](m).CIM_KEYNAME < key) {
+          f = m + 1;
+        } else {
+          {
+            if (m == 0)
+              return -1;
+            l = m - 1;
+          }
+        }
+        m = (l + f) / 2;
+      }
+    }
+    return -1;
+  } else {
+    return find_linear(key, start_pos, end_pos);
+  }
+}
+
+template <class T, class Key>
+  size_t sorted_vector_with_key <T, Key>:: find_linear(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  CIM_SORTED_VECTOR_COUNT(linear_searches, 1);
+  if (this->size() == 0)
+    return (size_t)-1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+
+  if (start_pos > end_pos)
+    return (size_t)-1;
+
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+
+  while (start_pos != end_pos)
+  {
+    if (this->operator[](start_pos++).CIM_KEYNAME == key)
+      return start_pos - 1;
+  }
+  return (this->operator[](end_pos).CIM_KEYNAME == key) ? end_pos : (size_t)-1;
+}
+
+template <class T, class Key>
+  void sorted_vector_with_key <T, Key>::  set_intersection(
+    const sorted_vector_with_key <T, Key> &sv,
+    sorted_vector_with_key <T, Key> &result)
+    const
+{
+  sorted_vector <T>::set_operation(*this, sv, result, false, false, true, key_less());
+}
+
+template <class T, class Key>
+  void sorted_vector_with_key <T, Key>::  set_difference(
+    const sorted_vector_with_key <T, Key> &sv,
+    sorted_vector_with_key <T, Key> &result)
+    const
+{
+  sorted_vector <T>::set_operation(*this, sv, result, true, false, false, key_less());
+}
+
+template <class T, class Key>
+  void sorted_vector_with_key <T, Key>::  set_union(
+    const sorted_vector_with_key <T, Key> &sv,
+    sorted_vector_with_key <T, Key> &result)
+    const
+{
+  sorted_vector <T>::set_operation(*this, sv, result, true, true, true, key_less());
+}
+
+template <class T, class Key>
+  void sorted_vector_with_key <T, Key>::  set_symmetric_difference(
+    const sorted_vector_with_key <T, Key> &sv,
+    sorted_vector_with_key <T, Key> &result)
+    const
+{
+  sorted_vector <T>::set_operation(*this, sv, result, true, true, false, key_less());
+}
+
+template <class T, class Key>
+  sorted_vector_view <T> sorted_vector_with_key <T, Key>::  range(
+    const Key &lo,
+    const Key &hi)
+    const
+{
+  return this->range_by(lo, hi, key_of());
+}
+
+template <class T, class Key>
+  sorted_vector_view <T> sorted_vector_with_key <T, Key>::  range(
+    const Key &lo,
+    const Key &hi)
+{
+  return this->range_by(lo, hi, key_of());
+}
+
+template <class T, class Key>
+  size_t sorted_vector_with_key <T, Key>::  count_range(
+    const Key &lo,
+    const Key &hi)
+    const
+{
+  return this->count_range_by(lo, hi, key_of());
+}
+
+template <class T, class Key>
+  size_t sorted_vector_with_key <T, Key>::  erase_range(
+    const Key &lo,
+    const Key &hi)
+{
+  return this->erase_range_by(lo, hi, key_of());
+}
+
+template <class T, class Key>
+  size_t sorted_vector_with_key <T, Key>:: rank(
+    const Key &key)
+    const
+{
+  return this->rank_by(key, key_of());
+}
+
+template <class T, class Key>
+  const T &sorted_vector_with_key <T, Key>::  select(
+    const Key &key,
+    size_t k)
+    const
+{
+  return this->select(rank(key) + k);
+}
+
+template <class T, class Key>
+  void sorted_vector_with_key <T, Key>::  sort_elements(
+    std::vector <T> &v)
+    const
+{
+  if (this->sort_runs(v))
+    return;
+  //Перемещение записей по 64-битному ключу обходится
+  //дороже std::sort, поэтому поразрядно сортируются
+  //только записи с ключом не длиннее 32 бит
+  sort_keys(
+    v,
+    std::integral_constant <bool,
+         std::is_integral <Key>::value
+      && !std::is_same <Key, bool>::value
+      && (sizeof(Key) <= 4)> ());
+}
+
+template <class T, class Key>
+  void sorted_vector_with_key <T, Key>::  sort_keys(
+    std::vector <T> &v,
+    std::false_type)
+{
+  std::sort(v.begin(), v.end());
+}
+
+template <class T, class Key>
+  void sorted_vector_with_key <T, Key>::  sort_keys(
+    std::vector <T> &v,
+    std::true_type)
+{
+  if (v.size() < CIM_SORTED_VECTOR_RADIX_SORT)
+    std::sort(v.begin(), v.end());
+  else
+    sorted_vector <T>::radix_sort_by(v, key_of());
+}
+
+//***Frozen snapshot***
+
+template <class T>
+  class frozen_sorted_vector
+{
+  public:
+    typedef const T * const_iterator;
+
+    frozen_sorted_vector();
+
+    sorted_vector <T> thaw();
+    void thaw(sorted_vector <T> &sv);
+
+    const_iterator begin()  const;
+    const_iterator end()    const;
+    const_iterator cbegin() const;
+    const_iterator cend()   const;
+
+    bool empty()  const;
+    size_t size() const;
+
+    const T &operator[](size_t pos) const;
+    const T &at(size_t pos)         const;
+    const T &front()                const;
+    const T &back()                 const;
+    const T *data()                 const;
+
+    size_t find(const T &t)                       const;
+    size_t find_first(const T &t)                 const;
+    size_t find_last(const T &t)                  const;
+    size_t find_floor(const T &t)                 const;
+    size_t find_ceil(const T &t)                  const;
+    bool contains(const T &t)                     const;
+
+    size_t rank(const T &t)                       const;
+    sorted_vector_view <T> range(const T &lo, const T &hi)  const;
+    size_t count_range(const T &lo, const T &hi)             const;
+
+  private:
+    friend sorted_vector <T>;
+
+    frozen_sorted_vector(std::vector <T> &&v);
+
+    size_t lower(const T &t) const;
+    size_t upper(const T &t) const;
+
+    std::vector <T> _storage;
+};
+
+template <class T>
+  frozen_sorted_vector <T>::  frozen_sorted_vector()
+{}
+
+template <class T>
+  frozen_sorted_vector <T>::  frozen_sorted_vector(
+    std::vector <T> &&v)
+  : _storage(static_cast <std::vector <T> &&> (v))
+{}
+
+template <class T>
+  frozen_sorted_vector <T> sorted_vector <T>::  freeze()
+{
+  //Замороженный экземпляр обязан быть упорядоченным,
+  //поэтому исправление выполняется и при
+  //приостановленном автоматическом исправлении
+  if (_is_corrupted)
+    repair();
+  frozen_sorted_vector <T> frozen(static_cast <std::vector <T> &&> (_storage.vector()));
+  _storage.clear();
+  _last_modified = (size_t)-1;
+  _is_corrupted = false;
+  on_reset();
+  return frozen;
+}
+
+template <class T>
+  sorted_vector <T> frozen_sorted_vector <T>::  thaw()
+{
+  sorted_vector <T> sv;
+  thaw(sv);
+  return sv;
+}
+
+template <class T>
+  void frozen_sorted_vector <T>::  thaw(
+    sorted_vector <T> &sv)
+{
+  sv.assign_sorted(static_cast <std::vector <T> &&> (_storage));
+  _storage.clear();
+}
+
+template <class T>
+  typename frozen_sorted_vector <T>::const_iterator frozen_sorted_vector <T>::  begin()
+  const
+{
+  return _storage.data();
+}
+
+template <class T>
+  typename frozen_sorted_vector <T>::const_iterator frozen_sorted_vector <T>::  end()
+  const
+{
+  return _storage.data() + _storage.size();
+}
+
+template <class T>
+  typename frozen_sorted_vector <T>::const_iterator frozen_sorted_vector <T>::  cbegin()
+  const
+{
+  return begin();
+}
+
+template <class T>
+  typename frozen_sorted_vector <T>::const_iterator frozen_sorted_vector <T>::  cend()
+  const
+{
+  return end();
+}
+
+template <class T>
+  bool frozen_sorted_vector <T>::  empty()
+  const
+{
+  return _storage.empty();
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  size()
+  const
+{
+  return _storage.size();
+}
+
+template <class T>
+  const T &frozen_sorted_vector <T>::  operator[](
+    size_t pos)
+    const
+{
+  return _storage[pos];
+}
+
+template <class T>
+  const T &frozen_sorted_vector <T>::  at(
+    size_t pos)
+    const
+{
+  return _storage.at(pos);
+}
+
+template <class T>
+  const T &frozen_sorted_vector <T>::  front()
+  const
+{
+  return _storage.front();
+}
+
+template <class T>
+  const T &frozen_sorted_vector <T>::  back()
+  const
+{
+  return _storage.back();
+}
+
+template <class T>
+  const T *frozen_sorted_vector <T>::  data()
+  const
+{
+  return _storage.data();
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  find(
+    const T &t)
+    const
+{
+  return find_first(t);
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  find_first(
+    const T &t)
+    const
+{
+  size_t pos = lower(t);
+  if (  (pos < _storage.size())
+      &&(!(t < _storage[pos])))
+    return pos;
+  return -1;
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  find_last(
+    const T &t)
+    const
+{
+  size_t pos = upper(t);
+  if (  (pos > 0)
+      &&(!(_storage[pos - 1] < t)))
+    return pos - 1;
+  return -1;
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  find_floor(
+    const T &t)
+    const
+{
+  size_t pos = lower(t);
+  if (  (pos < _storage.size())
+      &&(!(t < _storage[pos])))
+    return pos;
+  return (pos > 0) ? pos - 1 : (size_t)-1;
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  find_ceil(
+    const T &t)
+    const
+{
+  size_t pos = upper(t);
+  if (  (pos > 0)
+      &&(!(_storage[pos - 1] < t)))
+    return pos - 1;
+  return (pos < _storage.size()) ? pos : (size_t)-1;
+}
+
+template <class T>
+  bool frozen_sorted_vector <T>::  contains(
+    const T &t)
+    const
+{
+  return find_first(t) != (size_t)-1;
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  rank(
+    const T &t)
+    const
+{
+  return lower(t);
+}
+
+template <class T>
+  sorted_vector_view <T> frozen_sorted_vector <T>::  range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (hi < lo)
+    return sorted_vector_view <T> ();
+  return sorted_vector_view <T> (
+    _storage.data() + lower(lo),
+    _storage.data() + upper(hi));
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  count_range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (hi < lo)
+    return 0;
+  return upper(hi) - lower(lo);
+}
+
+//***private methods***
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  lower(
+    const T &t)
+    const
+{
+  //Порядок не проверяется: снимок неизменяем
+  const T *d = _storage.data();
+  return sorted_vector_partition_point(
+    _storage.size(),
+    [&](size_t i) { return d[i] < t; });
+}
+
+template <class T>
+  size_t frozen_sorted_vector <T>::  upper(
+    const T &t)
+    const
+{
+  const T *d = _storage.data();
+  return sorted_vector_partition_point(
+    _storage.size(),
+    [&](size_t i) { return !(t < d[i]); });
+}
+
+//***Cracking***
+
+template <class T>
+  class cracked_sorted_vector
+{
+  public:
+    cracked_sorted_vector();
+    cracked_sorted_vector(const std::vector <T> &v);
+    cracked_sorted_vector(std::vector <T> &&v);
+
+    sorted_vector <T> thaw();
+    void thaw(sorted_vector <T> &sv);
+
+    bool empty()  const;
+    size_t size() const;
+
+    const T &operator[](size_t pos) const;
+    const T *data()                 const;
+
+    size_t find(const T &t);
+    size_t find_first(const T &t);
+    size_t find_last(const T &t);
+    size_t find_floor(const T &t);
+    size_t find_ceil(const T &t);
+
+    size_t rank(const T &t);
+    size_t rank(const T &t)                                  const;
+    sorted_vector_view <T> range(const T &lo, const T &hi);
+    size_t count_range(const T &lo, const T &hi);
+    size_t count_range(const T &lo, const T &hi)             const;
+
+    void sort();
+    bool sorted()       const;
+    size_t pieces()     const;
+
+  private:
+    friend sorted_vector <T>;
+
+    cracked_sorted_vector(std::vector <T> &&v, bool is_sorted);
+
+    //Граница куска: слева элементы меньше pivot (не
+    //больше при upper), справа - не меньше (больше)
+    struct crack
+    {
+      size_t  pos;
+      T       pivot;
+      bool    upper;
+    };
+
+    bool crack_less(const crack &c, const T &t, bool upper) const;
+    size_t find_piece(const T &t, bool upper)               const;
+    size_t split(const T &t, bool upper);
+    size_t bound(const T &t, bool upper)                    const;
+    void sort_piece(size_t piece);
+    void sort_range(size_t first, size_t last);
+    size_t piece_first(size_t piece)                        const;
+    size_t piece_last(size_t piece)                         const;
+
+    std::vector <T>     _storage;
+    std::vector <crack> _cracks;
+    std::vector <char>  _sorted;
+    size_t              _unsorted = 0;
+};
+
+template <class T>
+  cracked_sorted_vector <T>::  cracked_sorted_vector()
+  : _sorted(1, 1)
+{}
+
+template <class T>
+  cracked_sorted_vector <T>::  cracked_sorted_vector(
+    const std::vector <T> &v)
+  : _storage(v), _sorted(1, 0), _unsorted(1)
+{
+  sort_piece(0);
+}
+
+template <class T>
+  cracked_sorted_vector <T>::  cracked_sorted_vector(
+    std::vector <T> &&v)
+  : _storage(static_cast <std::vector <T> &&> (v)), _sorted(1, 0), _unsorted(1)
+{
+  sort_piece(0);
+}
+
+template <class T>
+  cracked_sorted_vector <T>::  cracked_sorted_vector(
+    std::vector <T> &&v,
+    bool is_sorted)
+  : _storage(static_cast <std::vector <T> &&> (v)), _sorted(1, is_sorted), _unsorted(is_sorted ? 0 : 1)
+{
+  sort_piece(0);
+}
+
+template <class T>
+  cracked_sorted_vector <T> sorted_vector <T>::  crack()
+{
+  //Хранилище перемещается без сортировки; упорядоченный
+  //экземпляр становится одним упорядоченным куском
+  cracked_sorted_vector <T> cracked(
+    static_cast <std::vector <T> &&> (_storage.vector()),
+    !_is_corrupted);
+  _storage.clear();
+  _last_modified = (size_t)-1;
+  _is_corrupted = false;
+  on_reset();
+  return cracked;
+}
+
+template <class T>
+  sorted_vector <T> cracked_sorted_vector <T>::  thaw()
+{
+  sorted_vector <T> sv;
+  thaw(sv);
+  return sv;
+}
+
+template <class T>
+  void cracked_sorted_vector <T>::  thaw(
+    sorted_vector <T> &sv)
+{
+  sort();
+  sv.assign_sorted(static_cast <std::vector <T> &&> (_storage));
+  _storage.clear();
+}
+
+template <class T>
+  bool cracked_sorted_vector <T>::  empty()
+  const
+{
+  return _storage.empty();
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  size()
+  const
+{
+  return _storage.size();
+}
+
+template <class T>
+  const T &cracked_sorted_vector <T>::  operator[](
+    size_t pos)
+    const
+{
+  return _storage[pos];
+}
+
+template <class T>
+  const T *cracked_sorted_vector <T>::  data()
+  const
+{
+  return _storage.data();
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  find(
+    const T &t)
+{
+  return find_first(t);
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  find_first(
+    const T &t)
+{
+  //Равные t элементы собираются между двумя границами
+  size_t first = split(t, false);
+  size_t last = split(t, true);
+  return (first < last) ? first : (size_t)-1;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  find_last(
+    const T &t)
+{
+  size_t first = split(t, false);
+  size_t last = split(t, true);
+  return (first < last) ? last - 1 : (size_t)-1;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  find_floor(
+    const T &t)
+{
+  size_t first = split(t, false);
+  size_t last = split(t, true);
+  if (first < last)
+    return first;
+  if (first == 0)
+    return -1;
+
+  //Наибольший меньший элемент - максимум куска,
+  //заканчивающегося границей; граница по нему ставит
+  //его в конец куска
+  size_t piece = std::upper_bound(
+    _cracks.begin(),
+    _cracks.end(),
+    first - 1,
+    [](size_t pos, const crack &c) { return pos < c.pos; }) - _cracks.begin();
+  if (!_sorted[piece]) {
+    size_t f = piece_first(piece);
+    T max(*std::max_element(_storage.begin() + f, _storage.begin() + first));
+    split(max, false);
+  }
+  return first - 1;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  find_ceil(
+    const T &t)
+{
+  size_t first = split(t, false);
+  size_t last = split(t, true);
+  if (first < last)
+    return last - 1;
+  if (last == _storage.size())
+    return -1;
+
+  size_t piece = std::upper_bound(
+    _cracks.begin(),
+    _cracks.end(),
+    last,
+    [](size_t pos, const crack &c) { return pos < c.pos; }) - _cracks.begin();
+  if (!_sorted[piece]) {
+    size_t l = piece_last(piece);
+    T min(*std::min_element(_storage.begin() + last, _storage.begin() + l));
+    split(min, true);
+  }
+  return last;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  rank(
+    const T &t)
+{
+  return split(t, false);
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  rank(
+    const T &t)
+    const
+{
+  //Без разбиения: элементы неупорядоченного куска
+  //подсчитываются
+  return bound(t, false);
+}
+
+template <class T>
+  sorted_vector_view <T> cracked_sorted_vector <T>::  range(
+    const T &lo,
+    const T &hi)
+{
+  //Куски внутри интервала сортируются, поэтому
+  //представление остаётся упорядоченным и неизменным
+  //до следующего изменения экземпляра
+  if (hi < lo)
+    return sorted_vector_view <T> ();
+  size_t first = split(lo, false);
+  size_t last = split(hi, true);
+  sort_range(first, last);
+  return sorted_vector_view <T> (
+    _storage.data() + first,
+    _storage.data() + last);
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  count_range(
+    const T &lo,
+    const T &hi)
+{
+  if (hi < lo)
+    return 0;
+  size_t first = split(lo, false);
+  return split(hi, true) - first;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  count_range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (hi < lo)
+    return 0;
+  return bound(hi, true) - bound(lo, false);
+}
+
+template <class T>
+  void cracked_sorted_vector <T>::  sort()
+{
+  sort_range(0, _storage.size());
+}
+
+template <class T>
+  bool cracked_sorted_vector <T>::  sorted()
+  const
+{
+  return _unsorted == 0;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  pieces()
+  const
+{
+  return _sorted.size();
+}
+
+//***private methods***
+
+template <class T>
+  bool cracked_sorted_vector <T>::  crack_less(
+    const crack &c,
+    const T &t,
+    bool upper)
+    const
+{
+  //Границы упорядочены по (pivot, upper)
+  if (c.pivot < t)
+    return true;
+  if (t < c.pivot)
+    return false;
+  return (!c.upper) && upper;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  find_piece(
+    const T &t,
+    bool upper)
+    const
+{
+  //Кусок, в который попадает граница для t, или
+  //номер самой границы, если она уже поставлена
+  return std::lower_bound(
+    _cracks.begin(),
+    _cracks.end(),
+    t,
+    [&](const crack &c, const T &v) { return crack_less(c, v, upper); }) - _cracks.begin();
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  split(
+    const T &t,
+    bool upper)
+{
+  //Позиция, слева от которой элементы меньше t (не
+  //больше при upper). Неупорядоченный кусок, в который
+  //она попадает, разбивается одним проходом partition
+  if (  (_unsorted == 0)
+      ||(_storage.empty()))
+    return upper
+      ? std::upper_bound(_storage.begin(), _storage.end(), t) - _storage.begin()
+      : std::lower_bound(_storage.begin(), _storage.end(), t) - _storage.begin();
+
+  size_t piece = find_piece(t, upper);
+  if (  (piece < _cracks.size())
+      &&(!(t < _cracks[piece].pivot))
+      &&(_cracks[piece].upper == upper))
+    return _cracks[piece].pos;
+
+  typename std::vector <T>::iterator f = _storage.begin() + piece_first(piece);
+  typename std::vector <T>::iterator l = _storage.begin() + piece_last(piece);
+  if (_sorted[piece])
+    return (upper ? std::upper_bound(f, l, t) : std::lower_bound(f, l, t)) - _storage.begin();
+
+  typename std::vector <T>::iterator m = upper
+    ? std::partition(f, l, [&](const T &v) { return !(t < v); })
+    : std::partition(f, l, [&](const T &v) { return v < t; });
+  size_t pos = m - _storage.begin();
+  crack c = {pos, t, upper};
+  _cracks.insert(_cracks.begin() + piece, c);
+  _sorted.insert(_sorted.begin() + piece + 1, 0);
+  _unsorted++;
+  sort_piece(piece);
+  sort_piece(piece + 1);
+  return pos;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  bound(
+    const T &t,
+    bool upper)
+    const
+{
+  //Та же позиция, что у split, без изменения
+  //экземпляра: элементы неупорядоченного куска
+  //подсчитываются одним проходом
+  if (  (_unsorted == 0)
+      ||(_storage.empty()))
+    return upper
+      ? std::upper_bound(_storage.begin(), _storage.end(), t) - _storage.begin()
+      : std::lower_bound(_storage.begin(), _storage.end(), t) - _storage.begin();
+
+  size_t piece = find_piece(t, upper);
+  if (  (piece < _cracks.size())
+      &&(!(t < _cracks[piece].pivot))
+      &&(_cracks[piece].upper == upper))
+    return _cracks[piece].pos;
+
+  typename std::vector <T>::const_iterator f = _storage.begin() + piece_first(piece);
+  typename std::vector <T>::const_iterator l = _storage.begin() + piece_last(piece);
+  if (_sorted[piece])
+    return (upper ? std::upper_bound(f, l, t) : std::lower_bound(f, l, t)) - _storage.begin();
+  size_t n = upper
+    ? std::count_if(f, l, [&](const T &v) { return !(t < v); })
+    : std::count_if(f, l, [&](const T &v) { return v < t; });
+  return piece_first(piece) + n;
+}
+
+template <class T>
+  void cracked_sorted_vector <T>::  sort_piece(
+    size_t piece)
+{
+  //Маленький кусок сразу сортируется. Когда
+  //неупорядоченных кусков не остаётся, границы
+  //больше не нужны
+  if (_sorted[piece])
+    return;
+  size_t f = piece_first(piece);
+  size_t l = piece_last(piece);
+  if (l - f > CIM_SORTED_VECTOR_CRACKING_PIECE)
+    return;
+  std::sort(_storage.begin() + f, _storage.begin() + l);
+  _sorted[piece] = 1;
+  if (--_unsorted == 0) {
+    _cracks.clear();
+    _sorted.assign(1, 1);
+  }
+}
+
+template <class T>
+  void cracked_sorted_vector <T>::  sort_range(
+    size_t first,
+    size_t last)
+{
+  //Сортируются неупорядоченные куски, пересекающие
+  //[first, last); first и last - границы кусков
+  for (size_t piece = 0; (_unsorted > 0) && (piece < _sorted.size()); piece++) {
+    size_t f = piece_first(piece);
+    size_t l = piece_last(piece);
+    if (  (_sorted[piece])
+        ||(l <= first)
+        ||(f >= last))
+      continue;
+    std::sort(_storage.begin() + f, _storage.begin() + l);
+    _sorted[piece] = 1;
+    if (--_unsorted == 0) {
+      _cracks.clear();
+      _sorted.assign(1, 1);
+    }
+  }
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  piece_first(
+    size_t piece)
+    const
+{
+  return (piece == 0) ? 0 : _cracks[piece - 1].pos;
+}
+
+template <class T>
+  size_t cracked_sorted_vector <T>::  piece_last(
+    size_t piece)
+    const
+{
+  return (piece == _cracks.size()) ? _storage.size() : _cracks[piece].pos;
+}
+
+//***Sliding window***
+
+template <class T>
+  class sorted_window
+{
+  public:
+    typedef const T * const_iterator;
+
+    sorted_window(size_t max_size = 0);
+
+    void set_max_size(size_t max_size);
+    size_t max_size() const;
+
+    void push(const T &t);
+    void push(T &&t);
+
+    size_t trim_front(size_t count);
+    size_t trim_before(const T &t);
+    void clear();
+
+    const_iterator begin()  const;
+    const_iterator end()    const;
+    const_iterator cbegin() const;
+    const_iterator cend()   const;
+
+    bool empty()  const;
+    size_t size() const;
+
+    const T &operator[](size_t pos) const;
+    const T &at(size_t pos)         const;
+    const T &front()                const;
+    const T &back()                 const;
+    const T *data()                 const;
+
+    size_t find(const T &t)                       const;
+    size_t find_first(const T &t)                 const;
+    size_t find_last(const T &t)                  const;
+    size_t find_floor(const T &t)                 const;
+    size_t find_ceil(const T &t)                  const;
+    bool contains(const T &t)                     const;
+
+    size_t rank(const T &t)                       const;
+    sorted_vector_view <T> range(const T &lo, const T &hi)  const;
+    size_t count_range(const T &lo, const T &hi)             const;
+
+  private:
+    template <class U>
+      void place(U &&t);
+
+    void fit();
+
+    size_t lower(const T &t) const;
+    size_t upper(const T &t) const;
+
+    sorted_vector_buffer <T>  _storage;
+    size_t                    _max_size;  //0 - без ограничения
+};
+
+template <class T>
+  sorted_window <T>::  sorted_window(
+    size_t max_size)
+  : _max_size(max_size)
+{}
+
+template <class T>
+  void sorted_window <T>::  set_max_size(
+    size_t max_size)
+{
+  _max_size = max_size;
+  fit();
+}
+
+template <class T>
+  size_t sorted_window <T>::  max_size()
+  const
+{
+  return _max_size;
+}
+
+template <class T>
+  void sorted_window <T>::  push(
+    const T &t)
+{
+  place(t);
+  fit();
+}
+
+template <class T>
+  void sorted_window <T>::  push(
+    T &&t)
+{
+  place(static_cast <T &&> (t));
+  fit();
+}
+
+template <class T>
+  size_t sorted_window <T>::  trim_front(
+    size_t count)
+{
+  if (count > size())
+    count = size();
+  _storage.erase(_storage.begin(), _storage.begin() + count);
+  return count;
+}
+
+template <class T>
+  size_t sorted_window <T>::  trim_before(
+    const T &t)
+{
+  size_t count = lower(t);
+  _storage.erase(_storage.begin(), _storage.begin() + count);
+  return count;
+}
+
+template <class T>
+  void sorted_window <T>::  clear()
+{
+  _storage.clear();
+}
+
+template <class T>
+  typename sorted_window <T>::const_iterator sorted_window <T>::  begin()
+  const
+{
+  return data();
+}
+
+template <class T>
+  typename sorted_window <T>::const_iterator sorted_window <T>::  end()
+  const
+{
+  return _storage.end();
+}
+
+template <class T>
+  typename sorted_window <T>::const_iterator sorted_window <T>::  cbegin()
+  const
+{
+  return begin();
+}
+
+template <class T>
+  typename sorted_window <T>::const_iterator sorted_window <T>::  cend()
+  const
+{
+  return end();
+}
+
+template <class T>
+  bool sorted_window <T>::  empty()
+  const
+{
+  return _storage.empty();
+}
+
+template <class T>
+  size_t sorted_window <T>::  size()
+  const
+{
+  return _storage.size();
+}
+
+template <class T>
+  const T &sorted_window <T>::  operator[](
+    size_t pos)
+    const
+{
+  return _storage[pos];
+}
+
+template <class T>
+  const T &sorted_window <T>::  at(
+    size_t pos)
+    const
+{
+  if (pos >= size())
+    throw std::out_of_range("sorted_window::at");
+  return _storage[pos];
+}
+
+template <class T>
+  const T &sorted_window <T>::  front()
+  const
+{
+  return _storage.front();
+}
+
+template <class T>
+  const T &sorted_window <T>::  back()
+  const
+{
+  return _storage.back();
+}
+
+template <class T>
+  const T *sorted_window <T>::  data()
+  const
+{
+  return _storage.data();
+}
+
+template <class T>
+  size_t sorted_window <T>::  find(
+    const T &t)
+    const
+{
+  return find_first(t);
+}
+
+template <class T>
+  size_t sorted_window <T>::  find_first(
+    const T &t)
+    const
+{
+  size_t pos = lower(t);
+  if (  (pos < size())
+      &&(!(t < (*this)[pos])))
+    return pos;
+  return -1;
+}
+
+template <class T>
+  size_t sorted_window <T>::  find_last(
+    const T &t)
+    const
+{
+  size_t pos = upper(t);
+  if (  (pos > 0)
+      &&(!((*this)[pos - 1] < t)))
+    return pos - 1;
+  return -1;
+}
+
+template <class T>
+  size_t sorted_window <T>::  find_floor(
+    const T &t)
+    const
+{
+  size_t pos = lower(t);
+  if (  (pos < size())
+      &&(!(t < (*this)[pos])))
+    return pos;
+  return (pos > 0) ? pos - 1 : (size_t)-1;
+}
+
+template <class T>
+  size_t sorted_window <T>::  find_ceil(
+    const T &t)
+    const
+{
+  size_t pos = upper(t);
+  if (  (pos > 0)
+      &&(!((*this)[pos - 1] < t)))
+    return pos - 1;
+  return (pos < size()) ? pos : (size_t)-1;
+}
+
+template <class T>
+  bool sorted_window <T>::  contains(
+    const T &t)
+    const
+{
+  return find_first(t) != (size_t)-1;
+}
+
+template <class T>
+  size_t sorted_window <T>::  rank(
+    const T &t)
+    const
+{
+  return lower(t);
+}
+
+template <class T>
+  sorted_vector_view <T> sorted_window <T>::  range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (hi < lo)
+    return sorted_vector_view <T> ();
+  return sorted_vector_view <T> (
+    data() + lower(lo),
+    data() + upper(hi));
+}
+
+template <class T>
+  size_t sorted_window <T>::  count_range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (hi < lo)
+    return 0;
+  return upper(hi) - lower(lo);
+}
+
+//***private methods***
+
+template <class T>
+  template <class U>
+  void sorted_window <T>::  place(
+    U &&t)
+{
+  //Элемент не меньше последнего добавляется в конец,
+  //иначе вставка сдвигает ближнюю к нему часть окна
+  if (  (empty())
+      ||(!(t < _storage.back())))
+    _storage.push_back(static_cast <U &&> (t));
+  else
+    _storage.insert(_storage.begin() + upper(t), static_cast <U &&> (t));
+}
+
+template <class T>
+  void sorted_window <T>::  fit()
+{
+  if (  (_max_size > 0)
+      &&(size() > _max_size))
+    _storage.erase(_storage.begin(), _storage.begin() + (size() - _max_size));
+}
+
+template <class T>
+  size_t sorted_window <T>::  lower(
+    const T &t)
+    const
+{
+  const T *d = data();
+  return sorted_vector_partition_point(
+    size(),
+    [&](size_t i) { return d[i] < t; });
+}
+
+template <class T>
+  size_t sorted_window <T>::  upper(
+    const T &t)
+    const
+{
+  const T *d = data();
+  return sorted_vector_partition_point(
+    size(),
+    [&](size_t i) { return !(t < d[i]); });
+}
+
+//***Set operations***
+
+template <class T>
+  sorted_vector <T> set_intersection(
+    const sorted_vector <T> &a,
+    const sorted_vector <T> &b)
+{
+  sorted_vector <T> result;
+  a.set_intersection(b, result);
+  return result;
+}
+
+template <class T>
+  sorted_vector <T> set_difference(
+    const sorted_vector <T> &a,
+    const sorted_vector <T> &b)
+{
+  sorted_vector <T> result;
+  a.set_difference(b, result);
+  return result;
+}
+
+template <class T>
+  sorted_vector <T> set_union(
+    const sorted_vector <T> &a,
+    const sorted_vector <T> &b)
+{
+  sorted_vector <T> result;
+  a.set_union(b, result);
+  return result;
+}
+
+template <class T>
+  sorted_vector <T> set_symmetric_difference(
+    const sorted_vector <T> &a,
+    const sorted_vector <T> &b)
+{
+  sorted_vector <T> result;
+  a.set_symmetric_difference(b, result);
+  return result;
+}
+
+template <class T, class Key>
+  sorted_vector_with_key <T, Key> set_intersection(
+    const sorted_vector_with_key <T, Key> &a,
+    const sorted_vector_with_key <T, Key> &b)
+{
+  sorted_vector_with_key <T, Key> result;
+  a.set_intersection(b, result);
+  return result;
+}
+
+template <class T, class Key>
+  sorted_vector_with_key <T, Key> set_difference(
+    const sorted_vector_with_key <T, Key> &a,
+    const sorted_vector_with_key <T, Key> &b)
+{
+  sorted_vector_with_key <T, Key> result;
+  a.set_difference(b, result);
+  return result;
+}
+
+template <class T, class Key>
+  sorted_vector_with_key <T, Key> set_union(
+    const sorted_vector_with_key <T, Key> &a,
+    const sorted_vector_with_key <T, Key> &b)
+{
+  sorted_vector_with_key <T, Key> result;
+  a.set_union(b, result);
+  return result;
+}
+
+template <class T, class Key>
+  sorted_vector_with_key <T, Key> set_symmetric_difference(
+    const sorted_vector_with_key <T, Key> &a,
+    const sorted_vector_with_key <T, Key> &b)
+{
+  sorted_vector_with_key <T, Key> result;
+  a.set_symmetric_difference(b, result);
+  return result;
+}
+
+
+//***Aggregates***
+
+template <class V>
+  struct range_summary
+{
+  size_t  count;
+  V       sum;
+  V       min;
+  V       max;
+};
+
+template <class T>
+  struct summary_monoid
+{
+  typedef range_summary <T> value_type;
+
+  value_type identity() const
+  {
+    value_type v;
+    v.count = 0;
+    v.sum = T();
+    v.min = T();
+    v.max = T();
+    return v;
+  }
+
+  value_type lift(const T &t) const
+  {
+    value_type v;
+    v.count = 1;
+    v.sum = t;
+    v.min = t;
+    v.max = t;
+    return v;
+  }
+
+  value_type combine(const value_type &a, const value_type &b) const
+  {
+    if (a.count == 0)
+      return b;
+    if (b.count == 0)
+      return a;
+    value_type v;
+    v.count = a.count + b.count;
+    v.sum = a.sum + b.sum;
+    v.min = (b.min < a.min) ? b.min : a.min;
+    v.max = (a.max < b.max) ? b.max : a.max;
+    return v;
+  }
+};
+
+template <class T, class Monoid = summary_monoid <T>, class Base = sorted_vector <T> >
+  class sorted_vector_aggregate : public Base
+{
+  public:
+    typedef typename Monoid::value_type aggregate_type;
+
+    sorted_vector_aggregate(const Monoid &monoid = Monoid());
+    sorted_vector_aggregate(const std::vector <T> &v, const Monoid &monoid = Monoid());
+    sorted_vector_aggregate(std::vector <T> &&v, const Monoid &monoid = Monoid());
+
+    aggregate_type aggregate(const T &lo, const T &hi)                const;
+    aggregate_type aggregate(const sorted_vector_view <T> &view)      const;
+
+    //Интервал ключей, если Base - sorted_vector_with_key
+    template <class K, class B = Base>
+      auto aggregate(const K &lo, const K &hi) const -> decltype(typename B::key_of()(std::declval <const T &> ()), aggregate_type());
+    aggregate_type aggregate_positions(size_t first, size_t last)    const;
+
+    template <class M = Monoid>
+      auto sum_range(const T &lo, const T &hi) const -> decltype(typename M::value_type().sum);
+    template <class M = Monoid>
+      auto min_range(const T &lo, const T &hi) const -> decltype(typename M::value_type().min);
+    template <class M = Monoid>
+      auto max_range(const T &lo, const T &hi) const -> decltype(typename M::value_type().max);
+
+  protected:
+    void on_insert(size_t pos);
+    void on_erase(size_t first, size_t last);
+    void on_change(size_t pos);
+    void on_reset();
+
+  private:
+    void refresh()                            const;
+    void rebuild()                            const;
+    void build_fenwick()                      const;
+    void build_tree()                         const;
+    void tree_update(size_t b)                const;
+    void fenwick_add(size_t b, size_t d)      const;
+    void mark_dirty(size_t b)                 const;
+    void shift_dirty(size_t from, size_t d)   const;
+    size_t block_of(size_t pos)               const;
+    size_t block_start(size_t b)              const;
+
+    aggregate_type fold(size_t first, size_t last)            const;
+    aggregate_type tree_query(size_t b_first, size_t b_last)  const;
+
+    Monoid _monoid;
+
+    mutable std::vector <size_t>          _block_size;
+    mutable std::vector <aggregate_type>  _block_agg;
+    mutable std::vector <char>            _block_dirty;
+    mutable std::vector <size_t>          _dirty_blocks;
+    mutable std::vector <size_t>          _fenwick;
+    mutable std::vector <aggregate_type>  _tree;
+    mutable size_t                        _tree_leaves  = 0;
+    mutable bool                          _tree_stale   = true;
+    mutable bool                          _rebuild      = true;
+};
+
+template <class T, class Monoid, class Base>
+  sorted_vector_aggregate <T, Monoid, Base>::  sorted_vector_aggregate(
+    const Monoid &monoid)
+    : _monoid(monoid)
+{}
+
+template <class T, class Monoid, class Base>
+  sorted_vector_aggregate <T, Monoid, Base>::  sorted_vector_aggregate(
+    const std::vector <T> &v,
+    const Monoid &monoid)
+    : _monoid(monoid)
+{
+  this->merge(v);
+}
+
+template <class T, class Monoid, class Base>
+  sorted_vector_aggregate <T, Monoid, Base>::  sorted_vector_aggregate(
+    std::vector <T> &&v,
+    const Monoid &monoid)
+    : _monoid(monoid)
+{
+  this->merge(static_cast <std::vector <T> &&> (v));
+}
+
+template <class T, class Monoid, class Base>
+  typename sorted_vector_aggregate <T, Monoid, Base>::aggregate_type
+  sorted_vector_aggregate <T, Monoid, Base>::  aggregate(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (this->corrupted()) {
+    const T *d = this->data();
+    aggregate_type a = _monoid.identity();
+    for (size_t i = 0; i < this->size(); i++)
+      if (  (!(d[i] < lo))
+          &&(!(hi < d[i])))
+        a = _monoid.combine(a, _monoid.lift(d[i]));
+    return a;
+  }
+  return aggregate(this->range(lo, hi));
+}
+
+template <class T, class Monoid, class Base>
+  template <class K, class B>
+  auto sorted_vector_aggregate <T, Monoid, Base>::  aggregate(
+    const K &lo,
+    const K &hi)
+    const -> decltype(typename B::key_of()(std::declval <const T &> ()), aggregate_type())
+{
+  typename B::key_of key_of;
+  if (this->corrupted()) {
+    const T *d = this->data();
+    aggregate_type a = _monoid.identity();
+    for (size_t i = 0; i < this->size(); i++)
+      if (  (!(key_of(d[i]) < lo))
+          &&(!(hi < key_of(d[i]))))
+        a = _monoid.combine(a, _monoid.lift(d[i]));
+    return a;
+  }
+  return aggregate(this->range(lo, hi));
+}
+
+template <class T, class Monoid, class Base>
+  typename sorted_vector_aggregate <T, Monoid, Base>::aggregate_type
+  sorted_vector_aggregate <T, Monoid, Base>::  aggregate(
+    const sorted_vector_view <T> &view)
+    const
+{
+  if (view.empty())
+    return _monoid.identity();
+  size_t first = view.data() - this->data();
+  return aggregate_positions(first, first + view.size());
+}
+
+template <class T, class Monoid, class Base>
+  typename sorted_vector_aggregate <T, Monoid, Base>::aggregate_type
+  sorted_vector_aggregate <T, Monoid, Base>::  aggregate_positions(
+    size_t first,
+    size_t last)
+    const
+{
+  if (  (this->corrupted())
+      ||(last - first <= 2 * CIM_SORTED_VECTOR_AGGREGATE_BLOCK))
+    return fold(first, last);
+
+  refresh();
+
+  size_t bf = block_of(first);
+  size_t bl = block_of(last - 1);
+  size_t sf = block_start(bf);
+  size_t sl = block_start(bl);
+  if (bf == bl)
+    return fold(first, last);
+
+  return _monoid.combine(
+    _monoid.combine(
+      fold(first, sf + _block_size[bf]),
+      tree_query(bf + 1, bl)),
+    fold(sl, last));
+}
+
+template <class T, class Monoid, class Base>
+  template <class M>
+  auto sorted_vector_aggregate <T, Monoid, Base>::  sum_range(
+    const T &lo,
+    const T &hi)
+    const -> decltype(typename M::value_type().sum)
+{
+  return aggregate(lo, hi).sum;
+}
+
+template <class T, class Monoid, class Base>
+  template <class M>
+  auto sorted_vector_aggregate <T, Monoid, Base>::  min_range(
+    const T &lo,
+    const T &hi)
+    const -> decltype(typename M::value_type().min)
+{
+  return aggregate(lo, hi).min;
+}
+
+template <class T, class Monoid, class Base>
+  template <class M>
+  auto sorted_vector_aggregate <T, Monoid, Base>::  max_range(
+    const T &lo,
+    const T &hi)
+    const -> decltype(typename M::value_type().max)
+{
+  return aggregate(lo, hi).max;
+}
+
+//***protected methods***
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  on_insert(
+    size_t pos)
+{
+  Base::on_insert(pos);
+  if (_rebuild)
+    return;
+  if (_block_size.empty()) {
+    _rebuild = true;
+    return;
+  }
+
+  size_t b = block_of(pos);
+  if (b == _block_size.size())
+    b--;
+  _block_size[b]++;
+  fenwick_add(b, 1);
+  mark_dirty(b);
+
+  if (_block_size[b] > 2 * CIM_SORTED_VECTOR_AGGREGATE_BLOCK) {
+    //Деление переполненного блока пополам
+    size_t half = _block_size[b] / 2;
+    _block_size.insert(_block_size.begin() + b + 1, _block_size[b] - half);
+    _block_size[b] = half;
+    _block_agg.insert(_block_agg.begin() + b + 1, _monoid.identity());
+    _block_dirty.insert(_block_dirty.begin() + b + 1, (char)0);
+    shift_dirty(b + 1, 1);
+    mark_dirty(b + 1);
+    build_fenwick();
+    _tree_stale = true;
+  }
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  on_erase(
+    size_t first,
+    size_t last)
+{
+  Base::on_erase(first, last);
+  if (  (_rebuild)
+      ||(first == last))
+    return;
+
+  size_t b = block_of(first);
+  size_t k = first - block_start(b);
+  size_t left = last - first;
+  size_t b_first = b;
+  bool emptied = false;
+  while (left > 0) {
+    size_t take = std::min(left, _block_size[b] - k);
+    _block_size[b] -= take;
+    left -= take;
+    if (_block_size[b] == 0)
+      emptied = true;
+    else
+      mark_dirty(b);
+    b++;
+    k = 0;
+  }
+
+  if (  (!emptied)
+      &&(b == b_first + 1)) {
+    fenwick_add(b_first, (size_t)0 - (last - first));
+    return;
+  }
+
+  //Удаление опустевших блоков
+  for (size_t i = b; i-- > b_first;)
+    if (_block_size[i] == 0) {
+      _block_size.erase(_block_size.begin() + i);
+      _block_agg.erase(_block_agg.begin() + i);
+      if (_block_dirty[i]) {
+        _dirty_blocks.erase(std::find(_dirty_blocks.begin(), _dirty_blocks.end(), i));
+        _block_dirty[i] = 0;
+      }
+      _block_dirty.erase(_block_dirty.begin() + i);
+      shift_dirty(i + 1, (size_t)-1);
+    }
+  _tree_stale = true;
+
+  //Слишком много мелких блоков: перестроение
+  if (_block_size.size() > 2 * (this->size() / CIM_SORTED_VECTOR_AGGREGATE_BLOCK) + 2)
+    _rebuild = true;
+  else
+    build_fenwick();
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  on_change(
+    size_t pos)
+{
+  Base::on_change(pos);
+  if (!_rebuild)
+    mark_dirty(block_of(pos));
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  on_reset()
+{
+  Base::on_reset();
+  _rebuild = true;
+}
+
+//***private methods***
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  refresh()
+  const
+{
+  if (_rebuild) {
+    rebuild();
+    return;
+  }
+  for (size_t i = 0; i < _dirty_blocks.size(); i++) {
+    size_t b = _dirty_blocks[i];
+    size_t start = block_start(b);
+    _block_agg[b] = fold(start, start + _block_size[b]);
+    _block_dirty[b] = 0;
+    if (!_tree_stale)
+      tree_update(b);
+  }
+  _dirty_blocks.clear();
+  if (_tree_stale)
+    build_tree();
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  rebuild()
+  const
+{
+  size_t n = this->size();
+  size_t nb = (n + CIM_SORTED_VECTOR_AGGREGATE_BLOCK - 1) / CIM_SORTED_VECTOR_AGGREGATE_BLOCK;
+  _block_size.assign(nb, CIM_SORTED_VECTOR_AGGREGATE_BLOCK);
+  if (nb > 0)
+    _block_size[nb - 1] = n - (nb - 1) * CIM_SORTED_VECTOR_AGGREGATE_BLOCK;
+  _block_agg.resize(nb);
+  for (size_t b = 0; b < nb; b++)
+    _block_agg[b] = fold(
+      b * CIM_SORTED_VECTOR_AGGREGATE_BLOCK,
+      b * CIM_SORTED_VECTOR_AGGREGATE_BLOCK + _block_size[b]);
+  _block_dirty.assign(nb, (char)0);
+  _dirty_blocks.clear();
+  build_fenwick();
+  build_tree();
+  _rebuild = false;
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  build_fenwick()
+  const
+{
+  size_t nb = _block_size.size();
+  _fenwick.assign(nb + 1, 0);
+  for (size_t i = 1; i <= nb; i++) {
+    _fenwick[i] += _block_size[i - 1];
+    size_t j = i + (i & (0 - i));
+    if (j <= nb)
+      _fenwick[j] += _fenwick[i];
+  }
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  build_tree()
+  const
+{
+  _tree_leaves = 1;
+  while (_tree_leaves < _block_agg.size())
+    _tree_leaves <<= 1;
+  _tree.assign(2 * _tree_leaves, _monoid.identity());
+  for (size_t b = 0; b < _block_agg.size(); b++)
+    _tree[_tree_leaves + b] = _block_agg[b];
+  for (size_t i = _tree_leaves; i-- > 1;)
+    _tree[i] = _monoid.combine(_tree[2 * i], _tree[2 * i + 1]);
+  _tree_stale = false;
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  tree_update(
+    size_t b)
+    const
+{
+  size_t i = _tree_leaves + b;
+  _tree[i] = _block_agg[b];
+  for (i >>= 1; i > 0; i >>= 1)
+    _tree[i] = _monoid.combine(_tree[2 * i], _tree[2 * i + 1]);
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  fenwick_add(
+    size_t b,
+    size_t d)
+    const
+{
+  //d может быть "отрицательным" (по модулю 2^N)
+  for (size_t i = b + 1; i < _fenwick.size(); i += i & (0 - i))
+    _fenwick[i] += d;
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  mark_dirty(
+    size_t b)
+    const
+{
+  if (!_block_dirty[b]) {
+    _block_dirty[b] = 1;
+    _dirty_blocks.push_back(b);
+  }
+}
+
+template <class T, class Monoid, class Base>
+  void sorted_vector_aggregate <T, Monoid, Base>::  shift_dirty(
+    size_t from,
+    size_t d)
+    const
+{
+  //Сдвиг номеров изменённых блоков после
+  //вставки или удаления блока
+  for (size_t i = 0; i < _dirty_blocks.size(); i++)
+    if (_dirty_blocks[i] >= from)
+      _dirty_blocks[i] += d;
+}
+
+template <class T, class Monoid, class Base>
+  size_t sorted_vector_aggregate <T, Monoid, Base>::  block_of(
+    size_t pos)
+    const
+{
+  //Спуск по дереву Фенвика: число блоков,
+  //целиком лежащих левее позиции pos
+  size_t nb = _block_size.size();
+  size_t step = 1;
+  while (step * 2 <= nb)
+    step <<= 1;
+  size_t b = 0;
+  for (; step > 0; step >>= 1)
+    if (  (b + step <= nb)
+        &&(_fenwick[b + step] <= pos)) {
+      b += step;
+      pos -= _fenwick[b];
+    }
+  return b;
+}
+
+template <class T, class Monoid, class Base>
+  size_t sorted_vector_aggregate <T, Monoid, Base>::  block_start(
+    size_t b)
+    const
+{
+  size_t s = 0;
+  for (; b > 0; b -= b & (0 - b))
+    s += _fenwick[b];
+  return s;
+}
+
+template <class T, class Monoid, class Base>
+  typename sorted_vector_aggregate <T, Monoid, Base>::aggregate_type
+  sorted_vector_aggregate <T, Monoid, Base>::  fold(
+    size_t first,
+    size_t last)
+    const
+{
+  const T *d = this->data();
+  aggregate_type a = _monoid.identity();
+  for (size_t i = first; i < last; i++)
+    a = _monoid.combine(a, _monoid.lift(d[i]));
+  return a;
+}
+
+template <class T, class Monoid, class Base>
+  typename sorted_vector_aggregate <T, Monoid, Base>::aggregate_type
+  sorted_vector_aggregate <T, Monoid, Base>::  tree_query(
+    size_t b_first,
+    size_t b_last)
+    const
+{
+  aggregate_type left = _monoid.identity();
+  aggregate_type right = _monoid.identity();
+  size_t l = b_first + _tree_leaves;
+  size_t r = b_last + _tree_leaves;
+  for (; l < r; l >>= 1, r >>= 1) {
+    if (l & 1)
+      left = _monoid.combine(left, _tree[l++]);
+    if (r & 1)
+      right = _monoid.combine(_tree[--r], right);
+  }
+  return _monoid.combine(left, right);
+}
+
+//***Compressed storage***
+
+template <class T>
+  class compressed_sorted_vector;
+
+template <class T>
+  class compressed_sorted_vector_const_iterator
+{
+  friend compressed_sorted_vector <T>;
+
+  compressed_sorted_vector_const_iterator(size_t pos, const compressed_sorted_vector <T> *owner);
+
+  public:
+    //Значения распаковываются при разыменовании,
+    //поэтому reference - сам тип значения
+    typedef std::input_iterator_tag iterator_category;
+    typedef T                       value_type;
+    typedef std::ptrdiff_t          difference_type;
+    typedef const T *               pointer;
+    typedef T                       reference;
+
+    compressed_sorted_vector_const_iterator(const compressed_sorted_vector_const_iterator &it);
+
+    bool operator!=(const compressed_sorted_vector_const_iterator &it) const;
+    bool operator==(const compressed_sorted_vector_const_iterator &it) const;
+
+    T operator*() const;
+
+    compressed_sorted_vector_const_iterator &operator++();
+
+    compressed_sorted_vector_const_iterator operator+(size_t inc) const;
+    compressed_sorted_vector_const_iterator operator-(size_t dec) const;
+
+    size_t pos() const;
+
+  private:
+    size_t _pos = (size_t)-1;
+    const compressed_sorted_vector <T> *_owner = nullptr;
+};
+
+template <class T>
+  class compressed_sorted_vector
+{
+  static_assert(
+       (std::is_integral <T>::value)
+    && (!std::is_same <T, bool>::value),
+    "compressed_sorted_vector requires an integral element type");
+
+  public:
+    typedef compressed_sorted_vector_const_iterator <T> const_iterator;
+
+    compressed_sorted_vector();
+    explicit compressed_sorted_vector(const sorted_vector <T> &sv);
+    explicit compressed_sorted_vector(std::vector <T> v);
+
+    void assign(const sorted_vector <T> &sv);
+    void assign_sorted(const T *data, size_t count);
+    void clear();
+
+    void decompress(sorted_vector <T> &sv)        const;
+    void decode_block(size_t block, T *out)       const;
+
+    T at(size_t pos)         const;
+    T operator[](size_t pos) const;
+    T front()                const;
+    T back()                 const;
+
+    const_iterator begin()  const;
+    const_iterator cbegin() const;
+    const_iterator end()    const;
+    const_iterator cend()   const;
+
+    bool empty()          const;
+    size_t size()         const;
+    size_t blocks()       const;
+    size_t memory_usage() const;
+
+    size_t find(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_first(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)   const;
+    size_t find_floor(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_ceil(const T &t, size_t start_pos = 0, size_t end_pos = -1)   const;
+
+    size_t count_range(const T &lo, const T &hi) const;
+    size_t rank(const T &t)                      const;
+
+  protected:
+    typedef typename std::make_unsigned <T>::type U;
+
+    size_t block_size(size_t block)             const;
+    U extract(size_t block, size_t j)           const;
+    size_t count_below(size_t block, U delta)   const;
+    size_t lower(const T &t)                    const;
+    size_t upper(const T &t)                    const;
+
+  private:
+    std::vector <T>       _first;
+    std::vector <uint8_t> _width;
+    std::vector <size_t>  _offset;
+    std::vector <uint8_t> _packed;
+    size_t                _size = 0;
+};
+
+template <class T>
+  compressed_sorted_vector_const_iterator <T>::  compressed_sorted_vector_const_iterator(
+    size_t pos,
+    const compressed_sorted_vector <T> *owner)
+    : _pos(pos), _owner(owner)
+{}
+
+template <class T>
+  compressed_sorted_vector_const_iterator <T>::  compressed_sorted_vector_const_iterator(
+    const compressed_sorted_vector_const_iterator &it)
+    : _pos(it._pos), _owner(it._owner)
+{}
+
+template <class T>
+  bool compressed_sorted_vector_const_iterator <T>:: operator!=(
+    const compressed_sorted_vector_const_iterator &it)
+    const
+{
+  return (  (_owner != it._owner)
+          ||(_pos != it._pos));
+}
+
+template <class T>
+  bool compressed_sorted_vector_const_iterator <T>:: operator==(
+    const compressed_sorted_vector_const_iterator &it)
+    const
+{
+  return (  (_owner == it._owner)
+          &&(_pos == it._pos));
+}
+
+template <class T>
+  T compressed_sorted_vector_const_iterator <T>:: operator*()
+  const
+{
+  return _owner->operator[](_pos);
+}
+
+template <class T>
+  compressed_sorted_vector_const_iterator <T> &compressed_sorted_vector_const_iterator <T>::  operator++()
+{
+  _pos++;
+  return *this;
+}
+
+template <class T>
+  compressed_sorted_vector_const_iterator <T> compressed_sorted_vector_const_iterator <T>:: operator+(
+    size_t inc)
+    const
+{
+  return compressed_sorted_vector_const_iterator(_pos + inc, _owner);
+}
+
+template <class T>
+  compressed_sorted_vector_const_iterator <T> compressed_sorted_vector_const_iterator <T>:: operator-(
+    size_t dec)
+    const
+{
+  return compressed_sorted_vector_const_iterator(_pos - dec, _owner);
+}
+
+template <class T>
+  size_t compressed_sorted_vector_const_iterator <T>:: pos()
+    const
+{
+  return _pos;
+}
+
+template <class T>
+  compressed_sorted_vector <T>::  compressed_sorted_vector()
+{}
+
+template <class T>
+  compressed_sorted_vector <T>::  compressed_sorted_vector(
+    const sorted_vector <T> &sv)
+{
+  assign(sv);
+}
+
+template <class T>
+  compressed_sorted_vector <T>::  compressed_sorted_vector(
+    std::vector <T> v)
+{
+  std::sort(v.begin(), v.end());
+  assign_sorted(v.data(), v.size());
+}
+
+template <class T>
+  void compressed_sorted_vector <T>::  assign(
+    const sorted_vector <T> &sv)
+{
+  if (!sv.corrupted()) {
+    assign_sorted(sv.data(), sv.size());
+    return;
+  }
+  std::vector <T> v(sv.data(), sv.data() + sv.size());
+  std::sort(v.begin(), v.end());
+  assign_sorted(v.data(), v.size());
+}
+
+template <class T>
+  void compressed_sorted_vector <T>::  assign_sorted(
+    const T *data,
+    size_t count)
+{
+  //data должен быть отсортирован по возрастанию
+  const size_t B = CIM_SORTED_VECTOR_COMPRESSED_BLOCK;
+  size_t nb = (count + B - 1) / B;
+
+  clear();
+  _size = count;
+  _first.reserve(nb);
+  _width.reserve(nb);
+  _offset.reserve(nb);
+
+  for (size_t b = 0; b < nb; b++) {
+    const T *v = data + b * B;
+    size_t n = std::min(B, count - b * B);
+    U first = (U)v[0];
+    U span = (U)v[n - 1] - first;
+
+    //Ширина упаковки - разрядность наибольшего отклонения
+    //от первого значения блока; отклонения шире 56 бит
+    //хранятся без упаковки (64 бита)
+    unsigned width = 0;
+    while (  (width < sizeof(U) * 8)
+           &&(((uint64_t)span >> width) != 0))
+      width++;
+    if (width > 56)
+      width = 64;
+
+    _first.push_back(v[0]);
+    _width.push_back((uint8_t)width);
+    _offset.push_back(_packed.size());
+
+    size_t bytes = (n * width + 7) / 8;
+    size_t offset = _packed.size();
+    _packed.resize(offset + bytes + 8, 0);
+    uint8_t *p = _packed.data() + offset;
+    for (size_t j = 0; (width > 0) && (j < n); j++) {
+      uint64_t d = (U)((U)v[j] - first);
+      if (width == 64) {
+        memcpy(p + j * 8, &d, 8);
+        continue;
+      }
+      size_t bit = j * width;
+      uint64_t w;
+      memcpy(&w, p + (bit >> 3), 8);
+      w |= d << (bit & 7);
+      memcpy(p + (bit >> 3), &w, 8);
+    }
+    _packed.resize(offset + bytes);
+  }
+  //запас для 64-битного чтения последнего значения
+  _packed.resize(_packed.size() + 8, 0);
+  _packed.shrink_to_fit();
+}
+
+template <class T>
+  void compressed_sorted_vector <T>::  clear()
+{
+  _first.clear();
+  _width.clear();
+  _offset.clear();
+  _packed.clear();
+  _size = 0;
+}
+
+template <class T>
+  void compressed_sorted_vector <T>::  decompress(
+    sorted_vector <T> &sv)
+    const
+{
+  std::vector <T> v(_size);
+  for (size_t b = 0; b < blocks(); b++)
+    decode_block(b, v.data() + b * CIM_SORTED_VECTOR_COMPRESSED_BLOCK);
+  sv.assign_sorted(static_cast <std::vector <T> &&> (v));
+}
+
+template <class T>
+  void compressed_sorted_vector <T>::  decode_block(
+    size_t block,
+    T *out)
+    const
+{
+  size_t n = block_size(block);
+  unsigned width = _width[block];
+  U first = (U)_first[block];
+  U *o = reinterpret_cast <U *> (out);
+  size_t j = 0;
+  if (  (width > 0)
+      &&(width <= 56))
+    j = simd::unpack(_packed.data() + _offset[block], width, n, first, o);
+  for (; j < n; j++)
+    o[j] = (U)(first + extract(block, j));
+}
+
+template <class T>
+  T compressed_sorted_vector <T>::  at(
+    size_t pos)
+    const
+{
+  if (pos >= _size)
+    throw std::out_of_range("compressed_sorted_vector::at");
+  return operator[](pos);
+}
+
+template <class T>
+  T compressed_sorted_vector <T>:: operator[](
+    size_t pos)
+    const
+{
+  size_t b = pos / CIM_SORTED_VECTOR_COMPRESSED_BLOCK;
+  return (T)(U)((U)_first[b] + extract(b, pos % CIM_SORTED_VECTOR_COMPRESSED_BLOCK));
+}
+
+template <class T>
+  T compressed_sorted_vector <T>::  front()
+    const
+{
+  return _first.front();
+}
+
+template <class T>
+  T compressed_sorted_vector <T>::  back()
+    const
+{
+  return operator[](_size - 1);
+}
+
+template <class T>
+  typename compressed_sorted_vector <T>::const_iterator compressed_sorted_vector <T>::  begin()
+    const
+{
+  return const_iterator(0, this);
+}
+
+template <class T>
+  typename compressed_sorted_vector <T>::const_iterator compressed_sorted_vector <T>::  cbegin()
+    const
+{
+  return const_iterator(0, this);
+}
+
+template <class T>
+  typename compressed_sorted_vector <T>::const_iterator compressed_sorted_vector <T>::  end()
+    const
+{
+  return const_iterator(_size, this);
+}
+
+template <class T>
+  typename compressed_sorted_vector <T>::const_iterator compressed_sorted_vector <T>::  cend()
+    const
+{
+  return const_iterator(_size, this);
+}
+
+template <class T>
+  bool compressed_sorted_vector <T>::  empty()
+    const
+{
+  return _size == 0;
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  size()
+    const
+{
+  return _size;
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  blocks()
+    const
+{
+  return _first.size();
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  memory_usage()
+    const
+{
+  return _first.capacity() * sizeof(T)
+       + _width.capacity()
+       + _offset.capacity() * sizeof(size_t)
+       + _packed.capacity();
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>:: find(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  return find_first(t, start_pos, end_pos);
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>:: find_first(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  size_t pos = std::max(lower(t), start_pos);
+  if (  (pos > end_pos)
+      ||(operator[](pos) != t))
+    return -1;
+  return pos;
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>:: find_last(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  size_t pos = std::min(upper(t), end_pos + 1);
+  if (  (pos <= start_pos)
+      ||(operator[](pos - 1) != t))
+    return -1;
+  return pos - 1;
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>:: find_floor(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Семантика sorted_vector::find_floor: первый равный
+  //элемент, иначе наибольший меньший
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  size_t pos = std::min(std::max(lower(t), start_pos), end_pos + 1);
+  if (  (pos <= end_pos)
+      &&(operator[](pos) == t))
+    return pos;
+  return (pos == start_pos) ? (size_t)-1 : pos - 1;
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>:: find_ceil(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Семантика sorted_vector::find_ceil: последний равный
+  //элемент, иначе наименьший больший
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  size_t pos = std::min(std::max(upper(t), start_pos), end_pos + 1);
+  if (  (pos > start_pos)
+      &&(operator[](pos - 1) == t))
+    return pos - 1;
+  return (pos > end_pos) ? (size_t)-1 : pos;
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  count_range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (hi < lo)
+    return 0;
+  return upper(hi) - lower(lo);
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>:: rank(
+    const T &t)
+    const
+{
+  return lower(t);
+}
+
+//***protected methods***
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  block_size(
+    size_t block)
+    const
+{
+  return std::min(
+    (size_t)CIM_SORTED_VECTOR_COMPRESSED_BLOCK,
+    _size - block * CIM_SORTED_VECTOR_COMPRESSED_BLOCK);
+}
+
+template <class T>
+  typename compressed_sorted_vector <T>::U compressed_sorted_vector <T>::  extract(
+    size_t block,
+    size_t j)
+    const
+{
+  //Отклонение j-го значения блока от первого
+  unsigned width = _width[block];
+  if (width == 0)
+    return 0;
+  const uint8_t *p = _packed.data() + _offset[block];
+  uint64_t w;
+  if (width == 64) {
+    memcpy(&w, p + j * 8, 8);
+    return (U)w;
+  }
+  size_t bit = j * width;
+  memcpy(&w, p + (bit >> 3), 8);
+  return (U)((w >> (bit & 7)) & ((uint64_t(1) << width) - 1));
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  count_below(
+    size_t block,
+    U delta)
+    const
+{
+  //Число значений блока с отклонением меньше delta; бинарный
+  //поиск выполняется по упакованным данным без распаковки блока
+  size_t f = 0;
+  size_t l = block_size(block);
+  while (f < l) {
+    size_t m = f + (l - f) / 2;
+    if (extract(block, m) < delta)
+      f = m + 1;
+    else
+      l = m;
+  }
+  return f;
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  lower(
+    const T &t)
+    const
+{
+  //Первая позиция, значение в которой не меньше t:
+  //блок выбирается по массиву первых значений
+  size_t b = std::lower_bound(_first.begin(), _first.end(), t) - _first.begin();
+  if (b == 0)
+    return 0;
+  b--;
+  return b * CIM_SORTED_VECTOR_COMPRESSED_BLOCK
+       + count_below(b, (U)((U)t - (U)_first[b]));
+}
+
+template <class T>
+  size_t compressed_sorted_vector <T>::  upper(
+    const T &t)
+    const
+{
+  //Первая позиция, значение в которой больше t
+  size_t b = std::upper_bound(_first.begin(), _first.end(), t) - _first.begin();
+  if (b == 0)
+    return 0;
+  b--;
+  U delta = (U)((U)t - (U)_first[b]);
+  if (delta == (U)-1)
+    return b * CIM_SORTED_VECTOR_COMPRESSED_BLOCK + block_size(b);
+  return b * CIM_SORTED_VECTOR_COMPRESSED_BLOCK
+       + count_below(b, (U)(delta + 1));
+}
+
+//***Front-coded strings***
+
+//Одно определение во всех режимах языка: std::string,
+//std::string_view и другие строки с data() и size()
+//преобразуются в string_ref неявно, обратно - явно
+
+class string_ref
+{
+  public:
+    string_ref() {}
+    string_ref(const char *s) : _data(s), _size(strlen(s)) {}
+    string_ref(const char *s, size_t n) : _data(s), _size(n) {}
+
+    template <class S,
+              class = typename std::enable_if <
+                std::is_convertible <decltype(std::declval <const S &> ().data()), const char *>::value
+                && std::is_convertible <decltype(std::declval <const S &> ().size()), size_t>::value>::type>
+      string_ref(const S &s) : _data(s.data()), _size(s.size()) {}
+
+    template <class S,
+              class = typename std::enable_if <std::is_constructible <S, const char *, size_t>::value>::type>
+      explicit operator S() const
+    {
+      return S(_data, _size);
+    }
+
+    const char *data()              const { return _data; }
+    size_t size()                   const { return _size; }
+    bool empty()                    const { return _size == 0; }
+    const char *begin()             const { return _data; }
+    const char *end()               const { return _data + _size; }
+    char operator[](size_t pos)     const { return _data[pos]; }
+
+    int compare(string_ref s) const
+    {
+      int c = memcmp(_data, s._data, std::min(_size, s._size));
+      if (c != 0)
+        return c;
+      return (_size < s._size) ? -1 : (_size > s._size ? 1 : 0);
+    }
+
+  private:
+    const char  *_data = "";
+    size_t      _size  = 0;
+};
+
+inline bool operator==(string_ref a, string_ref b) { return (a.size() == b.size()) && (a.compare(b) == 0); }
+inline bool operator!=(string_ref a, string_ref b) { return !(a == b); }
+inline bool operator<(string_ref a, string_ref b)  { return a.compare(b) < 0; }
+inline bool operator>(string_ref a, string_ref b)  { return b < a; }
+inline bool operator<=(string_ref a, string_ref b) { return !(b < a); }
+inline bool operator>=(string_ref a, string_ref b) { return !(a < b); }
+
+class front_coded_sorted_vector;
+
+class front_coded_sorted_vector_const_iterator
+{
+  friend front_coded_sorted_vector;
+
+  front_coded_sorted_vector_const_iterator(size_t pos, const front_coded_sorted_vector *owner);
+
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef string_ref              value_type;
+    typedef std::ptrdiff_t          difference_type;
+    typedef const string_ref *      pointer;
+    typedef string_ref              reference;
+
+    front_coded_sorted_vector_const_iterator(const front_coded_sorted_vector_const_iterator &it);
+
+    bool operator!=(const front_coded_sorted_vector_const_iterator &it) const;
+    bool operator==(const front_coded_sorted_vector_const_iterator &it) const;
+
+    //Представление действительно до сдвига итератора
+    string_ref operator*() const;
+
+    front_coded_sorted_vector_const_iterator &operator++();
+
+    size_t pos() const;
+
+  private:
+    void load();
+
+    size_t      _pos = (size_t)-1;
+    const front_coded_sorted_vector *_owner = nullptr;
+    const char  *_cursor = nullptr;
+    std::string _value;
+};
+
+class front_coded_sorted_vector
+{
+  friend front_coded_sorted_vector_const_iterator;
+
+  public:
+    typedef front_coded_sorted_vector_const_iterator const_iterator;
+
+    front_coded_sorted_vector();
+    explicit front_coded_sorted_vector(const sorted_vector <std::string> &sv);
+    explicit front_coded_sorted_vector(std::vector <std::string> v);
+
+    void assign(const sorted_vector <std::string> &sv);
+    void assign_sorted(const std::string *data, size_t count);
+    void clear();
+
+    void decompress(sorted_vector <std::string> &sv) const;
+
+    std::string at(size_t pos)          const;
+    std::string operator[](size_t pos)  const;
+    std::string front()                 const;
+    std::string back()                  const;
+
+    const_iterator begin()  const;
+    const_iterator cbegin() const;
+    const_iterator end()    const;
+    const_iterator cend()   const;
+
+    bool empty()          const;
+    size_t size()         const;
+    size_t buckets()      const;
+    size_t memory_usage() const;
+
+    size_t find(string_ref t, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_first(string_ref t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_last(string_ref t, size_t start_pos = 0, size_t end_pos = -1)   const;
+    size_t find_floor(string_ref t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_ceil(string_ref t, size_t start_pos = 0, size_t end_pos = -1)   const;
+
+    size_t count_range(string_ref lo, string_ref hi) const;
+    size_t rank(string_ref t)                        const;
+
+  protected:
+    static void put_size(std::vector <char> &arena, size_t n);
+    static size_t get_size(const char *&p);
+    static size_t common_prefix(const char *a, size_t na, const char *b, size_t nb);
+    static int compare_tail(const char *a, size_t na, const char *b, size_t nb);
+
+    size_t bucket_size(size_t bucket)                                        const;
+    string_ref head(size_t bucket)                                           const;
+    size_t scan(size_t bucket, string_ref t, bool upper, int &last, int &stop) const;
+    size_t lower(string_ref t, bool &equal)                                  const;
+    size_t upper(string_ref t, bool &equal)                                  const;
+
+  private:
+    std::vector <char>    _arena;
+    std::vector <size_t>  _bucket;
+    size_t                _size = 0;
+};
+
+inline front_coded_sorted_vector_const_iterator::  front_coded_sorted_vector_const_iterator(
+  size_t pos,
+  const front_coded_sorted_vector *owner)
+  : _pos(pos), _owner(owner)
+{
+  load();
+}
+
+inline front_coded_sorted_vector_const_iterator::  front_coded_sorted_vector_const_iterator(
+  const front_coded_sorted_vector_const_iterator &it)
+  : _pos(it._pos), _owner(it._owner), _cursor(it._cursor), _value(it._value)
+{}
+
+inline bool front_coded_sorted_vector_const_iterator:: operator!=(
+  const front_coded_sorted_vector_const_iterator &it)
+  const
+{
+  return (  (_owner != it._owner)
+          ||(_pos != it._pos));
+}
+
+inline bool front_coded_sorted_vector_const_iterator:: operator==(
+  const front_coded_sorted_vector_const_iterator &it)
+  const
+{
+  return (  (_owner == it._owner)
+          &&(_pos == it._pos));
+}
+
+inline string_ref front_coded_sorted_vector_const_iterator:: operator*()
+  const
+{
+  return string_ref(_value.data(), _value.size());
+}
+
+inline front_coded_sorted_vector_const_iterator &front_coded_sorted_vector_const_iterator::  operator++()
+{
+  //Внутри блока строка восстанавливается из
+  //предыдущей: общий префикс + суффикс
+  if (++_pos >= _owner->size())
+    return *this;
+  if (_pos % CIM_SORTED_VECTOR_FRONT_CODING_BUCKET == 0) {
+    load();
+    return *this;
+  }
+  size_t shared = front_coded_sorted_vector::get_size(_cursor);
+  size_t n = front_coded_sorted_vector::get_size(_cursor);
+  _value.resize(shared);
+  _value.append(_cursor, n);
+  _cursor += n;
+  return *this;
+}
+
+inline size_t front_coded_sorted_vector_const_iterator:: pos()
+  const
+{
+  return _pos;
+}
+
+inline void front_coded_sorted_vector_const_iterator::  load()
+{
+  if (_pos >= _owner->size())
+    return;
+  size_t b = _pos / CIM_SORTED_VECTOR_FRONT_CODING_BUCKET;
+  _cursor = _owner->_arena.data() + _owner->_bucket[b];
+  size_t n = front_coded_sorted_vector::get_size(_cursor);
+  _value.assign(_cursor, n);
+  _cursor += n;
+  for (size_t j = b * CIM_SORTED_VECTOR_FRONT_CODING_BUCKET; j < _pos; j++) {
+    size_t shared = front_coded_sorted_vector::get_size(_cursor);
+    n = front_coded_sorted_vector::get_size(_cursor);
+    _value.resize(shared);
+    _value.append(_cursor, n);
+    _cursor += n;
+  }
+}
+
+inline front_coded_sorted_vector::  front_coded_sorted_vector()
+{}
+
+inline front_coded_sorted_vector::  front_coded_sorted_vector(
+  const sorted_vector <std::string> &sv)
+{
+  assign(sv);
+}
+
+inline front_coded_sorted_vector::  front_coded_sorted_vector(
+  std::vector <std::string> v)
+{
+  std::sort(v.begin(), v.end());
+  assign_sorted(v.data(), v.size());
+}
+
+inline void front_coded_sorted_vector::  assign(
+  const sorted_vector <std::string> &sv)
+{
+  if (!sv.corrupted()) {
+    assign_sorted(sv.data(), sv.size());
+    return;
+  }
+  std::vector <std::string> v(sv.data(), sv.data() + sv.size());
+  std::sort(v.begin(), v.end());
+  assign_sorted(v.data(), v.size());
+}
+
+inline void front_coded_sorted_vector::  assign_sorted(
+  const std::string *data,
+  size_t count)
+{
+  //data должен быть отсортирован по возрастанию.
+  //Первая строка блока хранится целиком: длина и
+  //символы; остальные - длина общего с предыдущей
+  //префикса, длина суффикса и символы суффикса
+  clear();
+  _size = count;
+  _bucket.reserve((count + CIM_SORTED_VECTOR_FRONT_CODING_BUCKET - 1) / CIM_SORTED_VECTOR_FRONT_CODING_BUCKET);
+  for (size_t i = 0; i < count; i++) {
+    const std::string &s = data[i];
+    if (i % CIM_SORTED_VECTOR_FRONT_CODING_BUCKET == 0) {
+      _bucket.push_back(_arena.size());
+      put_size(_arena, s.size());
+      _arena.insert(_arena.end(), s.begin(), s.end());
+      continue;
+    }
+    const std::string &prev = data[i - 1];
+    size_t shared = common_prefix(prev.data(), prev.size(), s.data(), s.size());
+    put_size(_arena, shared);
+    put_size(_arena, s.size() - shared);
+    _arena.insert(_arena.end(), s.begin() + shared, s.end());
+  }
+  _arena.shrink_to_fit();
+}
+
+inline void front_coded_sorted_vector::  clear()
+{
+  _arena.clear();
+  _bucket.clear();
+  _size = 0;
+}
+
+inline void front_coded_sorted_vector::  decompress(
+  sorted_vector <std::string> &sv)
+  const
+{
+  std::vector <std::string> v;
+  v.reserve(_size);
+  for (const_iterator it = begin(); it != end(); ++it)
+    v.push_back(std::string(*it));
+  sv.assign_sorted(static_cast <std::vector <std::string> &&> (v));
+}
+
+inline std::string front_coded_sorted_vector::  at(
+  size_t pos)
+  const
+{
+  if (pos >= _size)
+    throw std::out_of_range("front_coded_sorted_vector::at");
+  return operator[](pos);
+}
+
+inline std::string front_coded_sorted_vector:: operator[](
+  size_t pos)
+  const
+{
+  return std::string(*const_iterator(pos, this));
+}
+
+inline std::string front_coded_sorted_vector::  front()
+  const
+{
+  return std::string(head(0));
+}
+
+inline std::string front_coded_sorted_vector::  back()
+  const
+{
+  return operator[](_size - 1);
+}
+
+inline front_coded_sorted_vector::const_iterator front_coded_sorted_vector::  begin()
+  const
+{
+  return const_iterator(0, this);
+}
+
+inline front_coded_sorted_vector::const_iterator front_coded_sorted_vector::  cbegin()
+  const
+{
+  return const_iterator(0, this);
+}
+
+inline front_coded_sorted_vector::const_iterator front_coded_sorted_vector::  end()
+  const
+{
+  return const_iterator(_size, this);
+}
+
+inline front_coded_sorted_vector::const_iterator front_coded_sorted_vector::  cend()
+  const
+{
+  return const_iterator(_size, this);
+}
+
+inline bool front_coded_sorted_vector::  empty()
+  const
+{
+  return _size == 0;
+}
+
+inline size_t front_coded_sorted_vector::  size()
+  const
+{
+  return _size;
+}
+
+inline size_t front_coded_sorted_vector::  buckets()
+  const
+{
+  return _bucket.size();
+}
+
+inline size_t front_coded_sorted_vector::  memory_usage()
+  const
+{
+  return _arena.capacity()
+       + _bucket.capacity() * sizeof(size_t);
+}
+
+inline size_t front_coded_sorted_vector:: find(
+  string_ref t,
+  size_t start_pos,
+  size_t end_pos)
+  const
+{
+  return find_first(t, start_pos, end_pos);
+}
+
+inline size_t front_coded_sorted_vector:: find_first(
+  string_ref t,
+  size_t start_pos,
+  size_t end_pos)
+  const
+{
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  bool equal;
+  size_t pos = lower(t, equal);
+  if (pos < start_pos) {
+    pos = start_pos;
+    equal = upper(t, equal) > start_pos;
+  }
+  if (  (pos > end_pos)
+      ||(!equal))
+    return -1;
+  return pos;
+}
+
+inline size_t front_coded_sorted_vector:: find_last(
+  string_ref t,
+  size_t start_pos,
+  size_t end_pos)
+  const
+{
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  bool equal;
+  size_t pos = upper(t, equal);
+  if (pos > end_pos + 1) {
+    pos = end_pos + 1;
+    equal = lower(t, equal) <= end_pos;
+  }
+  if (  (pos <= start_pos)
+      ||(!equal))
+    return -1;
+  return pos - 1;
+}
+
+inline size_t front_coded_sorted_vector:: find_floor(
+  string_ref t,
+  size_t start_pos,
+  size_t end_pos)
+  const
+{
+  //Семантика sorted_vector::find_floor: первый равный
+  //элемент, иначе наибольший меньший
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  bool equal;
+  size_t pos = lower(t, equal);
+  if (pos < start_pos) {
+    pos = start_pos;
+    equal = upper(t, equal) > start_pos;
+  }
+  if (  (pos <= end_pos)
+      &&(equal))
+    return pos;
+  pos = std::min(pos, end_pos + 1);
+  return (pos == start_pos) ? (size_t)-1 : pos - 1;
+}
+
+inline size_t front_coded_sorted_vector:: find_ceil(
+  string_ref t,
+  size_t start_pos,
+  size_t end_pos)
+  const
+{
+  //Семантика sorted_vector::find_ceil: последний равный
+  //элемент, иначе наименьший больший
+  if (_size == 0)
+    return -1;
+  if (end_pos == (size_t)-1)
+    end_pos = _size - 1;
+  bool equal;
+  size_t pos = upper(t, equal);
+  if (pos > end_pos + 1) {
+    pos = end_pos + 1;
+    equal = lower(t, equal) <= end_pos;
+  }
+  if (  (pos > start_pos)
+      &&(equal))
+    return pos - 1;
+  pos = std::max(pos, start_pos);
+  return (pos > end_pos) ? (size_t)-1 : pos;
+}
+
+inline size_t front_coded_sorted_vector::  count_range(
+  string_ref lo,
+  string_ref hi)
+  const
+{
+  if (hi < lo)
+    return 0;
+  bool equal;
+  return upper(hi, equal) - lower(lo, equal);
+}
+
+inline size_t front_coded_sorted_vector:: rank(
+  string_ref t)
+  const
+{
+  bool equal;
+  return lower(t, equal);
+}
+
+//***protected methods***
+
+inline void front_coded_sorted_vector::  put_size(
+  std::vector <char> &arena,
+  size_t n)
+{
+  //7 бит на байт, старший бит - признак продолжения
+  while (n >= 0x80) {
+    arena.push_back((char)(n | 0x80));
+    n >>= 7;
+  }
+  arena.push_back((char)n);
+}
+
+inline size_t front_coded_sorted_vector::  get_size(
+  const char *&p)
+{
+  size_t n = 0;
+  for (unsigned shift = 0; ; shift += 7) {
+    unsigned char c = (unsigned char)*p++;
+    n |= (size_t)(c & 0x7f) << shift;
+    if (c < 0x80)
+      return n;
+  }
+}
+
+inline size_t front_coded_sorted_vector::  common_prefix(
+  const char *a,
+  size_t na,
+  const char *b,
+  size_t nb)
+{
+  size_t n = std::min(na, nb);
+  size_t i = 0;
+  while (  (i < n)
+         &&(a[i] == b[i]))
+    i++;
+  return i;
+}
+
+inline int front_coded_sorted_vector::  compare_tail(
+  const char *a,
+  size_t na,
+  const char *b,
+  size_t nb)
+{
+  //Строки уже различаются в первом символе,
+  //либо одна из них пуста
+  if (na == 0)
+    return (nb == 0) ? 0 : -1;
+  if (nb == 0)
+    return 1;
+  return ((unsigned char)*a < (unsigned char)*b) ? -1 : 1;
+}
+
+inline size_t front_coded_sorted_vector::  bucket_size(
+  size_t bucket)
+  const
+{
+  return std::min(
+    (size_t)CIM_SORTED_VECTOR_FRONT_CODING_BUCKET,
+    _size - bucket * CIM_SORTED_VECTOR_FRONT_CODING_BUCKET);
+}
+
+inline string_ref front_coded_sorted_vector::  head(
+  size_t bucket)
+  const
+{
+  const char *p = _arena.data() + _bucket[bucket];
+  size_t n = get_size(p);
+  return string_ref(p, n);
+}
+
+inline size_t front_coded_sorted_vector::  scan(
+  size_t bucket,
+  string_ref t,
+  bool upper,
+  int &last,
+  int &stop)
+  const
+{
+  //Число строк блока, меньших t (при upper - не больших).
+  //Строки не восстанавливаются: для каждой известны длина
+  //m общего с t префикса предыдущей строки и результат их
+  //сравнения c. Если общий с предыдущей префикс строки
+  //короче m, строка больше t; если длиннее - меньше t
+  //(как и предыдущая); иначе сравнивается только суффикс
+  const char *p = _arena.data() + _bucket[bucket];
+  size_t n = bucket_size(bucket);
+  size_t len = get_size(p);
+  size_t m = common_prefix(p, len, t.data(), t.size());
+  int c = compare_tail(p + m, len - m, t.data() + m, t.size() - m);
+  p += len;
+
+  last = -1;
+  for (size_t j = 0; ; ) {
+    if (  (c > 0)
+        ||((c == 0) && (!upper))) {
+      stop = c;
+      return j;
+    }
+    last = c;
+    if (++j == n) {
+      stop = 2;
+      return j;
+    }
+    size_t shared = get_size(p);
+    size_t sn = get_size(p);
+    const char *s = p;
+    p += sn;
+    if (c == 0)
+      c = (  (shared == m)
+           &&(sn == 0)) ? 0 : 1;
+    else if (shared < m)
+      c = 1;
+    else if (shared == m) {
+      size_t k = common_prefix(s, sn, t.data() + m, t.size() - m);
+      c = compare_tail(s + k, sn - k, t.data() + m + k, t.size() - m - k);
+      m += k;
+    }
+  }
+}
+
+inline size_t front_coded_sorted_vector::  lower(
+  string_ref t,
+  bool &equal)
+  const
+{
+  //Первая позиция, строка в которой не меньше t;
+  //equal - равна ли она t
+  size_t f = 0;
+  size_t l = _bucket.size();
+  while (f < l) {
+    size_t m = f + (l - f) / 2;
+    if (head(m) < t)
+      f = m + 1;
+    else
+      l = m;
+  }
+  if (f == 0) {
+    equal = (_size > 0) && (head(0) == t);
+    return 0;
+  }
+  int last;
+  int stop;
+  size_t pos = (f - 1) * CIM_SORTED_VECTOR_FRONT_CODING_BUCKET + scan(f - 1, t, false, last, stop);
+  if (stop == 2)
+    equal = (f < _bucket.size()) && (head(f) == t);
+  else
+    equal = stop == 0;
+  return pos;
+}
+
+inline size_t front_coded_sorted_vector::  upper(
+  string_ref t,
+  bool &equal)
+  const
+{
+  //Первая позиция, строка в которой больше t;
+  //equal - равна ли t предыдущая строка
+  size_t f = 0;
+  size_t l = _bucket.size();
+  while (f < l) {
+    size_t m = f + (l - f) / 2;
+    if (!(t < head(m)))
+      f = m + 1;
+    else
+      l = m;
+  }
+  if (f == 0) {
+    equal = false;
+    return 0;
+  }
+  int last;
+  int stop;
+  size_t pos = (f - 1) * CIM_SORTED_VECTOR_FRONT_CODING_BUCKET + scan(f - 1, t, true, last, stop);
+  equal = last == 0;
+  return pos;
+}
+
+//***Lazy model***
+
+//Модель, которую потомок sorted_vector строит при первом
+//константном запросе. Построение выполняется под мьютексом
+//с повторной проверкой флага, поэтому константные запросы
+//из нескольких потоков безопасны, как и для sorted_vector.
+//update поправляет построенную модель под тем же мьютексом;
+//value и reset выполняются без блокировки и не должны
+//пересекаться с запросами. Копия получает пустую модель
+//и строит её заново
+template <class M>
+  class sorted_vector_lazy
+{
+  public:
+    sorted_vector_lazy();
+    sorted_vector_lazy(const sorted_vector_lazy &l);
+    sorted_vector_lazy &operator=(const sorted_vector_lazy &l);
+
+    template <class Build>
+      const M &get(Build build) const;
+    template <class Update>
+      void update(Update u);
+    bool ready()  const;
+    M &value();
+    void reset();
+
+  private:
+    mutable M                   _model;
+    mutable std::atomic <bool>  _ready;
+    mutable std::mutex          _mutex;
+};
+
+template <class M>
+  sorted_vector_lazy <M>::  sorted_vector_lazy()
+  : _ready(false)
+{}
+
+template <class M>
+  sorted_vector_lazy <M>::  sorted_vector_lazy(
+    const sorted_vector_lazy &)
+  : _ready(false)
+{}
+
+template <class M>
+  sorted_vector_lazy <M> &sorted_vector_lazy <M>::  operator=(
+    const sorted_vector_lazy &)
+{
+  reset();
+  return *this;
+}
+
+template <class M>
+  template <class Build>
+  const M &sorted_vector_lazy <M>::  get(
+    Build build)
+    const
+{
+  if (!_ready.load(std::memory_order_acquire)) {
+    std::lock_guard <std::mutex> lock(_mutex);
+    if (!_ready.load(std::memory_order_relaxed)) {
+      build(_model);
+      _ready.store(true, std::memory_order_release);
+    }
+  }
+  return _model;
+}
+
+template <class M>
+  template <class Update>
+  void sorted_vector_lazy <M>::  update(
+    Update u)
+{
+  //u возвращает false, если модель больше не годится
+  //и должна быть построена заново
+  std::lock_guard <std::mutex> lock(_mutex);
+  if (  (_ready.load(std::memory_order_relaxed))
+      &&(!u(_model)))
+    _ready.store(false, std::memory_order_relaxed);
+}
+
+template <class M>
+  bool sorted_vector_lazy <M>::  ready()
+    const
+{
+  return _ready.load(std::memory_order_acquire);
+}
+
+template <class M>
+  M &sorted_vector_lazy <M>::  value()
+{
+  return _model;
+}
+
+template <class M>
+  void sorted_vector_lazy <M>::  reset()
+{
+  _ready.store(false, std::memory_order_relaxed);
+}
+
+//***Learned index***
+
+template <class T, class Base = sorted_vector <T> >
+  class sorted_vector_learned : public Base
+{
+  static_assert(
+    std::is_arithmetic <T>::value,
+    "sorted_vector_learned requires an arithmetic element type");
+
+  public:
+    sorted_vector_learned();
+    sorted_vector_learned(const std::vector <T> &v);
+    sorted_vector_learned(std::vector <T> &&v);
+
+    size_t find(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_first(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)   const;
+    size_t find_floor(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_ceil(const T &t, size_t start_pos = 0, size_t end_pos = -1)   const;
+
+    size_t rank(const T &t)                      const;
+    size_t count_range(const T &lo, const T &hi) const;
+
+    bool trained()      const;
+    size_t max_error()  const;
+
+    using Base::find;
+    using Base::find_first;
+    using Base::find_last;
+    using Base::find_floor;
+    using Base::find_ceil;
+    using Base::rank;
+    using Base::count_range;
+
+  protected:
+    void on_insert(size_t pos);
+    void on_erase(size_t first, size_t last);
+    void on_change(size_t pos);
+    void on_reset();
+
+  private:
+    struct leaf
+    {
+      double  mean_key;
+      double  mean_pos;
+      double  slope;
+      size_t  start;
+      size_t  err_lo;
+      size_t  err_hi;
+    };
+
+    struct model
+    {
+      std::vector <leaf>  leaves;
+      double              base        = 0;
+      double              root_mean   = 0;
+      double              root_slope  = 0;
+      size_t              max_error   = 0;
+      size_t              drift       = 0;
+    };
+
+    bool ready()                                          const;
+    const model &trained_model()                          const;
+    void train(model &m)                                  const;
+    static double key(const model &m, const T &t);
+    static size_t leaf_of(const model &m, double x);
+    void window(const T &t, size_t &first, size_t &last)  const;
+    size_t lower(const T &t)                              const;
+    size_t upper(const T &t)                              const;
+    void shift(size_t d);
+
+    sorted_vector_lazy <model> _model;
+};
+
+template <class T, class Base>
+  sorted_vector_learned <T, Base>::  sorted_vector_learned()
+{}
+
+template <class T, class Base>
+  sorted_vector_learned <T, Base>::  sorted_vector_learned(
+    const std::vector <T> &v)
+{
+  this->merge(v);
+}
+
+template <class T, class Base>
+  sorted_vector_learned <T, Base>::  sorted_vector_learned(
+    std::vector <T> &&v)
+{
+  this->merge(static_cast <std::vector <T> &&> (v));
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>:: find(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (!ready())
+    return Base::find(t, start_pos, end_pos);
+  return find_first(t, start_pos, end_pos);
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>:: find_first(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (!ready())
+    return Base::find_first(t, start_pos, end_pos);
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+  size_t pos = std::max(lower(t), start_pos);
+  if (  (pos > end_pos)
+      ||(!(this->data()[pos] == t)))
+    return -1;
+  return pos;
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>:: find_last(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (!ready())
+    return Base::find_last(t, start_pos, end_pos);
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+  size_t pos = std::min(upper(t), end_pos + 1);
+  if (  (pos <= start_pos)
+      ||(!(this->data()[pos - 1] == t)))
+    return -1;
+  return pos - 1;
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>:: find_floor(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Семантика sorted_vector::find_floor: первый равный
+  //элемент, иначе наибольший меньший
+  if (!ready())
+    return Base::find_floor(t, start_pos, end_pos);
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+  size_t pos = std::min(std::max(lower(t), start_pos), end_pos + 1);
+  if (  (pos <= end_pos)
+      &&(this->data()[pos] == t))
+    return pos;
+  return (pos == start_pos) ? (size_t)-1 : pos - 1;
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>:: find_ceil(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  //Семантика sorted_vector::find_ceil: последний равный
+  //элемент, иначе наименьший больший
+  if (!ready())
+    return Base::find_ceil(t, start_pos, end_pos);
+  if (end_pos == (size_t)-1)
+    end_pos = this->size() - 1;
+  size_t pos = std::min(std::max(upper(t), start_pos), end_pos + 1);
+  if (  (pos > start_pos)
+      &&(this->data()[pos - 1] == t))
+    return pos - 1;
+  return (pos > end_pos) ? (size_t)-1 : pos;
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>:: rank(
+    const T &t)
+    const
+{
+  if (!ready())
+    return Base::rank(t);
+  return lower(t);
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>::  count_range(
+    const T &lo,
+    const T &hi)
+    const
+{
+  if (!ready())
+    return Base::count_range(lo, hi);
+  if (hi < lo)
+    return 0;
+  return upper(hi) - lower(lo);
+}
+
+template <class T, class Base>
+  bool sorted_vector_learned <T, Base>::  trained()
+    const
+{
+  return _model.ready();
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>::  max_error()
+    const
+{
+  if (!ready())
+    return 0;
+  return trained_model().max_error;
+}
+
+template <class T, class Base>
+  void sorted_vector_learned <T, Base>::  on_insert(
+    size_t pos)
+{
+  Base::on_insert(pos);
+  shift(1);
+}
+
+template <class T, class Base>
+  void sorted_vector_learned <T, Base>::  on_erase(
+    size_t first,
+    size_t last)
+{
+  Base::on_erase(first, last);
+  shift(last - first);
+}
+
+template <class T, class Base>
+  void sorted_vector_learned <T, Base>::  on_change(
+    size_t pos)
+{
+  Base::on_change(pos);
+  shift(1);
+}
+
+template <class T, class Base>
+  void sorted_vector_learned <T, Base>::  on_reset()
+{
+  Base::on_reset();
+  _model.reset();
+}
+
+//***private methods***
+
+template <class T, class Base>
+  bool sorted_vector_learned <T, Base>::  ready()
+  const
+{
+  //Модель обучается при первом запросе к отсортированному
+  //экземпляру; маленькому экземпляру она не нужна
+  if (  (this->corrupted())
+      ||(this->size() < 2 * CIM_SORTED_VECTOR_LEARNED_LEAF))
+    return false;
+  trained_model();
+  return true;
+}
+
+template <class T, class Base>
+  const typename sorted_vector_learned <T, Base>::model &
+  sorted_vector_learned <T, Base>::  trained_model()
+  const
+{
+  return _model.get([this](model &m) { train(m); });
+}
+
+template <class T, class Base>
+  void sorted_vector_learned <T, Base>::  shift(
+    size_t d)
+{
+  //Вставка, удаление или замена элемента сдвигает позицию
+  //любого ключа не более чем на единицу, поэтому модель
+  //остаётся верной, если расширить окно поиска на число
+  //изменений после обучения. Переобучение откладывается,
+  //пока расширение не превысит долю размера
+  size_t limit = std::max(
+    (size_t)CIM_SORTED_VECTOR_LEARNED_LEAF,
+    this->size() / CIM_SORTED_VECTOR_LEARNED_DRIFT);
+  _model.update([d, limit](model &m) {
+    m.drift += d;
+    return m.drift <= limit;
+  });
+}
+
+template <class T, class Base>
+  void sorted_vector_learned <T, Base>::  train(
+    model &m)
+  const
+{
+  //Двухуровневая модель: корневая линейная регрессия
+  //позиции по ключу выбирает лист, листовая регрессия
+  //по ключам листа предсказывает позицию. Корневая
+  //модель монотонна, поэтому ключи листа образуют
+  //непрерывный участок [start, start следующего листа)
+  const T *d = this->data();
+  size_t n = this->size();
+  size_t nl = n / CIM_SORTED_VECTOR_LEARNED_LEAF;
+  m.base = (double)d[0];
+  m.drift = 0;
+
+  double mean_key = 0;
+  for (size_t i = 0; i < n; i++)
+    mean_key += (key(m, d[i]) - mean_key) / (double)(i + 1);
+  double mean_pos = (double)(n - 1) / 2;
+  double cov = 0;
+  double var = 0;
+  for (size_t i = 0; i < n; i++) {
+    double dx = key(m, d[i]) - mean_key;
+    cov += dx * ((double)i - mean_pos);
+    var += dx * dx;
+  }
+  m.root_mean = mean_key;
+  m.root_slope = (var > 0) ? std::max(0.0, cov / var) * (double)nl / (double)n : 0;
+
+  m.leaves.assign(nl + 1, leaf());
+  size_t l = 0;
+  m.leaves[0].start = 0;
+  for (size_t i = 0; i < n; i++) {
+    size_t li = leaf_of(m, key(m, d[i]));
+    while (l < li)
+      m.leaves[++l].start = i;
+  }
+  while (l < nl)
+    m.leaves[++l].start = n;
+
+  m.max_error = 0;
+  for (l = 0; l < nl; l++) {
+    leaf &f = m.leaves[l];
+    size_t first = f.start;
+    size_t last = m.leaves[l + 1].start;
+    f.mean_key = 0;
+    f.mean_pos = (double)first;
+    f.slope = 0;
+    f.err_lo = 0;
+    f.err_hi = 0;
+    if (first == last)
+      continue;
+
+    for (size_t i = first; i < last; i++)
+      f.mean_key += (key(m, d[i]) - f.mean_key) / (double)(i - first + 1);
+    f.mean_pos = (double)(first + last - 1) / 2;
+    cov = 0;
+    var = 0;
+    for (size_t i = first; i < last; i++) {
+      double dx = key(m, d[i]) - f.mean_key;
+      cov += dx * ((double)i - f.mean_pos);
+      var += dx * dx;
+    }
+    f.slope = (var > 0) ? std::max(0.0, cov / var) : 0;
+
+    for (size_t i = first; i < last; i++) {
+      double p = f.mean_pos + f.slope * (key(m, d[i]) - f.mean_key);
+      if (p > (double)i)
+        f.err_lo = std::max(f.err_lo, (size_t)(p - (double)i) + 1);
+      else
+        f.err_hi = std::max(f.err_hi, (size_t)((double)i - p) + 1);
+    }
+    m.max_error = std::max(m.max_error, std::max(f.err_lo, f.err_hi));
+  }
+}
+
+template <class T, class Base>
+  double sorted_vector_learned <T, Base>::  key(
+    const model &m,
+    const T &t)
+{
+  //Ключи отсчитываются от первого элемента: для больших
+  //значений (отметки времени) это сохраняет точность
+  //средних и регрессии
+  return (double)t - m.base;
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>::  leaf_of(
+    const model &m,
+    double x)
+{
+  double l = (double)(m.leaves.size() - 1) / 2 + m.root_slope * (x - m.root_mean);
+  if (!(l > 0))
+    return 0;
+  if (l >= (double)(m.leaves.size() - 2))
+    return m.leaves.size() - 2;
+  return (size_t)l;
+}
+
+template <class T, class Base>
+  void sorted_vector_learned <T, Base>::  window(
+    const T &t,
+    size_t &first,
+    size_t &last)
+  const
+{
+  //Границы позиции ключа: лист задаёт участок, предсказание
+  //с погрешностью листа сужает его. Позиция i с
+  //d[i-1] < t <= d[i] (или d[i-1] <= t < d[i]) лежит в
+  //[p - err_lo, p + err_hi + 1] в силу монотонности модели.
+  //Изменения после обучения расширяют окно на m.drift
+  const model &m = trained_model();
+  double x = key(m, t);
+  size_t l = leaf_of(m, x);
+  const leaf &f = m.leaves[l];
+  first = f.start;
+  last = m.leaves[l + 1].start;
+  if (first < last) {
+    double p = f.mean_pos + f.slope * (x - f.mean_key);
+    double lo = p - (double)f.err_lo - 1;
+    double hi = p + (double)f.err_hi + 2;
+    if (lo > (double)first)
+      first = (lo < (double)last) ? (size_t)lo : last;
+    if (hi < (double)last)
+      last = (hi > (double)first) ? (size_t)hi : first;
+  }
+  if (m.drift > 0) {
+    first = (first > m.drift) ? first - m.drift : 0;
+    last = std::min(last + m.drift, this->size());
+  }
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>::  lower(
+    const T &t)
+  const
+{
+  size_t first;
+  size_t last;
+  window(t, first, last);
+  const T *d = this->data();
+  return std::lower_bound(d + first, d + last, t) - d;
+}
+
+template <class T, class Base>
+  size_t sorted_vector_learned <T, Base>::  upper(
+    const T &t)
+  const
+{
+  size_t first;
+  size_t last;
+  window(t, first, last);
+  const T *d = this->data();
+  return std::upper_bound(d + first, d + last, t) - d;
+}
+
+//***Bloom filter***
+
+class sorted_vector_bloom
+{
+  public:
+    sorted_vector_bloom();
+    sorted_vector_bloom(const sorted_vector_bloom &b);
+    sorted_vector_bloom(sorted_vector_bloom &&b);
+
+    sorted_vector_bloom &operator=(const sorted_vector_bloom &b);
+    sorted_vector_bloom &operator=(sorted_vector_bloom &&b);
+
+    void reset(size_t capacity);
+    void clear();
+
+    void add(uint64_t h);
+    bool may_contain(uint64_t h) const;
+
+    size_t blocks()       const;
+    size_t memory_usage() const;
+
+    static uint64_t mix(uint64_t h);
+
+  private:
+    uint64_t *block(size_t i);
+    const uint64_t *block(size_t i)   const;
+    size_t index(uint64_t h)          const;
+    static uint64_t bit(uint64_t h, size_t word);
+
+    std::vector <uint64_t>  _words;
+    size_t                  _blocks = 0;
+};
+
+inline sorted_vector_bloom::  sorted_vector_bloom()
+{}
+
+inline sorted_vector_bloom::  sorted_vector_bloom(
+  const sorted_vector_bloom &b)
+{
+  *this = b;
+}
+
+inline sorted_vector_bloom::  sorted_vector_bloom(
+  sorted_vector_bloom &&b)
+  : _words(static_cast <std::vector <uint64_t> &&> (b._words)), _blocks(b._blocks)
+{
+  b._blocks = 0;
+}
+
+inline sorted_vector_bloom &sorted_vector_bloom:: operator=(
+  const sorted_vector_bloom &b)
+{
+  //Выравнивание копии может отличаться от оригинала,
+  //поэтому копируются блоки, а не буфер целиком
+  if (this == &b)
+    return *this;
+  _words.assign(b._words.size(), 0);
+  _blocks = b._blocks;
+  if (_blocks > 0)
+    memcpy(block(0), b.block(0), _blocks * 64);
+  return *this;
+}
+
+inline sorted_vector_bloom &sorted_vector_bloom:: operator=(
+  sorted_vector_bloom &&b)
+{
+  _words = static_cast <std::vector <uint64_t> &&> (b._words);
+  _blocks = b._blocks;
+  b._blocks = 0;
+  return *this;
+}
+
+inline void sorted_vector_bloom:: reset(
+  size_t capacity)
+{
+  //Блок - 8 слов по 64 бита (одна линия кэша), ключ
+  //устанавливает по одному биту в каждом слове блока.
+  //Буфер берётся с запасом в 7 слов для выравнивания
+  //блоков по 64 байтам
+  _blocks = (capacity * CIM_SORTED_VECTOR_FILTER_BITS + 511) / 512;
+  if (_blocks == 0)
+    _blocks = 1;
+  std::vector <uint64_t> (_blocks * 8 + 7, 0).swap(_words);
+}
+
+inline void sorted_vector_bloom:: clear()
+{
+  std::vector <uint64_t>().swap(_words);
+  _blocks = 0;
+}
+
+inline void sorted_vector_bloom:: add(
+  uint64_t h)
+{
+  uint64_t *b = block(index(h));
+  for (size_t i = 0; i < 8; i++)
+    b[i] |= bit(h, i);
+}
+
+inline bool sorted_vector_bloom:: may_contain(
+  uint64_t h)
+  const
+{
+  //Пустой фильтр ничего не исключает
+  if (_blocks == 0)
+    return true;
+  const uint64_t *b = block(index(h));
+  uint64_t miss = 0;
+  for (size_t i = 0; i < 8; i++)
+    miss |= bit(h, i) & ~b[i];
+  return miss == 0;
+}
+
+inline size_t sorted_vector_bloom:: blocks()
+  const
+{
+  return _blocks;
+}
+
+inline size_t sorted_vector_bloom:: memory_usage()
+  const
+{
+  return _words.capacity() * sizeof(uint64_t);
+}
+
+inline uint64_t sorted_vector_bloom:: mix(
+  uint64_t h)
+{
+  //Финализатор MurmurHash3: std::hash для целых -
+  //тождественное отображение
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+//***private methods***
+
+inline uint64_t *sorted_vector_bloom:: block(
+  size_t i)
+{
+  uint64_t *p = _words.data();
+  return p + ((64 - ((uintptr_t)p & 63)) & 63) / 8 + i * 8;
+}
+
+inline const uint64_t *sorted_vector_bloom:: block(
+  size_t i)
+  const
+{
+  const uint64_t *p = _words.data();
+  return p + ((64 - ((uintptr_t)p & 63)) & 63) / 8 + i * 8;
+}
+
+inline size_t sorted_vector_bloom:: index(
+  uint64_t h)
+  const
+{
+  //Старшие 32 бита хеша выбирают блок умножением
+  //вместо деления по модулю
+  return (size_t)(((h >> 32) * (uint64_t)_blocks) >> 32);
+}
+
+inline uint64_t sorted_vector_bloom:: bit(
+  uint64_t h,
+  size_t word)
+{
+  //Младшие 32 бита хеша, умноженные на нечётную соль
+  //слова, дают номер бита в старших 6 битах
+  static const uint32_t salt[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+  return (uint64_t)1 << (((uint32_t)h * salt[word]) >> 26);
+}
+
+//***Filtered sorted_vector***
+
+template <class T, class Base = sorted_vector <T>, class Hash = std::hash <T> >
+  class sorted_vector_filtered : public Base
+{
+  public:
+    sorted_vector_filtered();
+    sorted_vector_filtered(const std::vector <T> &v);
+    sorted_vector_filtered(std::vector <T> &&v);
+
+    size_t find(const T &t, size_t start_pos = 0, size_t end_pos = -1)        const;
+    size_t find_first(const T &t, size_t start_pos = 0, size_t end_pos = -1)  const;
+    size_t find_last(const T &t, size_t start_pos = 0, size_t end_pos = -1)   const;
+
+    bool may_contain(const T &t)        const;
+    size_t filter_memory_usage()        const;
+
+    using Base::find;
+    using Base::find_first;
+    using Base::find_last;
+
+  protected:
+    void on_insert(size_t pos);
+    void on_erase(size_t first, size_t last);
+    void on_change(size_t pos);
+    void on_reset();
+
+    bool may_contain_hash(size_t h)     const;
+
+  private:
+    struct model
+    {
+      sorted_vector_bloom filter;
+      size_t              capacity  = 0;
+      size_t              count     = 0;
+      size_t              erased    = 0;
+    };
+
+    bool ready()                        const;
+    const model &built()                const;
+    void build(model &m)                const;
+    void add(size_t pos);
+
+    sorted_vector_lazy <model> _model;
+};
+
+template <class T, class Base, class Hash>
+  sorted_vector_filtered <T, Base, Hash>::  sorted_vector_filtered()
+{}
+
+template <class T, class Base, class Hash>
+  sorted_vector_filtered <T, Base, Hash>::  sorted_vector_filtered(
+    const std::vector <T> &v)
+{
+  this->merge(v);
+}
+
+template <class T, class Base, class Hash>
+  sorted_vector_filtered <T, Base, Hash>::  sorted_vector_filtered(
+    std::vector <T> &&v)
+{
+  this->merge(static_cast <std::vector <T> &&> (v));
+}
+
+template <class T, class Base, class Hash>
+  size_t sorted_vector_filtered <T, Base, Hash>:: find(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (!may_contain_hash(Hash()(t)))
+    return -1;
+  return Base::find(t, start_pos, end_pos);
+}
+
+template <class T, class Base, class Hash>
+  size_t sorted_vector_filtered <T, Base, Hash>:: find_first(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (!may_contain_hash(Hash()(t)))
+    return -1;
+  return Base::find_first(t, start_pos, end_pos);
+}
+
+template <class T, class Base, class Hash>
+  size_t sorted_vector_filtered <T, Base, Hash>:: find_last(
+    const T &t,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (!may_contain_hash(Hash()(t)))
+    return -1;
+  return Base::find_last(t, start_pos, end_pos);
+}
+
+template <class T, class Base, class Hash>
+  bool sorted_vector_filtered <T, Base, Hash>::  may_contain(
+    const T &t)
+    const
+{
+  return may_contain_hash(Hash()(t));
+}
+
+template <class T, class Base, class Hash>
+  size_t sorted_vector_filtered <T, Base, Hash>::  filter_memory_usage()
+    const
+{
+  if (!_model.ready())
+    return 0;
+  return built().filter.memory_usage();
+}
+
+template <class T, class Base, class Hash>
+  void sorted_vector_filtered <T, Base, Hash>::  on_insert(
+    size_t pos)
+{
+  Base::on_insert(pos);
+  add(pos);
+}
+
+template <class T, class Base, class Hash>
+  void sorted_vector_filtered <T, Base, Hash>::  on_erase(
+    size_t first,
+    size_t last)
+{
+  //Биты удалённых элементов не снимаются и дают ложные
+  //срабатывания; фильтр перестраивается, когда удалена
+  //четверть занесённых в него элементов
+  Base::on_erase(first, last);
+  if (!_model.ready())
+    return;
+  model &m = _model.value();
+  m.erased += last - first;
+  if (m.erased * 4 > m.count)
+    _model.reset();
+}
+
+template <class T, class Base, class Hash>
+  void sorted_vector_filtered <T, Base, Hash>::  on_change(
+    size_t pos)
+{
+  Base::on_change(pos);
+  add(pos);
+}
+
+template <class T, class Base, class Hash>
+  void sorted_vector_filtered <T, Base, Hash>::  on_reset()
+{
+  Base::on_reset();
+  _model.reset();
+}
+
+template <class T, class Base, class Hash>
+  bool sorted_vector_filtered <T, Base, Hash>::  may_contain_hash(
+    size_t h)
+    const
+{
+  //false - элемента с таким хешем гарантированно нет
+  if (!ready())
+    return true;
+  return built().filter.may_contain(sorted_vector_bloom::mix(h));
+}
+
+//***private methods***
+
+template <class T, class Base, class Hash>
+  bool sorted_vector_filtered <T, Base, Hash>::  ready()
+  const
+{
+  return !this->corrupted();
+}
+
+template <class T, class Base, class Hash>
+  const typename sorted_vector_filtered <T, Base, Hash>::model &
+  sorted_vector_filtered <T, Base, Hash>::  built()
+  const
+{
+  return _model.get([this](model &m) { build(m); });
+}
+
+template <class T, class Base, class Hash>
+  void sorted_vector_filtered <T, Base, Hash>::  build(
+    model &m)
+  const
+{
+  //Запас в полтора раза делает перестроение при
+  //пополнении амортизированно O(1) на элемент
+  const T *d = this->data();
+  size_t n = this->size();
+  m.capacity = std::max(n + n / 2, (size_t)256);
+  m.count = n;
+  m.erased = 0;
+  m.filter.reset(m.capacity);
+  for (size_t i = 0; i < n; i++)
+    m.filter.add(sorted_vector_bloom::mix(Hash()(d[i])));
+}
+
+template <class T, class Base, class Hash>
+  void sorted_vector_filtered <T, Base, Hash>::  add(
+    size_t pos)
+{
+  //Неконстантный data() пометил бы экземпляр испорченным
+  if (!_model.ready())
+    return;
+  model &m = _model.value();
+  if (++m.count > m.capacity) {
+    _model.reset();
+    return;
+  }
+  const sorted_vector_filtered &self = *this;
+  m.filter.add(sorted_vector_bloom::mix(Hash()(self.data()[pos])));
+}
+
+//***Filtered sorted_vector_with_key***
+
+template <class T, class Key, class Hash = std::hash <Key> >
+  struct sorted_vector_key_hash
+{
+  size_t operator()(const T &t) const
+  {
+    return Hash()(t.CIM_KEYNAME);
+  }
+};
+
+template <class T, class Key, class Hash = std::hash <Key> >
+  class sorted_vector_filtered_with_key
+    : public sorted_vector_filtered <T, sorted_vector_with_key <T, Key>, sorted_vector_key_hash <T, Key, Hash> >
+{
+  typedef sorted_vector_filtered <T, sorted_vector_with_key <T, Key>, sorted_vector_key_hash <T, Key, Hash> > filtered;
+
+  public:
+    sorted_vector_filtered_with_key();
+    sorted_vector_filtered_with_key(const std::vector <T> &v);
+    sorted_vector_filtered_with_key(std::vector <T> &&v);
+
+    size_t find(const Key &key, size_t start_pos = 0, size_t end_pos = -1) const;
+
+    bool may_contain(const Key &key) const;
+
+    using filtered::find;
+    using filtered::may_contain;
+};
+
+template <class T, class Key, class Hash>
+  sorted_vector_filtered_with_key <T, Key, Hash>::  sorted_vector_filtered_with_key()
+{}
+
+template <class T, class Key, class Hash>
+  sorted_vector_filtered_with_key <T, Key, Hash>::  sorted_vector_filtered_with_key(
+    const std::vector <T> &v)
+  : filtered(v)
+{}
+
+template <class T, class Key, class Hash>
+  sorted_vector_filtered_with_key <T, Key, Hash>::  sorted_vector_filtered_with_key(
+    std::vector <T> &&v)
+  : filtered(static_cast <std::vector <T> &&> (v))
+{}
+
+template <class T, class Key, class Hash>
+  size_t sorted_vector_filtered_with_key <T, Key, Hash>:: find(
+    const Key &key,
+    size_t start_pos,
+    size_t end_pos)
+    const
+{
+  if (!this->may_contain_hash(Hash()(key)))
+    return -1;
+  return sorted_vector_with_key <T, Key>::find(key, start_pos, end_pos);
+}
+
+template <class T, class Key, class Hash>
+  bool sorted_vector_filtered_with_key <T, Key, Hash>::  may_contain(
+    const Key &key)
+    const
+{
+  return this->may_contain_hash(Hash()(key));
+}
+
+//***Secondary indexes***
+
+template <class Index, class... Indexes>
+  struct sorted_vector_index_of;
+
+template <class Index, class... Rest>
+  struct sorted_vector_index_of <Index, Index, Rest...>
+{
+  static const size_t value = 0;
+};
+
+template <class Index, class First, class... Rest>
+  struct sorted_vector_index_of <Index, First, Rest...>
+{
+  static const size_t value = 1 + sorted_vector_index_of <Index, Rest...>::value;
+};
+
+template <class T, class Base, class... Indexes>
+  class sorted_vector_indexed : public Base
+{
+  static_assert(
+    sizeof...(Indexes) > 0,
+    "sorted_vector_indexed requires at least one index");
+
+  public:
+    sorted_vector_indexed();
+    sorted_vector_indexed(const std::vector <T> &v);
+    sorted_vector_indexed(std::vector <T> &&v);
+
+    template <class Index, class K>
+      size_t find_by(const K &key)                                      const;
+    template <class Index, class K>
+      size_t count_by(const K &key)                                     const;
+    template <class Index, class K>
+      void find_all_by(const K &key, std::vector <size_t> &positions)   const;
+
+    size_t index_memory_usage() const;
+
+  protected:
+    void on_insert(size_t pos);
+    void on_erase(size_t first, size_t last);
+    void on_change(size_t pos);
+    void on_reset();
+
+  private:
+    //Перестановки позиций хранилища, упорядоченные по
+    //проекциям Indexes (при равенстве - по позиции)
+    struct model
+    {
+      std::vector <uint32_t> permutations[sizeof...(Indexes)];
+    };
+
+    template <class Index>
+      const std::vector <uint32_t> &permutation()                       const;
+
+    bool ready()                                                        const;
+    const model &built()                                                const;
+    void build(model &m)                                                const;
+    template <class Index>
+      void build_index(model &m)                                        const;
+    template <class Index, class K>
+      size_t bound(const K &key, bool upper)                            const;
+    template <class Index>
+      void insert_entry(size_t pos);
+    void erase_entries(size_t first, size_t last);
+
+    sorted_vector_lazy <model> _model;
+};
+
+template <class T, class Base, class... Indexes>
+  sorted_vector_indexed <T, Base, Indexes...>::  sorted_vector_indexed()
+{}
+
+template <class T, class Base, class... Indexes>
+  sorted_vector_indexed <T, Base, Indexes...>::  sorted_vector_indexed(
+    const std::vector <T> &v)
+{
+  this->merge(v);
+}
+
+template <class T, class Base, class... Indexes>
+  sorted_vector_indexed <T, Base, Indexes...>::  sorted_vector_indexed(
+    std::vector <T> &&v)
+{
+  this->merge(static_cast <std::vector <T> &&> (v));
+}
+
+template <class T, class Base, class... Indexes>
+  template <class Index, class K>
+  size_t sorted_vector_indexed <T, Base, Indexes...>::  find_by(
+    const K &key)
+    const
+{
+  const T *d = this->data();
+  Index proj;
+  if (!ready()) {
+    for (size_t i = 0; i < this->size(); i++)
+      if (  (!(proj(d[i]) < key))
+          &&(!(key < proj(d[i]))))
+        return i;
+    return -1;
+  }
+  const std::vector <uint32_t> &p = permutation <Index> ();
+  size_t i = bound <Index> (key, false);
+  if (  (i < p.size())
+      &&(!(key < proj(d[p[i]]))))
+    return p[i];
+  return -1;
+}
+
+template <class T, class Base, class... Indexes>
+  template <class Index, class K>
+  size_t sorted_vector_indexed <T, Base, Indexes...>::  count_by(
+    const K &key)
+    const
+{
+  if (!ready()) {
+    const T *d = this->data();
+    Index proj;
+    size_t count = 0;
+    for (size_t i = 0; i < this->size(); i++)
+      if (  (!(proj(d[i]) < key))
+          &&(!(key < proj(d[i]))))
+        count++;
+    return count;
+  }
+  return bound <Index> (key, true) - bound <Index> (key, false);
+}
+
+template <class T, class Base, class... Indexes>
+  template <class Index, class K>
+  void sorted_vector_indexed <T, Base, Indexes...>::  find_all_by(
+    const K &key,
+    std::vector <size_t> &positions)
+    const
+{
+  //Позиции добавляются по возрастанию
+  const T *d = this->data();
+  Index proj;
+  if (!ready()) {
+    for (size_t i = 0; i < this->size(); i++)
+      if (  (!(proj(d[i]) < key))
+          &&(!(key < proj(d[i]))))
+        positions.push_back(i);
+    return;
+  }
+  const std::vector <uint32_t> &p = permutation <Index> ();
+  size_t last = bound <Index> (key, true);
+  for (size_t i = bound <Index> (key, false); i < last; i++)
+    positions.push_back(p[i]);
+}
+
+template <class T, class Base, class... Indexes>
+  size_t sorted_vector_indexed <T, Base, Indexes...>::  index_memory_usage()
+  const
+{
+  if (!_model.ready())
+    return 0;
+  const model &m = built();
+  size_t bytes = 0;
+  for (size_t i = 0; i < sizeof...(Indexes); i++)
+    bytes += m.permutations[i].capacity() * sizeof(uint32_t);
+  return bytes;
+}
+
+template <class T, class Base, class... Indexes>
+  void sorted_vector_indexed <T, Base, Indexes...>::  on_insert(
+    size_t pos)
+{
+  Base::on_insert(pos);
+  if (!_model.ready())
+    return;
+  if (  (this->corrupted())
+      ||(this->size() > UINT32_MAX)) {
+    _model.reset();
+    return;
+  }
+  int expand[] = {(insert_entry <Indexes> (pos), 0)...};
+  (void)expand;
+}
+
+template <class T, class Base, class... Indexes>
+  void sorted_vector_indexed <T, Base, Indexes...>::  on_erase(
+    size_t first,
+    size_t last)
+{
+  Base::on_erase(first, last);
+  if (!_model.ready())
+    return;
+  if (this->corrupted()) {
+    _model.reset();
+    return;
+  }
+  erase_entries(first, last);
+}
+
+template <class T, class Base, class... Indexes>
+  void sorted_vector_indexed <T, Base, Indexes...>::  on_change(
+    size_t pos)
+{
+  Base::on_change(pos);
+  if (!_model.ready())
+    return;
+  if (this->corrupted()) {
+    _model.reset();
+    return;
+  }
+  erase_entries(pos, pos + 1);
+  int expand[] = {(insert_entry <Indexes> (pos), 0)...};
+  (void)expand;
+}
+
+template <class T, class Base, class... Indexes>
+  void sorted_vector_indexed <T, Base, Indexes...>::  on_reset()
+{
+  Base::on_reset();
+  _model.reset();
+}
+
+//***private methods***
 
-      if (  (_last_modified < _storage.size() - 1)
-          &&(   _storage[_last_modified]
-              > _storage[_last_modified + 1])) {
+template <class T, class Base, class... Indexes>
+  template <class Index>
+  const std::vector <uint32_t> &sorted_vector_indexed <T, Base, Indexes...>::  permutation()
+  const
+{
+  return built().permutations[sorted_vector_index_of <Index, Indexes...>::value];
+}
 
-        size_t pos_floor = find_floor(
-          _storage[_last_modified],
-          _last_modified + 1,
-          _storage.size() - 1);
+template <class T, class Base, class... Indexes>
+  bool sorted_vector_indexed <T, Base, Indexes...>::  ready()
+  const
+{
+  //Элемент испорченного экземпляра мог измениться без
+  //уведомления, поэтому индексы используются только
+  //для исправного экземпляра и строятся при первом
+  //запросе к нему
+  if (this->corrupted())
+    return false;
+  built();
+  return true;
+}
 
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-        T t(static_cast <T &&> (_storage[_last_modified]));
-#endif
-#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
-        char t[sizeof(T)];
-        memcpy(t, &_storage[_last_modified], sizeof(T));
-#endif
-        single_shift_left(_last_modified, pos_floor);
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-        _storage[pos_floor] = static_cast <T &&> (t);
-#endif
-#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
-        memcpy(&_storage[pos_floor], t, sizeof(T));
-#endif
-      }
-    }
-    _last_modified = -1;
-  }
+template <class T, class Base, class... Indexes>
+  const typename sorted_vector_indexed <T, Base, Indexes...>::model &
+  sorted_vector_indexed <T, Base, Indexes...>::  built()
+  const
+{
+  return _model.get([this](model &m) { build(m); });
 }
 
-template <class T>
-  void sorted_vector <T>::  merge(
-    const sorted_vector <T> &sv)
+template <class T, class Base, class... Indexes>
+  void sorted_vector_indexed <T, Base, Indexes...>::  build(
+    model &m)
+  const
 {
-  _storage.reserve(sv.size() + size());
-  _storage.insert(_storage.end(), sv._storage.begin(), sv._storage.end());
-  _last_modified = (size_t)-1;
-  _is_corrupted = true;
-  repair();
+  if (this->size() > UINT32_MAX)
+    throw std::length_error("sorted_vector_indexed: too many elements");
+  int expand[] = {(build_index <Indexes> (m), 0)...};
+  (void)expand;
 }
 
-template <class T>
-  void sorted_vector <T>::  merge(
-    sorted_vector <T> &&sv)
+template <class T, class Base, class... Indexes>
+  template <class Index>
+  void sorted_vector_indexed <T, Base, Indexes...>::  build_index(
+    model &m)
+  const
 {
-  merge(static_cast <std::vector<T> &&> (sv._storage));
+  std::vector <uint32_t> &p = m.permutations[sorted_vector_index_of <Index, Indexes...>::value];
+  p.resize(this->size());
+  for (size_t i = 0; i < p.size(); i++)
+    p[i] = (uint32_t)i;
+  const T *d = this->data();
+  Index proj;
+  std::stable_sort(
+    p.begin(),
+    p.end(),
+    [&](uint32_t a, uint32_t b) { return proj(d[a]) < proj(d[b]); });
 }
 
-template <class T>
-  void sorted_vector <T>::  merge(
-    const std::vector <T> &v)
+template <class T, class Base, class... Indexes>
+  template <class Index, class K>
+  size_t sorted_vector_indexed <T, Base, Indexes...>::  bound(
+    const K &key,
+    bool upper)
+    const
 {
-  _storage.reserve(v.size() + size());
-  _storage.insert(_storage.end(), v.begin(), v.end());
-  _last_modified = (size_t)-1;
-  _is_corrupted = true;
-  repair();
+  const std::vector <uint32_t> &p = permutation <Index> ();
+  const T *d = this->data();
+  Index proj;
+  if (upper)
+    return sorted_vector_partition_point(
+      p.size(),
+      [&](size_t i) { return !(key < proj(d[p[i]])); });
+  return sorted_vector_partition_point(
+    p.size(),
+    [&](size_t i) { return proj(d[p[i]]) < key; });
+}
+
+template <class T, class Base, class... Indexes>
+  template <class Index>
+  void sorted_vector_indexed <T, Base, Indexes...>::  insert_entry(
+    size_t pos)
+{
+  //Позиции не меньше pos сдвигаются, новая вставляется
+  //перед первой большей по (проекция, позиция).
+  //Неконстантный data() пометил бы экземпляр испорченным
+  std::vector <uint32_t> &p = _model.value().permutations[sorted_vector_index_of <Index, Indexes...>::value];
+  for (size_t i = 0; i < p.size(); i++)
+    p[i] += (p[i] >= pos) ? 1 : 0;
+  const sorted_vector_indexed &self = *this;
+  const T *d = self.data();
+  Index proj;
+  p.insert(
+    std::lower_bound(
+      p.begin(),
+      p.end(),
+      (uint32_t)pos,
+      [&](uint32_t a, uint32_t b) {
+        return  (proj(d[a]) < proj(d[b]))
+              ||(  (!(proj(d[b]) < proj(d[a])))
+                 &&(a < b));
+      }),
+    (uint32_t)pos);
+}
+
+template <class T, class Base, class... Indexes>
+  void sorted_vector_indexed <T, Base, Indexes...>::  erase_entries(
+    size_t first,
+    size_t last)
+{
+  //Один проход по каждой перестановке: удалённые
+  //позиции исключаются, следующие за ними сдвигаются
+  uint32_t count = (uint32_t)(last - first);
+  for (size_t i = 0; i < sizeof...(Indexes); i++) {
+    std::vector <uint32_t> &p = _model.value().permutations[i];
+    size_t w = 0;
+    for (size_t r = 0; r < p.size(); r++) {
+      if (  (p[r] >= first)
+          &&(p[r] < last))
+        continue;
+      p[w++] = (p[r] >= last) ? p[r] - count : p[r];
+    }
+    p.resize(w);
+  }
 }
 
+//***Unique sets and maps***
+
 template <class T>
-  void sorted_vector <T>::  merge(
-    std::vector <T> &&v)
+  class sorted_set : protected sorted_vector <T>
 {
-  _storage.reserve(v.size() + size());
+  typedef sorted_vector <T> base;
 
-  _storage.insert(
-    _storage.end(),
-    std::make_move_iterator(v.begin()),
-    std::make_move_iterator(v.end()));
+  public:
+    typedef sorted_vector_const_iterator <T> const_iterator;
 
-  _last_modified = (size_t)-1;
-  _is_corrupted = true;
-  repair();
-}
+    sorted_set();
+    sorted_set(std::initializer_list <T> ilist);
+    sorted_set(const std::vector <T> &v);
+    sorted_set(std::vector <T> &&v);
+
+    std::pair <size_t, bool> insert(const T &t);
+    std::pair <size_t, bool> insert(T &&t);
+
+    template <class InputIt>
+      size_t insert(InputIt first, InputIt last);
+
+    template <class Range>
+      size_t insert_range(Range &&range);
+
+    template <class... Args>
+      std::pair <size_t, bool> emplace(Args &&... args);
+
+    std::pair <size_t, bool> insert_or_assign(const T &t);
+    std::pair <size_t, bool> insert_or_assign(T &&t);
+
+    size_t erase(const T &t);
+
+    bool contains(const T &t)                     const;
+    size_t find(const T &t)                       const;
+
+    const T &operator[](size_t pos)               const;
+    const T &at(size_t pos)                       const;
+    const T &front()                              const;
+    const T &back()                               const;
+
+    const_iterator begin()                        const;
+    const_iterator end()                          const;
+    const_iterator cbegin()                       const;
+    const_iterator cend()                         const;
+
+    const std::vector <T> &storage()              const;
+
+    using base::empty;
+    using base::size;
+    using base::reserve;
+    using base::capacity;
+    using base::shrink_to_fit;
+    using base::clear;
+    using base::find_floor;
+    using base::find_ceil;
+    using base::rank;
+    using base::range;
+    using base::count_range;
+    using base::erase_range;
+    using base::erase_if;
+    using base::erase_keys;
+    using base::erase_positions;
+
+  private:
+    void unique();
+
+    template <class Range>
+      size_t insert_range(Range &range, std::false_type);
+
+    template <class Range>
+      size_t insert_range(Range &range, std::true_type);
+
+    size_t insert_batch(std::vector <T> &batch);
+};
 
 template <class T>
-  void sorted_vector <T>::  merge_replace(
-    const sorted_vector <T> &sv)
+  sorted_set <T>::  sorted_set()
 {
-  _storage.reserve(sv.size() + size());
-  for (size_t i = 0; i < sv.size(); i++)
-    replace(sv[i]);
+  //Начало хранилища не смещается: storage
+  //возвращает вектор элементов
+  this->_storage.set_packed(true);
 }
 
 template <class T>
-  void sorted_vector <T>::  merge_replace(
-    sorted_vector <T> &&sv)
+  sorted_set <T>::  sorted_set(
+    std::initializer_list <T> ilist)
+  : base(ilist)
 {
-  _storage.reserve(sv.size() + size());
-  for (size_t i = 0; i < sv.size(); i++)
-    replace(static_cast <T &&> (sv[i]));
+  this->_storage.set_packed(true);
+  unique();
 }
 
 template <class T>
-  void sorted_vector <T>::  merge_replace(
+  sorted_set <T>::  sorted_set(
     const std::vector <T> &v)
+  : base(v)
 {
-  _storage.reserve(v.size() + size());
-  for (size_t i = 0; i < v.size(); i++)
-    replace(v[i]);
+  this->_storage.set_packed(true);
+  unique();
 }
 
 template <class T>
-  void sorted_vector <T>::  merge_replace(
+  sorted_set <T>::  sorted_set(
     std::vector <T> &&v)
+  : base(static_cast <std::vector <T> &&> (v))
 {
-  _storage.reserve(v.size() + size());
-  for (size_t i = 0; i < v.size(); i++)
-    replace(static_cast <T &&> (v[i]));
+  this->_storage.set_packed(true);
+  unique();
 }
 
 template <class T>
-  bool sorted_vector <T>:: corrupted()
-  const
+  std::pair <size_t, bool> sorted_set <T>::  insert(
+    const T &t)
 {
-  return _is_corrupted;
+  size_t pos = this->rank(t);
+  if (  (pos < this->_storage.size())
+      &&(!(t < this->_storage[pos])))
+    return std::make_pair(pos, false);
+  this->emplace_hint(pos, t);
+  return std::make_pair(pos, true);
 }
 
 template <class T>
-  std::vector <T> &sorted_vector <T>::  storage()
+  std::pair <size_t, bool> sorted_set <T>::  insert(
+    T &&t)
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-#ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-#endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  }
-  _is_corrupted = true;
-  _last_modified = -1;
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  return _storage;
+  size_t pos = this->rank(t);
+  if (  (pos < this->_storage.size())
+      &&(!(t < this->_storage[pos])))
+    return std::make_pair(pos, false);
+  this->emplace_hint(pos, static_cast <T &&> (t));
+  return std::make_pair(pos, true);
 }
 
 template <class T>
-  const std::vector <T> &sorted_vector <T>::  cstorage()
+  template <class InputIt>
+  size_t sorted_set <T>::  insert(
+    InputIt first,
+    InputIt last)
 {
-  return _storage;
+  std::vector <T> batch(first, last);
+  return insert_batch(batch);
 }
 
 template <class T>
-  T *sorted_vector <T>::  data()
+  template <class Range>
+  size_t sorted_set <T>::  insert_range(
+    Range &&range)
 {
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  if (_is_corrupted) {
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-    if (!_flag_suspend_autorepair)
-      repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
-  }
-  _is_corrupted = true;
-  _last_modified = -1;
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  return _storage.data();
+  return insert_range(
+    range,
+    std::integral_constant <bool, !std::is_lvalue_reference <Range>::value> ());
 }
 
 template <class T>
-  const T *sorted_vector <T>::  data()
-  const
+  template <class... Args>
+  std::pair <size_t, bool> sorted_set <T>::  emplace(
+    Args &&... args)
 {
-  return _storage.data();
+  //Элемент нужен для поиска до вставки; если он
+  //уже есть, временный объект просто уничтожается
+  return insert(T(static_cast <Args &&> (args)...));
 }
 
 template <class T>
-  void sorted_vector <T>::  suspend_autorepair()
+  std::pair <size_t, bool> sorted_set <T>::  insert_or_assign(
+    const T &t)
 {
-  _flag_suspend_autorepair = true;
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-  _last_modified = -1;
-  _is_corrupted = true;
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  size_t pos = this->rank(t);
+  if (  (pos < this->_storage.size())
+      &&(!(t < this->_storage[pos]))) {
+    this->_storage[pos] = t;
+    this->on_change(pos);
+    return std::make_pair(pos, false);
+  }
+  this->emplace_hint(pos, t);
+  return std::make_pair(pos, true);
 }
 
 template <class T>
-  void sorted_vector <T>::  resume_autorepair()
+  std::pair <size_t, bool> sorted_set <T>::  insert_or_assign(
+    T &&t)
 {
-  _flag_suspend_autorepair = false;
-#ifndef CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
-# ifdef CIM_SORTED_VECTOR_AUTOREPAIR
-  repair();
-# endif // CIM_SORTED_VECTOR_AUTOREPAIR
-#endif // CIM_SORTED_VECTOR_IGNORE_POSSIBLY_CORRUPTED
+  size_t pos = this->rank(t);
+  if (  (pos < this->_storage.size())
+      &&(!(t < this->_storage[pos]))) {
+    this->_storage[pos] = static_cast <T &&> (t);
+    this->on_change(pos);
+    return std::make_pair(pos, false);
+  }
+  this->emplace_hint(pos, static_cast <T &&> (t));
+  return std::make_pair(pos, true);
 }
 
-//***protected methods***
-
 template <class T>
-  void sorted_vector <T>::  single_shift_left(
-    size_t start_pos,
-    size_t end_pos)
+  size_t sorted_set <T>::  erase(
+    const T &t)
 {
-  if (start_pos == end_pos)
-    return;
-
-  if (end_pos == (size_t)-1)
-    end_pos = size() - 1;
-
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-  T t = static_cast <T &&> (_storage[start_pos]);
-  _storage.erase(_storage.begin() + start_pos);
-
-  _storage.insert(
-    _storage.begin() + end_pos,
-    static_cast <T &&> (t));
-
-#endif // !CIM_SORTED_VECTOR_USE_MEMMOVE
-
-#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
-
-  memmove(
-    reinterpret_cast <void *> (&_storage[start_pos]),
-    reinterpret_cast <void *> (&_storage[start_pos + 1]),
-    sizeof(T) * (end_pos - start_pos));
-
-#endif // CIM_SORTED_VECTOR_USE_MEMMOVE
+  size_t pos = find(t);
+  if (pos == (size_t)-1)
+    return 0;
+  base::erase(pos);
+  return 1;
 }
 
 template <class T>
-  void sorted_vector <T>::  single_shift_right(
-    size_t start_pos,
-    size_t end_pos)
+  bool sorted_set <T>::  contains(
+    const T &t)
+    const
 {
-  if (start_pos == end_pos)
-    return;
-
-  if (end_pos == (size_t)-1)
-    end_pos = size() - 1;
-#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
-  T t = static_cast <T &&> (_storage[end_pos]);
-  _storage.erase(_storage.begin() + end_pos);
-
-  _storage.insert(
-    _storage.begin() + start_pos,
-    static_cast <T &&> (t));
-#endif // !CIM_SORTED_VECTOR_USE_MEMMOVE
-#ifdef CIM_SORTED_VECTOR_USE_MEMMOVE
-  memmove(
-    reinterpret_cast <void *> (&_storage[start_pos + 1]),
-    reinterpret_cast <void *> (&_storage[start_pos]),
-    sizeof(T) * (end_pos - start_pos));
-#endif // !CIM_SORTED_VECTOR_USE_MEMMOVE
+  return base::find(t) != (size_t)-1;
 }
 
-//***end sorted_vector***
-
-//***Iterators***
-
 template <class T>
-  class sorted_vector_iterator : public std::iterator<std::input_iterator_tag, T>
+  size_t sorted_set <T>::  find(
+    const T &t)
+    const
 {
-  friend sorted_vector <T>;
-
-  typedef T & reference;
-
-  sorted_vector_iterator(size_t pos, sorted_vector <T> *owner);
-
-  public:
-    sorted_vector_iterator(const sorted_vector_iterator &it);
-
-    bool operator!=(const sorted_vector_iterator &it) const;
-    bool operator==(const sorted_vector_iterator &it) const;
-
-    typename sorted_vector_iterator::reference operator*() const;
-
-    sorted_vector_iterator &operator++();
-
-    sorted_vector_iterator operator+(size_t inc) const;
-    sorted_vector_iterator operator-(size_t dec) const;
-
-    size_t pos() const;
+  return base::find(t);
+}
 
-  private:
-    size_t _pos = (size_t)-1;
-    sorted_vector <T> *_owner = nullptr;
-};
+template <class T>
+  const T &sorted_set <T>::  operator[](
+    size_t pos)
+    const
+{
+  return this->_storage[pos];
+}
 
 template <class T>
-  sorted_vector_iterator <T>::  sorted_vector_iterator(
-    size_t pos,
-    sorted_vector <T> *owner)
-    : _pos(pos), _owner(owner)
-{}
+  const T &sorted_set <T>::  at(
+    size_t pos)
+    const
+{
+  return base::at(pos);
+}
 
 template <class T>
-  sorted_vector_iterator <T>::  sorted_vector_iterator(
-    const sorted_vector_iterator &it)
-    : _pos(it._pos), _owner(it._owner)
-{}
-
+  const T &sorted_set <T>::  front()
+  const
+{
+  return this->_storage.front();
+}
 
 template <class T>
-  bool sorted_vector_iterator <T>:: operator!=(
-    const sorted_vector_iterator &it)
-    const
+  const T &sorted_set <T>::  back()
+  const
 {
-  return (  (_owner != it._owner)
-          ||(_pos != it._pos));
+  return this->_storage.back();
 }
 
 template <class T>
-  bool sorted_vector_iterator <T>:: operator==(
-    const sorted_vector_iterator &it)
-    const
+  typename sorted_set <T>::const_iterator sorted_set <T>::  begin()
+  const
 {
-  return (  (_owner == it._owner)
-          &&(_pos == it._pos));
+  return base::cbegin();
 }
 
 template <class T>
-  typename sorted_vector_iterator <T>::reference
-  sorted_vector_iterator <T>:: operator*()
+  typename sorted_set <T>::const_iterator sorted_set <T>::  end()
   const
 {
-  return _owner->operator[](_pos);
+  return base::cend();
 }
 
 template <class T>
-  sorted_vector_iterator <T> &sorted_vector_iterator <T>::  operator++()
+  typename sorted_set <T>::const_iterator sorted_set <T>::  cbegin()
+  const
 {
-  _pos++;
-  return *this;
+  return base::cbegin();
 }
 
 template <class T>
-  sorted_vector_iterator <T> sorted_vector_iterator <T>:: operator+(
-  size_t inc)
+  typename sorted_set <T>::const_iterator sorted_set <T>::  cend()
   const
 {
-  return sorted_vector_iterator(_pos + inc, _owner);
+  return base::cend();
 }
 
 template <class T>
-  sorted_vector_iterator <T> sorted_vector_iterator <T>:: operator-(
-  size_t dec)
+  const std::vector <T> &sorted_set <T>::  storage()
   const
 {
-  return sorted_vector_iterator(_pos - dec, _owner);
+  return this->_storage.cvector();
 }
 
+//***private methods***
+
 template <class T>
-  size_t sorted_vector_iterator <T>:: pos()
-    const
+  void sorted_set <T>::  unique()
 {
-  return _pos;
+  //compact вызывает предикат до переноса участка,
+  //в котором лежат i - 1 и i, поэтому сравнение
+  //соседей выполняется по исходным элементам
+  const sorted_vector_buffer <T> &s = this->_storage;
+  this->compact(
+    1,
+    [&](size_t i) { return !(s[i - 1] < s[i]); });
 }
 
 template <class T>
-  class sorted_vector_const_iterator : public std::iterator<std::input_iterator_tag, T>
+  template <class Range>
+  size_t sorted_set <T>::  insert_range(
+    Range &range,
+    std::false_type)
 {
-  friend sorted_vector <T>;
+  using std::begin;
+  using std::end;
+  return insert(begin(range), end(range));
+}
 
-  typedef const T & const_reference;
+template <class T>
+  template <class Range>
+  size_t sorted_set <T>::  insert_range(
+    Range &range,
+    std::true_type)
+{
+  using std::begin;
+  using std::end;
+  return insert(
+    std::make_move_iterator(begin(range)),
+    std::make_move_iterator(end(range)));
+}
 
-  sorted_vector_const_iterator(size_t pos, const sorted_vector <T> *owner);
+template <class T>
+  size_t sorted_set <T>::  insert_batch(
+    std::vector <T> &batch)
+{
+  //Из упорядоченного пакета исключаются повторы и
+  //уже имеющиеся элементы; остаток сливается с
+  //хранилищем так же, как в push_batch
+  base::sort_batch(batch);
+  const sorted_vector_buffer <T> &s = this->_storage;
+  size_t kept = 0;
+  size_t from = 0;
+  for (size_t j = 0; j < batch.size(); j++) {
+    if (  (kept > 0)
+        &&(!(batch[kept - 1] < batch[j])))
+      continue;
+    from = std::lower_bound(s.begin() + from, s.end(), batch[j]) - s.begin();
+    if (  (from < s.size())
+        &&(!(batch[j] < s[from])))
+      continue;
+    if (kept != j)
+      batch[kept] = static_cast <T &&> (batch[j]);
+    kept++;
+  }
+  if (kept == 0)
+    return 0;
+  batch.erase(batch.begin() + kept, batch.end());
+
+  size_t capacity = this->_storage.cvector().capacity();
+  this->_storage.reserve(this->_storage.size() + kept);
+  this->count_reallocation(capacity);
+  size_t shifted = base::merge_backward(
+    this->_storage.vector(),
+    batch,
+    [&](size_t j, size_t i) { return batch[j] < s[i]; });
+  CIM_SORTED_VECTOR_COUNT(moved, shifted);
+  (void)shifted;
+  this->on_reset();
+  return kept;
+}
+
+template <class K, class V>
+  class sorted_map : protected sorted_vector <K>
+{
+  typedef sorted_vector <K> base;
 
   public:
-    sorted_vector_const_iterator(const sorted_vector_const_iterator &it);
+    typedef K key_type;
+    typedef V mapped_type;
 
-    bool operator!=(const sorted_vector_const_iterator &it) const;
-    bool operator==(const sorted_vector_const_iterator &it) const;
+    sorted_map();
+    sorted_map(std::initializer_list <std::pair <K, V> > ilist);
 
-    typename sorted_vector_const_iterator::const_reference operator*() const;
+    std::pair <size_t, bool> insert(const std::pair <K, V> &kv);
+    std::pair <size_t, bool> insert(std::pair <K, V> &&kv);
 
-    sorted_vector_const_iterator &operator++();
+    template <class InputIt>
+      size_t insert(InputIt first, InputIt last);
 
-    sorted_vector_const_iterator operator+(size_t inc) const;
-    sorted_vector_const_iterator operator-(size_t dec) const;
+    template <class Range>
+      size_t insert_range(Range &&range);
 
-    size_t pos() const;
+    template <class... Args>
+      std::pair <size_t, bool> try_emplace(const K &k, Args &&... args);
+    template <class... Args>
+      std::pair <size_t, bool> try_emplace(K &&k, Args &&... args);
+
+    template <class M>
+      std::pair <size_t, bool> insert_or_assign(const K &k, M &&v);
+    template <class M>
+      std::pair <size_t, bool> insert_or_assign(K &&k, M &&v);
+
+    V &operator[](const K &k);
+    V &operator[](K &&k);
+
+    V       &at(const K &k);
+    const V &at(const K &k)                       const;
+
+    size_t erase(const K &k);
+    void clear();
+    void reserve(size_t n);
+
+    bool contains(const K &k)                     const;
+    size_t find(const K &k)                       const;
+
+    const K &key(size_t pos)                      const;
+    V       &value(size_t pos);
+    const V &value(size_t pos)                    const;
+
+    const std::vector <K> &keys()                 const;
+    const std::vector <V> &values()               const;
+
+    using base::empty;
+    using base::size;
+    using base::find_floor;
+    using base::find_ceil;
+    using base::rank;
+    using base::count_range;
 
   private:
-    size_t _pos = (size_t)-1;
-    const sorted_vector <T> *_owner = nullptr;
+    template <class KK, class... Args>
+      std::pair <size_t, bool> emplace_key(KK &&k, Args &&... args);
+
+    template <class KK, class M>
+      std::pair <size_t, bool> assign_key(KK &&k, M &&v);
+
+    template <class Range>
+      size_t insert_range(Range &range, std::false_type);
+
+    template <class Range>
+      size_t insert_range(Range &range, std::true_type);
+
+    size_t insert_batch(std::vector <std::pair <K, V> > &batch);
+
+    //Значения в порядке ключей хранилища
+    //sorted_vector <K>
+    std::vector <V> _values;
 };
 
+template <class K, class V>
+  sorted_map <K, V>::  sorted_map()
+{
+  //Начало хранилища ключей не смещается: keys
+  //возвращает вектор ключей
+  this->_storage.set_packed(true);
+}
 
-template <class T>
-  sorted_vector_const_iterator <T>::  sorted_vector_const_iterator(
-    size_t pos,
-    const sorted_vector <T> *owner)
-    : _pos(pos), _owner(owner)
-{}
+template <class K, class V>
+  sorted_map <K, V>::  sorted_map(
+    std::initializer_list <std::pair <K, V> > ilist)
+{
+  this->_storage.set_packed(true);
+  insert(ilist.begin(), ilist.end());
+}
 
-template <class T>
-  sorted_vector_const_iterator <T>::  sorted_vector_const_iterator(
-    const sorted_vector_const_iterator &it)
-    : _pos(it._pos), _owner(it._owner)
-{}
+template <class K, class V>
+  std::pair <size_t, bool> sorted_map <K, V>::  insert(
+    const std::pair <K, V> &kv)
+{
+  return emplace_key(kv.first, kv.second);
+}
 
+template <class K, class V>
+  std::pair <size_t, bool> sorted_map <K, V>::  insert(
+    std::pair <K, V> &&kv)
+{
+  return emplace_key(
+    static_cast <K &&> (kv.first),
+    static_cast <V &&> (kv.second));
+}
 
-template <class T>
-  bool sorted_vector_const_iterator <T>:: operator!=(
-    const sorted_vector_const_iterator &it)
-    const
+template <class K, class V>
+  template <class InputIt>
+  size_t sorted_map <K, V>::  insert(
+    InputIt first,
+    InputIt last)
 {
-  return (  (_owner != it._owner)
-          ||(_pos != it._pos));
+  std::vector <std::pair <K, V> > batch(first, last);
+  return insert_batch(batch);
 }
 
-template <class T>
-  bool sorted_vector_const_iterator <T>:: operator==(
-    const sorted_vector_const_iterator &it)
+template <class K, class V>
+  template <class Range>
+  size_t sorted_map <K, V>::  insert_range(
+    Range &&range)
+{
+  return insert_range(
+    range,
+    std::integral_constant <bool, !std::is_lvalue_reference <Range>::value> ());
+}
+
+template <class K, class V>
+  template <class... Args>
+  std::pair <size_t, bool> sorted_map <K, V>::  try_emplace(
+    const K &k,
+    Args &&... args)
+{
+  return emplace_key(k, static_cast <Args &&> (args)...);
+}
+
+template <class K, class V>
+  template <class... Args>
+  std::pair <size_t, bool> sorted_map <K, V>::  try_emplace(
+    K &&k,
+    Args &&... args)
+{
+  return emplace_key(static_cast <K &&> (k), static_cast <Args &&> (args)...);
+}
+
+template <class K, class V>
+  template <class M>
+  std::pair <size_t, bool> sorted_map <K, V>::  insert_or_assign(
+    const K &k,
+    M &&v)
+{
+  return assign_key(k, static_cast <M &&> (v));
+}
+
+template <class K, class V>
+  template <class M>
+  std::pair <size_t, bool> sorted_map <K, V>::  insert_or_assign(
+    K &&k,
+    M &&v)
+{
+  return assign_key(static_cast <K &&> (k), static_cast <M &&> (v));
+}
+
+template <class K, class V>
+  V &sorted_map <K, V>::  operator[](
+    const K &k)
+{
+  return _values[emplace_key(k).first];
+}
+
+template <class K, class V>
+  V &sorted_map <K, V>::  operator[](
+    K &&k)
+{
+  return _values[emplace_key(static_cast <K &&> (k)).first];
+}
+
+template <class K, class V>
+  V &sorted_map <K, V>::  at(
+    const K &k)
+{
+  size_t pos = find(k);
+  if (pos == (size_t)-1)
+    throw std::out_of_range("sorted_map::at");
+  return _values[pos];
+}
+
+template <class K, class V>
+  const V &sorted_map <K, V>::  at(
+    const K &k)
     const
 {
-  return (  (_owner == it._owner)
-          &&(_pos == it._pos));
+  size_t pos = find(k);
+  if (pos == (size_t)-1)
+    throw std::out_of_range("sorted_map::at");
+  return _values[pos];
 }
 
-template <class T>
-  typename sorted_vector_const_iterator <T>::const_reference
-  sorted_vector_const_iterator <T>:: operator*()
-  const
+template <class K, class V>
+  size_t sorted_map <K, V>::  erase(
+    const K &k)
 {
-  return _owner->operator[](_pos);
+  size_t pos = find(k);
+  if (pos == (size_t)-1)
+    return 0;
+  _values.erase(_values.begin() + pos);
+  base::erase(pos);
+  return 1;
 }
 
-template <class T>
-  sorted_vector_const_iterator <T> &sorted_vector_const_iterator <T>::  operator++()
+template <class K, class V>
+  void sorted_map <K, V>::  clear()
 {
-  _pos++;
-  return *this;
+  _values.clear();
+  base::clear();
 }
 
-template <class T>
-  sorted_vector_const_iterator <T> sorted_vector_const_iterator <T>:: operator+(
-    size_t inc)
+template <class K, class V>
+  void sorted_map <K, V>::  reserve(
+    size_t n)
+{
+  _values.reserve(n);
+  base::reserve(n);
+}
+
+template <class K, class V>
+  bool sorted_map <K, V>::  contains(
+    const K &k)
     const
 {
-  return sorted_vector_const_iterator(_pos + inc, _owner);
+  return base::find(k) != (size_t)-1;
 }
 
-template <class T>
-  sorted_vector_const_iterator <T> sorted_vector_const_iterator <T>:: operator-(
-    size_t dec)
+template <class K, class V>
+  size_t sorted_map <K, V>::  find(
+    const K &k)
     const
 {
-  return sorted_vector_const_iterator(_pos - dec, _owner);
+  return base::find(k);
 }
 
-template <class T>
-  size_t sorted_vector_const_iterator <T>:: pos()
+template <class K, class V>
+  const K &sorted_map <K, V>::  key(
+    size_t pos)
     const
 {
-  return _pos;
+  return this->_storage[pos];
 }
 
-#define CIM_KEYNAME _key
-  //Макрос определяет название поля в классе,
-  //хранимом sorted_vector_with_key, по
-  //которому происходит сравнение для поиска
-  //без вызова конструктора хранимого класса.
-  // !Должно совпадать с полем, по которому !
-  // !происходит сортировка!                !
+template <class K, class V>
+  V &sorted_map <K, V>::  value(
+    size_t pos)
+{
+  return _values[pos];
+}
 
-template <class T, class Key>
-  class sorted_vector_with_key : public sorted_vector <T>
+template <class K, class V>
+  const V &sorted_map <K, V>::  value(
+    size_t pos)
+    const
 {
-  public:
-    size_t find(const Key &key, size_t start_pos = 0, size_t end_pos = -1)        const;
-    size_t find_linear(const Key &key, size_t start_pos = 0, size_t end_pos = -1) const;
+  return _values[pos];
+}
 
-    using sorted_vector <T>::find;
-    using sorted_vector <T>::find_linear;
-};
+template <class K, class V>
+  const std::vector <K> &sorted_map <K, V>::  keys()
+  const
+{
+  return this->_storage.cvector();
+}
 
-template <class T, class Key>
-  size_t sorted_vector_with_key <T, Key>:: find(
-    const Key &key,
-    size_t start_pos,
-    size_t end_pos)
-    const
+template <class K, class V>
+  const std::vector <V> &sorted_map <K, V>::  values()
+  const
 {
-  if (this->size() == 0)
-    return -1;
-  if (!this->corrupted()) {
-    size_t f = start_pos;
-    size_t l = (end_pos == (size_t)-1) ? this->size() - 1 : end_pos;
-    size_t m = (f + l) / 2;
-    while (f <= l) {
-      if (this->operator[](m).CIM_KEYNAME == key)
-        return m;
-      else if (this->operator[](f).CIM_KEYNAME == key)
-        return f;
-      else if (this->operator[](l).CIM_KEYNAME == key)
-        return l;
-      else {
-        if (this->operator[](m).CIM_KEYNAME < key) {
-          f = m + 1;
-        } else {
-          {
-            if (m == 0)
-              return -1;
-            l = m - 1;
-          }
-        }
-        m = (l + f) / 2;
-      }
-    }
-    return -1;
-  } else {
-    return find_linear(key, start_pos, end_pos);
-  }
+  return _values;
 }
 
-template <class T, class Key>
-  size_t sorted_vector_with_key <T, Key>:: find_linear(
-    const Key &key,
-    size_t start_pos,
-    size_t end_pos)
-    const
+//***private methods***
+
+template <class K, class V>
+  template <class KK, class... Args>
+  std::pair <size_t, bool> sorted_map <K, V>::  emplace_key(
+    KK &&k,
+    Args &&... args)
 {
-  if (this->size() == 0)
-    return (size_t)-1;
+  size_t pos = this->rank(k);
+  if (  (pos < this->_storage.size())
+      &&(!(k < this->_storage[pos])))
+    return std::make_pair(pos, false);
+  //Ключ вставляется первым и удаляется, если
+  //конструирование значения бросит исключение:
+  //ключи и _values остаются одной длины
+  this->emplace_hint(pos, static_cast <KK &&> (k));
+  try {
+    _values.emplace(_values.begin() + pos, static_cast <Args &&> (args)...);
+  } catch (...) {
+    base::erase(pos);
+    throw;
+  }
+  return std::make_pair(pos, true);
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = this->size() - 1;
+template <class K, class V>
+  template <class KK, class M>
+  std::pair <size_t, bool> sorted_map <K, V>::  assign_key(
+    KK &&k,
+    M &&v)
+{
+  size_t pos = this->rank(k);
+  if (  (pos < this->_storage.size())
+      &&(!(k < this->_storage[pos]))) {
+    _values[pos] = static_cast <M &&> (v);
+    return std::make_pair(pos, false);
+  }
+  this->emplace_hint(pos, static_cast <KK &&> (k));
+  try {
+    _values.emplace(_values.begin() + pos, static_cast <M &&> (v));
+  } catch (...) {
+    base::erase(pos);
+    throw;
+  }
+  return std::make_pair(pos, true);
+}
 
-  if (start_pos > end_pos)
-    return (size_t)-1;
+template <class K, class V>
+  template <class Range>
+  size_t sorted_map <K, V>::  insert_range(
+    Range &range,
+    std::false_type)
+{
+  using std::begin;
+  using std::end;
+  return insert(begin(range), end(range));
+}
 
-  if (end_pos == (size_t)-1)
-    end_pos = this->size() - 1;
+template <class K, class V>
+  template <class Range>
+  size_t sorted_map <K, V>::  insert_range(
+    Range &range,
+    std::true_type)
+{
+  using std::begin;
+  using std::end;
+  return insert(
+    std::make_move_iterator(begin(range)),
+    std::make_move_iterator(end(range)));
+}
 
-  while (start_pos != end_pos)
-  {
-    if (this->operator[](start_pos++).CIM_KEYNAME == key)
-      return start_pos - 1;
+template <class K, class V>
+  size_t sorted_map <K, V>::  insert_batch(
+    std::vector <std::pair <K, V> > &batch)
+{
+  //Из пакета, устойчиво упорядоченного по ключам,
+  //остаются первые вхождения отсутствующих ключей.
+  //Память под ключи и значения резервируется до
+  //слияния; значения сливаются первыми, пока ключи
+  //хранилища ещё на прежних местах
+  std::stable_sort(
+    batch.begin(),
+    batch.end(),
+    [](const std::pair <K, V> &a, const std::pair <K, V> &b) { return a.first < b.first; });
+  const sorted_vector_buffer <K> &s = this->_storage;
+  std::vector <K> batch_keys;
+  std::vector <V> batch_values;
+  size_t from = 0;
+  for (size_t j = 0; j < batch.size(); j++) {
+    if (  (!batch_keys.empty())
+        &&(!(batch_keys.back() < batch[j].first)))
+      continue;
+    from = std::lower_bound(s.begin() + from, s.end(), batch[j].first) - s.begin();
+    if (  (from < s.size())
+        &&(!(batch[j].first < s[from])))
+      continue;
+    batch_keys.push_back(static_cast <K &&> (batch[j].first));
+    batch_values.push_back(static_cast <V &&> (batch[j].second));
   }
-  return (size_t)-1;
+  size_t k = batch_keys.size();
+  if (k == 0)
+    return 0;
+
+  auto before = [&](size_t j, size_t i) { return batch_keys[j] < s[i]; };
+  size_t capacity = this->_storage.cvector().capacity();
+  this->_storage.reserve(this->_storage.size() + k);
+  this->count_reallocation(capacity);
+  _values.reserve(_values.size() + k);
+  base::merge_backward(_values, batch_values, before);
+
+  size_t shifted = base::merge_backward(this->_storage.vector(), batch_keys, before);
+  CIM_SORTED_VECTOR_COUNT(moved, shifted);
+  (void)shifted;
+  this->on_reset();
+  return k;
 }
 
 }
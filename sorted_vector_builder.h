@@ -0,0 +1,958 @@
+/*
+ * Шаблонный класс cim::sorted_vector_builder - построение упорядоченного
+ * массива, не помещающегося в оперативную память (внешняя сортировка)
+ *
+ * Построитель принимает поток элементов (push, read) и хранит в памяти не
+ * более memory_limit байт. Заполненный буфер (половина лимита)
+ * сортируется и сбрасывается во временный файл - серию, - пока в
+ * фоновом потоке, а вызывающий продолжает заполнять вторую половину
+ * (двойная буферизация). При threads > 1 буфер делится на threads частей,
+ * которые сортируются параллельно и сливаются при записи в одну серию.
+ *
+ * build выполняет k-путевое слияние серий:
+ *
+ *   build(sorted_vector) - в экземпляр sorted_vector (результат должен
+ *   помещаться в память; передаётся через assign_sorted без сортировки);
+ *   build(path) - в файл формата save_sorted_vector (mapped_sorted_vector.h)
+ *   с поисковым индексом, не удерживая результат в памяти.
+ *
+ * Если серий больше, чем позволяет лимит памяти при блоке чтения не
+ * меньше CIM_SORTED_VECTOR_BUILDER_BLOCK байт, слияние выполняется в
+ * несколько проходов. Чтение серий и запись результата идут блоками с
+ * упреждением: следующий блок читается (записывается) асинхронно, пока
+ * обрабатывается текущий. Операции с блоками выполняет общий для
+ * построителя пул из CIM_SORTED_VECTOR_BUILDER_IO_THREADS потоков, так что
+ * число потоков не растёт с числом серий. Если все элементы поместились
+ * в один буфер, временные файлы не создаются.
+ *
+ * Временные файлы создаются в temp_dir (по умолчанию $TMPDIR или /tmp) и
+ * удаляются из каталога сразу после создания. Тип элемента должен быть
+ * тривиально копируемым. Требуется POSIX и поддержка потоков (-pthread).
+ * Методы возвращают false при ошибке ввода-вывода; после ошибки
+ * построитель остаётся в состоянии ошибки до clear. После build
+ * построитель пуст и готов к повторному использованию.
+ *
+ * sorted_vector_builder_with_key дополнительно записывает в файл теневой
+ * массив ключей для mapped_sorted_vector_with_key.
+ *
+ */
+
+#ifndef CIM_SORTED_VECTOR_BUILDER_H
+#define CIM_SORTED_VECTOR_BUILDER_H
+
+#include "mapped_sorted_vector.h"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace cim{
+
+//Лимит памяти построителя по умолчанию, байт
+#ifndef CIM_SORTED_VECTOR_BUILDER_MEMORY
+#define CIM_SORTED_VECTOR_BUILDER_MEMORY  ((size_t)256 << 20)
+#endif
+
+//Минимальный размер блока чтения серии при слиянии, байт. Определяет
+//наибольшее число серий, сливаемых за один проход
+#ifndef CIM_SORTED_VECTOR_BUILDER_BLOCK
+#define CIM_SORTED_VECTOR_BUILDER_BLOCK   ((size_t)1 << 20)
+#endif
+
+//Число потоков, читающих и записывающих блоки серий
+#ifndef CIM_SORTED_VECTOR_BUILDER_IO_THREADS
+#define CIM_SORTED_VECTOR_BUILDER_IO_THREADS  4
+#endif
+
+//***I/O thread pool***
+
+class sorted_vector_io_pool
+{
+  public:
+    explicit sorted_vector_io_pool(unsigned threads = CIM_SORTED_VECTOR_BUILDER_IO_THREADS);
+    sorted_vector_io_pool(const sorted_vector_io_pool &pool) = delete;
+    ~sorted_vector_io_pool();
+
+    sorted_vector_io_pool &operator=(const sorted_vector_io_pool &pool) = delete;
+
+    std::future <bool> submit(std::function <bool()> task);
+
+  protected:
+    void work();
+
+  private:
+    std::mutex                                _mutex;
+    std::condition_variable                   _ready;
+    std::deque <std::packaged_task <bool()> > _tasks;
+    std::vector <std::thread>                 _workers;
+    bool                                      _stop = false;
+};
+
+inline sorted_vector_io_pool::  sorted_vector_io_pool(
+  unsigned threads)
+{
+  for (unsigned i = 0; i < std::max(1u, threads); i++)
+    _workers.push_back(std::thread([this] { work(); }));
+}
+
+inline sorted_vector_io_pool::  ~sorted_vector_io_pool()
+{
+  {
+    std::lock_guard <std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _ready.notify_all();
+  for (std::thread &w : _workers)
+    w.join();
+}
+
+inline std::future <bool> sorted_vector_io_pool::  submit(
+  std::function <bool()> task)
+{
+  std::packaged_task <bool()> t(task);
+  std::future <bool> result = t.get_future();
+  {
+    std::lock_guard <std::mutex> lock(_mutex);
+    _tasks.push_back(static_cast <std::packaged_task <bool()> &&> (t));
+  }
+  _ready.notify_one();
+  return result;
+}
+
+inline void sorted_vector_io_pool::  work()
+{
+  //задачи не ждут друг друга, поэтому очередь
+  //не может заблокироваться при любом числе потоков
+  for (;;) {
+    std::packaged_task <bool()> t;
+    {
+      std::unique_lock <std::mutex> lock(_mutex);
+      _ready.wait(lock, [this] { return (_stop) || (!_tasks.empty()); });
+      if (_tasks.empty())
+        return;
+      t = static_cast <std::packaged_task <bool()> &&> (_tasks.front());
+      _tasks.pop_front();
+    }
+    t();
+  }
+}
+
+//***Buffered file I/O***
+
+inline FILE *sorted_vector_temp_file(
+  const std::string &dir)
+{
+  std::string path = dir + "/cim_sorted_vector_XXXXXX";
+  std::vector <char> name(path.begin(), path.end());
+  name.push_back(0);
+
+  int fd = mkstemp(name.data());
+  if (fd < 0)
+    return nullptr;
+  unlink(name.data());
+
+  FILE *f = fdopen(fd, "w+b");
+  if (f == nullptr)
+    ::close(fd);
+  return f;
+}
+
+template <class T>
+  class sorted_vector_file_output
+{
+  public:
+    sorted_vector_file_output(FILE *f, size_t block, sorted_vector_io_pool &pool);
+    sorted_vector_file_output(const sorted_vector_file_output <T> &out) = delete;
+    ~sorted_vector_file_output();
+
+    bool push(const T &t);
+    bool finish();
+
+  protected:
+    bool flush();
+
+  private:
+    FILE                  *_file;
+    size_t                _block;
+    sorted_vector_io_pool &_pool;
+    std::vector <T>       _front;
+    std::vector <T>       _back;
+    std::future <bool>    _pending;
+    bool                  _ok = true;
+};
+
+template <class T>
+  sorted_vector_file_output <T>::  sorted_vector_file_output(
+    FILE *f,
+    size_t block,
+    sorted_vector_io_pool &pool)
+  : _file(f),
+    _block((block > 0) ? block : 1),
+    _pool(pool)
+{
+  _front.reserve(_block);
+  _back.reserve(_block);
+}
+
+template <class T>
+  sorted_vector_file_output <T>::  ~sorted_vector_file_output()
+{
+  if (_pending.valid())
+    _pending.wait();
+}
+
+template <class T>
+  bool sorted_vector_file_output <T>::  push(
+    const T &t)
+{
+  _front.push_back(t);
+  if (_front.size() == _block)
+    return flush();
+  return _ok;
+}
+
+template <class T>
+  bool sorted_vector_file_output <T>::  flush()
+{
+  if (_pending.valid())
+    _ok = (_pending.get()) && (_ok);
+  if (_front.empty())
+    return _ok;
+
+  //пока блок записывается, заполняется второй
+  _front.swap(_back);
+  _front.clear();
+  FILE *f = _file;
+  const std::vector <T> *b = &_back;
+  _pending = _pool.submit([f, b] {
+    return fwrite(b->data(), sizeof(T), b->size(), f) == b->size();
+  });
+  return _ok;
+}
+
+template <class T>
+  bool sorted_vector_file_output <T>::  finish()
+{
+  flush();
+  if (_pending.valid())
+    _ok = (_pending.get()) && (_ok);
+  return (_ok) && (fflush(_file) == 0);
+}
+
+template <class T>
+  class sorted_vector_file_input
+{
+  public:
+    sorted_vector_file_input(FILE *f, size_t block, sorted_vector_io_pool &pool);
+    sorted_vector_file_input(const sorted_vector_file_input <T> &in) = delete;
+    ~sorted_vector_file_input();
+
+    bool empty()        const;
+    const T &front()    const;
+    bool pop();
+
+  protected:
+    void fetch();
+    bool next();
+
+  private:
+    FILE                  *_file;
+    size_t                _block;
+    sorted_vector_io_pool &_pool;
+    std::vector <T>       _front;
+    std::vector <T>       _back;
+    size_t                _pos = 0;
+    std::future <bool>    _pending;
+    bool                  _ok = true;
+};
+
+template <class T>
+  sorted_vector_file_input <T>::  sorted_vector_file_input(
+    FILE *f,
+    size_t block,
+    sorted_vector_io_pool &pool)
+  : _file(f),
+    _block((block > 0) ? block : 1),
+    _pool(pool)
+{
+  rewind(_file);
+  _front.reserve(_block);
+  _back.reserve(_block);
+  fetch();
+  next();
+}
+
+template <class T>
+  sorted_vector_file_input <T>::  ~sorted_vector_file_input()
+{
+  if (_pending.valid())
+    _pending.wait();
+}
+
+template <class T>
+  bool sorted_vector_file_input <T>::  empty()
+    const
+{
+  return _pos == _front.size();
+}
+
+template <class T>
+  const T &sorted_vector_file_input <T>::  front()
+    const
+{
+  return _front[_pos];
+}
+
+template <class T>
+  bool sorted_vector_file_input <T>::  pop()
+{
+  if (++_pos == _front.size())
+    return next();
+  return _ok;
+}
+
+template <class T>
+  void sorted_vector_file_input <T>::  fetch()
+{
+  FILE *f = _file;
+  size_t block = _block;
+  std::vector <T> *b = &_back;
+  _pending = _pool.submit([f, block, b] {
+    b->resize(block);
+    b->resize(fread(b->data(), sizeof(T), block, f));
+    return ferror(f) == 0;
+  });
+}
+
+template <class T>
+  bool sorted_vector_file_input <T>::  next()
+{
+  _ok = (_pending.get()) && (_ok);
+  _front.swap(_back);
+  _pos = 0;
+  //следующий блок читается, пока обрабатывается текущий
+  if (!_front.empty())
+    fetch();
+  return _ok;
+}
+
+//Потоковая запись в формате save_sorted_vector: элементы записываются по
+//мере поступления, ключи - во временный файл, заголовок - последним
+template <class T, class K, class Proj>
+  class sorted_vector_file_stream
+{
+  public:
+    sorted_vector_file_stream(Proj proj, size_t block, const std::string &temp_dir, sorted_vector_io_pool &pool);
+    sorted_vector_file_stream(const sorted_vector_file_stream <T, K, Proj> &fs) = delete;
+    ~sorted_vector_file_stream();
+
+    bool open(const char *path, bool with_keys, size_t index_stride);
+    bool operator()(const T &t);
+    bool close();
+
+  private:
+    Proj          _proj;
+    size_t        _block;
+    std::string   _temp_dir;
+    sorted_vector_io_pool &_pool;
+    FILE          *_file      = nullptr;
+    FILE          *_key_file  = nullptr;
+    bool          _with_keys  = false;
+    size_t        _stride     = 0;
+    size_t        _count      = 0;
+    std::vector <K> _index;
+    std::unique_ptr <sorted_vector_file_output <T> > _data;
+    std::unique_ptr <sorted_vector_file_output <K> > _keys;
+};
+
+template <class T, class K, class Proj>
+  sorted_vector_file_stream <T, K, Proj>::  sorted_vector_file_stream(
+    Proj proj,
+    size_t block,
+    const std::string &temp_dir,
+    sorted_vector_io_pool &pool)
+  : _proj(proj),
+    _block(block),
+    _temp_dir(temp_dir),
+    _pool(pool)
+{}
+
+template <class T, class K, class Proj>
+  sorted_vector_file_stream <T, K, Proj>::  ~sorted_vector_file_stream()
+{
+  _data.reset();
+  _keys.reset();
+  if (_file != nullptr)
+    fclose(_file);
+  if (_key_file != nullptr)
+    fclose(_key_file);
+}
+
+template <class T, class K, class Proj>
+  bool sorted_vector_file_stream <T, K, Proj>::  open(
+    const char *path,
+    bool with_keys,
+    size_t index_stride)
+{
+  static_assert(
+    std::is_trivially_copyable <K>::value,
+    "sorted_vector file format requires trivially copyable keys");
+
+  _with_keys = with_keys;
+  _stride = sorted_vector_file_stride(index_stride, sizeof(T));
+  _file = fopen(path, "wb");
+  if (_file == nullptr)
+    return false;
+  if (_with_keys) {
+    _key_file = sorted_vector_temp_file(_temp_dir);
+    if (_key_file == nullptr)
+      return false;
+    _keys.reset(new sorted_vector_file_output <K> (_key_file, _block * sizeof(T) / sizeof(K), _pool));
+  }
+
+  //место под заголовок; сам заголовок записывается в close
+  sorted_vector_file_header h;
+  memset(&h, 0, sizeof(h));
+  if (  (fwrite(&h, sizeof(h), 1, _file) != 1)
+      ||(!sorted_vector_file_pad(_file, sizeof(h))))
+    return false;
+
+  _data.reset(new sorted_vector_file_output <T> (_file, _block, _pool));
+  return true;
+}
+
+template <class T, class K, class Proj>
+  bool sorted_vector_file_stream <T, K, Proj>::  operator()(
+    const T &t)
+{
+  if (_count++ % _stride == 0)
+    _index.push_back(_proj(t));
+  if (  (_with_keys)
+      &&(!_keys->push(_proj(t))))
+    return false;
+  return _data->push(t);
+}
+
+template <class T, class K, class Proj>
+  bool sorted_vector_file_stream <T, K, Proj>::  close()
+{
+  if (_data == nullptr)
+    return false;
+
+  sorted_vector_file_header h;
+  sorted_vector_file_init <T, K> (h, _count, true, _with_keys, _stride);
+
+  bool ok = (_data->finish())
+         && (sorted_vector_file_pad(_file, h.data_offset + _count * sizeof(T)));
+
+  if (  (ok)
+      &&(_with_keys)) {
+    ok = _keys->finish();
+    rewind(_key_file);
+    std::vector <K> buf(_block * sizeof(T) / sizeof(K) + 1);
+    size_t n;
+    while (  (ok)
+           &&((n = fread(buf.data(), sizeof(K), buf.size(), _key_file)) > 0))
+      ok = fwrite(buf.data(), sizeof(K), n, _file) == n;
+    ok = (ok)
+      && (ferror(_key_file) == 0)
+      && (sorted_vector_file_pad(_file, h.key_offset + _count * sizeof(K)));
+  }
+
+  if (  (ok)
+      &&(h.index_count))
+    ok = fwrite(_index.data(), sizeof(K), _index.size(), _file) == _index.size();
+
+  ok = (ok)
+    && (fseek(_file, 0, SEEK_SET) == 0)
+    && (fwrite(&h, sizeof(h), 1, _file) == 1);
+
+  _data.reset();
+  _keys.reset();
+  if (fclose(_file) != 0)
+    ok = false;
+  _file = nullptr;
+  return ok;
+}
+
+//***Builder***
+
+template <class T>
+  class sorted_vector_builder
+{
+  public:
+    explicit sorted_vector_builder(
+      size_t memory_limit = CIM_SORTED_VECTOR_BUILDER_MEMORY,
+      unsigned threads = 1,
+      const char *temp_dir = nullptr);
+    sorted_vector_builder(const sorted_vector_builder <T> &svb) = delete;
+
+    virtual ~sorted_vector_builder();
+
+    sorted_vector_builder <T> &operator=(const sorted_vector_builder <T> &svb) = delete;
+
+    bool push(const T &t);
+    bool push(const T *data, size_t count);
+    template <class InputIt>
+      bool push(InputIt first, InputIt last);
+    bool read(FILE *f);
+
+    size_t size() const;
+    size_t runs() const;
+
+    bool build(sorted_vector <T> &sv);
+    bool build(const char *path, size_t index_stride = 0);
+
+    void clear();
+
+  protected:
+    template <class K, class Proj>
+      bool build_file(const char *path, size_t index_stride, bool with_keys, Proj proj);
+    template <class Sink>
+      bool merge(Sink &sink);
+    template <class Sink>
+      bool merge_runs(size_t first, size_t last, size_t block, Sink &sink);
+
+    bool reserve(size_t count);
+    bool spill();
+    bool wait();
+    void release();
+
+    static bool write_run(std::vector <T> &data, FILE *f, unsigned threads);
+
+  private:
+    size_t              _memory;
+    size_t              _run;
+    unsigned            _threads;
+    std::string         _temp_dir;
+    sorted_vector_io_pool _pool;
+    std::vector <T>     _buffer;
+    std::vector <T>     _spare;
+    std::vector <FILE *> _runs;
+    std::future <bool>  _spilling;
+    size_t              _size = 0;
+    bool                _ok   = true;
+};
+
+template <class T>
+  sorted_vector_builder <T>::  sorted_vector_builder(
+    size_t memory_limit,
+    unsigned threads,
+    const char *temp_dir)
+  : _memory(memory_limit),
+    _threads((threads > 0) ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+  static_assert(
+    std::is_trivially_copyable <T>::value,
+    "sorted_vector_builder requires trivially copyable elements");
+
+  //буфер заполнения и буфер, сбрасываемый в фоне, - по половине лимита
+  _run = std::max((size_t)1, _memory / 2 / sizeof(T));
+
+  if (temp_dir != nullptr)
+    _temp_dir = temp_dir;
+  else if (getenv("TMPDIR") != nullptr)
+    _temp_dir = getenv("TMPDIR");
+  else
+    _temp_dir = "/tmp";
+}
+
+template <class T>
+  sorted_vector_builder <T>::  ~sorted_vector_builder()
+{
+  clear();
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  push(
+    const T &t)
+{
+  if (!reserve(1))
+    return false;
+  _buffer.push_back(t);
+  _size++;
+  return true;
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  push(
+    const T *data,
+    size_t count)
+{
+  while (count > 0) {
+    //reserve(1) сбрасывает заполненный буфер, после
+    //чего в нём есть место хотя бы для одного элемента
+    if (!reserve(1))
+      return false;
+    size_t n = std::min(count, _run - _buffer.size());
+    if (!reserve(n))
+      return false;
+    _buffer.insert(_buffer.end(), data, data + n);
+    data += n;
+    count -= n;
+    _size += n;
+  }
+  return true;
+}
+
+template <class T>
+  template <class InputIt>
+    bool sorted_vector_builder <T>::  push(
+      InputIt first,
+      InputIt last)
+{
+  for (; first != last; ++first)
+    if (!push(*first))
+      return false;
+  return true;
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  read(
+    FILE *f)
+{
+  //элементы читаются как есть, в представлении платформы
+  std::vector <T> buf(std::max((size_t)1, CIM_SORTED_VECTOR_BUILDER_BLOCK / sizeof(T)));
+  size_t n;
+  while ((n = fread(buf.data(), sizeof(T), buf.size(), f)) > 0)
+    if (!push(buf.data(), n))
+      return false;
+  return ferror(f) == 0;
+}
+
+template <class T>
+  size_t sorted_vector_builder <T>::  size()
+    const
+{
+  return _size;
+}
+
+template <class T>
+  size_t sorted_vector_builder <T>::  runs()
+    const
+{
+  return _runs.size();
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  build(
+    sorted_vector <T> &sv)
+{
+  if (  (!_ok)
+      ||(!wait()))
+    return false;
+
+  if (_runs.empty()) {
+    //всё поместилось в память - временные файлы не нужны
+    std::sort(_buffer.begin(), _buffer.end());
+    sv.assign_sorted(static_cast <std::vector <T> &&> (_buffer));
+    clear();
+    return true;
+  }
+
+  std::vector <T> v;
+  v.reserve(_size);
+  auto sink = [&v](const T &t) {
+    v.push_back(t);
+    return true;
+  };
+  if (!merge(sink))
+    return false;
+  sv.assign_sorted(static_cast <std::vector <T> &&> (v));
+  return true;
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  build(
+    const char *path,
+    size_t index_stride)
+{
+  return build_file <T> (path, index_stride, false, sorted_vector_file_identity <T>());
+}
+
+template <class T>
+  void sorted_vector_builder <T>::  clear()
+{
+  if (_spilling.valid())
+    _spilling.wait();
+  _spilling = std::future <bool>();
+  for (FILE *f : _runs)
+    fclose(f);
+  _runs.clear();
+  release();
+  _size = 0;
+  _ok = true;
+}
+
+template <class T>
+  template <class K, class Proj>
+    bool sorted_vector_builder <T>::  build_file(
+      const char *path,
+      size_t index_stride,
+      bool with_keys,
+      Proj proj)
+{
+  if (!_ok)
+    return false;
+
+  //буферы вывода - в пределах лимита памяти
+  sorted_vector_file_stream <T, K, Proj> out(
+    proj,
+    std::max((size_t)1, CIM_SORTED_VECTOR_BUILDER_BLOCK / sizeof(T)),
+    _temp_dir,
+    _pool);
+
+  bool ok = (out.open(path, with_keys, index_stride))
+         && (merge(out));
+  return (out.close()) && (ok);
+}
+
+template <class T>
+  template <class Sink>
+    bool sorted_vector_builder <T>::  merge(
+      Sink &sink)
+{
+  if (  (!_ok)
+      ||(!wait()))
+    return false;
+
+  if (_runs.empty()) {
+    std::sort(_buffer.begin(), _buffer.end());
+    for (const T &t : _buffer)
+      if (!sink(t)) {
+        clear();
+        return false;
+      }
+    clear();
+    return true;
+  }
+
+  //остаток буфера - последняя серия; память буферов отдаётся слиянию
+  if (!_buffer.empty()) {
+    if (!spill())
+      return false;
+    if (!wait())
+      return false;
+  }
+  release();
+
+  //на каждую серию и на вывод - по два блока
+  size_t memory = std::max((size_t)6, _memory / sizeof(T));
+  size_t min_block = std::min(
+    std::max((size_t)1, CIM_SORTED_VECTOR_BUILDER_BLOCK / sizeof(T)),
+    memory / 6);
+  size_t fanin = memory / (2 * min_block) - 1;
+
+  while (_runs.size() > fanin) {
+    FILE *f = sorted_vector_temp_file(_temp_dir);
+    if (f == nullptr) {
+      _ok = false;
+      return false;
+    }
+    size_t block = memory / (2 * (fanin + 1));
+    bool ok;
+    {
+      sorted_vector_file_output <T> out(f, block, _pool);
+      auto sink_run = [&out](const T &t) {
+        return out.push(t);
+      };
+      ok = (merge_runs(0, fanin, block, sink_run))
+        && (out.finish());
+    }
+    for (size_t i = 0; i < fanin; i++)
+      fclose(_runs[i]);
+    _runs.erase(_runs.begin(), _runs.begin() + fanin);
+    _runs.push_back(f);
+    if (!ok) {
+      _ok = false;
+      return false;
+    }
+  }
+
+  size_t block = memory / (2 * (_runs.size() + 1));
+  bool ok = merge_runs(0, _runs.size(), block, sink);
+  clear();
+  return ok;
+}
+
+template <class T>
+  template <class Sink>
+    bool sorted_vector_builder <T>::  merge_runs(
+      size_t first,
+      size_t last,
+      size_t block,
+      Sink &sink)
+{
+  std::vector <std::unique_ptr <sorted_vector_file_input <T> > > in;
+  std::vector <size_t> heap;
+  for (size_t i = first; i < last; i++) {
+    in.emplace_back(new sorted_vector_file_input <T> (_runs[i], block, _pool));
+    if (!in.back()->empty())
+      heap.push_back(in.size() - 1);
+  }
+
+  //куча номеров серий с наименьшим текущим элементом в вершине
+  auto after = [&in](size_t a, size_t b) {
+    return in[b]->front() < in[a]->front();
+  };
+  std::make_heap(heap.begin(), heap.end(), after);
+
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), after);
+    sorted_vector_file_input <T> &r = *in[heap.back()];
+    if (  (!sink(r.front()))
+        ||(!r.pop()))
+      return false;
+    if (r.empty())
+      heap.pop_back();
+    else
+      std::push_heap(heap.begin(), heap.end(), after);
+  }
+  return true;
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  reserve(
+    size_t count)
+{
+  if (!_ok)
+    return false;
+  if (  (_buffer.size() == _run)
+      &&(!spill()))
+    return false;
+
+  //рост ёмкости не выходит за размер серии
+  size_t need = _buffer.size() + count;
+  if (need > _buffer.capacity())
+    _buffer.reserve(std::min(_run, std::max(need, 2 * _buffer.capacity())));
+  return true;
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  spill()
+{
+  //предыдущая серия должна быть записана - её буфер станет буфером заполнения
+  if (!wait())
+    return false;
+
+  FILE *f = sorted_vector_temp_file(_temp_dir);
+  if (f == nullptr) {
+    _ok = false;
+    return false;
+  }
+  _runs.push_back(f);
+
+  _buffer.swap(_spare);
+  _buffer.clear();
+  std::vector <T> *data = &_spare;
+  unsigned threads = _threads;
+  _spilling = std::async(std::launch::async, [data, f, threads] {
+    return write_run(*data, f, threads);
+  });
+  return true;
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  wait()
+{
+  if (_spilling.valid())
+    _ok = (_spilling.get()) && (_ok);
+  return _ok;
+}
+
+template <class T>
+  void sorted_vector_builder <T>::  release()
+{
+  std::vector <T>().swap(_buffer);
+  std::vector <T>().swap(_spare);
+}
+
+template <class T>
+  bool sorted_vector_builder <T>::  write_run(
+    std::vector <T> &data,
+    FILE *f,
+    unsigned threads)
+{
+  size_t n = data.size();
+  size_t parts = std::max((size_t)1, std::min((size_t)threads, n));
+  std::vector <size_t> bound(parts + 1);
+  for (size_t i = 0; i <= parts; i++)
+    bound[i] = n * i / parts;
+
+  if (parts == 1) {
+    std::sort(data.begin(), data.end());
+    return (fwrite(data.data(), sizeof(T), n, f) == n)
+        && (fflush(f) == 0);
+  }
+
+  std::vector <std::thread> workers;
+  for (size_t i = 0; i < parts; i++)
+    workers.push_back(std::thread([&data, &bound, i] {
+      std::sort(data.begin() + bound[i], data.begin() + bound[i + 1]);
+    }));
+  for (std::thread &w : workers)
+    w.join();
+
+  //части сливаются при записи в одну серию: без второго
+  //буфера размером с серию, только блок вывода
+  std::vector <size_t> pos(bound.begin(), bound.end() - 1);
+  std::vector <size_t> heap;
+  for (size_t i = 0; i < parts; i++)
+    if (pos[i] < bound[i + 1])
+      heap.push_back(i);
+  auto after = [&data, &pos](size_t a, size_t b) {
+    return data[pos[b]] < data[pos[a]];
+  };
+  std::make_heap(heap.begin(), heap.end(), after);
+
+  std::vector <T> block;
+  block.reserve(std::max((size_t)1, CIM_SORTED_VECTOR_BUILDER_BLOCK / sizeof(T)));
+  bool ok = true;
+  while (  (ok)
+         &&(!heap.empty())) {
+    std::pop_heap(heap.begin(), heap.end(), after);
+    size_t i = heap.back();
+    block.push_back(data[pos[i]++]);
+    if (pos[i] == bound[i + 1])
+      heap.pop_back();
+    else
+      std::push_heap(heap.begin(), heap.end(), after);
+    if (  (block.size() == block.capacity())
+        ||(heap.empty())) {
+      ok = fwrite(block.data(), sizeof(T), block.size(), f) == block.size();
+      block.clear();
+    }
+  }
+  return (ok) && (fflush(f) == 0);
+}
+
+//***Builder with key***
+
+template <class T, class Key>
+  class sorted_vector_builder_with_key : public sorted_vector_builder <T>
+{
+  public:
+    using sorted_vector_builder <T>::sorted_vector_builder;
+
+    bool build(const char *path, size_t index_stride = 0);
+
+    using sorted_vector_builder <T>::build;
+};
+
+template <class T, class Key>
+  bool sorted_vector_builder_with_key <T, Key>::  build(
+    const char *path,
+    size_t index_stride)
+{
+  return this->template build_file <Key> (path, index_stride, true, sorted_vector_file_key <T, Key>());
+}
+
+}
+
+#endif
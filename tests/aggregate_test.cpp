@@ -0,0 +1,247 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct keyed
+{
+  int _key;
+  long payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+struct payload_sum
+{
+  typedef long value_type;
+
+  value_type identity() const
+  {
+    return 0;
+  }
+
+  value_type lift(const keyed &t) const
+  {
+    return t.payload;
+  }
+
+  value_type combine(const value_type &a, const value_type &b) const
+  {
+    return a + b;
+  }
+};
+
+template <class Aggregate>
+  void check_summary(const Aggregate &a, const std::vector <long> &m, long lo, long hi)
+{
+  auto first = std::lower_bound(m.begin(), m.end(), lo);
+  auto last = std::upper_bound(m.begin(), m.end(), hi);
+  range_summary <long> r = a.aggregate(lo, hi);
+  ASSERT_EQ(r.count, (size_t)(last - first));
+  long sum = 0;
+  for (auto it = first; it != last; ++it)
+    sum += *it;
+  ASSERT_EQ(r.sum, sum);
+  if (first != last) {
+    ASSERT_EQ(r.min, *first);
+    ASSERT_EQ(r.max, *(last - 1));
+  }
+}
+
+template <class Aggregate>
+  void check_random_updates(uint64_t seed)
+{
+  std::mt19937_64 g(seed);
+  std::vector <long> m;
+  for (int i = 0; i < 3000; i++)
+    m.push_back((long)(g() % 100000));
+  Aggregate a(m);
+  std::sort(m.begin(), m.end());
+
+  for (int step = 0; step < 2000; step++) {
+    switch (g() % 4) {
+      case 0:
+      case 1: {
+        long t = (long)(g() % 100000);
+        a.push(t);
+        m.insert(std::upper_bound(m.begin(), m.end(), t), t);
+        break;
+      }
+      case 2:
+        if (!m.empty()) {
+          size_t p = g() % m.size();
+          a.erase(p);
+          m.erase(m.begin() + p);
+        }
+        break;
+      default: {
+        long lo = (long)(g() % 100000);
+        long hi = lo + (long)(g() % 20000);
+        a.erase_range(lo, hi);
+        m.erase(std::lower_bound(m.begin(), m.end(), lo), std::upper_bound(m.begin(), m.end(), hi));
+        break;
+      }
+    }
+    long lo = (long)(g() % 100000);
+    long hi = lo + (long)(g() % 50000);
+    check_summary(a, m, lo, hi);
+  }
+}
+
+//Базовый класс, считающий вызовы обработчиков изменений
+struct counting_base : sorted_vector <long>
+{
+  size_t inserts = 0;
+  size_t erases = 0;
+  size_t changes = 0;
+  size_t resets = 0;
+
+  protected:
+    void on_insert(size_t pos)
+    {
+      sorted_vector <long>::on_insert(pos);
+      inserts++;
+    }
+
+    void on_erase(size_t first, size_t last)
+    {
+      sorted_vector <long>::on_erase(first, last);
+      erases++;
+    }
+
+    void on_change(size_t pos)
+    {
+      sorted_vector <long>::on_change(pos);
+      changes++;
+    }
+
+    void on_reset()
+    {
+      sorted_vector <long>::on_reset();
+      resets++;
+    }
+};
+
+} // namespace
+
+TEST(Aggregate, RandomUpdates)
+{
+  check_random_updates <sorted_vector_aggregate <long> > (1);
+}
+
+TEST(Aggregate, Positions)
+{
+  sorted_vector_aggregate <long> a;
+  for (long i = 0; i < 1000; i++)
+    a.push(i);
+  EXPECT_EQ(a.aggregate_positions(100, 900).sum, (100 + 899) * 800 / 2);
+  EXPECT_EQ(a.sum_range(10, 19), 145);
+  EXPECT_EQ(a.min_range(500, 2000), 500);
+  EXPECT_EQ(a.max_range(-5, 3), 3);
+  EXPECT_EQ(a.aggregate(2000, 3000).count, 0u);
+}
+
+TEST(Aggregate, CorruptedInstance)
+{
+  std::vector <long> v;
+  for (long i = 0; i < 1000; i++)
+    v.push_back(i);
+  sorted_vector_aggregate <long> a(v);
+  a.suspend_autorepair();
+  a.storage()[0] = 950;
+  EXPECT_EQ(a.aggregate(900, 999).count, 101u);
+  EXPECT_EQ(a.aggregate(0, 10).sum, 55);
+  a.resume_autorepair();
+  EXPECT_EQ(a.aggregate(900, 999).count, 101u);
+}
+
+TEST(Aggregate, WithKeyInterval)
+{
+  sorted_vector_aggregate <keyed, payload_sum, sorted_vector_with_key <keyed, int> > a;
+  for (int i = 0; i < 1000; i++)
+    a.push({i, (long)i * 2});
+
+  EXPECT_EQ(a.aggregate(10, 19), 2 * 145);
+  EXPECT_EQ(a.aggregate(keyed{10, 0}, keyed{19, 0}), 2 * 145);
+  a.erase_range(0, 14);
+  EXPECT_EQ(a.aggregate(10, 19), 2 * (15 + 16 + 17 + 18 + 19));
+}
+
+TEST(Aggregate, ForwardsHooksToBase)
+{
+  sorted_vector_aggregate <long, summary_monoid <long>, counting_base> a;
+  for (long i = 0; i < 100; i++)
+    a.push(i);
+  EXPECT_EQ(a.inserts, 100u);
+  a.erase(10);
+  EXPECT_EQ(a.erases, 1u);
+  size_t resets = a.resets;
+  a.sort();
+  EXPECT_EQ(a.resets, resets + 1);
+  EXPECT_EQ(a.aggregate(0, 1000).count, 99u);
+}
+
+TEST(Aggregate, ComposedOverFiltered)
+{
+  typedef sorted_vector_aggregate <long, summary_monoid <long>, sorted_vector_filtered <long> > composed;
+  check_random_updates <composed> (2);
+
+  std::vector <long> v;
+  for (long i = 0; i < 2000; i++)
+    v.push_back(i * 3);
+  composed a(v);
+  const composed &ca = a;
+  ASSERT_NE(ca.find(v[0]), (size_t)-1);
+  for (long t = 100000; t < 100500; t++) {
+    a.push(t);
+    ASSERT_NE(ca.find(t), (size_t)-1);
+  }
+}
+
+TEST(Aggregate, ComposedOverLearned)
+{
+  typedef sorted_vector_aggregate <long, summary_monoid <long>, sorted_vector_learned <long> > composed;
+  check_random_updates <composed> (3);
+
+  std::mt19937_64 g(4);
+  std::vector <long> v;
+  for (int i = 0; i < 2000; i++)
+    v.push_back((long)(g() % 100000));
+  composed a(v);
+  const composed &ca = a;
+  ca.find(v[0]);
+  for (int i = 0; i < 500; i++) {
+    long t = (long)(g() % 100000);
+    a.push(t);
+    size_t p = ca.find_first(t);
+    ASSERT_NE(p, (size_t)-1);
+    ASSERT_EQ(ca[p], t);
+    ASSERT_TRUE((p == 0) || (ca[p - 1] != t));
+  }
+}
+
+TEST(Aggregate, FilteredOverAggregate)
+{
+  typedef sorted_vector_filtered <long, sorted_vector_aggregate <long> > composed;
+  check_random_updates <composed> (5);
+}
@@ -0,0 +1,144 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <list>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct keyed
+{
+  int _key;
+  int payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+std::vector <int> payloads(const sorted_vector <keyed> &sv)
+{
+  std::vector <int> p;
+  for (size_t i = 0; i < sv.size(); i++)
+    p.push_back(sv[i].payload);
+  return p;
+}
+
+} // namespace
+
+TEST(PushBatch, MatchesSequentialPush)
+{
+  //Порядок равных элементов - как при последовательных push
+  std::mt19937_64 g(1);
+  for (int it = 0; it < 100; it++) {
+    sorted_vector <keyed> batched;
+    sorted_vector <keyed> pushed;
+    int payload = 0;
+    size_t n = g() % 200;
+    for (size_t i = 0; i < n; i++) {
+      keyed k = {(int)(g() % 50), payload++};
+      batched.push(k);
+      pushed.push(k);
+    }
+    std::vector <keyed> batch;
+    size_t m = g() % 200;
+    for (size_t i = 0; i < m; i++)
+      batch.push_back(keyed{(int)(g() % 60) - 5, payload++});
+    batched.push_batch(batch.begin(), batch.end());
+    for (size_t i = 0; i < batch.size(); i++)
+      pushed.push(batch[i]);
+    ASSERT_EQ(batched.size(), pushed.size());
+    EXPECT_FALSE(batched.corrupted());
+    EXPECT_EQ(payloads(batched), payloads(pushed));
+  }
+}
+
+TEST(PushBatch, ParallelSort)
+{
+  //Пакет больше CIM_SORTED_VECTOR_PARALLEL_SORT
+  //сортируется в нескольких потоках (без директивы -
+  //в вызывающем потоке)
+#ifdef CIM_SORTED_VECTOR_PARALLEL_SORT
+  const size_t parallel = CIM_SORTED_VECTOR_PARALLEL_SORT;
+#else
+  const size_t parallel = 65536;
+#endif
+  std::mt19937_64 g(2);
+  std::vector <int> initial(1000);
+  for (size_t i = 0; i < initial.size(); i++)
+    initial[i] = (int)(g() % 1000000);
+  std::vector <int> batch(parallel * 2 + 17);
+  for (size_t i = 0; i < batch.size(); i++)
+    batch[i] = (int)(g() % 1000000);
+
+  sorted_vector <int> sv(initial);
+  sv.push_batch(batch.begin(), batch.end());
+
+  std::vector <int> expected(initial);
+  expected.insert(expected.end(), batch.begin(), batch.end());
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(sv.cstorage(), expected);
+}
+
+TEST(PushBatch, EmptyAndCorrupted)
+{
+  sorted_vector <int> sv({5, 1, 3});
+  std::vector <int> none;
+  sv.push_batch(none.begin(), none.end());
+  EXPECT_EQ(sv.size(), 3u);
+
+  //Испорченный экземпляр: пакет дописывается в конец
+  sv.storage()[0] = 10;
+  ASSERT_TRUE(sv.corrupted());
+  std::vector <int> batch = {4, 2};
+  sv.push_batch(batch.begin(), batch.end());
+  EXPECT_EQ(sv.size(), 5u);
+  sv.sort();
+  EXPECT_EQ(sv.cstorage(), (std::vector <int> {2, 3, 4, 5, 10}));
+}
+
+TEST(InsertRange, AnyRange)
+{
+  sorted_vector <int> sv({1, 5, 9});
+  std::list <int> l = {8, 2, 6};
+  sv.insert_range(l);
+  EXPECT_EQ(l.size(), 3u);
+  int a[] = {7, 0};
+  sv.insert_range(a);
+  sv.insert_range(std::vector <int> {4, 3});
+  EXPECT_EQ(sv.cstorage(), (std::vector <int> {0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(InsertRange, AfterPopFront)
+{
+  //Слияние с хранилищем, начало которого смещено
+  sorted_vector <int> sv;
+  for (int i = 0; i < 100; i++)
+    sv.push(i * 2);
+  for (int i = 0; i < 30; i++)
+    sv.pop_front();
+  std::vector <int> batch = {1, 61, 199, 300};
+  sv.insert_range(batch);
+  std::vector <int> expected;
+  for (int i = 30; i < 100; i++)
+    expected.push_back(i * 2);
+  expected.insert(expected.end(), batch.begin(), batch.end());
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(sv.cstorage(), expected);
+}
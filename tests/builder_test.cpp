@@ -0,0 +1,102 @@
+#include "sorted_vector_builder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+std::vector <uint32_t> random_values(uint64_t seed, size_t n)
+{
+  std::mt19937_64 g(seed);
+  std::vector <uint32_t> v(n);
+  for (size_t i = 0; i < n; i++)
+    v[i] = (uint32_t)g();
+  return v;
+}
+
+} // namespace
+
+TEST(Builder, InMemory)
+{
+  std::vector <uint32_t> v = random_values(1, 1000);
+  sorted_vector_builder <uint32_t> b;
+  ASSERT_TRUE(b.push(v.data(), v.size()));
+  EXPECT_EQ(b.runs(), 0u);
+
+  sorted_vector <uint32_t> sv;
+  ASSERT_TRUE(b.build(sv));
+  std::sort(v.begin(), v.end());
+  EXPECT_EQ(sv.cstorage(), v);
+  EXPECT_EQ(b.size(), 0u);
+}
+
+TEST(Builder, MultiPassMerge)
+{
+  //64 КБ лимита: серии по 8192 элемента, несколько проходов слияния
+  std::vector <uint32_t> v = random_values(2, 200000);
+  for (unsigned threads : {1u, 4u}) {
+    sorted_vector_builder <uint32_t> b(64 << 10, threads);
+    for (size_t i = 0; i < v.size(); i += 1000)
+      ASSERT_TRUE(b.push(v.data() + i, std::min((size_t)1000, v.size() - i)));
+
+    //одна серия на каждый сброс буфера при любом числе потоков
+    EXPECT_EQ(b.runs(), (v.size() - 1) / 8192);
+
+    sorted_vector <uint32_t> sv;
+    ASSERT_TRUE(b.build(sv));
+    std::vector <uint32_t> e = v;
+    std::sort(e.begin(), e.end());
+    EXPECT_EQ(sv.cstorage(), e);
+    EXPECT_FALSE(sv.corrupted());
+  }
+}
+
+TEST(Builder, BuildFile)
+{
+  std::string path = "sorted_vector_builder_test_" + std::to_string(getpid()) + ".bin";
+  std::vector <uint32_t> v = random_values(3, 50000);
+  sorted_vector_builder <uint32_t> b(32 << 10, 2);
+  ASSERT_TRUE(b.push(v.begin(), v.end()));
+  ASSERT_TRUE(b.build(path.c_str()));
+
+  mapped_sorted_vector <uint32_t> m(path.c_str());
+  ASSERT_TRUE(m.is_open());
+  std::sort(v.begin(), v.end());
+  ASSERT_EQ(m.size(), v.size());
+  EXPECT_TRUE(std::equal(v.begin(), v.end(), m.begin()));
+  EXPECT_FALSE(m.corrupted());
+  remove(path.c_str());
+}
+
+TEST(Builder, ReadFromFile)
+{
+  std::vector <uint32_t> v = random_values(4, 30000);
+  FILE *f = tmpfile();
+  ASSERT_NE(f, nullptr);
+  ASSERT_EQ(fwrite(v.data(), sizeof(uint32_t), v.size(), f), v.size());
+  rewind(f);
+
+  sorted_vector_builder <uint32_t> b(16 << 10);
+  ASSERT_TRUE(b.read(f));
+  fclose(f);
+  sorted_vector <uint32_t> sv;
+  ASSERT_TRUE(b.build(sv));
+  std::sort(v.begin(), v.end());
+  EXPECT_EQ(sv.cstorage(), v);
+}
+
+TEST(Builder, MissingTempDirFails)
+{
+  std::vector <uint32_t> v = random_values(5, 10000);
+  sorted_vector_builder <uint32_t> b(4 << 10, 1, "/nonexistent/sorted_vector_builder");
+  EXPECT_FALSE(b.push(v.data(), v.size()));
+  sorted_vector <uint32_t> sv;
+  EXPECT_FALSE(b.build(sv));
+}
@@ -0,0 +1,79 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+static_assert(
+  std::is_same <std::iterator_traits <compressed_sorted_vector <int64_t>::const_iterator>::iterator_category,
+                std::input_iterator_tag>::value,
+  "compressed_sorted_vector iterator category");
+
+namespace {
+
+template <class T>
+  void check_compressed(const std::vector <T> &m)
+{
+  compressed_sorted_vector <T> c{std::vector <T> (m)};
+  ASSERT_EQ(c.size(), m.size());
+  for (size_t i = 0; i < m.size(); i++)
+    ASSERT_EQ(c[i], m[i]);
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), m.begin()));
+  EXPECT_EQ(std::vector <T> (c.begin(), c.end()), m);
+
+  sorted_vector <T> sv(m);
+  sorted_vector <T> back;
+  c.decompress(back);
+  EXPECT_EQ(back.cstorage(), m);
+
+  for (size_t i = 0; i < m.size(); i += 13) {
+    T t = m[i];
+    EXPECT_EQ(c.find_first(t), sv.find_first(t));
+    EXPECT_EQ(c.find_last(t), sv.find_last(t));
+    EXPECT_EQ(c.rank(t), sv.rank(t));
+    EXPECT_EQ(c.find_floor(t + 1), sv.find_floor(t + 1));
+    EXPECT_EQ(c.find_ceil(t - 1), sv.find_ceil(t - 1));
+    EXPECT_EQ(c.count_range(t, t + 100), sv.count_range(t, t + 100));
+  }
+}
+
+} // namespace
+
+TEST(Compressed, DenseIds)
+{
+  std::vector <uint32_t> m;
+  for (uint32_t i = 0; i < 5000; i++)
+    m.push_back(1000000 + i * 3 + (i % 7));
+  std::sort(m.begin(), m.end());
+  check_compressed(m);
+  compressed_sorted_vector <uint32_t> c{std::vector <uint32_t> (m)};
+  EXPECT_LT(c.memory_usage(), m.size() * sizeof(uint32_t) / 2);
+}
+
+TEST(Compressed, SignedWithDuplicates)
+{
+  std::mt19937_64 g(1);
+  std::vector <int64_t> m;
+  for (int i = 0; i < 3000; i++)
+    m.push_back((int64_t)(g() % 1000) - 500);
+  m.push_back(INT64_MIN + 1);
+  m.push_back(INT64_MAX - 1);
+  std::sort(m.begin(), m.end());
+  check_compressed(m);
+}
+
+TEST(Compressed, Empty)
+{
+  compressed_sorted_vector <int> c;
+  EXPECT_TRUE(c.empty());
+  EXPECT_EQ(c.find(1), (size_t)-1);
+  EXPECT_EQ(c.rank(1), 0u);
+  EXPECT_TRUE(c.begin() == c.end());
+}
@@ -0,0 +1,138 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+TEST(Cracked, MatchesSortedVector)
+{
+  //Позиции и семантика find... - как у sorted_vector
+  std::mt19937_64 g(1);
+  for (int it = 0; it < 50; it++) {
+    std::vector <int> m;
+    size_t n = g() % 2000;
+    for (size_t i = 0; i < n; i++)
+      m.push_back((int)(g() % 500));
+    sorted_vector <int> sv(m);
+    const sorted_vector <int> &ref = sv;
+    cracked_sorted_vector <int> cr(m);
+
+    for (int q = 0; q < 200; q++) {
+      int t = (int)(g() % 520) - 10;
+      switch (g() % 6) {
+        case 0:
+          EXPECT_EQ(cr.find_first(t), ref.find_first(t));
+          break;
+        case 1:
+          EXPECT_EQ(cr.find_last(t), ref.find_last(t));
+          break;
+        case 2:
+          EXPECT_EQ(cr.find_floor(t), ref.find_floor(t));
+          break;
+        case 3:
+          EXPECT_EQ(cr.find_ceil(t), ref.find_ceil(t));
+          break;
+        case 4:
+          EXPECT_EQ(cr.rank(t), ref.rank(t));
+          break;
+        default: {
+          sorted_vector_view <int> r = cr.range(t, t + 20);
+          ASSERT_EQ((size_t)(r.end() - r.begin()), ref.count_range(t, t + 20));
+          EXPECT_TRUE(std::is_sorted(r.begin(), r.end()));
+          EXPECT_EQ(cr.count_range(t, t + 20), ref.count_range(t, t + 20));
+        }
+      }
+    }
+    sorted_vector <int> back = cr.thaw();
+    EXPECT_EQ(back.cstorage(), sv.cstorage());
+  }
+}
+
+TEST(Cracked, QueriesConvergeToSorted)
+{
+  std::mt19937_64 g(2);
+  std::vector <int> m(10000);
+  for (size_t i = 0; i < m.size(); i++)
+    m[i] = (int)(g() % 100000);
+  cracked_sorted_vector <int> cr(m);
+  EXPECT_FALSE(cr.sorted());
+  for (int t = 0; t < 100000 && !cr.sorted(); t += 97)
+    cr.rank(t);
+  EXPECT_TRUE(cr.sorted());
+  EXPECT_TRUE(std::is_sorted(cr.data(), cr.data() + cr.size()));
+}
+
+TEST(Cracked, FromCorruptedInstance)
+{
+  sorted_vector <int> sv({1, 2, 3, 4, 5});
+  sv.storage()[0] = 10;
+  ASSERT_TRUE(sv.corrupted());
+  cracked_sorted_vector <int> cr = sv.crack();
+  EXPECT_TRUE(sv.empty());
+  EXPECT_EQ(cr.find(10), 4u);
+  cr.sort();
+  EXPECT_TRUE(cr.sorted());
+  EXPECT_EQ(cr.pieces(), 1u);
+  EXPECT_EQ(std::vector <int> (cr.data(), cr.data() + cr.size()), (std::vector <int> {2, 3, 4, 5, 10}));
+}
+
+TEST(Cracked, ConstQueriesDoNotCrack)
+{
+  std::mt19937_64 g(3);
+  std::vector <int> m(5000);
+  for (size_t i = 0; i < m.size(); i++)
+    m[i] = (int)(g() % 1000);
+  cracked_sorted_vector <int> cr(m);
+  cr.rank(500);
+  cr.count_range(100, 200);
+  const cracked_sorted_vector <int> &c = cr;
+  std::vector <int> before(c.data(), c.data() + c.size());
+  size_t pieces = c.pieces();
+
+  std::sort(m.begin(), m.end());
+  for (int t = -5; t < 1005; t += 3) {
+    EXPECT_EQ(c.rank(t), (size_t)(std::lower_bound(m.begin(), m.end(), t) - m.begin()));
+    EXPECT_EQ(c.count_range(t, t + 10),
+              (size_t)(std::upper_bound(m.begin(), m.end(), t + 10) - std::lower_bound(m.begin(), m.end(), t)));
+  }
+  EXPECT_EQ(c.pieces(), pieces);
+  EXPECT_EQ(std::vector <int> (c.data(), c.data() + c.size()), before);
+}
+
+TEST(Cracked, ConcurrentReaders)
+{
+  //Константные запросы из нескольких потоков не
+  //изменяют экземпляр
+  std::mt19937_64 g(4);
+  std::vector <int> m(20000);
+  for (size_t i = 0; i < m.size(); i++)
+    m[i] = (int)(g() % 5000);
+  cracked_sorted_vector <int> cr(m);
+  for (int t = 0; t < 5000; t += 500)
+    cr.find(t);
+  const cracked_sorted_vector <int> &c = cr;
+  std::sort(m.begin(), m.end());
+
+  std::vector <size_t> errors(4, 0);
+  std::vector <std::thread> threads;
+  for (size_t k = 0; k < errors.size(); k++)
+    threads.emplace_back([&, k]() {
+      for (int t = (int)k; t < 5000; t += 7) {
+        size_t lo = std::lower_bound(m.begin(), m.end(), t) - m.begin();
+        size_t hi = std::upper_bound(m.begin(), m.end(), t + 20) - m.begin();
+        if (  (c.rank(t) != lo)
+            ||(c.count_range(t, t + 20) != hi - lo))
+          errors[k]++;
+      }
+    });
+  for (size_t k = 0; k < threads.size(); k++)
+    threads[k].join();
+  for (size_t k = 0; k < errors.size(); k++)
+    EXPECT_EQ(errors[k], 0u);
+  EXPECT_FALSE(c.sorted());
+}
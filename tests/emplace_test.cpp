@@ -0,0 +1,141 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct tracked
+{
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+  static int copies;
+#endif
+
+  int _key;
+  int payload;
+
+  tracked(int k, int p) : _key(k), payload(p) {}
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+  //Со счётчиком копий тип не тривиально копируемый,
+  //поэтому при побитовом перемещении счётчика нет
+  tracked(const tracked &t) : _key(t._key), payload(t.payload) { copies++; }
+  tracked(tracked &&t) noexcept : _key(t._key), payload(t.payload) {}
+  tracked &operator=(const tracked &t) { _key = t._key; payload = t.payload; copies++; return *this; }
+  tracked &operator=(tracked &&t) noexcept { _key = t._key; payload = t.payload; return *this; }
+#endif
+};
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+int tracked::copies = 0;
+#endif
+
+bool operator<(const tracked &a, const tracked &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const tracked &a, const tracked &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const tracked &a, const tracked &b)
+{
+  return a._key == b._key;
+}
+
+std::vector <int> payloads(const sorted_vector <tracked> &sv)
+{
+  std::vector <int> p;
+  for (size_t i = 0; i < sv.size(); i++)
+    p.push_back(sv[i].payload);
+  return p;
+}
+
+} // namespace
+
+TEST(Emplace, MatchesPush)
+{
+  std::mt19937_64 g(1);
+  sorted_vector <tracked> emplaced;
+  sorted_vector <tracked> pushed;
+  const sorted_vector <tracked> &c = emplaced;
+  for (int i = 0; i < 2000; i++) {
+    int k = (int)(g() % 300);
+    size_t pos = emplaced.emplace(k, i);
+    pushed.push(tracked(k, i));
+    ASSERT_LT(pos, emplaced.size());
+    EXPECT_EQ(c[pos].payload, i);
+  }
+  EXPECT_FALSE(emplaced.corrupted());
+  EXPECT_EQ(payloads(emplaced), payloads(pushed));
+}
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+TEST(Emplace, NoCopies)
+{
+  sorted_vector <tracked> sv;
+  sv.reserve(100);
+  tracked::copies = 0;
+  for (int i = 0; i < 100; i++)
+    sv.emplace((i * 37) % 100, i);
+  EXPECT_EQ(tracked::copies, 0);
+}
+#endif
+
+TEST(EmplaceHint, AnyHintGivesPushOrder)
+{
+  //Верная подсказка пропускает поиск, неверная
+  //(в том числе за концом) - ищется позиция
+  std::mt19937_64 g(2);
+  sorted_vector <tracked> hinted;
+  sorted_vector <tracked> pushed;
+  const sorted_vector <tracked> &c = hinted;
+  for (int i = 0; i < 2000; i++) {
+    int k = (int)(g() % 100);
+    size_t hint = g() % (hinted.size() + 3);
+    size_t pos = hinted.emplace_hint(hint, k, i);
+    pushed.push(tracked(k, i));
+    ASSERT_LT(pos, hinted.size());
+    EXPECT_EQ(c[pos].payload, i);
+  }
+  EXPECT_EQ(payloads(hinted), payloads(pushed));
+}
+
+TEST(EmplaceHint, ExactHint)
+{
+  sorted_vector <tracked> sv;
+  const sorted_vector <tracked> &c = sv;
+  for (int i = 0; i < 10; i++)
+    sv.emplace(i * 10, i);
+  EXPECT_EQ(sv.emplace_hint(3, 25, 100), 3u);
+  EXPECT_EQ(sv.emplace_hint(0, -1, 101), 0u);
+  EXPECT_EQ(sv.emplace_hint(12, 1000, 102), 12u);
+  //Равный элемент ставится после имеющихся
+  EXPECT_EQ(sv.emplace_hint(0, 50, 103), 8u);
+  EXPECT_EQ(c[7].payload, 5);
+  EXPECT_FALSE(sv.corrupted());
+}
+
+TEST(Emplace, CorruptedAppends)
+{
+  sorted_vector <tracked> sv;
+  for (int i = 0; i < 5; i++)
+    sv.emplace(i, i);
+  sv.storage()[0]._key = 10;
+  ASSERT_TRUE(sv.corrupted());
+  //С CIM_SORTED_VECTOR_AUTOREPAIR экземпляр сначала
+  //исправляется, иначе элемент дописывается в конец
+  sv.emplace(2, 5);
+  sv.repair();
+  const sorted_vector <tracked> &c = sv;
+  std::vector <int> keys;
+  for (size_t i = 0; i < c.size(); i++)
+    keys.push_back(c[i]._key);
+  EXPECT_EQ(keys, (std::vector <int> {1, 2, 2, 3, 4, 10}));
+}
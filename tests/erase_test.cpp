@@ -0,0 +1,112 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+std::vector <int> random_sorted(std::mt19937_64 &g, size_t n, int range)
+{
+  std::vector <int> v(n);
+  for (size_t i = 0; i < n; i++)
+    v[i] = (int)(g() % range);
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+} // namespace
+
+TEST(EraseIf, MatchesRemoveIf)
+{
+  std::mt19937_64 g(1);
+  for (int it = 0; it < 200; it++) {
+    std::vector <int> m = random_sorted(g, g() % 300, 100);
+    sorted_vector <int> sv(m);
+    int mod = 2 + (int)(g() % 5);
+    auto pred = [mod](int x) { return x % mod == 0; };
+    size_t erased = sv.erase_if(pred);
+    size_t before = m.size();
+    m.erase(std::remove_if(m.begin(), m.end(), pred), m.end());
+    EXPECT_EQ(erased, before - m.size());
+    EXPECT_FALSE(sv.corrupted());
+    EXPECT_EQ(sv.cstorage(), m);
+  }
+}
+
+TEST(EraseKeys, RemovesAllEqual)
+{
+  std::mt19937_64 g(2);
+  for (int it = 0; it < 200; it++) {
+    std::vector <int> m = random_sorted(g, g() % 300, 60);
+    std::vector <int> keys = random_sorted(g, g() % 20, 80);
+    sorted_vector <int> sv(m);
+    size_t erased = sv.erase_keys(keys.begin(), keys.end());
+    size_t before = m.size();
+    m.erase(
+      std::remove_if(
+        m.begin(),
+        m.end(),
+        [&](int x) { return std::binary_search(keys.begin(), keys.end(), x); }),
+      m.end());
+    EXPECT_EQ(erased, before - m.size());
+    EXPECT_EQ(sv.cstorage(), m);
+  }
+}
+
+TEST(ErasePositions, MatchesPositions)
+{
+  std::mt19937_64 g(3);
+  for (int it = 0; it < 200; it++) {
+    std::vector <int> m = random_sorted(g, 1 + g() % 300, 1000);
+    std::vector <size_t> pos;
+    for (size_t i = 0; i < m.size(); i++)
+      if (g() % 4 == 0)
+        pos.push_back(i);
+    sorted_vector <int> sv(m);
+    EXPECT_EQ(sv.erase_positions(pos.begin(), pos.end()), pos.size());
+    for (size_t i = pos.size(); i-- > 0;)
+      m.erase(m.begin() + pos[i]);
+    EXPECT_EQ(sv.cstorage(), m);
+  }
+}
+
+TEST(Erase, EmptyArguments)
+{
+  sorted_vector <int> sv({1, 2, 3});
+  std::vector <int> none;
+  std::vector <size_t> no_pos;
+  EXPECT_EQ(sv.erase_keys(none.begin(), none.end()), 0u);
+  EXPECT_EQ(sv.erase_positions(no_pos.begin(), no_pos.end()), 0u);
+  EXPECT_EQ(sv.erase_if([](int) { return false; }), 0u);
+  EXPECT_EQ(sv.size(), 3u);
+}
+
+TEST(Erase, AfterPopFront)
+{
+  //Удаление из хранилища со смещённым началом
+  sorted_vector <int> sv;
+  std::vector <int> m;
+  for (int i = 0; i < 200; i++) {
+    sv.push(i);
+    m.push_back(i);
+  }
+  for (int i = 0; i < 50; i++)
+    sv.pop_front();
+  m.erase(m.begin(), m.begin() + 50);
+
+  EXPECT_EQ(sv.erase_if([](int x) { return x % 10 == 0; }), 15u);
+  m.erase(std::remove_if(m.begin(), m.end(), [](int x) { return x % 10 == 0; }), m.end());
+  std::vector <int> keys = {51, 52, 199, 500};
+  EXPECT_EQ(sv.erase_keys(keys.begin(), keys.end()), 3u);
+  m.erase(std::remove_if(m.begin(), m.end(), [](int x) { return x == 51 || x == 52 || x == 199; }), m.end());
+  std::vector <size_t> pos = {0, 1, 100};
+  EXPECT_EQ(sv.erase_positions(pos.begin(), pos.end()), 3u);
+  m.erase(m.begin() + 100);
+  m.erase(m.begin(), m.begin() + 2);
+  EXPECT_EQ(sv.cstorage(), m);
+}
@@ -0,0 +1,149 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct keyed
+{
+  int _key;
+  long payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+std::vector <long> even_keys(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector <long> v(n);
+  for (size_t i = 0; i < n; i++)
+    v[i] = (long)(rng() % (n * 8)) * 2;
+  return v;
+}
+
+} // namespace
+
+TEST(Filtered, RejectsMostAbsentKeys)
+{
+  sorted_vector_filtered <long> sv(even_keys(20000, 1));
+  const sorted_vector_filtered <long> &c = sv;
+  for (size_t i = 0; i < c.size(); i++)
+    EXPECT_TRUE(c.may_contain(c[i]));
+
+  size_t passed = 0;
+  for (long t = 1; t < 200001; t += 2) {
+    EXPECT_EQ(c.find(t), (size_t)-1);
+    if (c.may_contain(t))
+      passed++;
+  }
+  //8 бит на ключ с запасом: ложных срабатываний порядка процента
+  EXPECT_LT(passed, 100000u / 20);
+  EXPECT_GT(c.filter_memory_usage(), 0u);
+}
+
+TEST(Filtered, NoFalseNegativesUnderUpdates)
+{
+  sorted_vector_filtered <long> sv(even_keys(5000, 2));
+  const sorted_vector_filtered <long> &c = sv;
+  c.may_contain(0);
+  std::mt19937 rng(3);
+  for (int i = 0; i < 20000; i++) {
+    long t = (long)(rng() % 100000);
+    switch (rng() % 4) {
+      case 0:
+      case 1:
+        sv.push(t);
+        break;
+      case 2:
+        if (!sv.empty())
+          sv.erase((size_t)(rng() % sv.size()));
+        break;
+      default:
+        sv.replace(t);
+    }
+    if (i % 97 == 0) {
+      for (size_t j = 0; j < c.size(); j++)
+        ASSERT_TRUE(c.may_contain(c[j]));
+    }
+    size_t pos = c.find_first(t);
+    size_t expected = std::lower_bound(c.data(), c.data() + c.size(), t) - c.data();
+    if (  (expected < c.size())
+        &&(c[expected] == t))
+      EXPECT_EQ(pos, expected);
+    else
+      EXPECT_EQ(pos, (size_t)-1);
+  }
+}
+
+TEST(Filtered, CorruptedInstancePassesEverything)
+{
+  sorted_vector_filtered <long> sv(even_keys(1000, 4));
+  sv.storage()[0] = 7;
+  ASSERT_TRUE(sv.corrupted());
+  const sorted_vector_filtered <long> &c = sv;
+  EXPECT_TRUE(c.may_contain(7));
+  sv.sort();
+  EXPECT_NE(c.find(7), (size_t)-1);
+}
+
+TEST(Filtered, WithKey)
+{
+  std::vector <keyed> v;
+  for (int i = 0; i < 1000; i++)
+    v.push_back(keyed{i * 3, (long)i});
+  sorted_vector_filtered_with_key <keyed, int> sv(v);
+  const sorted_vector_filtered_with_key <keyed, int> &c = sv;
+  EXPECT_EQ(c.find(300), 100u);
+  EXPECT_EQ(c.find(301), (size_t)-1);
+  sv.push(keyed{301, 0});
+  EXPECT_TRUE(c.may_contain(301));
+  EXPECT_EQ(c.find(301), 101u);
+}
+
+TEST(Filtered, CopyRebuilds)
+{
+  sorted_vector_filtered <long> sv(even_keys(5000, 5));
+  sv.may_contain(0);
+  const sorted_vector_filtered <long> copy(sv);
+  EXPECT_EQ(copy.filter_memory_usage(), 0u);
+  for (size_t i = 0; i < copy.size(); i++)
+    EXPECT_NE(copy.find(copy[i]), (size_t)-1);
+}
+
+TEST(Filtered, ConcurrentQueries)
+{
+  sorted_vector_filtered <long> sv(even_keys(50000, 6));
+  const sorted_vector_filtered <long> &c = sv;
+  std::vector <size_t> errors(4, 0);
+  std::vector <std::thread> threads;
+  for (size_t k = 0; k < errors.size(); k++)
+    threads.emplace_back([&, k]() {
+      for (size_t i = k; i < c.size(); i += 3)
+        if (c.find(c.data()[i]) == (size_t)-1)
+          errors[k]++;
+    });
+  for (size_t k = 0; k < threads.size(); k++)
+    threads[k].join();
+  for (size_t k = 0; k < errors.size(); k++)
+    EXPECT_EQ(errors[k], 0u);
+}
@@ -0,0 +1,90 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+static_assert(
+  std::is_same <std::iterator_traits <front_coded_sorted_vector::const_iterator>::value_type, string_ref>::value,
+  "front_coded_sorted_vector iterator value type");
+
+namespace {
+
+std::vector <std::string> urls(size_t n)
+{
+  std::mt19937_64 g(1);
+  std::vector <std::string> v;
+  char buf[96];
+  for (size_t i = 0; i < n; i++) {
+    snprintf(buf, sizeof(buf), "https://example.com/%s/item/%05u",
+      (g() & 1) ? "catalog" : "archive", (unsigned)(g() % 20000));
+    v.push_back(buf);
+  }
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+} // namespace
+
+TEST(FrontCoded, MatchesSortedVector)
+{
+  std::vector <std::string> m = urls(3000);
+  front_coded_sorted_vector f{std::vector <std::string> (m)};
+  sorted_vector <std::string> sv(m);
+  ASSERT_EQ(f.size(), m.size());
+
+  size_t i = 0;
+  for (auto it = f.begin(); it != f.end(); ++it, ++i)
+    ASSERT_EQ(std::string(*it), m[i]);
+  EXPECT_EQ(i, m.size());
+
+  for (size_t k = 0; k < m.size(); k += 11) {
+    EXPECT_EQ(f[k], m[k]);
+    EXPECT_EQ(f.find_first(m[k]), sv.find_first(m[k]));
+    EXPECT_EQ(f.find_last(m[k]), sv.find_last(m[k]));
+    EXPECT_EQ(f.rank(m[k]), sv.rank(m[k]));
+    std::string probe = m[k] + "!";
+    EXPECT_EQ(f.find(probe), (size_t)-1);
+    EXPECT_EQ(f.find_floor(probe), sv.find_floor(probe));
+    EXPECT_EQ(f.find_ceil(probe), sv.find_ceil(probe));
+  }
+  EXPECT_EQ(
+    f.count_range("https://example.com/archive", "https://example.com/archive/item/10000"),
+    sv.count_range("https://example.com/archive", "https://example.com/archive/item/10000"));
+}
+
+TEST(FrontCoded, StringRefConversions)
+{
+  front_coded_sorted_vector f{std::vector <std::string> {"alpha", "beta", "gamma"}};
+  std::string key = "beta";
+  std::string_view view = key;
+
+  EXPECT_EQ(f.find("beta"), 1u);
+  EXPECT_EQ(f.find(key), 1u);
+  EXPECT_EQ(f.find(view), 1u);
+  EXPECT_EQ(f.find(string_ref(key.data(), 2)), (size_t)-1);
+
+  string_ref r = *f.begin();
+  EXPECT_EQ(std::string(r), "alpha");
+  EXPECT_EQ(std::string_view(r), "alpha");
+  EXPECT_TRUE(r < string_ref("beta"));
+  EXPECT_TRUE(r == string_ref("alpha"));
+}
+
+TEST(FrontCoded, Empty)
+{
+  front_coded_sorted_vector f;
+  EXPECT_TRUE(f.empty());
+  EXPECT_EQ(f.find("x"), (size_t)-1);
+  EXPECT_EQ(f.count_range("a", "z"), 0u);
+  EXPECT_TRUE(f.begin() == f.end());
+}
@@ -0,0 +1,68 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+TEST(Frozen, MatchesSortedVector)
+{
+  //Поиск снимка - с семантикой sorted_vector
+  std::mt19937_64 g(1);
+  for (int it = 0; it < 100; it++) {
+    std::vector <int> m;
+    size_t n = g() % 300;
+    for (size_t i = 0; i < n; i++)
+      m.push_back((int)(g() % 100));
+    sorted_vector <int> sv(m);
+    const sorted_vector <int> &ref = sv;
+    sorted_vector <int> source(m);
+    frozen_sorted_vector <int> fz = source.freeze();
+    EXPECT_TRUE(source.empty());
+    ASSERT_EQ(fz.size(), ref.size());
+
+    for (int t = -2; t < 103; t++) {
+      EXPECT_EQ(fz.find_first(t), ref.find_first(t));
+      EXPECT_EQ(fz.find_last(t), ref.find_last(t));
+      EXPECT_EQ(fz.find_floor(t), ref.find_floor(t));
+      EXPECT_EQ(fz.find_ceil(t), ref.find_ceil(t));
+      EXPECT_EQ(fz.contains(t), ref.find(t) != (size_t)-1);
+      EXPECT_EQ(fz.rank(t), ref.rank(t));
+      EXPECT_EQ(fz.count_range(t, t + 5), ref.count_range(t, t + 5));
+      sorted_vector_view <int> r = fz.range(t, t + 5);
+      EXPECT_EQ((size_t)(r.end() - r.begin()), ref.count_range(t, t + 5));
+    }
+  }
+}
+
+TEST(Frozen, FreezeRepairsAndThawRestores)
+{
+  sorted_vector <int> sv({1, 2, 3, 4});
+  sv.storage()[0] = 9;
+  ASSERT_TRUE(sv.corrupted());
+  frozen_sorted_vector <int> fz = sv.freeze();
+  EXPECT_EQ(std::vector <int> (fz.begin(), fz.end()), (std::vector <int> {2, 3, 4, 9}));
+  EXPECT_EQ(fz.front(), 2);
+  EXPECT_EQ(fz.back(), 9);
+  EXPECT_THROW(fz.at(4), std::out_of_range);
+
+  sorted_vector <int> back = fz.thaw();
+  EXPECT_TRUE(fz.empty());
+  EXPECT_FALSE(back.corrupted());
+  back.push(5);
+  EXPECT_EQ(back.cstorage(), (std::vector <int> {2, 3, 4, 5, 9}));
+}
+
+TEST(Frozen, Empty)
+{
+  sorted_vector <int> sv;
+  frozen_sorted_vector <int> fz = sv.freeze();
+  EXPECT_EQ(fz.find(1), (size_t)-1);
+  EXPECT_EQ(fz.rank(1), 0u);
+  EXPECT_EQ(fz.count_range(0, 10), 0u);
+  EXPECT_FALSE(fz.contains(1));
+}
@@ -0,0 +1,175 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct record
+{
+  int _key;
+  int group;
+  int score;
+};
+
+bool operator<(const record &a, const record &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const record &a, const record &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const record &a, const record &b)
+{
+  return a._key == b._key;
+}
+
+struct by_group
+{
+  int operator()(const record &r) const
+  {
+    return r.group;
+  }
+};
+
+struct by_score
+{
+  int operator()(const record &r) const
+  {
+    return r.score;
+  }
+};
+
+typedef sorted_vector_indexed <record, sorted_vector_with_key <record, int>, by_group, by_score> indexed;
+
+record random_record(std::mt19937_64 &g)
+{
+  record r = {(int)(g() % 1000), (int)(g() % 20), (int)(g() % 50)};
+  return r;
+}
+
+template <class Proj>
+  std::vector <size_t> linear_positions(const indexed &c, int key)
+{
+  std::vector <size_t> positions;
+  Proj proj;
+  for (size_t i = 0; i < c.size(); i++)
+    if (proj(c[i]) == key)
+      positions.push_back(i);
+  return positions;
+}
+
+void expect_matches(const indexed &c, int group, int score)
+{
+  std::vector <size_t> expected = linear_positions <by_group> (c, group);
+  std::vector <size_t> positions;
+  c.find_all_by <by_group> (group, positions);
+  EXPECT_EQ(positions, expected);
+  EXPECT_EQ(c.count_by <by_group> (group), expected.size());
+  EXPECT_EQ(c.find_by <by_group> (group), expected.empty() ? (size_t)-1 : expected[0]);
+
+  expected = linear_positions <by_score> (c, score);
+  EXPECT_EQ(c.count_by <by_score> (score), expected.size());
+  EXPECT_EQ(c.find_by <by_score> (score), expected.empty() ? (size_t)-1 : expected[0]);
+}
+
+} // namespace
+
+TEST(Indexed, MatchesLinearScan)
+{
+  std::mt19937_64 g(1);
+  std::vector <record> v;
+  for (int i = 0; i < 3000; i++)
+    v.push_back(random_record(g));
+  indexed sv(v);
+  const indexed &c = sv;
+  for (int k = -1; k < 52; k++)
+    expect_matches(c, k, k);
+  EXPECT_GT(c.index_memory_usage(), 0u);
+}
+
+TEST(Indexed, MaintainedUnderUpdates)
+{
+  //Индексы поддерживаются инкрементально
+  //при вставке, удалении и замене
+  std::mt19937_64 g(2);
+  indexed sv;
+  const indexed &c = sv;
+  for (int i = 0; i < 500; i++)
+    sv.push(random_record(g));
+  c.find_by <by_group> (0);
+  for (int i = 0; i < 2000; i++) {
+    switch (g() % 4) {
+      case 0:
+      case 1:
+        sv.push(random_record(g));
+        break;
+      case 2:
+        if (!sv.empty())
+          sv.erase((size_t)(g() % sv.size()));
+        break;
+      default:
+        sv.replace(random_record(g));
+    }
+    if (i % 50 == 0)
+      expect_matches(c, (int)(g() % 20), (int)(g() % 50));
+  }
+  expect_matches(c, 3, 7);
+}
+
+TEST(Indexed, CorruptedAndRebuilt)
+{
+  std::mt19937_64 g(3);
+  std::vector <record> v;
+  for (int i = 0; i < 200; i++)
+    v.push_back(random_record(g));
+  indexed sv(v);
+  const indexed &c = sv;
+  expect_matches(c, 5, 5);
+  sv.storage()[10].group = 99;
+  ASSERT_TRUE(sv.corrupted());
+  EXPECT_EQ(c.count_by <by_group> (99), 1u);
+  sv.sort();
+  expect_matches(c, 99, 5);
+  sv.merge(std::vector <record> (3, record{500, 99, 1}));
+  expect_matches(c, 99, 1);
+}
+
+TEST(Indexed, CopyAndConcurrentQueries)
+{
+  std::mt19937_64 g(4);
+  std::vector <record> v;
+  for (int i = 0; i < 20000; i++)
+    v.push_back(random_record(g));
+  indexed sv(v);
+  sv.find_by <by_group> (0);
+  const indexed copy(sv);
+  EXPECT_EQ(copy.index_memory_usage(), 0u);
+
+  //Индексы копии строятся одновременными запросами
+  std::vector <size_t> counts(20, 0);
+  for (size_t i = 0; i < copy.size(); i++)
+    counts[copy[i].group]++;
+  std::vector <size_t> errors(4, 0);
+  std::vector <std::thread> threads;
+  for (size_t k = 0; k < errors.size(); k++)
+    threads.emplace_back([&, k]() {
+      for (int r = 0; r < 50; r++)
+        for (int group = 0; group < 20; group++)
+          if (copy.count_by <by_group> (group) != counts[group])
+            errors[k]++;
+    });
+  for (size_t k = 0; k < threads.size(); k++)
+    threads[k].join();
+  for (size_t k = 0; k < errors.size(); k++)
+    EXPECT_EQ(errors[k], 0u);
+}
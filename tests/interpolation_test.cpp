@@ -0,0 +1,180 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+//Интерполяционный поиск сравнивается с бинарным поиском
+//того же содержимого и с моделью на std::lower_bound
+template <class T>
+  void expect_same_as_binary(const std::vector <T> &values, const std::vector <T> &probes, std::mt19937_64 &g)
+{
+  sorted_vector <T> binary(values);
+  sorted_vector <T> interpolated(values);
+  interpolated.set_search_strategy(search_interpolation);
+  ASSERT_EQ(interpolated.get_search_strategy(), search_interpolation);
+  const sorted_vector <T> &b = binary;
+  const sorted_vector <T> &i = interpolated;
+  std::vector <T> m(values);
+  std::sort(m.begin(), m.end());
+
+  for (size_t k = 0; k < probes.size(); k++) {
+    const T &t = probes[k];
+    size_t any = b.find(t);
+    size_t first = b.find_first(t);
+    EXPECT_EQ(i.find_interpolated(t), first);
+    EXPECT_EQ(b.find_interpolated(t), first);
+    EXPECT_EQ(first == (size_t)-1, any == (size_t)-1);
+    EXPECT_EQ(i.find(t), first);
+    EXPECT_EQ(i.find_first(t), first);
+    EXPECT_EQ(i.find_last(t), b.find_last(t));
+    EXPECT_EQ(i.find_floor(t), b.find_floor(t));
+    EXPECT_EQ(i.find_ceil(t), b.find_ceil(t));
+    EXPECT_EQ(i.rank(t), b.rank(t));
+
+    //Поиск в части вектора
+    if (m.empty())
+      continue;
+    size_t start = (size_t)(g() % m.size());
+    size_t end = start + (size_t)(g() % (m.size() - start));
+    size_t lo = std::lower_bound(m.begin() + start, m.begin() + end + 1, t) - m.begin();
+    size_t hi = std::upper_bound(m.begin() + start, m.begin() + end + 1, t) - m.begin();
+    size_t expected = (lo < hi) ? lo : (size_t)-1;
+    EXPECT_EQ(i.find_interpolated(t, start, end), expected);
+    EXPECT_EQ(b.find_first(t, start, end), expected);
+    EXPECT_EQ(i.find_first(t, start, end), expected);
+    EXPECT_EQ(i.find_last(t, start, end), (lo < hi) ? hi - 1 : (size_t)-1);
+    EXPECT_EQ(i.find_floor(t, start, end), (lo < hi) ? lo : (lo == start ? (size_t)-1 : lo - 1));
+  }
+}
+
+template <class T>
+  std::vector <T> probes_for(const std::vector <T> &values, std::mt19937_64 &g)
+{
+  //Присутствующие значения и случайные между ними
+  //и за краями
+  std::vector <T> probes;
+  for (size_t k = 0; k < 200 && !values.empty(); k++)
+    probes.push_back(values[(size_t)(g() % values.size())]);
+  if (values.empty())
+    return probes;
+  T lo = *std::min_element(values.begin(), values.end());
+  T hi = *std::max_element(values.begin(), values.end());
+  std::uniform_real_distribution <double> d(-0.1, 1.1);
+  for (size_t k = 0; k < 200; k++)
+    probes.push_back((T)((double)lo + d(g) * ((double)hi - (double)lo)));
+  return probes;
+}
+
+} // namespace
+
+TEST(Interpolation, UniformIntegers)
+{
+  std::mt19937_64 g(1);
+  for (size_t n : {1, 2, 3, 17, 1000, 20000}) {
+    std::vector <long> v;
+    for (size_t k = 0; k < n; k++)
+      v.push_back((long)(g() % (n * 10)) - (long)n);
+    expect_same_as_binary(v, probes_for(v, g), g);
+  }
+}
+
+TEST(Interpolation, SkewedIntegers)
+{
+  //Экспоненциально растущие ключи - худший случай
+  //для предсказания позиции
+  std::mt19937_64 g(2);
+  std::vector <long long> v;
+  for (int k = 0; k < 62; k++)
+    for (int r = 0; r < 50; r++)
+      v.push_back((1LL << k) + r);
+  std::vector <long long> probes = probes_for(v, g);
+  for (int k = 0; k < 62; k++)
+    probes.push_back((1LL << k) - 1);
+  expect_same_as_binary(v, probes, g);
+}
+
+TEST(Interpolation, DuplicateHeavyIntegers)
+{
+  std::mt19937_64 g(3);
+  std::vector <int> v;
+  for (int k = 0; k < 5000; k++)
+    v.push_back((int)(g() % 4) * 1000);
+  v.push_back(2147483647);
+  v.push_back(-2147483647 - 1);
+  std::vector <int> probes = probes_for(v, g);
+  probes.push_back(0);
+  probes.push_back(1000);
+  probes.push_back(2999);
+  expect_same_as_binary(v, probes, g);
+
+  std::vector <unsigned> same(3000, 7u);
+  std::vector <unsigned> same_probes = {0u, 6u, 7u, 8u, 4294967295u};
+  expect_same_as_binary(same, same_probes, g);
+}
+
+TEST(Interpolation, Doubles)
+{
+  std::mt19937_64 g(4);
+  std::uniform_real_distribution <double> uniform(-1e6, 1e6);
+  std::exponential_distribution <double> skewed(0.01);
+  std::vector <double> u;
+  std::vector <double> s;
+  std::vector <double> d;
+  for (int k = 0; k < 10000; k++) {
+    u.push_back(uniform(g));
+    s.push_back(std::pow(skewed(g), 4));
+    d.push_back((double)(g() % 8) * 0.5);
+  }
+  expect_same_as_binary(u, probes_for(u, g), g);
+  expect_same_as_binary(s, probes_for(s, g), g);
+  std::vector <double> d_probes = probes_for(d, g);
+  d_probes.push_back(-0.0);
+  d_probes.push_back(3.5);
+  d_probes.push_back(3.75);
+  expect_same_as_binary(d, d_probes, g);
+}
+
+TEST(Interpolation, InfiniteEndpoints)
+{
+  //Бесконечные края и интервал шире DBL_MAX не дают
+  //предсказания: поиск продолжается бинарным
+  std::mt19937_64 g(5);
+  std::uniform_real_distribution <double> uniform(-1e6, 1e6);
+  std::vector <double> v;
+  for (int k = 0; k < 10000; k++)
+    v.push_back(uniform(g));
+  std::vector <double> probes;
+  for (int k = 0; k < 200; k++)
+    probes.push_back(v[(size_t)(g() % v.size())]);
+  for (int k = 0; k < 200; k++)
+    probes.push_back(uniform(g));
+  probes.push_back(-HUGE_VAL);
+  probes.push_back(HUGE_VAL);
+  probes.push_back(0.0);
+
+  std::vector <double> lower(v);
+  lower.push_back(-HUGE_VAL);
+  lower.push_back(-HUGE_VAL);
+  expect_same_as_binary(lower, probes, g);
+
+  std::vector <double> upper(v);
+  upper.push_back(HUGE_VAL);
+  expect_same_as_binary(upper, probes, g);
+
+  std::vector <double> both(upper);
+  both.push_back(-HUGE_VAL);
+  expect_same_as_binary(both, probes, g);
+
+  std::vector <double> wide(v);
+  wide.push_back(-1.5e308);
+  wide.push_back(1.5e308);
+  expect_same_as_binary(wide, probes, g);
+}
@@ -0,0 +1,144 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+std::vector <long> random_keys(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution <long> dist(0, (long)n * 4);
+  std::vector <long> v(n);
+  for (size_t i = 0; i < n; i++)
+    v[i] = dist(rng);
+  return v;
+}
+
+void expect_matches(const sorted_vector_learned <long> &sv, long t)
+{
+  std::vector <long> v(sv.data(), sv.data() + sv.size());
+  size_t lo = std::lower_bound(v.begin(), v.end(), t) - v.begin();
+  size_t hi = std::upper_bound(v.begin(), v.end(), t) - v.begin();
+  EXPECT_EQ(sv.rank(t), lo);
+  EXPECT_EQ(sv.find_first(t), lo < hi ? lo : (size_t)-1);
+  EXPECT_EQ(sv.find_last(t), lo < hi ? hi - 1 : (size_t)-1);
+  EXPECT_EQ(sv.find_floor(t), lo < hi ? lo : (lo == 0 ? (size_t)-1 : lo - 1));
+  EXPECT_EQ(sv.find_ceil(t), lo < hi ? hi - 1 : (hi == v.size() ? (size_t)-1 : hi));
+  EXPECT_EQ(sv.count_range(t, t + 10),
+    (size_t)(std::upper_bound(v.begin(), v.end(), t + 10) - v.begin()) - lo);
+}
+
+} // namespace
+
+TEST(Learned, MatchesBinarySearch)
+{
+  sorted_vector_learned <long> sv(random_keys(20000, 1));
+  for (long t = -5; t < 80010; t += 7)
+    expect_matches(sv, t);
+  EXPECT_TRUE(sv.trained());
+}
+
+TEST(Learned, KeepsModelAcrossUpdates)
+{
+  //Отдельные вставки и удаления не сбрасывают модель:
+  //окно поиска расширяется на число изменений
+  sorted_vector_learned <long> sv(random_keys(20000, 2));
+  sv.rank(0);
+  ASSERT_TRUE(sv.trained());
+  std::mt19937 rng(3);
+  std::uniform_int_distribution <long> dist(-100, 80100);
+  for (int i = 0; i < 200; i++) {
+    if (i % 3 == 2)
+      sv.erase((size_t)(rng() % sv.size()));
+    else
+      sv.push(dist(rng));
+    EXPECT_TRUE(sv.trained());
+    for (int j = 0; j < 5; j++)
+      expect_matches(sv, dist(rng));
+  }
+}
+
+TEST(Learned, RetrainsAfterDrift)
+{
+  sorted_vector_learned <long> sv(random_keys(4096, 4));
+  sv.rank(0);
+  ASSERT_TRUE(sv.trained());
+  for (long i = 0; i < 2 * CIM_SORTED_VECTOR_LEARNED_LEAF; i++)
+    sv.push(i * 3);
+  EXPECT_FALSE(sv.trained());
+  for (long t = -5; t < 20000; t += 11)
+    expect_matches(sv, t);
+  EXPECT_TRUE(sv.trained());
+
+  //Полное перестроение сбрасывает модель
+  sv.merge(random_keys(100, 5));
+  EXPECT_FALSE(sv.trained());
+}
+
+TEST(Learned, AppendedKeysBeyondModel)
+{
+  //Отметки времени: новые ключи больше всех обученных
+  std::vector <long> v(10000);
+  for (size_t i = 0; i < v.size(); i++)
+    v[i] = 1000000000L + (long)i * 10;
+  sorted_vector_learned <long> sv(v);
+  sv.rank(0);
+  for (long i = 0; i < 100; i++)
+    sv.push(1000000000L + 100000 + i * 10);
+  for (long t = 1000000000L - 5; t < 1000000000L + 101100; t += 13)
+    expect_matches(sv, t);
+}
+
+TEST(Learned, SmallAndCorrupted)
+{
+  sorted_vector_learned <long> small(random_keys(100, 6));
+  expect_matches(small, 50);
+  EXPECT_FALSE(small.trained());
+
+  sorted_vector_learned <long> sv(random_keys(5000, 7));
+  sv.rank(0);
+  sv.storage()[0] = 1000000;
+  ASSERT_TRUE(sv.corrupted());
+  EXPECT_EQ(sv.max_error(), 0u);
+}
+
+TEST(Learned, CopyRetrains)
+{
+  sorted_vector_learned <long> sv(random_keys(10000, 8));
+  sv.rank(0);
+  sorted_vector_learned <long> copy(sv);
+  EXPECT_FALSE(copy.trained());
+  for (long t = 0; t < 40000; t += 17)
+    expect_matches(copy, t);
+}
+
+TEST(Learned, ConcurrentQueries)
+{
+  //Константные запросы из нескольких потоков к
+  //необученному экземпляру: модель обучается один раз
+  sorted_vector_learned <long> sv(random_keys(50000, 9));
+  const sorted_vector_learned <long> &c = sv;
+  std::vector <long> v(c.data(), c.data() + c.size());
+  std::vector <size_t> errors(4, 0);
+  std::vector <std::thread> threads;
+  for (size_t k = 0; k < errors.size(); k++)
+    threads.emplace_back([&, k]() {
+      for (long t = (long)k; t < 200000; t += 37) {
+        size_t expected = std::lower_bound(v.begin(), v.end(), t) - v.begin();
+        if (c.rank(t) != expected)
+          errors[k]++;
+      }
+    });
+  for (size_t k = 0; k < threads.size(); k++)
+    threads[k].join();
+  for (size_t k = 0; k < errors.size(); k++)
+    EXPECT_EQ(errors[k], 0u);
+  EXPECT_TRUE(sv.trained());
+}
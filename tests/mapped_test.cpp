@@ -0,0 +1,198 @@
+#include "mapped_sorted_vector.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+//Свой файл у каждого процесса: ctest может запускать
+//обе программы одновременно
+const std::string test_file = "mapped_sorted_vector_test_" + std::to_string(getpid()) + ".bin";
+const char *test_path = test_file.c_str();
+
+void patch_header(const char *path, const sorted_vector_file_header &h)
+{
+  FILE *f = fopen(path, "r+b");
+  ASSERT_NE(f, nullptr);
+  ASSERT_EQ(fwrite(&h, sizeof(h), 1, f), 1u);
+  fclose(f);
+}
+
+struct keyed
+{
+  int _key;
+  int payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+sorted_vector_file_header read_header(const char *path)
+{
+  sorted_vector_file_header h;
+  memset(&h, 0, sizeof(h));
+  FILE *f = fopen(path, "rb");
+  if (f != nullptr) {
+    if (fread(&h, sizeof(h), 1, f) != 1)
+      memset(&h, 0, sizeof(h));
+    fclose(f);
+  }
+  return h;
+}
+
+} // namespace
+
+TEST(Mapped, SaveLoadRoundTrip)
+{
+  std::mt19937_64 g(1);
+  sorted_vector <uint64_t> sv;
+  for (int i = 0; i < 10000; i++)
+    sv.push(g() % 1000000);
+  ASSERT_TRUE(save_sorted_vector(sv, test_path));
+
+  sorted_vector <uint64_t> loaded;
+  ASSERT_TRUE(load_sorted_vector(test_path, loaded));
+  EXPECT_FALSE(loaded.corrupted());
+  EXPECT_EQ(loaded.cstorage(), sv.cstorage());
+
+  mapped_sorted_vector <uint64_t> m(test_path);
+  ASSERT_TRUE(m.is_open());
+  ASSERT_EQ(m.size(), sv.size());
+  for (size_t i = 0; i < sv.size(); i += 97) {
+    uint64_t t = sv[i];
+    EXPECT_EQ(m.find_first(t), sv.find_first(t));
+    EXPECT_EQ(m.rank(t), sv.rank(t));
+  }
+  remove(test_path);
+}
+
+TEST(Mapped, LoadUnsortedWithKey)
+{
+  //Неупорядоченный файл сортируется порядком
+  //sorted_vector_with_key: по ключу, устойчиво
+  std::mt19937_64 g(2);
+  std::vector <keyed> k(50000);
+  for (size_t i = 0; i < k.size(); i++)
+    k[i] = keyed{(int)(g() % 2000) - 1000, (int)i};
+  sorted_vector <keyed> unsorted;
+  unsorted.storage() = k;
+  ASSERT_TRUE(unsorted.corrupted());
+  ASSERT_TRUE(save_sorted_vector(unsorted, test_path));
+  ASSERT_FALSE(read_header(test_path).flags & sorted_vector_file_sorted);
+
+  sorted_vector_with_key <keyed, int> loaded;
+  ASSERT_TRUE(load_sorted_vector(test_path, loaded));
+  remove(test_path);
+  const sorted_vector_with_key <keyed, int> &c = loaded;
+  EXPECT_FALSE(c.corrupted());
+  std::stable_sort(k.begin(), k.end());
+  ASSERT_EQ(c.size(), k.size());
+  for (size_t i = 0; i < k.size(); i++) {
+    ASSERT_EQ(c[i]._key, k[i]._key);
+    ASSERT_EQ(c[i].payload, k[i].payload);
+  }
+  size_t pos = c.find(k[100]._key);
+  ASSERT_LT(pos, c.size());
+  EXPECT_EQ(c[pos]._key, k[100]._key);
+}
+
+TEST(Mapped, RejectsCountBeyondFileSize)
+{
+  sorted_vector <uint32_t> sv = {1, 2, 3};
+  ASSERT_TRUE(save_sorted_vector(sv, test_path));
+  sorted_vector_file_header h = read_header(test_path);
+
+  sorted_vector <uint32_t> loaded = {7};
+  h.count = 1000;
+  patch_header(test_path, h);
+  EXPECT_FALSE(load_sorted_vector(test_path, loaded));
+  EXPECT_EQ(loaded.size(), 1u);
+
+  //count * sizeof(T) переполняет 64 бита
+  h.count = UINT64_MAX / 2;
+  patch_header(test_path, h);
+  EXPECT_FALSE(load_sorted_vector(test_path, loaded));
+  EXPECT_FALSE(mapped_sorted_vector <uint32_t> (test_path).is_open());
+
+  h.count = 3;
+  h.data_offset = UINT64_MAX - 8;
+  patch_header(test_path, h);
+  EXPECT_FALSE(load_sorted_vector(test_path, loaded));
+  EXPECT_FALSE(mapped_sorted_vector <uint32_t> (test_path).is_open());
+  remove(test_path);
+}
+
+TEST(Mapped, RejectsWrongElementSizeAndMissingFile)
+{
+  sorted_vector <uint32_t> sv = {1, 2, 3};
+  ASSERT_TRUE(save_sorted_vector(sv, test_path));
+  sorted_vector <uint64_t> wide;
+  EXPECT_FALSE(load_sorted_vector(test_path, wide));
+  remove(test_path);
+  EXPECT_FALSE(load_sorted_vector(test_path, wide));
+}
+
+TEST(Mapped, RejectsInconsistentIndex)
+{
+  sorted_vector <uint64_t> sv;
+  for (uint64_t i = 0; i < 10000; i++)
+    sv.push(i * 2);
+  ASSERT_TRUE(save_sorted_vector(sv, test_path));
+  const sorted_vector_file_header saved = read_header(test_path);
+  ASSERT_TRUE(saved.flags & sorted_vector_file_index);
+  ASSERT_GT(saved.index_count, 1u);
+  EXPECT_TRUE(mapped_sorted_vector <uint64_t> (test_path).is_open());
+
+  //Индекс из элементов с размером записи, отличным от
+  //sizeof(T), и смещением, проходящим проверку границ
+  sorted_vector_file_header h = saved;
+  h.key_size = 1;
+  h.index_offset = saved.index_offset + saved.index_count * sizeof(uint64_t) - saved.index_count;
+  patch_header(test_path, h);
+  EXPECT_FALSE(mapped_sorted_vector <uint64_t> (test_path).is_open());
+
+  h = saved;
+  h.data_offset = saved.data_offset + 4;
+  h.count = saved.count - 1;
+  patch_header(test_path, h);
+  EXPECT_FALSE(mapped_sorted_vector <uint64_t> (test_path).is_open());
+
+  h = saved;
+  h.index_stride = 0;
+  patch_header(test_path, h);
+  EXPECT_FALSE(mapped_sorted_vector <uint64_t> (test_path).is_open());
+
+  //Записей индекса больше, чем блоков
+  h = saved;
+  h.index_stride = 1;
+  h.index_count = saved.index_count;
+  h.count = saved.index_count - 1;
+  patch_header(test_path, h);
+  EXPECT_FALSE(mapped_sorted_vector <uint64_t> (test_path).is_open());
+
+  patch_header(test_path, saved);
+  mapped_sorted_vector <uint64_t> m(test_path);
+  ASSERT_TRUE(m.is_open());
+  EXPECT_EQ(m.find(19998), 9999u);
+  remove(test_path);
+}
@@ -0,0 +1,143 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+TEST(PopFront, MatchesModel)
+{
+  //Удаление из начала смещает начало хранилища;
+  //содержимое и поиск совпадают с моделью
+  std::mt19937_64 g(1);
+  sorted_vector <int> sv;
+  const sorted_vector <int> &c = sv;
+  std::vector <int> m;
+  for (int i = 0; i < 20000; i++) {
+    int t = (int)(g() % 1000);
+    switch (g() % 6) {
+      case 0:
+      case 1:
+        sv.push(t);
+        m.insert(std::upper_bound(m.begin(), m.end(), t), t);
+        break;
+      case 2:
+        if (!m.empty()) {
+          sv.pop_front();
+          m.erase(m.begin());
+        }
+        break;
+      case 3:
+        if (!m.empty()) {
+          size_t pos = (size_t)(g() % m.size());
+          sv.erase(pos);
+          m.erase(m.begin() + pos);
+        }
+        break;
+      case 4:
+        if (m.size() > 4) {
+          sv.erase(0, 2);
+          m.erase(m.begin(), m.begin() + 3);
+        }
+        break;
+      default:
+        EXPECT_EQ(c.rank(t), (size_t)(std::lower_bound(m.begin(), m.end(), t) - m.begin()));
+    }
+    ASSERT_EQ(c.size(), m.size());
+    if (i % 500 == 0) {
+      EXPECT_TRUE(std::equal(c.data(), c.data() + c.size(), m.begin()));
+    }
+  }
+  EXPECT_FALSE(c.corrupted());
+  EXPECT_EQ(std::vector <int> (c.data(), c.data() + c.size()), m);
+}
+
+TEST(PopFront, SetOperationsAfterPopFront)
+{
+  //Операции над множествами читают хранилище со
+  //смещённым началом без копирования
+  sorted_vector <int> a;
+  sorted_vector <int> b;
+  for (int i = 0; i < 100; i++) {
+    a.push(i);
+    b.push(i * 2);
+  }
+  for (int i = 0; i < 10; i++) {
+    a.pop_front();
+    b.pop_front();
+  }
+  const sorted_vector <int> &ca = a;
+  const sorted_vector <int> &cb = b;
+  std::vector <int> va(ca.data(), ca.data() + ca.size());
+  std::vector <int> vb(cb.data(), cb.data() + cb.size());
+
+  std::vector <int> expected;
+  std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+  sorted_vector <int> r;
+  a.set_intersection(b, r);
+  EXPECT_EQ(r.cstorage(), expected);
+
+  expected.clear();
+  std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+  a.set_union(b, r);
+  EXPECT_EQ(r.cstorage(), expected);
+
+  expected.clear();
+  std::set_difference(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+  a.set_difference(b, r);
+  EXPECT_EQ(r.cstorage(), expected);
+
+  //Результат на месте одного из операндов
+  a.set_intersection(b, a);
+  expected.clear();
+  std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+  EXPECT_EQ(a.cstorage(), expected);
+}
+
+TEST(PopFront, SetAndMapStorageStayPacked)
+{
+  //storage() sorted_set и keys() sorted_map - ровно
+  //элементы контейнера и после удаления из начала
+  sorted_set <int> ss;
+  sorted_map <int, std::string> sm;
+  for (int i = 0; i < 100; i++) {
+    ss.insert(i);
+    sm.try_emplace(i, std::to_string(i));
+  }
+  for (int i = 0; i < 30; i++) {
+    ss.erase(i);
+    sm.erase(i);
+  }
+  const std::vector <int> &storage = ss.storage();
+  const std::vector <int> &keys = sm.keys();
+  EXPECT_EQ(storage, std::vector <int> (ss.begin(), ss.end()));
+  EXPECT_EQ(keys, storage);
+  EXPECT_EQ(storage.front(), 30);
+  EXPECT_EQ(sm.values().size(), keys.size());
+  EXPECT_EQ(sm.at(30), "30");
+}
+
+#ifdef CIM_SORTED_VECTOR_STATS
+TEST(PopFront, NoReallocationWithinCapacity)
+{
+  //Перенос элементов в начало вектора при удалении
+  //из начала не считается перераспределением хранилища
+  sorted_vector <int> sv;
+  sv.reserve(64);
+  for (int i = 0; i < 64; i++)
+    sv.push(i);
+  sv.reset_stats();
+  for (int i = 0; i < 48; i++)
+    sv.pop_front();
+  for (int i = 64; i < 112; i++)
+    sv.push(i);
+  EXPECT_EQ(sv.stats().reallocations, 0u);
+  sv.push(112);
+  EXPECT_EQ(sv.stats().reallocations, 1u);
+}
+#endif // CIM_SORTED_VECTOR_STATS
@@ -0,0 +1,106 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct keyed
+{
+  int _key;
+  int payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+} // namespace
+
+TEST(Range, MatchesBounds)
+{
+  std::mt19937_64 g(1);
+  for (int it = 0; it < 300; it++) {
+    std::vector <int> m;
+    size_t n = g() % 300;
+    for (size_t i = 0; i < n; i++)
+      m.push_back((int)(g() % 100) - 30);
+    std::sort(m.begin(), m.end());
+    sorted_vector <int> sv(m);
+    const sorted_vector <int> &cs = sv;
+
+    int lo = (int)(g() % 120) - 40;
+    int hi = lo + (int)(g() % 40);
+    auto first = std::lower_bound(m.begin(), m.end(), lo);
+    auto last = std::upper_bound(m.begin(), m.end(), hi);
+
+    sorted_vector_view <int> r = cs.range(lo, hi);
+    ASSERT_EQ((size_t)(r.end() - r.begin()), (size_t)(last - first));
+    EXPECT_TRUE(std::equal(r.begin(), r.end(), first));
+    EXPECT_EQ(cs.count_range(lo, hi), (size_t)(last - first));
+
+    EXPECT_EQ(sv.erase_range(lo, hi), (size_t)(last - first));
+    m.erase(first, last);
+    EXPECT_EQ(sv.cstorage(), m);
+  }
+}
+
+TEST(Range, EmptyAndInvertedIntervals)
+{
+  sorted_vector <int> sv = {1, 2, 3};
+  EXPECT_EQ(sv.count_range(5, 10), 0u);
+  EXPECT_EQ(sv.count_range(3, 1), 0u);
+  EXPECT_TRUE(sv.range(-5, 0).empty());
+
+  sorted_vector <int> empty;
+  EXPECT_TRUE(empty.range(0, 10).empty());
+  EXPECT_EQ(empty.erase_range(0, 10), 0u);
+}
+
+TEST(Range, CorruptedInstance)
+{
+  sorted_vector <int> sv = {1, 2, 3, 4, 5};
+  sv.storage()[0] = 4;
+  const sorted_vector <int> &cs = sv;
+  ASSERT_TRUE(sv.corrupted());
+
+  //Константный range не восстанавливает экземпляр
+  EXPECT_TRUE(cs.range(2, 4).empty());
+  EXPECT_EQ(cs.count_range(2, 4), 4u);
+  EXPECT_TRUE(sv.corrupted());
+
+  sorted_vector_view <int> r = sv.range(2, 4);
+  EXPECT_FALSE(sv.corrupted());
+  EXPECT_EQ(std::vector <int> (r.begin(), r.end()), std::vector <int> ({2, 3, 4, 4}));
+}
+
+TEST(Range, WithKey)
+{
+  sorted_vector_with_key <keyed, int> sv;
+  for (int i = 0; i < 10; i++)
+    sv.push({i, i * 10});
+
+  sorted_vector_view <keyed> r = sv.range(3, 5);
+  ASSERT_EQ(r.size(), 3u);
+  EXPECT_EQ(r.begin()->payload, 30);
+  EXPECT_EQ(sv.count_range(3, 5), 3u);
+  EXPECT_EQ(sv.erase_range(0, 4), 5u);
+  EXPECT_EQ(sv.size(), 5u);
+  EXPECT_EQ(sv[0]._key, 5);
+}
@@ -0,0 +1,120 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct keyed
+{
+  int _key;
+  int payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+} // namespace
+
+TEST(RankSelect, RankAndSelect)
+{
+  std::mt19937_64 g(1);
+  std::vector <uint32_t> m;
+  for (int i = 0; i < 2000; i++)
+    m.push_back((uint32_t)(g() % 500));
+  std::sort(m.begin(), m.end());
+  sorted_vector <uint32_t> sv(m);
+  const sorted_vector <uint32_t> &cs = sv;
+
+  for (uint32_t t = 0; t < 510; t++)
+    ASSERT_EQ(cs.rank(t), (size_t)(std::lower_bound(m.begin(), m.end(), t) - m.begin()));
+  for (size_t k = 0; k < m.size(); k++)
+    ASSERT_EQ(cs.select(k), m[k]);
+  for (size_t k = 0; k < m.size(); k += 7)
+    ASSERT_EQ(cs.rank(cs.select(k)), (size_t)(std::lower_bound(m.begin(), m.end(), m[k]) - m.begin()));
+}
+
+TEST(RankSelect, NearestRankQuantile)
+{
+  sorted_vector <int> sv;
+  for (int i = 1; i <= 100; i++)
+    sv.push(i);
+
+  EXPECT_EQ(sv.quantile(0.0), 1);
+  EXPECT_EQ(sv.quantile(0.5), 50);
+  EXPECT_EQ(sv.quantile(0.99), 99);
+  EXPECT_EQ(sv.quantile(0.991), 100);
+  EXPECT_EQ(sv.quantile(1.0), 100);
+  EXPECT_EQ(sv.quantile(-3.0), 1);
+  EXPECT_EQ(sv.quantile(7.0), 100);
+
+  sorted_vector_view <int> p = sv.percentile_range(0.25, 0.75);
+  ASSERT_EQ(p.size(), 51u);
+  EXPECT_EQ(p.front(), 25);
+  EXPECT_EQ(p.back(), 75);
+  EXPECT_TRUE(sv.percentile_range(0.8, 0.2).empty());
+}
+
+TEST(RankSelect, QuantileRejectsNaN)
+{
+  sorted_vector <int> sv = {1, 2, 3};
+  const sorted_vector <int> &cs = sv;
+  double nan = std::numeric_limits <double>::quiet_NaN();
+  EXPECT_THROW(cs.quantile(nan), std::invalid_argument);
+  EXPECT_THROW(sv.quantile(nan), std::invalid_argument);
+  EXPECT_THROW(sv.percentile_range(0.0, nan), std::invalid_argument);
+}
+
+TEST(RankSelect, CorruptedInstance)
+{
+  sorted_vector <int> sv = {10, 20, 30, 40, 50};
+  sv.storage()[0] = 45;
+  const sorted_vector <int> &cs = sv;
+
+  //Константные методы не восстанавливают экземпляр
+  EXPECT_EQ(cs.select(0), 20);
+  EXPECT_EQ(cs.select(3), 45);
+  EXPECT_EQ(cs.quantile(1.0), 50);
+  EXPECT_EQ(cs.rank(41), 3u);
+  EXPECT_TRUE(cs.percentile_range(0.0, 1.0).empty());
+  EXPECT_TRUE(sv.corrupted());
+
+  EXPECT_EQ(sv.select(3), 45);
+  EXPECT_FALSE(sv.corrupted());
+  EXPECT_EQ(sv.percentile_range(0.0, 1.0).size(), 5u);
+}
+
+TEST(RankSelect, WithKey)
+{
+  sorted_vector_with_key <keyed, int> sv;
+  for (int i = 0; i < 20; i++)
+    sv.push({i * 2, i});
+
+  EXPECT_EQ(sv.rank(7), 4u);
+  EXPECT_EQ(sv.select(4)._key, 8);
+  EXPECT_EQ(sv.select(7, 0)._key, 8);
+  EXPECT_EQ(sv.select(7, 2)._key, 12);
+  EXPECT_EQ(sv.quantile(0.5)._key, 18);
+  EXPECT_EQ(sv.range(4, 8).size(), 3u);
+}
@@ -0,0 +1,241 @@
+#include "sorted_vector.h"
+
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+//Значение, конструктор которого бросает исключение
+//по требованию
+struct fragile
+{
+  static bool fail;
+
+  int v;
+
+  fragile() : v(0) {}
+  fragile(int x) : v(x)
+  {
+    if (fail)
+      throw std::runtime_error("fragile");
+  }
+};
+
+bool fragile::fail = false;
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+//Ключ, копирование которого бросает исключение
+//(побитовое перемещение для него неприменимо)
+struct fragile_key
+{
+  static bool fail;
+
+  int k;
+
+  fragile_key(int x) : k(x) {}
+  fragile_key(const fragile_key &o) : k(o.k)
+  {
+    if (fail)
+      throw std::runtime_error("fragile_key");
+  }
+  fragile_key &operator=(const fragile_key &o) { k = o.k; return *this; }
+};
+
+bool fragile_key::fail = false;
+
+bool operator<(const fragile_key &a, const fragile_key &b)
+{
+  return a.k < b.k;
+}
+
+bool operator>(const fragile_key &a, const fragile_key &b)
+{
+  return b.k < a.k;
+}
+
+bool operator==(const fragile_key &a, const fragile_key &b)
+{
+  return a.k == b.k;
+}
+#endif
+
+template <class Set>
+  std::vector <int> elements(const Set &s)
+{
+  return std::vector <int> (s.begin(), s.end());
+}
+
+} // namespace
+
+TEST(SortedSet, MatchesStdSet)
+{
+  std::mt19937_64 g(1);
+  sorted_set <int> ss;
+  std::set <int> ref;
+  for (int i = 0; i < 5000; i++) {
+    int t = (int)(g() % 500);
+    switch (g() % 4) {
+      case 0: {
+        std::pair <size_t, bool> r = ss.insert(t);
+        EXPECT_EQ(r.second, ref.insert(t).second);
+        EXPECT_EQ(ss[r.first], t);
+        break;
+      }
+      case 1:
+        EXPECT_EQ(ss.emplace(t).second, ref.insert(t).second);
+        break;
+      case 2:
+        EXPECT_EQ(ss.erase(t), ref.erase(t));
+        break;
+      default:
+        EXPECT_EQ(ss.contains(t), ref.count(t) == 1);
+    }
+  }
+  EXPECT_EQ(elements(ss), std::vector <int> (ref.begin(), ref.end()));
+  EXPECT_EQ(std::vector <int> (ss.storage().begin(), ss.storage().end()), elements(ss));
+}
+
+TEST(SortedSet, RangeInsertSkipsDuplicates)
+{
+  sorted_set <int> ss({5, 1, 5, 3});
+  EXPECT_EQ(ss.size(), 3u);
+  std::vector <int> batch = {3, 4, 4, 0, 9, 1};
+  EXPECT_EQ(ss.insert(batch.begin(), batch.end()), 3u);
+  EXPECT_EQ(ss.insert_range(std::vector <int> {9, 10}), 1u);
+  EXPECT_EQ(elements(ss), (std::vector <int> {0, 1, 3, 4, 5, 9, 10}));
+}
+
+TEST(SortedSet, CopyAndMoveStayPacked)
+{
+  //Копия и перемещённый экземпляр удаляют из начала
+  //без смещения: storage содержит только элементы
+  sorted_set <int> src({1, 2, 3, 4, 5, 6});
+  sorted_set <int> copy(src);
+  EXPECT_EQ(copy.erase(1), 1u);
+  EXPECT_EQ(copy.size(), 5u);
+  EXPECT_EQ(copy.storage().size(), copy.size());
+  EXPECT_EQ(copy.storage()[0], 2);
+
+  sorted_set <int> moved(static_cast <sorted_set <int> &&> (src));
+  EXPECT_EQ(moved.erase(1), 1u);
+  EXPECT_EQ(moved.size(), 5u);
+  EXPECT_EQ(moved.storage().size(), moved.size());
+  EXPECT_EQ(moved.storage()[0], 2);
+}
+
+TEST(SortedMap, MatchesStdMap)
+{
+  std::mt19937_64 g(2);
+  sorted_map <int, std::string> sm;
+  std::map <int, std::string> ref;
+  for (int i = 0; i < 5000; i++) {
+    int k = (int)(g() % 300);
+    std::string v = std::to_string(i);
+    switch (g() % 5) {
+      case 0:
+        EXPECT_EQ(sm.insert(std::make_pair(k, v)).second, ref.insert(std::make_pair(k, v)).second);
+        break;
+      case 1:
+        EXPECT_EQ(sm.try_emplace(k, v).second, ref.emplace(k, v).second);
+        break;
+      case 2:
+        EXPECT_EQ(sm.insert_or_assign(k, v).second, ref.count(k) == 0);
+        ref[k] = v;
+        break;
+      case 3:
+        sm[k] += "x";
+        ref[k] += "x";
+        break;
+      default:
+        EXPECT_EQ(sm.erase(k), ref.erase(k));
+    }
+  }
+  ASSERT_EQ(sm.size(), ref.size());
+  ASSERT_EQ(sm.values().size(), sm.size());
+  size_t pos = 0;
+  for (std::map <int, std::string>::const_iterator it = ref.begin(); it != ref.end(); ++it, pos++) {
+    EXPECT_EQ(sm.key(pos), it->first);
+    EXPECT_EQ(sm.value(pos), it->second);
+    EXPECT_EQ(sm.at(it->first), it->second);
+  }
+  EXPECT_THROW(sm.at(-1), std::out_of_range);
+}
+
+TEST(SortedMap, BatchKeepsFirstOccurrence)
+{
+  sorted_map <int, int> sm = {{2, 20}, {4, 40}};
+  std::vector <std::pair <int, int> > batch = {{3, 30}, {2, 21}, {3, 31}, {1, 10}};
+  EXPECT_EQ(sm.insert(batch.begin(), batch.end()), 2u);
+  EXPECT_EQ(std::vector <int> (sm.keys().begin(), sm.keys().end()), (std::vector <int> {1, 2, 3, 4}));
+  EXPECT_EQ(sm.values(), (std::vector <int> {10, 20, 30, 40}));
+}
+
+TEST(SortedMap, CopyAndMoveKeepKeysAndValuesInStep)
+{
+  sorted_map <int, int> src;
+  for (int i = 1; i <= 6; i++)
+    src.insert_or_assign(i, i * 10);
+
+  sorted_map <int, int> copy(src);
+  EXPECT_EQ(copy.erase(1), 1u);
+  EXPECT_EQ(copy.keys().size(), copy.values().size());
+  EXPECT_EQ(copy.keys().size(), 5u);
+  EXPECT_EQ(copy.keys()[0], 2);
+  EXPECT_EQ(copy.values()[0], 20);
+
+  sorted_map <int, int> moved(static_cast <sorted_map <int, int> &&> (src));
+  EXPECT_EQ(moved.erase(1), 1u);
+  EXPECT_EQ(moved.keys().size(), moved.values().size());
+  EXPECT_EQ(moved.keys().size(), 5u);
+  EXPECT_EQ(moved.keys()[0], 2);
+  EXPECT_EQ(moved.values()[0], 20);
+}
+
+TEST(SortedMap, ThrowingValueLeavesMapConsistent)
+{
+  //Исключение при конструировании значения не
+  //оставляет ключа без значения
+  sorted_map <int, fragile> sm;
+  sm.try_emplace(1, 10);
+  sm.try_emplace(3, 30);
+  fragile::fail = true;
+  EXPECT_THROW(sm.try_emplace(2, 20), std::runtime_error);
+  EXPECT_THROW(sm.insert_or_assign(0, 5), std::runtime_error);
+  fragile::fail = false;
+  EXPECT_EQ(sm.size(), 2u);
+  EXPECT_EQ(sm.values().size(), 2u);
+  EXPECT_FALSE(sm.contains(2));
+  EXPECT_FALSE(sm.contains(0));
+  EXPECT_EQ(sm.at(3).v, 30);
+  sm.try_emplace(2, 20);
+  EXPECT_EQ(sm.value(1).v, 20);
+}
+
+#ifndef CIM_SORTED_VECTOR_USE_MEMMOVE
+TEST(SortedMap, ThrowingKeyLeavesMapConsistent)
+{
+  //Значение не вставляется, если вставка ключа
+  //бросила исключение
+  sorted_map <fragile_key, int> sm;
+  sm.reserve(8);
+  fragile_key one(1);
+  fragile_key two(2);
+  sm.try_emplace(one, 10);
+  fragile_key::fail = true;
+  EXPECT_THROW(sm.try_emplace(two, 20), std::runtime_error);
+  EXPECT_THROW(sm.insert_or_assign(two, 20), std::runtime_error);
+  fragile_key::fail = false;
+  EXPECT_EQ(sm.size(), 1u);
+  EXPECT_EQ(sm.values(), std::vector <int> {10});
+  sm.try_emplace(two, 20);
+  EXPECT_EQ(sm.values(), (std::vector <int> {10, 20}));
+}
+#endif
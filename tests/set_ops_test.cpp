@@ -0,0 +1,140 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct keyed
+{
+  int _key;
+  int payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+template <class T>
+  std::vector <T> random_sorted(std::mt19937_64 &g, size_t n, int range)
+{
+  std::vector <T> v;
+  for (size_t i = 0; i < n; i++)
+    v.push_back((T)((long long)(g() % range) - range / 3));
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+template <class T>
+  void check_set_ops(const std::vector <T> &a, const std::vector <T> &b)
+{
+  sorted_vector <T> sa(a), sb(b), r;
+  std::vector <T> e;
+
+  sa.set_intersection(sb, r);
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+  EXPECT_EQ(r.cstorage(), e);
+  EXPECT_FALSE(r.corrupted());
+
+  e.clear();
+  sa.set_union(sb, r);
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+  EXPECT_EQ(r.cstorage(), e);
+
+  e.clear();
+  sa.set_difference(sb, r);
+  std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+  EXPECT_EQ(r.cstorage(), e);
+
+  e.clear();
+  sa.set_symmetric_difference(sb, r);
+  std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+  EXPECT_EQ(r.cstorage(), e);
+}
+
+} // namespace
+
+TEST(SetOps, MatchStdAlgorithms)
+{
+  std::mt19937_64 g(1);
+  for (int it = 0; it < 500; it++) {
+    std::vector <int> a = random_sorted <int> (g, g() % 200, 1 + g() % 300);
+    std::vector <int> b = random_sorted <int> (g, g() % 200, 1 + g() % 300);
+    check_set_ops(a, b);
+  }
+}
+
+TEST(SetOps, GallopingOnSkewedSizes)
+{
+  std::mt19937_64 g(2);
+  for (int it = 0; it < 100; it++) {
+    std::vector <long> a = random_sorted <long> (g, 5 + g() % 10, 100000);
+    std::vector <long> b = random_sorted <long> (g, 5000 + g() % 5000, 100000);
+    check_set_ops(a, b);
+    check_set_ops(b, a);
+  }
+}
+
+TEST(SetOps, Strings)
+{
+  std::vector <std::string> a = {"apple", "kiwi", "kiwi", "pear", "plum"};
+  std::vector <std::string> b = {"banana", "kiwi", "plum", "plum"};
+  check_set_ops(a, b);
+}
+
+TEST(SetOps, EmptyOperands)
+{
+  std::vector <int> a = {1, 2, 3}, empty;
+  check_set_ops(a, empty);
+  check_set_ops(empty, a);
+  check_set_ops(empty, empty);
+}
+
+TEST(SetOps, FreeFunctions)
+{
+  sorted_vector <int> a = {1, 3, 5, 7}, b = {3, 4, 5};
+  EXPECT_EQ(set_intersection(a, b).cstorage(), std::vector <int> ({3, 5}));
+  EXPECT_EQ(set_union(a, b).cstorage(), std::vector <int> ({1, 3, 4, 5, 7}));
+  EXPECT_EQ(set_difference(a, b).cstorage(), std::vector <int> ({1, 7}));
+  EXPECT_EQ(set_symmetric_difference(a, b).cstorage(), std::vector <int> ({1, 4, 7}));
+}
+
+TEST(SetOps, WithKeyComparesKeysOnly)
+{
+  sorted_vector_with_key <keyed, int> a, b, r;
+  a.push({1, 10});
+  a.push({2, 20});
+  a.push({4, 40});
+  b.push({2, 200});
+  b.push({3, 300});
+  b.push({4, 400});
+
+  a.set_intersection(b, r);
+  ASSERT_EQ(r.size(), 2u);
+  EXPECT_EQ(r[0]._key, 2);
+  EXPECT_EQ(r[0].payload, 20);
+  EXPECT_EQ(r[1]._key, 4);
+
+  a.set_difference(b, r);
+  ASSERT_EQ(r.size(), 1u);
+  EXPECT_EQ(r[0]._key, 1);
+}
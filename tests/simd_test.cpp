@@ -0,0 +1,116 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+template <class T>
+  std::vector <T> random_sorted(std::mt19937_64 &g, size_t n, long long range, bool unique)
+{
+  std::vector <T> v;
+  long long shift = std::is_signed <T>::value ? range / 2 : 0;
+  for (size_t i = 0; i < n; i++)
+    v.push_back((T)((long long)(g() % range) - shift));
+  std::sort(v.begin(), v.end());
+  if (unique)
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+  return v;
+}
+
+template <class T>
+  void check_kernels(const std::vector <T> &a, const std::vector <T> &b)
+{
+  std::vector <T> out, e;
+  if (simd::set_operation(a, b, out, false, std::less <T> ())) {
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+    ASSERT_EQ(out, e);
+  }
+  e.clear();
+  if (simd::set_operation(a, b, out, true, std::less <T> ())) {
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+    ASSERT_EQ(out, e);
+  }
+}
+
+template <class T>
+  void check_random(uint64_t seed)
+{
+  std::mt19937_64 g(seed);
+  for (int it = 0; it < 3000; it++) {
+    bool unique = (g() & 1) != 0;
+    long long range = 1 + g() % 400;
+    std::vector <T> a = random_sorted <T> (g, g() % 200, range, unique);
+    std::vector <T> b = random_sorted <T> (g, g() % 200, range, unique);
+    check_kernels(a, b);
+  }
+}
+
+} // namespace
+
+TEST(Simd, Int32)
+{
+  check_random <int32_t> (1);
+}
+
+TEST(Simd, UInt32)
+{
+  check_random <uint32_t> (2);
+}
+
+TEST(Simd, Int64)
+{
+  check_random <int64_t> (3);
+}
+
+TEST(Simd, UInt64)
+{
+  check_random <uint64_t> (4);
+}
+
+TEST(Simd, ExtremeValues)
+{
+  std::vector <int64_t> a = {INT64_MIN, -1, 0, 1, INT64_MAX};
+  std::vector <int64_t> b = {INT64_MIN, 0, 5, 7, INT64_MAX};
+  check_kernels(a, b);
+
+  std::vector <uint32_t> c = {0, 1, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu};
+  std::vector <uint32_t> d = {0, 0x80000000u, 0x80000001u, 0xFFFFFFFFu};
+  check_kernels(c, d);
+}
+
+TEST(Simd, OnlyNaturalOrderIntegers)
+{
+  std::vector <int32_t> a = {3, 2, 1}, b = {2, 1}, out;
+  EXPECT_FALSE(simd::set_operation(a, b, out, false, std::greater <int32_t> ()));
+
+  std::vector <double> c = {1.0, 2.0}, d = {2.0}, dout;
+  EXPECT_FALSE(simd::set_operation(c, d, dout, false, std::less <double> ()));
+}
+
+TEST(Simd, SetOperationsUseKernels)
+{
+  std::mt19937_64 g(5);
+  std::vector <uint32_t> a = random_sorted <uint32_t> (g, 5000, 20000, false);
+  std::vector <uint32_t> b = random_sorted <uint32_t> (g, 5000, 20000, false);
+  sorted_vector <uint32_t> sa(a), sb(b), r;
+  std::vector <uint32_t> e;
+
+  sa.set_intersection(sb, r);
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+  EXPECT_EQ(r.cstorage(), e);
+
+  e.clear();
+  sa.set_union(sb, r);
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+  EXPECT_EQ(r.cstorage(), e);
+}
@@ -0,0 +1,212 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+struct keyed
+{
+  int _key;
+  int payload;
+};
+
+bool operator<(const keyed &a, const keyed &b)
+{
+  return a._key < b._key;
+}
+
+bool operator>(const keyed &a, const keyed &b)
+{
+  return b._key < a._key;
+}
+
+bool operator==(const keyed &a, const keyed &b)
+{
+  return a._key == b._key;
+}
+
+//Содержимое, полностью отсортированное sort(), и
+//ожидаемый результат std::stable_sort
+template <class SV, class T>
+  std::vector <T> sorted_by_instance(const std::vector <T> &v)
+{
+  SV sv;
+  sv.storage() = v;
+  sv.sort();
+  const SV &c = sv;
+  EXPECT_FALSE(c.corrupted());
+  return std::vector <T> (c.data(), c.data() + c.size());
+}
+
+template <class T>
+  std::vector <T> stable_sorted(std::vector <T> v)
+{
+  std::stable_sort(v.begin(), v.end());
+  return v;
+}
+
+std::vector <int> payloads(const std::vector <keyed> &v)
+{
+  std::vector <int> p;
+  for (size_t i = 0; i < v.size(); i++)
+    p.push_back(v[i].payload);
+  return p;
+}
+
+//Вектор из runs серий: возрастающих, строго убывающих
+//и постоянных
+template <class T>
+  std::vector <T> make_runs(size_t runs, size_t length, std::mt19937_64 &g)
+{
+  std::vector <T> v;
+  for (size_t r = 0; r < runs; r++) {
+    long long base = (long long)(g() % 100000) - 50000;
+    switch (g() % 3) {
+      case 0:
+        for (size_t i = 0; i < length; i++)
+          v.push_back((T)(base + (long long)(i * 3)));
+        break;
+      case 1:
+        for (size_t i = 0; i < length; i++)
+          v.push_back((T)(base - (long long)(i * 3)));
+        break;
+      default:
+        for (size_t i = 0; i < length; i++)
+          v.push_back((T)base);
+    }
+  }
+  return v;
+}
+
+} // namespace
+
+TEST(Sort, DescendingRuns)
+{
+  //Строго убывающие серии разворачиваются; равные
+  //элементы в убывающей серии заканчивают её
+  std::vector <int> v;
+  for (int i = 5000; i > 0; i--)
+    v.push_back(i);
+  EXPECT_EQ((sorted_by_instance <sorted_vector <int> > (v)), stable_sorted(v));
+
+  v.clear();
+  for (int r = 0; r < 10; r++)
+    for (int i = 100; i > 0; i--)
+      v.push_back(i / 2 + r * 7);
+  EXPECT_EQ((sorted_by_instance <sorted_vector <int> > (v)), stable_sorted(v));
+
+  //Серии записей со строго убывающими ключами; равные
+  //ключи разных серий сохраняют порядок
+  std::vector <keyed> k;
+  for (int r = 0; r < 4; r++)
+    for (int i = 300; i > 0; i--)
+      k.push_back(keyed{i + r * 50, r * 1000 + i});
+  std::vector <keyed> got = sorted_by_instance <sorted_vector_with_key <keyed, int> > (k);
+  EXPECT_EQ(payloads(got), payloads(stable_sorted(k)));
+}
+
+TEST(Sort, FewRuns)
+{
+  std::mt19937_64 g(1);
+  for (size_t runs = 1; runs <= CIM_SORTED_VECTOR_SORT_RUNS + 2; runs++) {
+    std::vector <long> v = make_runs <long> (runs, 1 + (size_t)(g() % 400), g);
+    EXPECT_EQ((sorted_by_instance <sorted_vector <long> > (v)), stable_sorted(v));
+
+    std::vector <double> d = make_runs <double> (runs, 1 + (size_t)(g() % 400), g);
+    EXPECT_EQ((sorted_by_instance <sorted_vector <double> > (d)), stable_sorted(d));
+
+    //Слияние серий устойчиво; при большем числе серий
+    //короткий вектор сортируется std::sort, и порядок
+    //равных не определён
+    std::vector <keyed> k;
+    std::vector <int> keys = make_runs <int> (runs, 1 + (size_t)(g() % 400), g);
+    for (size_t i = 0; i < keys.size(); i++)
+      k.push_back(keyed{keys[i], (int)i});
+    std::vector <keyed> got = sorted_by_instance <sorted_vector_with_key <keyed, int> > (k);
+    std::vector <keyed> expected = stable_sorted(k);
+    EXPECT_TRUE(std::equal(got.begin(), got.end(), expected.begin()));
+    if (  (runs <= CIM_SORTED_VECTOR_SORT_RUNS)
+        ||(k.size() >= CIM_SORTED_VECTOR_RADIX_SORT)) {
+      EXPECT_EQ(payloads(got), payloads(expected));
+    }
+  }
+}
+
+TEST(Sort, RadixSignedKeys)
+{
+  std::mt19937_64 g(2);
+  for (size_t n : {(size_t)CIM_SORTED_VECTOR_RADIX_SORT - 1, (size_t)CIM_SORTED_VECTOR_RADIX_SORT, (size_t)100000}) {
+    std::vector <int8_t> i8(n);
+    std::vector <int16_t> i16(n);
+    std::vector <int> i32(n);
+    std::vector <long long> i64(n);
+    std::vector <unsigned long long> u64(n);
+    for (size_t i = 0; i < n; i++) {
+      i8[i] = (int8_t)g();
+      i16[i] = (int16_t)g();
+      i32[i] = (int)g();
+      i64[i] = (long long)g() >> (g() % 64);
+      u64[i] = g() >> (g() % 64);
+    }
+    i32[0] = INT32_MIN;
+    i32[1] = INT32_MAX;
+    i64[0] = INT64_MIN;
+    i64[1] = INT64_MAX;
+    EXPECT_EQ((sorted_by_instance <sorted_vector <int8_t> > (i8)), stable_sorted(i8));
+    EXPECT_EQ((sorted_by_instance <sorted_vector <int16_t> > (i16)), stable_sorted(i16));
+    EXPECT_EQ((sorted_by_instance <sorted_vector <int> > (i32)), stable_sorted(i32));
+    EXPECT_EQ((sorted_by_instance <sorted_vector <long long> > (i64)), stable_sorted(i64));
+    EXPECT_EQ((sorted_by_instance <sorted_vector <unsigned long long> > (u64)), stable_sorted(u64));
+
+    //Все значения равны в старших разрядах: такие
+    //разряды пропускаются
+    std::vector <int> small(n);
+    for (size_t i = 0; i < n; i++)
+      small[i] = (int)(g() % 100) - 50;
+    EXPECT_EQ((sorted_by_instance <sorted_vector <int> > (small)), stable_sorted(small));
+  }
+}
+
+TEST(Sort, RadixWithKey)
+{
+  //Поразрядная сортировка записей по ключу устойчива
+  std::mt19937_64 g(3);
+  for (size_t n : {(size_t)CIM_SORTED_VECTOR_RADIX_SORT, (size_t)50000}) {
+    std::vector <keyed> k(n);
+    for (size_t i = 0; i < n; i++)
+      k[i] = keyed{(int)(g() % 2000) - 1000, (int)i};
+    k[0]._key = INT32_MIN;
+    k[1]._key = INT32_MAX;
+    std::vector <keyed> expected = stable_sorted(k);
+    std::vector <keyed> got = sorted_by_instance <sorted_vector_with_key <keyed, int> > (k);
+    ASSERT_EQ(got.size(), expected.size());
+    EXPECT_EQ(payloads(got), payloads(expected));
+  }
+}
+
+TEST(Sort, RadixWithKeyConstructor)
+{
+  //Конструкторы sorted_vector_with_key сортируют
+  //собственным (поразрядным и устойчивым) порядком
+  std::mt19937_64 g(4);
+  std::vector <keyed> k(50000);
+  for (size_t i = 0; i < k.size(); i++)
+    k[i] = keyed{(int)(g() % 2000) - 1000, (int)i};
+  std::vector <keyed> expected = stable_sorted(k);
+
+  const sorted_vector_with_key <keyed, int> copied(k);
+  EXPECT_FALSE(copied.corrupted());
+  EXPECT_EQ(payloads(std::vector <keyed> (copied.data(), copied.data() + copied.size())), payloads(expected));
+
+  std::vector <keyed> tmp(k);
+  const sorted_vector_with_key <keyed, int> moved(static_cast <std::vector <keyed> &&> (tmp));
+  EXPECT_FALSE(moved.corrupted());
+  EXPECT_EQ(payloads(std::vector <keyed> (moved.data(), moved.data() + moved.size())), payloads(expected));
+}
@@ -0,0 +1,154 @@
+#include "sorted_vector.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+//Собирается только в программе с CIM_SORTED_VECTOR_STATS
+#ifndef CIM_SORTED_VECTOR_STATS
+# error "stats_test.cpp requires CIM_SORTED_VECTOR_STATS"
+#endif
+
+using namespace cim;
+
+namespace {
+
+sorted_vector <int> ascending(int n)
+{
+  std::vector <int> v;
+  for (int i = 0; i < n; i++)
+    v.push_back(i * 10);
+  sorted_vector <int> sv;
+  sv.assign_sorted(static_cast <std::vector <int> &&> (v));
+  sv.reset_stats();
+  return sv;
+}
+
+} // namespace
+
+TEST(Stats, MovedByPushAndErase)
+{
+  sorted_vector <int> sv = ascending(10);
+  sv.push(1000);
+  EXPECT_EQ(sv.stats().moved, 0u);
+
+  //Вставка перед последним элементом сдвигает один
+  sv.push(995);
+  EXPECT_EQ(sv.stats().moved, 1u);
+
+  //Удаление второго элемента сдвигает первый
+  //(ближнюю часть) смещением начала хранилища
+  sv.erase((size_t)1);
+  EXPECT_EQ(sv.stats().moved, 2u);
+  EXPECT_EQ(sv.stats().full_sorts, 0u);
+  EXPECT_EQ(sv.stats().repairs, 0u);
+}
+
+TEST(Stats, Searches)
+{
+  sorted_vector <int> sv = ascending(1000);
+  const sorted_vector <int> &c = sv;
+
+  EXPECT_EQ(c.find(500), 50u);
+  sorted_vector_stats st = c.stats();
+  EXPECT_EQ(st.searches, 1u);
+  EXPECT_GE(st.probes, 1u);
+  EXPECT_LE(st.probes, 11u);
+
+  c.find_floor(505);
+  c.find_ceil(505);
+  c.find_interpolated(500);
+  st = c.stats();
+  EXPECT_EQ(st.searches, 4u);
+  EXPECT_EQ(st.linear_searches, 0u);
+
+  sv.set_search_strategy(search_interpolation);
+  EXPECT_EQ(c.find(990), 99u);
+  EXPECT_EQ(c.stats().searches, 5u);
+}
+
+TEST(Stats, LinearSearchesWhenCorrupted)
+{
+  sorted_vector <int> sv = ascending(100);
+  const sorted_vector <int> &c = sv;
+  sv.storage()[0] = 5000;
+  ASSERT_TRUE(c.corrupted());
+
+  //Константный поиск не исправляет экземпляр
+  EXPECT_EQ(c.find(5000), 0u);
+  EXPECT_EQ(c.find_first(10), 1u);
+  EXPECT_EQ(c.find_last(10), 1u);
+  sorted_vector_stats st = c.stats();
+  EXPECT_EQ(st.linear_searches, 3u);
+  EXPECT_EQ(st.searches, 0u);
+  EXPECT_EQ(st.full_sorts, 0u);
+}
+
+TEST(Stats, FullSortsAndRepairs)
+{
+  sorted_vector <int> sv = ascending(100);
+
+  //Изменение одного элемента восстанавливается
+  //перемещением его на место
+  sv[10] = 555;
+  sv.repair();
+  sorted_vector_stats st = sv.stats();
+  EXPECT_EQ(st.repairs, 1u);
+  EXPECT_EQ(st.full_sorts, 0u);
+  EXPECT_EQ(st.moved, 45u);
+  EXPECT_FALSE(sv.corrupted());
+
+  //Изменение неизвестных элементов - полной сортировкой
+  std::vector <int> &storage = sv.storage();
+  storage[0] = 2000;
+  storage[1] = -5;
+  sv.repair();
+  st = sv.stats();
+  EXPECT_EQ(st.repairs, 1u);
+  EXPECT_EQ(st.full_sorts, 1u);
+
+  sv.sort();
+  EXPECT_EQ(sv.stats().full_sorts, 2u);
+}
+
+TEST(Stats, Reallocations)
+{
+  sorted_vector <int> sv;
+  sv.reserve(4);
+  sv.reset_stats();
+  for (int i = 0; i < 4; i++)
+    sv.push(i);
+  EXPECT_EQ(sv.stats().reallocations, 0u);
+  sv.push(4);
+  EXPECT_EQ(sv.stats().reallocations, 1u);
+}
+
+TEST(Stats, ResetStats)
+{
+  sorted_vector <int> sv = ascending(50);
+  const sorted_vector <int> &c = sv;
+  sv.push(5);
+  sv.storage()[3] = 1000;
+  c.find(1000);
+  sv.repair();
+  c.find(7);
+  sv.shrink_to_fit();
+  sv.push(1);
+  sorted_vector_stats st = sv.stats();
+  EXPECT_GT(st.moved, 0u);
+  EXPECT_GT(st.searches, 0u);
+  EXPECT_GT(st.probes, 0u);
+  EXPECT_GT(st.linear_searches, 0u);
+  EXPECT_GT(st.full_sorts, 0u);
+  EXPECT_GT(st.reallocations, 0u);
+
+  sv.reset_stats();
+  st = sv.stats();
+  EXPECT_EQ(st.full_sorts, 0u);
+  EXPECT_EQ(st.repairs, 0u);
+  EXPECT_EQ(st.moved, 0u);
+  EXPECT_EQ(st.searches, 0u);
+  EXPECT_EQ(st.probes, 0u);
+  EXPECT_EQ(st.linear_searches, 0u);
+  EXPECT_EQ(st.reallocations, 0u);
+}
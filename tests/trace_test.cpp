@@ -0,0 +1,145 @@
+#include "sorted_vector.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+//Собирается только в программе с CIM_SORTED_VECTOR_TRACE
+#ifndef CIM_SORTED_VECTOR_TRACE
+# error "trace_test.cpp requires CIM_SORTED_VECTOR_TRACE"
+#endif
+
+using namespace cim;
+
+namespace {
+
+std::vector <sorted_vector_trace> traces;
+
+void collect(const sorted_vector_trace &trace)
+{
+  traces.push_back(trace);
+}
+
+} // namespace
+
+TEST(Trace, BucketBounds)
+{
+  for (uint64_t ns = 0; ns < 8; ns++)
+    EXPECT_EQ(latency_histogram::bucket_of(ns), (size_t)ns);
+  EXPECT_EQ(latency_histogram::bucket_of(8), 8u);
+  EXPECT_EQ(latency_histogram::bucket_of(15), 15u);
+  EXPECT_EQ(latency_histogram::bucket_of(16), 16u);
+  EXPECT_EQ(latency_histogram::bucket_of(17), 16u);
+  EXPECT_EQ(latency_histogram::bucket_of(UINT64_MAX), (size_t)latency_histogram::buckets - 1);
+
+  //Значение лежит в границах своей корзины, корзины
+  //идут подряд, погрешность не больше 12.5%
+  std::mt19937_64 g(1);
+  for (int i = 0; i < 100000; i++) {
+    uint64_t ns = g() >> (g() % 64);
+    size_t b = latency_histogram::bucket_of(ns);
+    ASSERT_LT(b, (size_t)latency_histogram::buckets);
+    ASSERT_LE(latency_histogram::lower_bound(b), ns);
+    ASSERT_GE(latency_histogram::upper_bound(b), ns);
+    ASSERT_LE(latency_histogram::upper_bound(b) - latency_histogram::lower_bound(b),
+              latency_histogram::lower_bound(b) / 8);
+  }
+  for (size_t b = 1; b < latency_histogram::buckets; b++)
+    ASSERT_EQ(latency_histogram::lower_bound(b), latency_histogram::upper_bound(b - 1) + 1);
+}
+
+TEST(Trace, Percentile)
+{
+  latency_histogram h;
+  EXPECT_EQ(h.percentile(0.5), 0u);
+  EXPECT_EQ(h.max(), 0u);
+
+  for (uint64_t ns = 1; ns <= 100; ns++)
+    h.record(ns);
+  EXPECT_EQ(h.count(), 100u);
+  EXPECT_EQ(h.percentile(0.0), 1u);
+  EXPECT_EQ(h.percentile(0.05), 6u);
+  EXPECT_EQ(h.percentile(0.5), latency_histogram::upper_bound(latency_histogram::bucket_of(51)));
+  EXPECT_EQ(h.percentile(1.0), h.max());
+  EXPECT_EQ(h.max(), latency_histogram::upper_bound(latency_histogram::bucket_of(100)));
+
+  latency_histogram big;
+  big.record(1000000, 900);
+  h.add(big);
+  EXPECT_EQ(h.count(), 1000u);
+  EXPECT_EQ(h.bucket(latency_histogram::bucket_of(1000000)), 900u);
+  EXPECT_EQ(h.percentile(0.05), latency_histogram::upper_bound(latency_histogram::bucket_of(51)));
+  EXPECT_EQ(h.percentile(0.5), latency_histogram::upper_bound(latency_histogram::bucket_of(1000000)));
+}
+
+TEST(Trace, LatencyPerOperation)
+{
+  sorted_vector <int> sv;
+  const sorted_vector <int> &c = sv;
+  sorted_vector_latency_reset();
+  for (int i = 0; i < 100; i++)
+    sv.push(i);
+  //find_first вызывает find: замеряется один раз
+  for (int i = 0; i < 50; i++)
+    c.find_first(i);
+  sv.erase((size_t)0);
+  EXPECT_EQ(sorted_vector_latency(latency_push).count(), 100u);
+  EXPECT_EQ(sorted_vector_latency(latency_find).count(), 50u);
+  EXPECT_EQ(sorted_vector_latency(latency_erase).count(), 1u);
+  EXPECT_EQ(sorted_vector_latency(latency_sort).count(), 0u);
+
+  //Замеры завершившегося потока сохраняются
+  std::thread t([&c]() {
+    for (int i = 0; i < 30; i++)
+      c.find(i);
+  });
+  t.join();
+  EXPECT_EQ(sorted_vector_latency(latency_find).count(), 80u);
+
+  sorted_vector_latency_enable(false);
+  c.find(1);
+  sv.push(5);
+  sorted_vector_latency_enable(true);
+  EXPECT_EQ(sorted_vector_latency(latency_find).count(), 80u);
+  EXPECT_EQ(sorted_vector_latency(latency_push).count(), 100u);
+
+  sorted_vector_latency_reset();
+  EXPECT_EQ(sorted_vector_latency(latency_find).count(), 0u);
+  EXPECT_EQ(sorted_vector_latency(latency_push).count(), 0u);
+}
+
+TEST(Trace, CallbackOnRepairSort)
+{
+  sorted_vector <int> sv;
+  for (int i = 0; i < 1000; i++)
+    sv.push(i);
+  traces.clear();
+  set_sorted_vector_trace_callback(collect);
+
+  //Восстановление одного элемента - без полной сортировки
+  sv[10] = 500;
+  sv.repair();
+  EXPECT_TRUE(traces.empty());
+
+  sorted_vector_latency_reset();
+  std::vector <int> &storage = sv.storage();
+  storage[0] = 2000;
+  storage[999] = -1;
+  sv.repair();
+  ASSERT_EQ(traces.size(), 1u);
+  EXPECT_EQ(traces[0].event, trace_repair_sort);
+  EXPECT_EQ(traces[0].instance, (const void *)&sv);
+  EXPECT_EQ(traces[0].size, 1000u);
+  EXPECT_EQ(sorted_vector_latency(latency_sort).count(), 1u);
+  EXPECT_EQ(sorted_vector_latency(latency_repair).count(), 1u);
+  EXPECT_FALSE(sv.corrupted());
+
+  //Явная сортировка не вызывает функцию трассировки
+  sv.sort();
+  set_sorted_vector_trace_callback(nullptr);
+  sv.storage()[0] = 3000;
+  sv.repair();
+  EXPECT_EQ(traces.size(), 1u);
+}
@@ -0,0 +1,75 @@
+#include "sorted_vector.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace cim;
+
+namespace {
+
+void expect_lookups(const sorted_window <long> &w, const std::vector <long> &m, long t)
+{
+  size_t lo = std::lower_bound(m.begin(), m.end(), t) - m.begin();
+  size_t hi = std::upper_bound(m.begin(), m.end(), t) - m.begin();
+  EXPECT_EQ(w.rank(t), lo);
+  EXPECT_EQ(w.contains(t), lo < hi);
+  EXPECT_EQ(w.find_first(t), lo < hi ? lo : (size_t)-1);
+  EXPECT_EQ(w.find_last(t), lo < hi ? hi - 1 : (size_t)-1);
+  EXPECT_EQ(w.find_floor(t), lo < hi ? lo : (lo == 0 ? (size_t)-1 : lo - 1));
+  EXPECT_EQ(w.find_ceil(t), lo < hi ? hi - 1 : (hi == m.size() ? (size_t)-1 : hi));
+  size_t last = std::upper_bound(m.begin(), m.end(), t + 3) - m.begin();
+  EXPECT_EQ(w.count_range(t, t + 3), last - lo);
+}
+
+} // namespace
+
+TEST(Window, EvictsSmallest)
+{
+  //Отметки времени, иногда приходящие с опозданием;
+  //при переполнении вытесняются самые старые
+  std::mt19937_64 g(1);
+  sorted_window <long> w(500);
+  std::vector <long> m;
+  long now = 0;
+  for (int i = 0; i < 10000; i++) {
+    now += (long)(g() % 3);
+    long t = (g() % 10 == 0) ? now - (long)(g() % 50) : now;
+    w.push(t);
+    m.insert(std::upper_bound(m.begin(), m.end(), t), t);
+    if (m.size() > 500)
+      m.erase(m.begin());
+    ASSERT_EQ(w.size(), m.size());
+    if (i % 100 == 0) {
+      EXPECT_TRUE(std::equal(w.begin(), w.end(), m.begin()));
+      for (long t2 = now - 520; t2 <= now + 2; t2 += 3)
+        expect_lookups(w, m, t2);
+    }
+  }
+}
+
+TEST(Window, Trim)
+{
+  sorted_window <long> w;
+  std::vector <long> m;
+  for (long i = 0; i < 1000; i++) {
+    w.push(i * 2);
+    m.push_back(i * 2);
+  }
+  EXPECT_EQ(w.trim_before(301), 151u);
+  m.erase(m.begin(), m.begin() + 151);
+  EXPECT_EQ(w.trim_front(10), 10u);
+  m.erase(m.begin(), m.begin() + 10);
+  EXPECT_EQ(w.front(), m.front());
+  for (long t = 290; t < 2010; t += 7)
+    expect_lookups(w, m, t);
+
+  w.set_max_size(100);
+  EXPECT_EQ(w.size(), 100u);
+  EXPECT_EQ(w.front(), 1800);
+  EXPECT_EQ(w.trim_front(1000), 100u);
+  EXPECT_TRUE(w.empty());
+  expect_lookups(w, std::vector <long> (), 5);
+}